@@ -0,0 +1,587 @@
+/**
+ * @file opatioBindings.cpp
+ * @brief Python bindings exposing libopatio (OPAT, DataCard, OPATTable and TableLattice) to Python.
+ *
+ * The extension module is called `opatio_native`. It is written against the CPython and NumPy C APIs,
+ * so building it needs only the headers of Python and NumPy. Tables are returned as read-only NumPy
+ * arrays which share the C++ buffers; the array keeps its owning table (and therefore the owning card
+ * and OPAT object) alive, so no data is copied when moving between C++ and Python.
+ *
+ * **Example:**
+ * @code{.py}
+ * import numpy as np
+ * import opatio_native as on
+ *
+ * opat = on.read_opat("gs98hz.opat")
+ * table = opat[(0.35, 0.004)]["data"]
+ * print(table.data.shape, table.data.flags.owndata)  # (19, 70) False
+ *
+ * lattice = on.TableLattice(opat)
+ * points = np.array([[0.275, 0.07], [0.54421, 0.077585]])
+ * interpolated = lattice.get_batch(points, "data")   # shape (2, 19, 70)
+ * @endcode
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+#include "tableLattice.h"
+
+namespace {
+    // Thrown once a Python exception has been set, to unwind back to the binding which returns to Python
+    struct PythonError {};
+
+    // Runs `body`, turning C++ exceptions into the Python exceptions callers of the module expect
+    // (std::out_of_range is an IndexError, invalid arguments a ValueError, anything else a RuntimeError)
+    template <typename Body>
+    PyObject* guarded(Body&& body) {
+        try {
+            return body();
+        } catch (const PythonError&) {
+        } catch (const std::bad_alloc&) {
+            PyErr_NoMemory();
+        } catch (const std::out_of_range& e) {
+            PyErr_SetString(PyExc_IndexError, e.what());
+        } catch (const std::invalid_argument& e) {
+            PyErr_SetString(PyExc_ValueError, e.what());
+        } catch (const std::length_error& e) {
+            PyErr_SetString(PyExc_ValueError, e.what());
+        } catch (const std::exception& e) {
+            PyErr_SetString(PyExc_RuntimeError, e.what());
+        }
+        return nullptr;
+    }
+
+    PyObject* check(PyObject* object) {
+        if (object == nullptr) {
+            throw PythonError{};
+        }
+        return object;
+    }
+
+    // Python objects are allocated by the interpreter, so C++ members are constructed in place and destroyed in tp_dealloc
+    struct PyHeader {
+        PyObject_HEAD
+        opat::Header header;
+    };
+
+    struct PyOPAT {
+        PyObject_HEAD
+        std::shared_ptr<opat::OPAT> opat;
+    };
+
+    struct PyDataCard {
+        PyObject_HEAD
+        std::shared_ptr<const opat::DataCard> card;
+        PyObject* owner; ///< Keeps a card which does not own itself (an eagerly loaded card) alive; may be null.
+    };
+
+    struct PyOPATTable {
+        PyObject_HEAD
+        const opat::OPATTable* table;
+        PyObject* owner; ///< The DataCard object which holds the table.
+    };
+
+    struct PyTableLattice {
+        PyObject_HEAD
+        std::unique_ptr<opat::lattice::TableLattice> lattice;
+        PyObject* opat; ///< The lattice keeps a reference to the OPAT object, so the OPAT must outlive it.
+    };
+
+    PyTypeObject* HeaderType = nullptr;
+    PyTypeObject* OPATType = nullptr;
+    PyTypeObject* DataCardType = nullptr;
+    PyTypeObject* OPATTableType = nullptr;
+    PyTypeObject* TableLatticeType = nullptr;
+
+    template <typename Object>
+    Object* allocate(PyTypeObject* type) {
+        return reinterpret_cast<Object*>(check(type->tp_alloc(type, 0)));
+    }
+
+    template <typename Object>
+    void deallocate(PyObject* self) {
+        PyTypeObject* type = Py_TYPE(self);
+        reinterpret_cast<Object*>(self)->~Object();
+        type->tp_free(self);
+        Py_DECREF(type); // Heap types are referenced by their instances
+    }
+
+    // Objects are only created by the module, so Python code cannot make one without its C++ counterpart
+    PyObject* notConstructible(PyTypeObject* type, PyObject*, PyObject*) {
+        PyErr_Format(PyExc_TypeError, "cannot create '%s' instances", type->tp_name);
+        return nullptr;
+    }
+
+    std::vector<double> toVector(PyObject* sequence, const char* what) {
+        PyObject* fast = PySequence_Fast(sequence, what);
+        if (fast == nullptr) {
+            throw PythonError{};
+        }
+        std::vector<double> values(PySequence_Fast_GET_SIZE(fast));
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            values[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(fast, i));
+        }
+        Py_DECREF(fast);
+        if (PyErr_Occurred()) {
+            throw PythonError{};
+        }
+        return values;
+    }
+
+    std::string toString(PyObject* object) {
+        Py_ssize_t length = 0;
+        const char* data = PyUnicode_AsUTF8AndSize(object, &length);
+        if (data == nullptr) {
+            throw PythonError{};
+        }
+        return {data, static_cast<std::size_t>(length)};
+    }
+
+    std::string fixedString(const char* str, std::size_t maxLength) {
+        return {str, strnlen(str, maxLength)};
+    }
+
+    // Builds a read-only NumPy view over `data` whose lifetime is tied to the Python object `owner`
+    PyObject* makeView(const double* data, std::vector<npy_intp> shape, PyObject* owner) {
+        PyObject* view = check(PyArray_New(&PyArray_Type, static_cast<int>(shape.size()), shape.data(), NPY_DOUBLE, nullptr,
+                                           const_cast<double*>(data), 0, NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED, nullptr));
+        Py_INCREF(owner);
+        if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(view), owner) < 0) {
+            Py_DECREF(view);
+            throw PythonError{};
+        }
+        return view;
+    }
+
+    // Shape of the data array of a table: (N_R, N_C) for scalar cells, (N_R, N_C, vsize) otherwise
+    std::vector<npy_intp> tableShape(uint32_t numRows, uint32_t numColumns, uint64_t vsize) {
+        if (vsize == 1) {
+            return {static_cast<npy_intp>(numRows), static_cast<npy_intp>(numColumns)};
+        }
+        return {static_cast<npy_intp>(numRows), static_cast<npy_intp>(numColumns), static_cast<npy_intp>(vsize)};
+    }
+
+    std::vector<npy_intp> tableShape(const opat::OPATTable& table) {
+        return tableShape(table.N_R, table.N_C, table.m_vsize);
+    }
+
+    PyObject* newTable(const opat::OPATTable& table, PyObject* card) {
+        auto* self = allocate<PyOPATTable>(OPATTableType);
+        self->table = &table;
+        Py_INCREF(card);
+        self->owner = card;
+        return reinterpret_cast<PyObject*>(self);
+    }
+
+    PyObject* newCard(std::shared_ptr<const opat::DataCard> card, PyObject* owner) {
+        auto* self = allocate<PyDataCard>(DataCardType);
+        new (&self->card) std::shared_ptr<const opat::DataCard>(std::move(card));
+        Py_XINCREF(owner);
+        self->owner = owner;
+        return reinterpret_cast<PyObject*>(self);
+    }
+
+    // ---- Header ------------------------------------------------------------------------------------
+    // Header is a packed struct, so its fields are returned by value rather than bound by reference
+
+    const opat::Header& headerOf(PyObject* self) {
+        return reinterpret_cast<PyHeader*>(self)->header;
+    }
+
+    PyGetSetDef headerGetSet[] = {
+        {"magic", [](PyObject* self, void*) { const auto& h = headerOf(self); return PyUnicode_FromString(fixedString(h.magic, sizeof(h.magic)).c_str()); }, nullptr, nullptr, nullptr},
+        {"version", [](PyObject* self, void*) { return PyLong_FromUnsignedLong(headerOf(self).version); }, nullptr, nullptr, nullptr},
+        {"numTables", [](PyObject* self, void*) { return PyLong_FromUnsignedLong(headerOf(self).numTables); }, nullptr, nullptr, nullptr},
+        {"headerSize", [](PyObject* self, void*) { return PyLong_FromUnsignedLong(headerOf(self).headerSize); }, nullptr, nullptr, nullptr},
+        {"indexOffset", [](PyObject* self, void*) { return PyLong_FromUnsignedLongLong(headerOf(self).indexOffset); }, nullptr, nullptr, nullptr},
+        {"creationDate", [](PyObject* self, void*) { const auto& h = headerOf(self); return PyUnicode_FromString(fixedString(h.creationDate, sizeof(h.creationDate)).c_str()); }, nullptr, nullptr, nullptr},
+        {"sourceInfo", [](PyObject* self, void*) { const auto& h = headerOf(self); return PyUnicode_FromString(fixedString(h.sourceInfo, sizeof(h.sourceInfo)).c_str()); }, nullptr, nullptr, nullptr},
+        {"comment", [](PyObject* self, void*) { const auto& h = headerOf(self); return PyUnicode_FromString(fixedString(h.comment, sizeof(h.comment)).c_str()); }, nullptr, nullptr, nullptr},
+        {"numIndex", [](PyObject* self, void*) { return PyLong_FromUnsignedLong(headerOf(self).numIndex); }, nullptr, nullptr, nullptr},
+        {"hashPrecision", [](PyObject* self, void*) { return PyLong_FromUnsignedLong(headerOf(self).hashPrecision); }, nullptr, nullptr, nullptr},
+        {"merkleRoot", [](PyObject* self, void*) { return PyLong_FromUnsignedLongLong(headerOf(self).merkleRoot); }, nullptr, nullptr, nullptr},
+        {nullptr, nullptr, nullptr, nullptr, nullptr}
+    };
+
+    PyType_Slot headerSlots[] = {
+        {Py_tp_new, reinterpret_cast<void*>(notConstructible)},
+        {Py_tp_dealloc, reinterpret_cast<void*>(deallocate<PyHeader>)},
+        {Py_tp_getset, headerGetSet},
+        {0, nullptr}
+    };
+
+    // ---- OPATTable ---------------------------------------------------------------------------------
+
+    const opat::OPATTable& tableOf(PyObject* self) {
+        return *reinterpret_cast<PyOPATTable*>(self)->table;
+    }
+
+    void deallocateTable(PyObject* self) {
+        Py_DECREF(reinterpret_cast<PyOPATTable*>(self)->owner);
+        deallocate<PyOPATTable>(self);
+    }
+
+    PyGetSetDef tableGetSet[] = {
+        {"data", [](PyObject* self, void*) {
+            return guarded([&] { return makeView(tableOf(self).data.get(), tableShape(tableOf(self)), self); });
+        }, nullptr, "Read-only view of the table data, shape (N_R, N_C) or (N_R, N_C, vsize).", nullptr},
+        {"rowValues", [](PyObject* self, void*) {
+            return guarded([&] { return makeView(tableOf(self).rowValues.get(), {static_cast<npy_intp>(tableOf(self).N_R)}, self); });
+        }, nullptr, nullptr, nullptr},
+        {"columnValues", [](PyObject* self, void*) {
+            return guarded([&] { return makeView(tableOf(self).columnValues.get(), {static_cast<npy_intp>(tableOf(self).N_C)}, self); });
+        }, nullptr, nullptr, nullptr},
+        {"shape", [](PyObject* self, void*) {
+            return Py_BuildValue("(kk)", static_cast<unsigned long>(tableOf(self).N_R), static_cast<unsigned long>(tableOf(self).N_C));
+        }, nullptr, nullptr, nullptr},
+        {"vsize", [](PyObject* self, void*) { return PyLong_FromUnsignedLongLong(tableOf(self).vsize()); }, nullptr, nullptr, nullptr},
+        {nullptr, nullptr, nullptr, nullptr, nullptr}
+    };
+
+    PyObject* tableRepr(PyObject* self) {
+        const opat::OPATTable& table = tableOf(self);
+        return PyUnicode_FromString(("OPATTable(N_R: " + std::to_string(table.N_R) + ", N_C: " + std::to_string(table.N_C) + ")").c_str());
+    }
+
+    PyType_Slot tableSlots[] = {
+        {Py_tp_new, reinterpret_cast<void*>(notConstructible)},
+        {Py_tp_dealloc, reinterpret_cast<void*>(deallocateTable)},
+        {Py_tp_getset, tableGetSet},
+        {Py_tp_repr, reinterpret_cast<void*>(tableRepr)},
+        {0, nullptr}
+    };
+
+    // ---- DataCard ----------------------------------------------------------------------------------
+
+    const opat::DataCard& cardOf(PyObject* self) {
+        return *reinterpret_cast<PyDataCard*>(self)->card;
+    }
+
+    void deallocateCard(PyObject* self) {
+        Py_XDECREF(reinterpret_cast<PyDataCard*>(self)->owner);
+        deallocate<PyDataCard>(self);
+    }
+
+    PyObject* cardGet(PyObject* self, PyObject* tag) {
+        return guarded([&] { return newTable(cardOf(self).get(toString(tag)), self); });
+    }
+
+    PyMethodDef cardMethods[] = {
+        {"keys", [](PyObject* self, PyObject*) {
+            return guarded([&] {
+                const std::vector<std::string> keys = cardOf(self).getKeys();
+                PyObject* list = check(PyList_New(static_cast<Py_ssize_t>(keys.size())));
+                for (std::size_t i = 0; i < keys.size(); ++i) {
+                    PyObject* key = PyUnicode_FromString(keys[i].c_str());
+                    if (key == nullptr) {
+                        Py_DECREF(list);
+                        throw PythonError{};
+                    }
+                    PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), key);
+                }
+                return list;
+            });
+        }, METH_NOARGS, "Tags of the tables in the card."},
+        {"get", cardGet, METH_O, "The table `tag` of the card."},
+        {nullptr, nullptr, 0, nullptr}
+    };
+
+    PyType_Slot cardSlots[] = {
+        {Py_tp_new, reinterpret_cast<void*>(notConstructible)},
+        {Py_tp_dealloc, reinterpret_cast<void*>(deallocateCard)},
+        {Py_tp_methods, cardMethods},
+        {Py_mp_subscript, reinterpret_cast<void*>(cardGet)},
+        {Py_mp_length, reinterpret_cast<void*>(+[](PyObject* self) -> Py_ssize_t {
+            return static_cast<Py_ssize_t>(cardOf(self).tableIndex.tableIndex.size());
+        })},
+        {Py_sq_contains, reinterpret_cast<void*>(+[](PyObject* self, PyObject* tag) -> int {
+            if (!PyUnicode_Check(tag)) {
+                return 0;
+            }
+            PyObject* found = guarded([&] { return PyBool_FromLong(cardOf(self).tableIndex.tableIndex.contains(toString(tag))); });
+            if (found == nullptr) {
+                return -1;
+            }
+            const int result = found == Py_True;
+            Py_DECREF(found);
+            return result;
+        })},
+        {0, nullptr}
+    };
+
+    // ---- OPAT --------------------------------------------------------------------------------------
+
+    const opat::OPAT& opatOf(PyObject* self) {
+        return *reinterpret_cast<PyOPAT*>(self)->opat;
+    }
+
+    FloatIndexVector toIndexVector(const opat::OPAT& opat, PyObject* index) {
+        return {toVector(index, "index must be a sequence of numbers"), opat.header.hashPrecision};
+    }
+
+    PyObject* opatGet(PyObject* self, PyObject* index) {
+        // acquire rather than get, so that lazily loaded cards are held by the Python object instead of
+        // being pinned for the lifetime of the OPAT; eager cards are kept alive through `self`
+        return guarded([&] { return newCard(opatOf(self).acquire(toIndexVector(opatOf(self), index)), self); });
+    }
+
+    PyMethodDef opatMethods[] = {
+        {"get", opatGet, METH_O, "The card at `index`."},
+        {"index_vectors", [](PyObject* self, PyObject*) {
+            return guarded([&] {
+                const opat::OPAT& opat = opatOf(self);
+                npy_intp shape[] = {static_cast<npy_intp>(opat.cardCatalog.tableIndex.size()), static_cast<npy_intp>(opat.header.numIndex)};
+                PyObject* out = check(PyArray_SimpleNew(2, shape, NPY_DOUBLE));
+                auto* data = static_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(out)));
+                for (const auto& iv : opat.cardCatalog.tableIndex | std::views::keys) {
+                    for (int dim = 0; dim < opat.header.numIndex; ++dim) {
+                        *data++ = iv[dim];
+                    }
+                }
+                return out;
+            });
+        }, METH_NOARGS, "Index vectors of every card as an array of shape (numCards, numIndex)."},
+        {"bounds", [](PyObject* self, PyObject*) {
+            return guarded([&] {
+                const std::vector<opat::Bounds> bounds = opatOf(self).getBounds();
+                PyObject* list = check(PyList_New(static_cast<Py_ssize_t>(bounds.size())));
+                for (std::size_t i = 0; i < bounds.size(); ++i) {
+                    PyObject* pair = Py_BuildValue("(dd)", bounds[i].min, bounds[i].max);
+                    if (pair == nullptr) {
+                        Py_DECREF(list);
+                        throw PythonError{};
+                    }
+                    PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), pair);
+                }
+                return list;
+            });
+        }, METH_NOARGS, "(min, max) of every index dimension."},
+        {nullptr, nullptr, 0, nullptr}
+    };
+
+    PyGetSetDef opatGetSet[] = {
+        {"header", [](PyObject* self, void*) {
+            return guarded([&] {
+                auto* header = allocate<PyHeader>(HeaderType);
+                header->header = opatOf(self).header;
+                return reinterpret_cast<PyObject*>(header);
+            });
+        }, nullptr, nullptr, nullptr},
+        {nullptr, nullptr, nullptr, nullptr, nullptr}
+    };
+
+    PyType_Slot opatSlots[] = {
+        {Py_tp_new, reinterpret_cast<void*>(notConstructible)},
+        {Py_tp_dealloc, reinterpret_cast<void*>(deallocate<PyOPAT>)},
+        {Py_tp_methods, opatMethods},
+        {Py_tp_getset, opatGetSet},
+        {Py_mp_subscript, reinterpret_cast<void*>(opatGet)},
+        {Py_mp_length, reinterpret_cast<void*>(+[](PyObject* self) -> Py_ssize_t {
+            return static_cast<Py_ssize_t>(opatOf(self).cardCatalog.tableIndex.size());
+        })},
+        {Py_sq_contains, reinterpret_cast<void*>(+[](PyObject* self, PyObject* index) -> int {
+            PyObject* found = guarded([&] {
+                return PyBool_FromLong(opatOf(self).cardCatalog.tableIndex.contains(toIndexVector(opatOf(self), index)));
+            });
+            if (found == nullptr) {
+                return -1;
+            }
+            const int result = found == Py_True;
+            Py_DECREF(found);
+            return result;
+        })},
+        {0, nullptr}
+    };
+
+    // ---- TableLattice ------------------------------------------------------------------------------
+
+    const opat::lattice::TableLattice& latticeOf(PyObject* self) {
+        return *reinterpret_cast<PyTableLattice*>(self)->lattice;
+    }
+
+    PyObject* latticeNew(PyTypeObject* type, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = {"opat", nullptr};
+        PyObject* opat = nullptr;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!", const_cast<char**>(keywords), OPATType, &opat)) {
+            return nullptr;
+        }
+        return guarded([&] {
+            auto lattice = std::make_unique<opat::lattice::TableLattice>(opatOf(opat));
+            auto* self = allocate<PyTableLattice>(type);
+            new (&self->lattice) std::unique_ptr<opat::lattice::TableLattice>(std::move(lattice));
+            Py_INCREF(opat);
+            self->opat = opat;
+            return reinterpret_cast<PyObject*>(self);
+        });
+    }
+
+    void deallocateLattice(PyObject* self) {
+        auto* lattice = reinterpret_cast<PyTableLattice*>(self);
+        lattice->lattice.reset();
+        Py_XDECREF(lattice->opat);
+        deallocate<PyTableLattice>(self);
+    }
+
+    PyObject* latticeGet(PyObject* self, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = {"point", nullptr};
+        PyObject* point = nullptr;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", const_cast<char**>(keywords), &point)) {
+            return nullptr;
+        }
+        return guarded([&] {
+            const opat::lattice::TableLattice& lattice = latticeOf(self);
+            const FloatIndexVector index(toVector(point, "point must be a sequence of numbers"), lattice.getOPAT().header.hashPrecision);
+            return newCard(std::make_shared<const opat::DataCard>(lattice.get(index)), nullptr);
+        });
+    }
+
+    PyObject* latticeGetBatch(PyObject* self, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = {"points", "tag", nullptr};
+        PyObject* pointsArgument = nullptr;
+        const char* tagArgument = nullptr;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Os", const_cast<char**>(keywords), &pointsArgument, &tagArgument)) {
+            return nullptr;
+        }
+        PyObject* points = PyArray_FROMANY(pointsArgument, NPY_DOUBLE, 0, 0, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+        if (points == nullptr) {
+            return nullptr;
+        }
+        PyObject* out = nullptr;
+        PyObject* result = guarded([&] {
+            auto* array = reinterpret_cast<PyArrayObject*>(points);
+            if (PyArray_NDIM(array) != 2) {
+                throw std::invalid_argument("points must be a 2D array of shape (numPoints, numIndex)");
+            }
+            const npy_intp numPoints = PyArray_DIM(array, 0);
+            const npy_intp numIndex = PyArray_DIM(array, 1);
+            const auto* pts = static_cast<const double*>(PyArray_DATA(array));
+            const opat::lattice::TableLattice& lattice = latticeOf(self);
+            const opat::OPAT& opat = lattice.getOPAT();
+            const std::string tag = tagArgument;
+            if (numPoints == 0) {
+                // Nothing to interpolate, so the table shape comes from the index of any card
+                if (numIndex != opat.header.numIndex) {
+                    throw std::invalid_argument("points must have " + std::to_string(opat.header.numIndex) + " columns, one per index dimension");
+                }
+                const auto card = opat.acquire(opat.cardCatalog.tableIndex.begin()->first);
+                const opat::TableIndexEntry& entry = card->tableIndex.get(tag);
+                std::vector<npy_intp> shape = tableShape(entry.numRows, entry.numColumns, entry.size);
+                shape.insert(shape.begin(), 0);
+                return check(PyArray_SimpleNew(static_cast<int>(shape.size()), shape.data(), NPY_DOUBLE));
+            }
+
+            // Only the requested table is interpolated, at the file's hash precision as card lookups are
+            double* outData = nullptr;
+            std::size_t tableSize = 0;
+            std::vector<double> point(numIndex);
+            for (npy_intp i = 0; i < numPoints; ++i) {
+                std::copy_n(pts + i * numIndex, numIndex, point.data());
+                const opat::OPATTable table = lattice.getTable(FloatIndexVector(point, opat.header.hashPrecision), tag);
+                if (outData == nullptr) {
+                    std::vector<npy_intp> shape = tableShape(table);
+                    shape.insert(shape.begin(), numPoints);
+                    out = check(PyArray_SimpleNew(static_cast<int>(shape.size()), shape.data(), NPY_DOUBLE));
+                    outData = static_cast<double*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(out)));
+                    tableSize = table.N_R * table.N_C * table.m_vsize;
+                }
+                std::memcpy(outData + i * tableSize, table.data.get(), tableSize * sizeof(double));
+            }
+            return std::exchange(out, nullptr);
+        });
+        Py_XDECREF(out); // Only left set if a later point failed
+        Py_DECREF(points);
+        return result;
+    }
+
+    PyMethodDef latticeMethods[] = {
+        {"get", reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(latticeGet)), METH_VARARGS | METH_KEYWORDS,
+         "Interpolate a full DataCard at `point`."},
+        {"get_batch", reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(latticeGetBatch)), METH_VARARGS | METH_KEYWORDS,
+         "Interpolate table `tag` at every row of `points` (shape (numPoints, numIndex)). "
+         "Returns an array of shape (numPoints, N_R, N_C[, vsize])."},
+        {nullptr, nullptr, 0, nullptr}
+    };
+
+    PyType_Slot latticeSlots[] = {
+        {Py_tp_new, reinterpret_cast<void*>(latticeNew)},
+        {Py_tp_dealloc, reinterpret_cast<void*>(deallocateLattice)},
+        {Py_tp_methods, latticeMethods},
+        {0, nullptr}
+    };
+
+    // ---- Module ------------------------------------------------------------------------------------
+
+    PyObject* readOPAT(PyObject*, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = {"filename", "lazy", nullptr};
+        const char* filename = nullptr;
+        int lazy = 0;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|p", const_cast<char**>(keywords), &filename, &lazy)) {
+            return nullptr;
+        }
+        return guarded([&] {
+            auto opat = std::make_shared<opat::OPAT>(opat::readOPAT(filename, lazy ? opat::LoadMode::Lazy : opat::LoadMode::Eager));
+            auto* self = allocate<PyOPAT>(OPATType);
+            new (&self->opat) std::shared_ptr<opat::OPAT>(std::move(opat));
+            return reinterpret_cast<PyObject*>(self);
+        });
+    }
+
+    PyMethodDef moduleMethods[] = {
+        {"read_opat", reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(readOPAT)), METH_VARARGS | METH_KEYWORDS,
+         "Read an OPAT file using the C++ reader. With lazy=True cards are read on first access."},
+        {nullptr, nullptr, 0, nullptr}
+    };
+
+    PyModuleDef moduleDef = {
+        PyModuleDef_HEAD_INIT, "opatio_native", "Native (C++) reader and lattice interpolator for OPAT files", -1, moduleMethods,
+        nullptr, nullptr, nullptr, nullptr
+    };
+
+    // Creates a type from `slots` and adds it to `module` under `name`
+    PyTypeObject* addType(PyObject* module, const char* name, int basicSize, PyType_Slot* slots) {
+        static std::vector<std::unique_ptr<std::string>> qualifiedNames;
+        qualifiedNames.push_back(std::make_unique<std::string>(std::string("opatio_native.") + name));
+        PyType_Spec spec = {qualifiedNames.back()->c_str(), basicSize, 0, Py_TPFLAGS_DEFAULT, slots};
+        PyObject* type = check(PyType_FromSpec(&spec));
+        if (PyModule_AddObject(module, name, type) < 0) {
+            Py_DECREF(type);
+            throw PythonError{};
+        }
+        return reinterpret_cast<PyTypeObject*>(type); // Borrowed from the module, which lives until shutdown
+    }
+}
+
+PyMODINIT_FUNC PyInit_opatio_native() {
+    import_array();
+    PyObject* module = PyModule_Create(&moduleDef);
+    if (module == nullptr) {
+        return nullptr;
+    }
+    PyObject* result = guarded([&] {
+        HeaderType = addType(module, "Header", sizeof(PyHeader), headerSlots);
+        OPATTableType = addType(module, "OPATTable", sizeof(PyOPATTable), tableSlots);
+        DataCardType = addType(module, "DataCard", sizeof(PyDataCard), cardSlots);
+        OPATType = addType(module, "OPAT", sizeof(PyOPAT), opatSlots);
+        TableLatticeType = addType(module, "TableLattice", sizeof(PyTableLattice), latticeSlots);
+        return module;
+    });
+    if (result == nullptr) {
+        Py_DECREF(module);
+    }
+    return result;
+}
@@ -0,0 +1,270 @@
+#include "asyncOPAT.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <map>
+#include <span>
+#include <unordered_map>
+#include <utility>
+
+#include "lazyCardStore.h"
+#include "queryTrace.h"
+#include "tableLattice.h"
+
+namespace opat::async {
+
+    namespace {
+        /**
+         * Gathers the card and table reads of awaitables which suspend and hands them to the IO backend with
+         * `LazyCardStore::prefetchAsync`, so that no thread waits on the disk. Each store has at most one batch
+         * in flight: the first lookup starts one at once, and lookups which arrive while it is being read join
+         * the next, so a burst of lookups becomes a few deep backend batches. Once a batch is read, each
+         * lookup's continuation is posted to the executor it resumes on.
+         */
+        class Batcher {
+        public:
+            static Batcher& global() {
+                // Intentionally leaked, like io::defaultBackend, so that it outlives static destruction
+                static Batcher* batcher = new Batcher();
+                return *batcher;
+            }
+
+            // Makes `index` (and its table `tag`, unless empty) resident in `store`, then posts `then` to `executor`
+            void prefetch(Executor& executor, const LazyCardStore& store, FloatIndexVector index, std::string tag, std::function<void()> then) {
+                bool start;
+                {
+                    std::lock_guard lock(m_mutex);
+                    Queue& queue = m_queues[&store];
+                    queue.lookups.push_back({&executor, std::move(index), std::move(tag), std::move(then)});
+                    start = !std::exchange(queue.inFlight, true);
+                }
+                if (start) {
+                    read(store);
+                }
+            }
+
+        private:
+            struct Lookup {
+                Executor* executor;
+                FloatIndexVector index;
+                std::string tag;
+                std::function<void()> then;
+            };
+
+            struct Queue {
+                std::vector<Lookup> lookups;
+                bool inFlight = false; ///< A batch of this store is being read.
+            };
+
+            // One batch of lookups: its card indices, then the indices of each requested table
+            struct Batch {
+                std::vector<Lookup> lookups;
+                std::vector<FloatIndexVector> cards;
+                std::vector<std::pair<std::string, std::vector<FloatIndexVector>>> tables;
+                std::size_t nextTable = 0;
+            };
+
+            // Starts a batch of the lookups queued for `store`, or marks it idle if there are none
+            void read(const LazyCardStore& store) {
+                auto batch = std::make_shared<Batch>();
+                {
+                    std::lock_guard lock(m_mutex);
+                    Queue& queue = m_queues[&store];
+                    if (queue.lookups.empty()) {
+                        queue.inFlight = false;
+                        return;
+                    }
+                    batch->lookups.swap(queue.lookups);
+                }
+
+                // Card indices first, then each requested table, so that only the tables asked for are read
+                std::map<std::string, std::vector<FloatIndexVector>> tables;
+                for (const Lookup& lookup : batch->lookups) {
+                    batch->cards.push_back(lookup.index);
+                    if (!lookup.tag.empty()) {
+                        tables[lookup.tag].push_back(lookup.index);
+                    }
+                }
+                batch->tables.assign(std::make_move_iterator(tables.begin()), std::make_move_iterator(tables.end()));
+                try {
+                    store.prefetchAsync(batch->cards, {}, [this, &store, batch](std::exception_ptr, std::size_t) mutable {
+                        readTables(store, std::move(batch));
+                    });
+                } catch (...) {
+                    readTables(store, std::move(batch));
+                }
+            }
+
+            void readTables(const LazyCardStore& store, std::shared_ptr<Batch> batch) {
+                // Errors are not reported here: cards which could not be prefetched are read (and their errors
+                // reported) individually when the awaiting coroutine resumes
+                if (batch->nextTable < batch->tables.size()) {
+                    const auto& [tag, indices] = batch->tables[batch->nextTable++];
+                    try {
+                        store.prefetchAsync(indices, std::span(&tag, 1), [this, &store, batch](std::exception_ptr, std::size_t) mutable {
+                            readTables(store, std::move(batch));
+                        });
+                    } catch (...) {
+                        readTables(store, std::move(batch));
+                    }
+                    return;
+                }
+                for (Lookup& lookup : batch->lookups) {
+                    lookup.executor->post(std::move(lookup.then));
+                }
+                read(store);
+            }
+
+            std::mutex m_mutex;
+            std::unordered_map<const LazyCardStore*, Queue> m_queues;
+        };
+    }
+
+    ThreadPoolExecutor::ThreadPoolExecutor(unsigned threads) {
+        for (unsigned i = 0; i < std::max(threads, 1u); ++i) {
+            m_workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ThreadPoolExecutor::~ThreadPoolExecutor() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPoolExecutor::post(std::function<void()> work) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_queue.push_back(std::move(work));
+        }
+        m_wake.notify_one();
+    }
+
+    void ThreadPoolExecutor::work() {
+        while (true) {
+            std::function<void()> next;
+            {
+                std::unique_lock lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty()) {
+                    return;
+                }
+                next = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            next();
+        }
+    }
+
+    Executor& defaultExecutor() {
+        // Intentionally leaked: coroutines may still be resumed on it during static destruction
+        static Executor* executor = new ThreadPoolExecutor();
+        return *executor;
+    }
+
+    CardAwaitable::CardAwaitable(const OPAT& opat, FloatIndexVector index, Executor& executor) :
+        m_opat(opat), m_index(std::move(index)), m_executor(executor) {}
+
+    bool CardAwaitable::await_ready() const {
+        if (!m_opat.lazyCards || m_opat.cards.contains(m_index)) {
+            return true;
+        }
+        // Unknown indices resume immediately so that await_resume can report them
+        return !m_opat.lazyCards->contains(m_index) || m_opat.lazyCards->isLoaded(m_index);
+    }
+
+    void CardAwaitable::await_suspend(std::coroutine_handle<> continuation) {
+        Batcher::global().prefetch(m_executor, *m_opat.lazyCards, m_index, {}, [continuation] {
+            continuation.resume();
+        });
+    }
+
+    std::shared_ptr<const DataCard> CardAwaitable::await_resume() {
+        // Normally resident by now; if the card was evicted in the meantime it is read again here
+        return m_opat.acquire(m_index);
+    }
+
+    TableAwaitable::TableAwaitable(const OPAT& opat, FloatIndexVector index, std::string tag, Executor& executor) :
+        m_opat(opat), m_index(std::move(index)), m_tag(std::move(tag)), m_executor(executor) {}
+
+    bool TableAwaitable::await_ready() const {
+        // Eagerly loaded cards hold all of their tables in memory
+        return !m_opat.lazyCards || m_opat.cards.contains(m_index) || !m_opat.lazyCards->contains(m_index);
+    }
+
+    void TableAwaitable::await_suspend(std::coroutine_handle<> continuation) {
+        Batcher::global().prefetch(m_executor, *m_opat.lazyCards, m_index, m_tag, [this, continuation] {
+            fetch();
+            continuation.resume();
+        });
+    }
+
+    std::shared_ptr<const OPATTable> TableAwaitable::await_resume() {
+        if (!m_table && !m_error) {
+            fetch();
+        }
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+        return std::move(m_table);
+    }
+
+    void TableAwaitable::fetch() {
+        try {
+            std::shared_ptr<const DataCard> card = m_opat.acquire(m_index);
+            const OPATTable& table = card->get(m_tag);
+            m_table = std::shared_ptr<const OPATTable>(std::move(card), &table);
+        } catch (...) {
+            m_error = std::current_exception();
+        }
+    }
+
+    LatticeAwaitable::LatticeAwaitable(const lattice::TableLattice& lattice, FloatIndexVector index, Executor& executor) :
+        m_lattice(lattice), m_index(std::move(index)), m_executor(executor) {}
+
+    void LatticeAwaitable::await_suspend(std::coroutine_handle<> continuation) {
+        // Errors are reported by TableLattice::get when the coroutine resumes
+        Executor& executor = m_executor;
+        try {
+            m_lattice.prefetchCornersAsync(m_index, [&executor, continuation](std::exception_ptr) {
+                executor.post([continuation] { continuation.resume(); });
+            });
+        } catch (...) {
+            executor.post([continuation] { continuation.resume(); });
+        }
+    }
+
+    DataCard LatticeAwaitable::await_resume() {
+        return m_lattice.get(m_index);
+    }
+
+    TableAwaitable getTable(const OPAT& opat, const FloatIndexVector& index, const std::string& tag, Executor& executor) {
+        return {opat, index, tag, executor};
+    }
+
+    LatticeAwaitable interpolate(const lattice::TableLattice& lattice, const FloatIndexVector& index, Executor& executor) {
+        return {lattice, index, executor};
+    }
+
+}
+
+namespace opat {
+
+    async::CardAwaitable OPAT::getAsync(const FloatIndexVector& index) const {
+        return getAsync(index, async::defaultExecutor());
+    }
+
+    async::CardAwaitable OPAT::getAsync(const FloatIndexVector& index, async::Executor& executor) const {
+        if (recorder) {
+            recorder->record(trace::QueryKind::Card, index);
+        }
+        return {*this, index, executor};
+    }
+
+}
@@ -0,0 +1,337 @@
+#include "diff.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OPAT_DIFF_X86 1
+#include <immintrin.h>
+#endif
+
+namespace opat::diff {
+
+    namespace {
+        // One pair of values, as both kernels compare them
+        struct Compared {
+            bool skip;     // Equal or both NaN
+            bool nan;      // NaN in only one
+            double absolute;
+            double relative;
+            bool mismatch;
+        };
+
+        Compared compareOne(double a, double b, double absolute, double relative) {
+            const bool nanA = std::isnan(a);
+            const bool nanB = std::isnan(b);
+            if (a == b || (nanA && nanB)) {
+                return {true, false, 0.0, 0.0, false};
+            }
+            if (nanA || nanB) {
+                return {false, true, 0.0, 0.0, true};
+            }
+            const double difference = std::fabs(a - b);
+            const double scale = std::max(std::fabs(a), std::fabs(b));
+            const bool mismatch = difference > absolute + relative * scale || std::isinf(difference);
+            return {false, false, difference, difference / scale, mismatch};
+        }
+
+        Differences comparePortable(const double* a, const double* b, std::size_t count, double absolute, double relative) {
+            Differences result;
+            result.values = count;
+            for (std::size_t i = 0; i < count; ++i) {
+                const Compared c = compareOne(a[i], b[i], absolute, relative);
+                result.mismatches += c.mismatch;
+                result.nanMismatches += c.nan;
+                // Written so that NaN (infinity against infinity) never becomes the maximum, as in the AVX2 kernel
+                result.maxAbsolute = c.absolute > result.maxAbsolute ? c.absolute : result.maxAbsolute;
+                result.maxRelative = c.relative > result.maxRelative ? c.relative : result.maxRelative;
+            }
+            return result;
+        }
+
+#ifdef OPAT_DIFF_X86
+        __attribute__((target("avx2,popcnt")))
+        Differences compareAvx2(const double* a, const double* b, std::size_t count, double absolute, double relative) {
+            const __m256d sign = _mm256_set1_pd(-0.0);
+            const __m256d infinity = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+            const __m256d absoluteTolerance = _mm256_set1_pd(absolute);
+            const __m256d relativeTolerance = _mm256_set1_pd(relative);
+            __m256d maxAbsolute = _mm256_setzero_pd();
+            __m256d maxRelative = _mm256_setzero_pd();
+            std::size_t mismatches = 0;
+            std::size_t nanMismatches = 0;
+
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const __m256d va = _mm256_loadu_pd(a + i);
+                const __m256d vb = _mm256_loadu_pd(b + i);
+                const __m256d nanA = _mm256_cmp_pd(va, va, _CMP_UNORD_Q);
+                const __m256d nanB = _mm256_cmp_pd(vb, vb, _CMP_UNORD_Q);
+                const __m256d eitherNan = _mm256_or_pd(nanA, nanB);
+                const __m256d oneNan = _mm256_andnot_pd(_mm256_and_pd(nanA, nanB), eitherNan);
+                const __m256d skip = _mm256_or_pd(_mm256_cmp_pd(va, vb, _CMP_EQ_OQ), eitherNan);
+
+                // Differences are zeroed where the values are equal or NaN, as the portable kernel skips them
+                const __m256d difference = _mm256_andnot_pd(skip, _mm256_andnot_pd(sign, _mm256_sub_pd(va, vb)));
+                const __m256d scale = _mm256_max_pd(_mm256_andnot_pd(sign, va), _mm256_andnot_pd(sign, vb));
+                const __m256d rel = _mm256_andnot_pd(skip, _mm256_div_pd(difference, scale));
+                const __m256d limit = _mm256_add_pd(absoluteTolerance, _mm256_mul_pd(relativeTolerance, scale));
+                const __m256d over = _mm256_or_pd(_mm256_cmp_pd(difference, limit, _CMP_GT_OQ), _mm256_cmp_pd(difference, infinity, _CMP_EQ_OQ));
+
+                mismatches += std::popcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_or_pd(over, oneNan))));
+                nanMismatches += std::popcount(static_cast<unsigned>(_mm256_movemask_pd(oneNan)));
+                // max_pd returns its second operand when either is NaN, so NaN never becomes the maximum
+                maxAbsolute = _mm256_max_pd(difference, maxAbsolute);
+                maxRelative = _mm256_max_pd(rel, maxRelative);
+            }
+
+            alignas(32) double absolutes[4];
+            alignas(32) double relatives[4];
+            _mm256_store_pd(absolutes, maxAbsolute);
+            _mm256_store_pd(relatives, maxRelative);
+            Differences result = comparePortable(a + i, b + i, count - i, absolute, relative);
+            result.values = count;
+            result.mismatches += mismatches;
+            result.nanMismatches += nanMismatches;
+            for (int lane = 0; lane < 4; ++lane) {
+                result.maxAbsolute = std::max(result.maxAbsolute, absolutes[lane]);
+                result.maxRelative = std::max(result.maxRelative, relatives[lane]);
+            }
+            return result;
+        }
+
+        using Kernel = Differences (*)(const double*, const double*, std::size_t, double, double);
+
+        Kernel kernel() {
+            static const Kernel selected = __builtin_cpu_supports("avx2") ? compareAvx2 : comparePortable;
+            return selected;
+        }
+#endif
+
+        // The first value with the largest absolute difference
+        std::size_t worstIndex(const double* a, const double* b, std::size_t count, double maxAbsolute) {
+            for (std::size_t i = 0; i < count; ++i) {
+                const Compared c = compareOne(a[i], b[i], 0.0, 0.0);
+                if (!c.skip && !c.nan && c.absolute == maxAbsolute) {
+                    return i;
+                }
+            }
+            return 0;
+        }
+
+        std::vector<const CardCatalogEntry*> storedOrder(const OPAT& opat) {
+            std::vector<const CardCatalogEntry*> entries;
+            entries.reserve(opat.cardCatalog.tableIndex.size());
+            for (const CardCatalogEntry& entry : opat.cardCatalog.tableIndex | std::views::values) {
+                entries.push_back(&entry);
+            }
+            std::ranges::sort(entries, {}, &CardCatalogEntry::byteStart);
+            return entries;
+        }
+
+        FloatIndexVector keyIn(const OPAT& opat, const FloatIndexVector& index) {
+            return FloatIndexVector(index.getVector(), opat.header.hashPrecision);
+        }
+
+        // What one thread found, with the position in the first file of each card it concerns, for ordering
+        struct Partial {
+            std::vector<std::tuple<std::size_t, FloatIndexVector, std::string>> tagsOnlyInFirst;
+            std::vector<std::tuple<std::size_t, FloatIndexVector, std::string>> tagsOnlyInSecond;
+            std::vector<std::tuple<std::size_t, FloatIndexVector, std::string>> unreadable;
+            std::map<std::string, TagSummary> tags;
+            std::size_t cards = 0;
+        };
+
+        void addSummary(TagSummary& to, const TagSummary& from) {
+            if (from.values.maxAbsolute > to.values.maxAbsolute) {
+                to.worst = from.worst;
+            }
+            to.tables += from.tables;
+            to.identical += from.identical;
+            to.shapeMismatches += from.shapeMismatches;
+            to.axisMismatches += from.axisMismatches;
+            to.values += from.values;
+        }
+
+        void compareTables(const FloatIndexVector& index, const std::string& tag, const DataCard& first, const DataCard& second,
+                           const Options& options, TagSummary& summary) {
+            const TableIndexEntry& a = first.tableIndex.tableIndex.at(tag);
+            const TableIndexEntry& b = second.tableIndex.tableIndex.at(tag);
+            ++summary.tables;
+            const bool sameShape = a.numRows == b.numRows && a.numColumns == b.numColumns && a.size == b.size;
+            if (options.trustChecksums && sameShape && a.checksum != 0 && a.checksum == b.checksum) {
+                ++summary.identical;
+                summary.values.values += static_cast<std::size_t>(a.numRows) * a.numColumns * a.size;
+                return;
+            }
+
+            const OPATTable& ta = first.get(tag);
+            const OPATTable& tb = second.get(tag);
+            if (ta.N_R != tb.N_R || ta.N_C != tb.N_C || ta.m_vsize != tb.m_vsize) {
+                ++summary.shapeMismatches;
+                return;
+            }
+            if (compareValues(ta.rowValues.get(), tb.rowValues.get(), ta.N_R, options).mismatches > 0 ||
+                compareValues(ta.columnValues.get(), tb.columnValues.get(), ta.N_C, options).mismatches > 0) {
+                ++summary.axisMismatches;
+            }
+
+            const std::size_t cells = static_cast<std::size_t>(ta.N_R) * ta.N_C * ta.m_vsize;
+            const Differences differences = compareValues(ta.data.get(), tb.data.get(), cells, options);
+            if (differences.maxAbsolute > summary.values.maxAbsolute) {
+                const std::size_t worst = worstIndex(ta.data.get(), tb.data.get(), cells, differences.maxAbsolute);
+                const std::size_t cell = worst / ta.m_vsize;
+                summary.worst = {index, static_cast<uint32_t>(cell / ta.N_C), static_cast<uint32_t>(cell % ta.N_C), worst % ta.m_vsize};
+            }
+            summary.values += differences;
+        }
+
+        template <typename Part>
+        void appendSorted(std::vector<std::tuple<std::size_t, FloatIndexVector, std::string>>& from, std::vector<Part>& to) {
+            std::ranges::sort(from, [](const auto& x, const auto& y) {
+                return std::tie(std::get<0>(x), std::get<2>(x)) < std::tie(std::get<0>(y), std::get<2>(y));
+            });
+            for (auto& [position, index, text] : from) {
+                to.emplace_back(std::move(index), std::move(text));
+            }
+        }
+    }
+
+    Differences& Differences::operator+=(const Differences& other) {
+        values += other.values;
+        mismatches += other.mismatches;
+        nanMismatches += other.nanMismatches;
+        maxAbsolute = std::max(maxAbsolute, other.maxAbsolute);
+        maxRelative = std::max(maxRelative, other.maxRelative);
+        return *this;
+    }
+
+    bool Report::equal() const {
+        if (!headerDifferences.empty() || !onlyInFirst.empty() || !onlyInSecond.empty() || !tagsOnlyInFirst.empty() ||
+            !tagsOnlyInSecond.empty() || !unreadableCards.empty()) {
+            return false;
+        }
+        return std::ranges::all_of(tags | std::views::values, [](const TagSummary& summary) {
+            return summary.shapeMismatches == 0 && summary.axisMismatches == 0 && summary.values.mismatches == 0;
+        });
+    }
+
+    Differences compareValues(const double* a, const double* b, std::size_t count, const Options& options) {
+#ifdef OPAT_DIFF_X86
+        return kernel()(a, b, count, options.absolute, options.relative);
+#else
+        return comparePortable(a, b, count, options.absolute, options.relative);
+#endif
+    }
+
+    Report compare(const std::string& first, const std::string& second, const Options& options) {
+        // Only the headers and catalogs are read here; cards are read, compared and dropped by the workers
+        const OPAT a = readOPAT(first, LoadMode::Lazy);
+        const OPAT b = readOPAT(second, LoadMode::Lazy);
+
+        Report report;
+        const auto differ = [&report](const char* field, auto x, auto y) {
+            if (x != y) {
+                report.headerDifferences.push_back(std::string(field) + ": " + std::to_string(x) + " != " + std::to_string(y));
+            }
+        };
+        differ("version", a.header.version, b.header.version);
+        differ("numTables", a.header.numTables, b.header.numTables);
+        differ("numIndex", a.header.numIndex, b.header.numIndex);
+        differ("hashPrecision", static_cast<int>(a.header.hashPrecision), static_cast<int>(b.header.hashPrecision));
+
+        const std::vector<const CardCatalogEntry*> firstEntries = storedOrder(a);
+        std::vector<std::pair<const CardCatalogEntry*, const CardCatalogEntry*>> pairs;
+        pairs.reserve(firstEntries.size());
+        for (const CardCatalogEntry* entry : firstEntries) {
+            const auto match = b.cardCatalog.tableIndex.find(keyIn(b, entry->index));
+            if (match == b.cardCatalog.tableIndex.end()) {
+                report.onlyInFirst.push_back(entry->index);
+            } else {
+                pairs.emplace_back(entry, &match->second);
+            }
+        }
+        for (const CardCatalogEntry* entry : storedOrder(b)) {
+            if (!a.cardCatalog.tableIndex.contains(keyIn(a, entry->index))) {
+                report.onlyInSecond.push_back(entry->index);
+            }
+        }
+
+        const auto firstSource = std::make_shared<OPATFileHandle>(first);
+        const auto secondSource = std::make_shared<OPATFileHandle>(second);
+        std::atomic<std::size_t> next{0};
+        std::mutex mutex;
+        std::vector<Partial> partials;
+
+        const auto work = [&] {
+            Partial partial;
+            for (std::size_t i = next++; i < pairs.size(); i = next++) {
+                const FloatIndexVector& index = pairs[i].first->index;
+                try {
+                    const DataCard cardA = readDataCardDeferred(firstSource, *pairs[i].first);
+                    const DataCard cardB = readDataCardDeferred(secondSource, *pairs[i].second);
+                    for (const std::string& tag : cardA.tableIndex.tableIndex | std::views::keys) {
+                        if (!cardB.tableIndex.tableIndex.contains(tag)) {
+                            partial.tagsOnlyInFirst.emplace_back(i, index, tag);
+                            continue;
+                        }
+                        compareTables(index, tag, cardA, cardB, options, partial.tags[tag]);
+                    }
+                    for (const std::string& tag : cardB.tableIndex.tableIndex | std::views::keys) {
+                        if (!cardA.tableIndex.tableIndex.contains(tag)) {
+                            partial.tagsOnlyInSecond.emplace_back(i, index, tag);
+                        }
+                    }
+                    ++partial.cards;
+                } catch (const std::runtime_error& e) {
+                    partial.unreadable.emplace_back(i, index, e.what());
+                }
+            }
+            const std::lock_guard lock(mutex);
+            partials.push_back(std::move(partial));
+        };
+
+        unsigned threads = options.threads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::vector<std::thread> workers;
+        const std::size_t count = std::min<std::size_t>(threads, pairs.size());
+        workers.reserve(count);
+        for (std::size_t i = 1; i < count; ++i) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        Partial merged;
+        for (Partial& partial : partials) {
+            merged.cards += partial.cards;
+            for (const auto& [tag, summary] : partial.tags) {
+                addSummary(merged.tags[tag], summary);
+            }
+            std::ranges::move(partial.tagsOnlyInFirst, std::back_inserter(merged.tagsOnlyInFirst));
+            std::ranges::move(partial.tagsOnlyInSecond, std::back_inserter(merged.tagsOnlyInSecond));
+            std::ranges::move(partial.unreadable, std::back_inserter(merged.unreadable));
+        }
+        report.cards = merged.cards;
+        report.tags = std::move(merged.tags);
+        appendSorted(merged.tagsOnlyInFirst, report.tagsOnlyInFirst);
+        appendSorted(merged.tagsOnlyInSecond, report.tagsOnlyInSecond);
+        appendSorted(merged.unreadable, report.unreadableCards);
+        return report;
+    }
+
+}
@@ -0,0 +1,225 @@
+#include "embed.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <ranges>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace opat::embed {
+
+    namespace {
+        constexpr std::size_t ALIGNMENT = 64 / sizeof(double); // Arrays start on cache lines
+
+        // A borrowed array; the embedded data is read-only, so View only hands out the OPAT as const
+        TableArray borrow(const double* values) {
+            return TableArray(const_cast<double*>(values), TableArrayDeleter(false));
+        }
+
+        std::string tagOf(const char (&tag)[8]) {
+            return {tag, strnlen(tag, sizeof(tag))};
+        }
+
+        // A literal giving exactly `value`: hexadecimal floats for finite values, the bit pattern otherwise
+        std::string literal(double value) {
+            if (!std::isfinite(value)) {
+                std::ostringstream os;
+                os << "std::bit_cast<double>(0x" << std::hex << std::bit_cast<uint64_t>(value) << "ULL)";
+                return os.str();
+            }
+            char buffer[32];
+            const bool negative = std::signbit(value);
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), std::fabs(value), std::chars_format::hex);
+            return (negative ? "-0x" : "0x") + std::string(buffer, result.ptr);
+        }
+
+        template <std::size_t N>
+        std::string literal(const char (&bytes)[N]) {
+            std::size_t length = N;
+            while (length > 0 && bytes[length - 1] == 0) {
+                --length;
+            }
+            std::ostringstream os;
+            os << "{";
+            for (std::size_t i = 0; i < length; ++i) {
+                os << (i == 0 ? "" : ", ") << "'\\x" << std::hex << std::setw(2) << std::setfill('0')
+                   << static_cast<int>(static_cast<unsigned char>(bytes[i])) << "'";
+            }
+            os << "}";
+            return os.str();
+        }
+
+        std::string literal(uint64_t value) {
+            return std::to_string(value) + "ULL";
+        }
+
+        bool isIdentifier(const std::string& name) {
+            return !name.empty() && !std::isdigit(static_cast<unsigned char>(name.front())) &&
+                   std::ranges::all_of(name, [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+        }
+
+        // Appends `values` to the payload, padded to the next cache line, and returns their offset
+        std::size_t append(std::vector<double>& payload, const double* values, std::size_t count) {
+            const std::size_t offset = payload.size();
+            payload.insert(payload.end(), values, values + count);
+            payload.resize((payload.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, 0.0);
+            return offset;
+        }
+    }
+
+    View open(const Image& image) {
+        OPAT opat;
+        opat.header = image.header;
+        opat.cardCatalog.tableIndex.reserve(image.header.numTables);
+        opat.cards.reserve(image.header.numTables);
+
+        for (const Card& card : std::span(image.cards, image.header.numTables)) {
+            CardCatalogEntry entry;
+            entry.index = FloatIndexVector(std::vector<double>(card.index, card.index + image.header.numIndex), image.header.hashPrecision);
+            entry.byteStart = card.byteStart;
+            entry.byteEnd = card.byteEnd;
+            std::memcpy(entry.sha256, card.sha256, sizeof(entry.sha256));
+
+            DataCard dataCard;
+            dataCard.header = card.header;
+            for (const Table& table : std::span(card.tables, card.header.numTables)) {
+                const std::string tag = tagOf(table.entry.tag);
+                dataCard.tableIndex.tableIndex.emplace(tag, table.entry);
+                if (table.statistics != nullptr) {
+                    dataCard.tableIndex.statistics.emplace(tag, *table.statistics);
+                }
+
+                OPATTable view;
+                view.rowValues = borrow(table.rowValues);
+                view.columnValues = borrow(table.columnValues);
+                view.data = borrow(table.data);
+                view.N_R = table.entry.numRows;
+                view.N_C = table.entry.numColumns;
+                view.m_vsize = table.entry.size;
+                dataCard.tableData.emplace(tag, std::move(view));
+            }
+            opat.cards.emplace(entry.index, std::move(dataCard));
+            opat.cardCatalog.tableIndex.emplace(entry.index, std::move(entry));
+        }
+        return View(std::move(opat));
+    }
+
+    void writeSource(const OPAT& opat, const std::string& name, const std::string& source, std::ostream& os) {
+        if (!isIdentifier(name)) {
+            throw std::invalid_argument("'" + name + "' is not a valid name for an embedded OPAT file.");
+        }
+        if (opat.lazyCards) {
+            throw std::invalid_argument("Only eagerly loaded OPAT files can be embedded.");
+        }
+
+        std::vector<const CardCatalogEntry*> entries;
+        for (const CardCatalogEntry& entry : opat.cardCatalog.tableIndex | std::views::values) {
+            entries.push_back(&entry);
+        }
+        std::ranges::sort(entries, {}, &CardCatalogEntry::byteStart);
+
+        // Lay out the payload first, so that tables can refer to their offsets
+        std::vector<double> payload;
+        std::vector<double> indices;
+        std::ostringstream tables;
+        std::ostringstream statistics;
+        std::ostringstream cards;
+        std::size_t tableCount = 0;
+        std::size_t statisticsCount = 0;
+        for (const CardCatalogEntry* entry : entries) {
+            const DataCard& card = opat.get(entry->index);
+            std::vector<std::pair<uint64_t, std::string>> stored;
+            for (const auto& [tag, tableEntry] : card.tableIndex.tableIndex) {
+                stored.emplace_back(tableEntry.byteStart, tag);
+            }
+            std::ranges::sort(stored);
+
+            const std::size_t firstTable = tableCount;
+            for (const std::string& tag : stored | std::views::values) {
+                const TableIndexEntry& tableEntry = card.tableIndex.tableIndex.at(tag);
+                const OPATTable& table = card.get(tag);
+                const std::size_t rows = append(payload, table.rowValues.get(), table.N_R);
+                const std::size_t columns = append(payload, table.columnValues.get(), table.N_C);
+                const std::size_t data = append(payload, table.data.get(), static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize);
+
+                std::string stats = "nullptr";
+                if (const auto found = card.tableIndex.statistics.find(tag); found != card.tableIndex.statistics.end()) {
+                    const TableStatistics& s = found->second;
+                    statistics << "    {.tag = " << literal(s.tag) << ", .min = " << literal(s.min) << ", .max = " << literal(s.max)
+                               << ", .mean = " << literal(s.mean) << ", .nanCount = " << literal(s.nanCount) << "},\n";
+                    stats = "statistics + " + std::to_string(statisticsCount++);
+                }
+
+                tables << "    {{.tag = " << literal(tableEntry.tag) << ", .byteStart = " << literal(tableEntry.byteStart)
+                       << ", .byteEnd = " << literal(tableEntry.byteEnd) << ", .numColumns = " << tableEntry.numColumns
+                       << ", .numRows = " << tableEntry.numRows << ", .columnName = " << literal(tableEntry.columnName)
+                       << ", .rowName = " << literal(tableEntry.rowName) << ", .size = " << literal(tableEntry.size)
+                       << ", .checksum = " << literal(tableEntry.checksum) << "},\n"
+                       << "     payload + " << rows << ", payload + " << columns << ", payload + " << data << ", " << stats << "},\n";
+                ++tableCount;
+            }
+
+            const std::size_t index = indices.size();
+            const std::vector<double> values = entry->index.getVector();
+            indices.insert(indices.end(), values.begin(), values.end());
+            const CardHeader& header = card.header;
+            cards << "    {indices + " << index << ", " << literal(entry->byteStart) << ", " << literal(entry->byteEnd) << ", "
+                  << literal(entry->sha256) << ",\n"
+                  << "     {.magic = " << literal(header.magic) << ", .numTables = " << header.numTables
+                  << ", .headerSize = " << header.headerSize << ", .indexOffset = " << literal(header.indexOffset)
+                  << ", .cardSize = " << literal(header.cardSize) << ", .comment = " << literal(header.comment)
+                  << ", .statsOffset = " << literal(header.statsOffset) << ", .merkleRoot = " << literal(header.merkleRoot) << "},\n"
+                  << "     " << (stored.empty() ? "nullptr" : "tables + " + std::to_string(firstTable)) << "},\n";
+        }
+
+        const auto writeArray = [&os](const char* declaration, const std::vector<double>& values) {
+            os << "    " << declaration << " = {";
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                os << (i % 4 == 0 ? "\n        " : " ") << literal(values[i]) << ",";
+            }
+            os << (values.empty() ? "0.0" : "\n    ") << "};\n\n";
+        };
+
+        const Header& header = opat.header;
+        const std::string filename = std::filesystem::path(source).filename().string();
+        os << "// Generated by opatEmbed from " << filename << "; do not edit.\n"
+           << "#include <bit>\n"
+           << "#include \"embed.h\"\n\n"
+           << "namespace {\n";
+        writeArray("alignas(64) constexpr double payload[]", payload);
+        writeArray("constexpr double indices[]", indices);
+        if (statisticsCount > 0) {
+            os << "    constexpr opat::TableStatistics statistics[] = {\n" << statistics.str() << "    };\n\n";
+        }
+        if (tableCount > 0) {
+            os << "    constexpr opat::embed::Table tables[] = {\n" << tables.str() << "    };\n\n";
+        }
+        if (!entries.empty()) {
+            os << "    constexpr opat::embed::Card cards[] = {\n" << cards.str() << "    };\n";
+        }
+        os << "}\n\n"
+           << "namespace opat::embedded {\n"
+           << "    extern const opat::embed::Image " << name << ";\n"
+           << "    constinit const opat::embed::Image " << name << " = {\n"
+           << "        {.magic = " << literal(header.magic) << ", .version = " << header.version
+           << ", .numTables = " << header.numTables << ", .headerSize = " << header.headerSize
+           << ", .indexOffset = " << literal(header.indexOffset) << ",\n"
+           << "         .creationDate = " << literal(header.creationDate) << ",\n"
+           << "         .sourceInfo = " << literal(header.sourceInfo) << ",\n"
+           << "         .comment = " << literal(header.comment) << ",\n"
+           << "         .numIndex = " << header.numIndex << ", .hashPrecision = " << static_cast<int>(header.hashPrecision)
+           << ", .merkleRoot = " << literal(header.merkleRoot) << "},\n"
+           << "        " << (entries.empty() ? "nullptr" : "cards") << ",\n"
+           << "        " << std::quoted(filename) << "\n"
+           << "    };\n"
+           << "}\n";
+    }
+
+}
@@ -0,0 +1,299 @@
+#include "inverseLookup.h"
+#include "tableLattice.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace opat::inverse {
+
+    namespace {
+        using Runs = std::vector<std::vector<uint32_t>>;
+
+        constexpr double NOT_FOUND = std::numeric_limits<double>::quiet_NaN();
+
+        // The lines of a table along the solved axis (rows when solving for a column value, and vice versa)
+        struct Layout {
+            uint32_t lines;         ///< Number of lines.
+            uint32_t nodes;         ///< Number of values along each line.
+            std::size_t lineStride; ///< Distance in doubles between the starts of consecutive lines.
+            std::size_t nodeStride; ///< Distance in doubles between consecutive values of a line.
+            const double* lineValues; ///< Coordinates of the lines (along the fixed axis).
+            const double* nodeValues; ///< Coordinates of the values of each line (along the solved axis).
+        };
+
+        // One line of a corner table, weighted by its share of the interpolated line
+        struct Line {
+            const double* values;
+            std::size_t stride;
+            const std::vector<uint32_t>* runs;
+            double weight;
+
+            [[nodiscard]] double at(uint32_t node) const { return values[node * stride]; }
+        };
+
+        Layout layoutOf(const OPATTable& table, Axis axis) {
+            const std::size_t rowStride = static_cast<std::size_t>(table.N_C) * table.m_vsize;
+            if (axis == Axis::Column) {
+                return {table.N_R, table.N_C, rowStride, table.m_vsize, table.rowValues.get(), table.columnValues.get()};
+            }
+            return {table.N_C, table.N_R, table.m_vsize, rowStride, table.columnValues.get(), table.rowValues.get()};
+        }
+
+        void checkTable(const OPATTable& table, Axis axis, uint64_t zdepth) {
+            if (zdepth >= table.m_vsize) {
+                throw std::invalid_argument("Depth " + std::to_string(zdepth) + " is out of range for cells of size " +
+                                            std::to_string(table.m_vsize) + ".");
+            }
+            const Layout layout = layoutOf(table, axis);
+            if (layout.lines == 0 || layout.nodes == 0 ||
+                !std::ranges::is_sorted(layout.lineValues, layout.lineValues + layout.lines, std::ranges::less_equal{})) {
+                throw std::invalid_argument(std::string("Inverse lookups along this axis need strictly increasing ") +
+                                            (axis == Axis::Column ? "row" : "column") + " values.");
+            }
+        }
+
+        // Splits every line into runs along which it never changes direction. A missing (NaN) value ends a run,
+        // and the cells on either side of it are runs of their own, so no run spans it
+        Runs monotoneRuns(const OPATTable& table, Axis axis, uint64_t zdepth) {
+            const Layout layout = layoutOf(table, axis);
+            Runs runs(layout.lines);
+            for (uint32_t line = 0; line < layout.lines; ++line) {
+                const double* values = table.data.get() + line * layout.lineStride + zdepth;
+                std::vector<uint32_t>& starts = runs[line];
+                const auto boundary = [&starts](uint32_t node) {
+                    if (node > starts.back()) {
+                        starts.push_back(node);
+                    }
+                };
+                starts.push_back(0);
+                int direction = 0;
+                for (uint32_t node = 1; node < layout.nodes; ++node) {
+                    const double value = values[node * layout.nodeStride];
+                    const double previous = values[(node - 1) * layout.nodeStride];
+                    if (std::isnan(value) || std::isnan(previous)) {
+                        boundary(node - 1);
+                        boundary(node);
+                        direction = 0;
+                        continue;
+                    }
+                    const double step = value - previous;
+                    const int sign = (step > 0) - (step < 0);
+                    if (sign == 0) {
+                        continue;
+                    }
+                    if (direction != 0 && sign != direction) {
+                        boundary(node - 1);
+                    }
+                    direction = sign;
+                }
+                boundary(layout.nodes - 1);
+            }
+            return runs;
+        }
+
+        double blend(const std::vector<Line>& lines, uint32_t node) {
+            double value = 0.0;
+            for (const Line& line : lines) {
+                value += line.weight * line.at(node);
+            }
+            return value;
+        }
+
+        // The root in the cell [node, node + 1], on which the blended line is linear (a single secant step)
+        double cellRoot(const double* coordinates, uint32_t node, double low, double high, double target) {
+            if (low == target || high == low) {
+                return coordinates[node];
+            }
+            const double fraction = (target - low) / (high - low);
+            return coordinates[node] + fraction * (coordinates[node + 1] - coordinates[node]);
+        }
+
+        // The first coordinate (in node order) at which the weighted sum of `lines` takes the value `target`
+        double solveLines(const std::vector<Line>& lines, const double* coordinates, uint32_t nodes, double target) {
+            if (nodes == 1) {
+                return blend(lines, 0) == target ? coordinates[0] : NOT_FOUND;
+            }
+            // Every line is monotone between consecutive boundaries of the union of their runs
+            std::vector<uint32_t> boundaries;
+            for (const Line& line : lines) {
+                boundaries.insert(boundaries.end(), line.runs->begin(), line.runs->end());
+            }
+            std::ranges::sort(boundaries);
+            boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+            for (std::size_t segment = 0; segment + 1 < boundaries.size(); ++segment) {
+                const uint32_t first = boundaries[segment];
+                const uint32_t last = boundaries[segment + 1];
+                double low = 0.0;
+                double high = 0.0;
+                int direction = 0;
+                bool monotone = true;
+                for (const Line& line : lines) {
+                    const double start = line.weight * line.at(first);
+                    const double end = line.weight * line.at(last);
+                    low += std::min(start, end);
+                    high += std::max(start, end);
+                    const int sign = (end > start) - (end < start);
+                    if (sign != 0) {
+                        monotone = monotone && (direction == 0 || direction == sign);
+                        direction = sign;
+                    }
+                }
+                if (target < low || target > high) {
+                    continue;
+                }
+                // Cells with missing (NaN) values never bracket the target, so leave them to the scan
+                monotone = monotone && !std::isnan(low + high);
+
+                if (monotone) {
+                    // Bisect for the first cell whose far end reaches the target
+                    uint32_t lower = first;
+                    uint32_t upper = last;
+                    const double lowerValue = blend(lines, lower);
+                    if (lowerValue == target || direction == 0) {
+                        return coordinates[first];
+                    }
+                    while (upper - lower > 1) {
+                        const uint32_t middle = lower + (upper - lower) / 2;
+                        if ((blend(lines, middle) - target) * direction < 0) {
+                            lower = middle;
+                        } else {
+                            upper = middle;
+                        }
+                    }
+                    return cellRoot(coordinates, lower, blend(lines, lower), blend(lines, upper), target);
+                }
+
+                // The lines disagree in direction here, so the blend may turn: scan its cells
+                double previous = blend(lines, first);
+                for (uint32_t node = first; node < last; ++node) {
+                    const double next = blend(lines, node + 1);
+                    if (std::min(previous, next) <= target && target <= std::max(previous, next)) {
+                        return cellRoot(coordinates, node, previous, next, target);
+                    }
+                    previous = next;
+                }
+            }
+            return NOT_FOUND;
+        }
+
+        // The lines bracketing `fixed` along the fixed axis, with their bilinear weights
+        std::vector<std::pair<uint32_t, double>> bracket(const Layout& layout, double fixed) {
+            const double* values = layout.lineValues;
+            if (!(fixed >= values[0] && fixed <= values[layout.lines - 1])) {
+                throw std::out_of_range("Coordinate " + std::to_string(fixed) + " is outside the table [" +
+                                        std::to_string(values[0]) + ", " + std::to_string(values[layout.lines - 1]) + "].");
+            }
+            if (layout.lines == 1) {
+                return {{0, 1.0}};
+            }
+            const auto position = std::upper_bound(values, values + layout.lines, fixed);
+            const uint32_t line = static_cast<uint32_t>(std::min<std::ptrdiff_t>(position - values, layout.lines - 1) - 1);
+            const double fraction = (fixed - values[line]) / (values[line + 1] - values[line]);
+            if (fraction == 0.0) {
+                return {{line, 1.0}};
+            }
+            if (fraction == 1.0) {
+                return {{line + 1, 1.0}};
+            }
+            return {{line, 1.0 - fraction}, {line + 1, fraction}};
+        }
+
+        // A corner table of an interpolated line, with the monotone runs of its lines
+        struct WeightedTable {
+            const OPATTable* table;
+            const Runs* runs;
+            double weight;
+        };
+
+        double solveWeighted(const std::vector<WeightedTable>& tables, Axis axis, uint64_t zdepth, const Query& query) {
+            const Layout layout = layoutOf(*tables.front().table, axis);
+            std::vector<Line> lines;
+            lines.reserve(tables.size() * 2);
+            for (const auto& [line, lineWeight] : bracket(layout, query.fixed)) {
+                for (const WeightedTable& table : tables) {
+                    lines.push_back({table.table->data.get() + line * layout.lineStride + zdepth, layout.nodeStride,
+                                     &(*table.runs)[line], lineWeight * table.weight});
+                }
+            }
+            return solveLines(lines, layout.nodeValues, layout.nodes, query.target);
+        }
+    }
+
+    TableInverse::TableInverse(const OPATTable& table, Axis axis, uint64_t zdepth) :
+        m_table(table), m_axis(axis), m_zdepth(zdepth) {
+        checkTable(table, axis, zdepth);
+        m_runs = monotoneRuns(table, axis, zdepth);
+    }
+
+    double TableInverse::solve(double fixed, double target) const {
+        return solveWeighted({{&m_table, &m_runs, 1.0}}, m_axis, m_zdepth, {fixed, target});
+    }
+
+    std::vector<double> TableInverse::solve(std::span<const Query> queries) const {
+        const std::vector<WeightedTable> tables = {{&m_table, &m_runs, 1.0}};
+        std::vector<double> results;
+        results.reserve(queries.size());
+        for (const Query& query : queries) {
+            results.push_back(solveWeighted(tables, m_axis, m_zdepth, query));
+        }
+        return results;
+    }
+
+    std::size_t TableInverse::runCount() const {
+        std::size_t count = 0;
+        for (const auto& starts : m_runs) {
+            count += starts.size() - 1;
+        }
+        return count;
+    }
+
+    LatticeInverse::LatticeInverse(const lattice::TableLattice& lattice, std::string tag, Axis axis, uint64_t zdepth) :
+        m_lattice(lattice), m_tag(std::move(tag)), m_axis(axis), m_zdepth(zdepth) {}
+
+    double LatticeInverse::solve(const FloatIndexVector& indexVector, double fixed, double target) const {
+        const Query query{fixed, target};
+        return solve(indexVector, std::span(&query, 1)).front();
+    }
+
+    std::vector<double> LatticeInverse::solve(const FloatIndexVector& indexVector, std::span<const Query> queries) const {
+        // Holding the corners keeps their cards resident for the batch
+        const std::vector<lattice::Corner> corners = m_lattice.corners(indexVector);
+        std::vector<std::shared_ptr<const Runs>> runs;
+        std::vector<WeightedTable> tables;
+        runs.reserve(corners.size());
+        tables.reserve(corners.size());
+        for (const lattice::Corner& corner : corners) {
+            if (corner.weight == 0.0) {
+                continue;
+            }
+            const OPATTable& table = corner.card->get(m_tag);
+            std::shared_ptr<const Runs> cornerRuns;
+            {
+                std::lock_guard lock(m_mutex);
+                if (const auto it = m_runs.find(corner.index); it != m_runs.end()) {
+                    cornerRuns = it->second;
+                }
+            }
+            if (!cornerRuns) {
+                checkTable(table, m_axis, m_zdepth);
+                cornerRuns = std::make_shared<const Runs>(monotoneRuns(table, m_axis, m_zdepth));
+                std::lock_guard lock(m_mutex);
+                m_runs.emplace(corner.index, cornerRuns);
+            }
+            runs.push_back(cornerRuns);
+            tables.push_back({&table, runs.back().get(), corner.weight});
+        }
+
+        std::vector<double> results;
+        results.reserve(queries.size());
+        for (const Query& query : queries) {
+            results.push_back(solveWeighted(tables, m_axis, m_zdepth, query));
+        }
+        return results;
+    }
+
+}
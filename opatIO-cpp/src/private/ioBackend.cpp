@@ -0,0 +1,733 @@
+#include "ioBackend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define OPAT_HAVE_IO_URING 1
+#endif
+
+namespace opat::io {
+
+    namespace {
+        std::runtime_error readError(const ReadRequest& request, int error) {
+            return std::runtime_error("Read of " + std::to_string(request.length) + " bytes at offset " +
+                                      std::to_string(request.offset) + " failed: " +
+                                      (error == 0 ? std::string("unexpected end of file") : std::strerror(error)));
+        }
+
+        // Keeps a pool of workers which each run whole pread loops
+        class ThreadPoolBackend final : public IOBackend {
+        public:
+            explicit ThreadPoolBackend(unsigned threads) {
+                for (unsigned i = 0; i < std::max(threads, 1u); ++i) {
+                    m_workers.emplace_back([this] { work(); });
+                }
+            }
+
+            ~ThreadPoolBackend() override {
+                {
+                    std::lock_guard lock(m_mutex);
+                    m_stopping = true;
+                }
+                m_wake.notify_all();
+                for (auto& worker : m_workers) {
+                    worker.join();
+                }
+            }
+
+            void read(std::span<const ReadRequest> requests) override {
+                std::promise<void> finished;
+                readAsync(requests, [&finished](std::exception_ptr error) {
+                    if (error) {
+                        finished.set_exception(error);
+                    } else {
+                        finished.set_value();
+                    }
+                });
+                finished.get_future().get();
+            }
+
+            void readAsync(std::span<const ReadRequest> requests, std::function<void(std::exception_ptr)> done) override {
+                if (requests.empty()) {
+                    done(nullptr);
+                    return;
+                }
+                struct Batch {
+                    std::mutex mutex;
+                    std::size_t remaining;
+                    std::exception_ptr error;
+                    std::function<void(std::exception_ptr)> done;
+                };
+                auto batch = std::make_shared<Batch>();
+                batch->remaining = requests.size();
+                batch->done = std::move(done);
+
+                {
+                    std::lock_guard lock(m_mutex);
+                    for (const ReadRequest& request : requests) {
+                        m_queue.emplace_back([batch, &request] {
+                            std::exception_ptr error;
+                            try {
+                                readFully(request);
+                            } catch (...) {
+                                error = std::current_exception();
+                            }
+                            {
+                                std::lock_guard batchLock(batch->mutex);
+                                if (error && !batch->error) {
+                                    batch->error = error;
+                                }
+                                if (--batch->remaining != 0) {
+                                    return;
+                                }
+                            }
+                            batch->done(batch->error);
+                        });
+                    }
+                }
+                m_wake.notify_all();
+            }
+
+            [[nodiscard]] std::string_view name() const override { return "threads"; }
+
+        private:
+            static void readFully(const ReadRequest& request) {
+                std::size_t done = 0;
+                while (done < request.length) {
+                    const ssize_t n = ::pread(request.fd, request.buffer + done, request.length - done,
+                                              static_cast<off_t>(request.offset + done));
+                    if (n < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (n <= 0) {
+                        throw readError(request, n < 0 ? errno : 0);
+                    }
+                    done += static_cast<std::size_t>(n);
+                }
+            }
+
+            void work() {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock lock(m_mutex);
+                        m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                        if (m_queue.empty()) {
+                            return;
+                        }
+                        task = std::move(m_queue.front());
+                        m_queue.pop_front();
+                    }
+                    task();
+                }
+            }
+
+            std::mutex m_mutex;
+            std::condition_variable m_wake;
+            std::deque<std::function<void()>> m_queue;
+            bool m_stopping = false;
+            std::vector<std::thread> m_workers;
+        };
+
+#ifdef OPAT_HAVE_IO_URING
+        class AsyncRing;
+
+        // One io_uring instance, talked to through the syscalls directly so that liburing is not a dependency.
+        // A ring is single-producer, so only one batch at a time may use it.
+        class Ring {
+        public:
+            explicit Ring(unsigned queueDepth) {
+                io_uring_params params{};
+                m_ringFD = static_cast<int>(::syscall(__NR_io_uring_setup, std::max(queueDepth, 1u), &params));
+                if (m_ringFD < 0) {
+                    throw std::runtime_error(std::string("io_uring is unavailable: ") + std::strerror(errno));
+                }
+                try {
+                    mapRings(params);
+                } catch (...) {
+                    release();
+                    throw;
+                }
+            }
+
+            Ring(const Ring&) = delete;
+            Ring& operator=(const Ring&) = delete;
+
+            ~Ring() {
+                release();
+            }
+
+            void read(std::span<const ReadRequest> requests) {
+                std::vector<std::size_t> progress(requests.size(), 0);
+                std::size_t next = 0;
+                std::size_t inFlight = 0;
+                std::size_t completed = 0;
+                int firstError = -1;
+                std::size_t failedRequest = 0;
+                std::vector<std::size_t> resubmit;
+
+                try {
+                    while (inFlight > 0 || (firstError < 0 && completed < requests.size())) {
+                        // Entries the kernel did not take on the last call are still queued, and count against the ring
+                        unsigned queued = unsubmitted();
+                        while (firstError < 0 && inFlight + queued < m_entries && (!resubmit.empty() || next < requests.size())) {
+                            std::size_t i;
+                            if (!resubmit.empty()) {
+                                i = resubmit.back();
+                                resubmit.pop_back();
+                            } else {
+                                i = next++;
+                                if (requests[i].length == 0) {
+                                    ++completed;
+                                    continue;
+                                }
+                            }
+                            queueRead(requests[i], progress[i], i);
+                            ++queued;
+                        }
+                        if (queued == 0 && inFlight == 0) {
+                            break;
+                        }
+                        enter(queued, inFlight > 0 ? 1 : 0);
+                        inFlight += queued - unsubmitted();
+
+                        // Reap whatever has completed
+                        std::atomic_ref cqTail(*m_cqTail);
+                        std::atomic_ref cqHead(*m_cqHead);
+                        unsigned head = cqHead.load(std::memory_order_relaxed);
+                        const unsigned tail = cqTail.load(std::memory_order_acquire);
+                        for (; head != tail; ++head) {
+                            const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                            const auto i = static_cast<std::size_t>(cqe.user_data);
+                            --inFlight;
+                            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                                resubmit.push_back(i);
+                            } else if (cqe.res <= 0) {
+                                if (firstError < 0) {
+                                    firstError = -cqe.res;
+                                    failedRequest = i;
+                                }
+                                ++completed;
+                            } else {
+                                progress[i] += static_cast<std::size_t>(cqe.res);
+                                if (progress[i] < requests[i].length) {
+                                    resubmit.push_back(i); // short read
+                                } else {
+                                    ++completed;
+                                }
+                            }
+                        }
+                        cqHead.store(head, std::memory_order_release);
+                    }
+                } catch (...) {
+                    drain(inFlight);
+                    throw;
+                }
+
+                if (firstError >= 0) {
+                    throw readError(requests[failedRequest], firstError);
+                }
+            }
+
+            // False once a failure left reads in flight that could not be waited for; such a ring is not reused
+            [[nodiscard]] bool usable() const { return m_usable; }
+
+        private:
+            void mapRings(const io_uring_params& params) {
+                m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (singleMap) {
+                    m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+                }
+                m_sqRing = map(m_sqRingSize, IORING_OFF_SQ_RING);
+                m_cqRing = singleMap ? m_sqRing : map(m_cqRingSize, IORING_OFF_CQ_RING);
+                m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                m_sqes = static_cast<io_uring_sqe*>(map(m_sqesSize, IORING_OFF_SQES));
+
+                auto* sq = static_cast<char*>(m_sqRing);
+                m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+                m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                auto* cq = static_cast<char*>(m_cqRing);
+                m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+                m_entries = params.sq_entries;
+            }
+
+            void release() {
+                if (m_sqes != nullptr) {
+                    ::munmap(m_sqes, m_sqesSize);
+                }
+                if (m_cqRing != nullptr && m_cqRing != m_sqRing) {
+                    ::munmap(m_cqRing, m_cqRingSize);
+                }
+                if (m_sqRing != nullptr) {
+                    ::munmap(m_sqRing, m_sqRingSize);
+                }
+                if (m_ringFD >= 0) {
+                    ::close(m_ringFD);
+                }
+            }
+
+            void* map(std::size_t size, off_t offset) const {
+                void* ring = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFD, offset);
+                if (ring == MAP_FAILED) {
+                    throw std::runtime_error(std::string("Could not map io_uring: ") + std::strerror(errno));
+                }
+                return ring;
+            }
+
+            void queueRead(const ReadRequest& request, std::size_t done, std::size_t userData) {
+                std::atomic_ref sqTail(*m_sqTail);
+                const unsigned tail = sqTail.load(std::memory_order_relaxed);
+                const unsigned slot = tail & m_sqMask;
+                io_uring_sqe& sqe = m_sqes[slot];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = request.fd;
+                sqe.off = request.offset + done;
+                sqe.addr = reinterpret_cast<uint64_t>(request.buffer + done);
+                sqe.len = static_cast<uint32_t>(std::min<std::size_t>(request.length - done, 1u << 30));
+                sqe.user_data = userData;
+                m_sqArray[slot] = slot;
+                sqTail.store(tail + 1, std::memory_order_release);
+            }
+
+            void queueNop(std::size_t userData) {
+                std::atomic_ref sqTail(*m_sqTail);
+                const unsigned tail = sqTail.load(std::memory_order_relaxed);
+                const unsigned slot = tail & m_sqMask;
+                io_uring_sqe& sqe = m_sqes[slot];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_NOP;
+                sqe.user_data = userData;
+                m_sqArray[slot] = slot;
+                sqTail.store(tail + 1, std::memory_order_release);
+            }
+
+            // Entries queued in the submission ring that the kernel has not consumed yet
+            [[nodiscard]] unsigned unsubmitted() const {
+                return std::atomic_ref(*m_sqTail).load(std::memory_order_relaxed) -
+                       std::atomic_ref(*m_sqHead).load(std::memory_order_acquire);
+            }
+
+            // Submits up to `toSubmit` queued entries and waits for `minComplete` completions. The kernel may take
+            // fewer entries than offered (under memory pressure, say); the rest stay queued for the next call.
+            void enter(unsigned toSubmit, unsigned minComplete) const {
+                while (::syscall(__NR_io_uring_enter, m_ringFD, toSubmit, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+                    if ((errno == EAGAIN || errno == EBUSY) && minComplete > 0) {
+                        // Out of resources or completions are backed up; reaping what is in flight frees both
+                        toSubmit = 0;
+                    } else if (errno != EINTR) {
+                        throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+                    }
+                    toSubmit = std::min(toSubmit, unsubmitted());
+                }
+            }
+
+            // Leaves the ring empty after a failure, so that no read still writes into the caller's buffers
+            void drain(std::size_t inFlight) noexcept {
+                // Entries the kernel never took are withdrawn; it only reads the tail during io_uring_enter
+                std::atomic_ref(*m_sqTail).store(std::atomic_ref(*m_sqHead).load(std::memory_order_acquire),
+                                                 std::memory_order_release);
+                std::atomic_ref cqTail(*m_cqTail);
+                std::atomic_ref cqHead(*m_cqHead);
+                while (inFlight > 0) {
+                    unsigned head = cqHead.load(std::memory_order_relaxed);
+                    const unsigned tail = cqTail.load(std::memory_order_acquire);
+                    inFlight -= std::min<std::size_t>(inFlight, tail - head);
+                    cqHead.store(tail, std::memory_order_release);
+                    if (inFlight == 0) {
+                        break;
+                    }
+                    if (::syscall(__NR_io_uring_enter, m_ringFD, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                        errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                        m_usable = false;
+                        return;
+                    }
+                }
+            }
+
+            friend class AsyncRing;
+
+            int m_ringFD = -1;
+            unsigned m_entries = 0;
+            bool m_usable = true;
+            void* m_sqRing = nullptr;
+            void* m_cqRing = nullptr;
+            std::size_t m_sqRingSize = 0;
+            std::size_t m_cqRingSize = 0;
+            io_uring_sqe* m_sqes = nullptr;
+            std::size_t m_sqesSize = 0;
+            unsigned* m_sqHead = nullptr;
+            unsigned* m_sqTail = nullptr;
+            unsigned* m_sqArray = nullptr;
+            unsigned m_sqMask = 0;
+            unsigned* m_cqHead = nullptr;
+            unsigned* m_cqTail = nullptr;
+            io_uring_cqe* m_cqes = nullptr;
+            unsigned m_cqMask = 0;
+        };
+
+        // The ring behind IOUringBackend::readAsync, shared by every asynchronous batch. Any thread queues and
+        // submits reads under the mutex; one reaper thread waits for completions, resumes short reads, and runs
+        // each batch's callback once its last read has completed.
+        class AsyncRing {
+        public:
+            explicit AsyncRing(unsigned queueDepth) : m_ring(queueDepth), m_reaper([this] { reap(); }) {}
+
+            AsyncRing(const AsyncRing&) = delete;
+            AsyncRing& operator=(const AsyncRing&) = delete;
+
+            ~AsyncRing() {
+                {
+                    // A no-op wakes the reaper so that it can see m_stopping. It is retried rather than withdrawn
+                    // like a failed read, since the reaper would otherwise wait forever.
+                    std::unique_lock lock(m_mutex);
+                    m_stopping = true;
+                    m_ring.queueNop(0);
+                    m_queued.push_back(nullptr);
+                    while (!m_queued.empty()) {
+                        const unsigned offered = m_ring.unsubmitted();
+                        const long result = ::syscall(__NR_io_uring_enter, m_ring.m_ringFD, offered, 0, 0, nullptr, 0);
+                        const unsigned taken = offered - m_ring.unsubmitted();
+                        m_inFlight += taken;
+                        m_queued.erase(m_queued.begin(), m_queued.begin() + taken);
+                        if (result < 0 && errno != EINTR) {
+                            if (errno != EAGAIN && errno != EBUSY) {
+                                break; // The ring is broken, so the reaper's own wait fails and it stops
+                            }
+                            lock.unlock(); // Lets the reaper free the resources the kernel is short of
+                            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                            lock.lock();
+                        }
+                    }
+                }
+                m_reaper.join();
+            }
+
+            void read(std::span<const ReadRequest> requests, std::function<void(std::exception_ptr)> done) {
+                auto batch = std::make_unique<Batch>();
+                batch->requests = requests;
+                batch->progress.assign(requests.size(), 0);
+                batch->done = std::move(done);
+                batch->ops.reserve(requests.size());
+                for (std::size_t i = 0; i < requests.size(); ++i) {
+                    if (requests[i].length > 0) {
+                        batch->ops.push_back({batch.get(), i});
+                    }
+                }
+                batch->remaining = batch->ops.size();
+                if (batch->remaining == 0) {
+                    batch->done(nullptr);
+                    return;
+                }
+
+                std::vector<Batch*> finished;
+                {
+                    std::lock_guard lock(m_mutex);
+                    for (Op& op : batch->ops) {
+                        m_pending.push_back(&op);
+                    }
+                    static_cast<void>(batch.release()); // Owned by the ring until its callback has run
+                    fill(finished);
+                }
+                complete(finished);
+            }
+
+        private:
+            struct Batch;
+
+            // One request of a batch; its address is the user data of its submissions
+            struct Op {
+                Batch* batch;
+                std::size_t index;
+            };
+
+            struct Batch {
+                std::span<const ReadRequest> requests;
+                std::vector<std::size_t> progress;
+                std::vector<Op> ops;
+                std::size_t remaining = 0;
+                int error = -1;
+                std::size_t failedRequest = 0;
+                std::function<void(std::exception_ptr)> done;
+            };
+
+            // Queues pending reads while the ring has room, then submits them. Requires m_mutex.
+            void fill(std::vector<Batch*>& finished) {
+                while (!m_pending.empty() && m_inFlight + m_queued.size() < m_ring.m_entries) {
+                    Op* op = m_pending.front();
+                    m_pending.pop_front();
+                    m_ring.queueRead(op->batch->requests[op->index], op->batch->progress[op->index], reinterpret_cast<std::size_t>(op));
+                    m_queued.push_back(op);
+                }
+                submit(finished);
+            }
+
+            // Hands the queued entries to the kernel; those it does not take stay queued. Requires m_mutex.
+            void submit(std::vector<Batch*>& finished) {
+                while (!m_queued.empty()) {
+                    const unsigned offered = m_ring.unsubmitted();
+                    const long result = ::syscall(__NR_io_uring_enter, m_ring.m_ringFD, offered, 0, 0, nullptr, 0);
+                    const unsigned taken = offered - m_ring.unsubmitted();
+                    m_inFlight += taken;
+                    m_queued.erase(m_queued.begin(), m_queued.begin() + taken);
+                    if (result >= 0 && taken > 0) {
+                        continue;
+                    }
+                    if (result < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (m_inFlight > 0 && (result >= 0 || errno == EAGAIN || errno == EBUSY)) {
+                        return; // Retried once completions free the resources the kernel is short of
+                    }
+
+                    // Nothing in flight will make room, so the entries fail. The kernel only reads the tail in
+                    // io_uring_enter, so withdrawing them is safe.
+                    const int error = result < 0 ? errno : EAGAIN;
+                    std::atomic_ref(*m_ring.m_sqTail).store(std::atomic_ref(*m_ring.m_sqHead).load(std::memory_order_acquire),
+                                                            std::memory_order_release);
+                    for (Op* op : m_queued) {
+                        if (op != nullptr) {
+                            fail(*op, error, finished);
+                        }
+                    }
+                    m_queued.clear();
+                    return;
+                }
+            }
+
+            static void fail(const Op& op, int error, std::vector<Batch*>& finished) {
+                Batch& batch = *op.batch;
+                if (batch.error < 0) {
+                    batch.error = error;
+                    batch.failedRequest = op.index;
+                }
+                if (--batch.remaining == 0) {
+                    finished.push_back(&batch);
+                }
+            }
+
+            // Runs the callbacks of finished batches; called without m_mutex, so that callbacks may submit more
+            static void complete(const std::vector<Batch*>& finished) {
+                for (Batch* batch : finished) {
+                    const std::unique_ptr<Batch> owned(batch);
+                    batch->done(batch->error < 0 ? nullptr : std::make_exception_ptr(readError(batch->requests[batch->failedRequest], batch->error)));
+                }
+            }
+
+            void reap() {
+                std::atomic_ref cqTail(*m_ring.m_cqTail);
+                std::atomic_ref cqHead(*m_ring.m_cqHead);
+                while (true) {
+                    if (::syscall(__NR_io_uring_enter, m_ring.m_ringFD, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                        errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                        // Waiting failed outright; back off rather than spin until it recovers
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+
+                    std::vector<Batch*> finished;
+                    bool stop;
+                    {
+                        std::lock_guard lock(m_mutex);
+                        unsigned head = cqHead.load(std::memory_order_relaxed);
+                        const unsigned tail = cqTail.load(std::memory_order_acquire);
+                        for (; head != tail; ++head) {
+                            const io_uring_cqe& cqe = m_ring.m_cqes[head & m_ring.m_cqMask];
+                            --m_inFlight;
+                            auto* op = reinterpret_cast<Op*>(static_cast<uintptr_t>(cqe.user_data));
+                            if (op == nullptr) {
+                                continue; // The wake-up no-op
+                            }
+                            Batch& batch = *op->batch;
+                            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                                m_pending.push_front(op);
+                            } else if (cqe.res <= 0) {
+                                fail(*op, -cqe.res, finished);
+                            } else {
+                                batch.progress[op->index] += static_cast<std::size_t>(cqe.res);
+                                if (batch.progress[op->index] < batch.requests[op->index].length) {
+                                    m_pending.push_front(op); // short read
+                                } else if (--batch.remaining == 0) {
+                                    finished.push_back(&batch);
+                                }
+                            }
+                        }
+                        cqHead.store(head, std::memory_order_release);
+                        fill(finished);
+                        stop = m_stopping && m_inFlight == 0 && m_queued.empty() && m_pending.empty();
+                    }
+                    complete(finished);
+                    if (stop) {
+                        return;
+                    }
+                }
+            }
+
+            Ring m_ring;
+            std::mutex m_mutex;
+            std::deque<Op*> m_pending;  ///< Reads waiting for room in the ring.
+            std::deque<Op*> m_queued;   ///< Entries in the submission ring the kernel has not taken, in order; null for the wake-up.
+            std::size_t m_inFlight = 0; ///< Entries the kernel has taken and not completed.
+            bool m_stopping = false;
+            std::thread m_reaper;
+        };
+
+        // Gives each concurrent batch a ring of its own, so that threads never wait on each other's reads.
+        // Rings are created on demand and kept for reuse, so there are as many as the peak number of readers.
+        class IOUringBackend final : public IOBackend {
+        public:
+            explicit IOUringBackend(unsigned queueDepth) : m_queueDepth(queueDepth) {
+                m_idle.push_back(std::make_unique<Ring>(queueDepth)); // fails early if io_uring is unavailable
+            }
+
+            void read(std::span<const ReadRequest> requests) override {
+                if (requests.empty()) {
+                    return;
+                }
+                std::unique_ptr<Ring> ring;
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (!m_idle.empty()) {
+                        ring = std::move(m_idle.back());
+                        m_idle.pop_back();
+                    }
+                }
+                if (!ring) {
+                    ring = std::make_unique<Ring>(m_queueDepth);
+                }
+
+                try {
+                    ring->read(requests);
+                } catch (...) {
+                    giveBack(std::move(ring));
+                    throw;
+                }
+                giveBack(std::move(ring));
+            }
+
+            void readAsync(std::span<const ReadRequest> requests, std::function<void(std::exception_ptr)> done) override {
+                // Started on first use, so that backends which are only read synchronously have no reaper thread
+                std::call_once(m_asyncStarted, [this] { m_async = std::make_unique<AsyncRing>(m_queueDepth); });
+                m_async->read(requests, std::move(done));
+            }
+
+            [[nodiscard]] std::string_view name() const override { return "io_uring"; }
+
+        private:
+            void giveBack(std::unique_ptr<Ring> ring) {
+                if (!ring->usable()) {
+                    // The kernel may still write into buffers through it, so it is never unmapped or reused
+                    static_cast<void>(ring.release());
+                    return;
+                }
+                std::lock_guard lock(m_mutex);
+                m_idle.push_back(std::move(ring));
+            }
+
+            unsigned m_queueDepth;
+            std::mutex m_mutex;
+            std::vector<std::unique_ptr<Ring>> m_idle;
+            std::once_flag m_asyncStarted;
+            std::unique_ptr<AsyncRing> m_async;
+        };
+#endif
+    }
+
+    std::unique_ptr<IOBackend> makeBackend(BackendKind kind, unsigned queueDepth) {
+        if (kind != BackendKind::ThreadPool) {
+#ifdef OPAT_HAVE_IO_URING
+            try {
+                return std::make_unique<IOUringBackend>(queueDepth);
+            } catch (const std::runtime_error&) {
+                if (kind == BackendKind::IOUring) {
+                    throw;
+                }
+            }
+#else
+            if (kind == BackendKind::IOUring) {
+                throw std::runtime_error("io_uring is unavailable: opatIO was built without <linux/io_uring.h>");
+            }
+#endif
+        }
+        // Threads blocked in pread are cheap, so the pool is sized for the queue depth rather than the core count
+        return std::make_unique<ThreadPoolBackend>(std::min(queueDepth, 64u));
+    }
+
+    IOBackend& defaultBackend() {
+        // Intentionally leaked, like MemoryManager::global, so that it outlives static destruction
+        static IOBackend* backend = [] {
+            const char* choice = std::getenv("OPAT_IO_BACKEND");
+            const std::string_view name = choice == nullptr ? "" : choice;
+            if (name == "io_uring") {
+                return makeBackend(BackendKind::IOUring).release();
+            }
+            if (name == "threads") {
+                return makeBackend(BackendKind::ThreadPool).release();
+            }
+            return makeBackend(BackendKind::Auto).release();
+        }();
+        return *backend;
+    }
+
+    ReadArena::ReadArena(std::size_t blockSize) : m_blockSize(std::max<std::size_t>(blockSize, BLOCK_ALIGNMENT)) {}
+
+    void ReadArena::AlignedDelete::operator()(std::byte* block) const {
+        ::operator delete[](block, std::align_val_t{BLOCK_ALIGNMENT});
+    }
+
+    std::byte* ReadArena::allocate(std::size_t bytes, std::size_t alignment) {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > BLOCK_ALIGNMENT) {
+            throw std::invalid_argument("ReadArena alignment must be a power of two no larger than " + std::to_string(BLOCK_ALIGNMENT));
+        }
+        if (!m_blocks.empty()) {
+            Block& block = m_blocks.back();
+            const std::size_t start = (block.used + alignment - 1) & ~(alignment - 1);
+            if (start + bytes <= block.size) {
+                block.used = start + bytes;
+                return block.data.get() + start;
+            }
+        }
+        const std::size_t size = std::max(m_blockSize, (bytes + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1));
+        auto* data = static_cast<std::byte*>(::operator new[](size, std::align_val_t{BLOCK_ALIGNMENT}));
+        m_blocks.push_back({std::unique_ptr<std::byte[], AlignedDelete>(data), size, bytes});
+        return data;
+    }
+
+    void ReadArena::reset() {
+        m_blocks.clear();
+    }
+
+    std::size_t ReadArena::capacity() const {
+        std::size_t total = 0;
+        for (const Block& block : m_blocks) {
+            total += block.size;
+        }
+        return total;
+    }
+
+}
@@ -0,0 +1,397 @@
+#include "lazyCardStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <spanstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace opat {
+
+    namespace {
+        // Bytes held by a card once all of its tables have been read. Tables are read on demand, so this is
+        // an upper bound; it is what the memory manager is charged, since any table may be read at any time.
+        std::size_t cardBytes(const DataCard& card) {
+            std::size_t bytes = sizeof(DataCard);
+            for (const auto& [tag, entry] : card.tableIndex.tableIndex) {
+                bytes += tag.size() + sizeof(OPATTable);
+                bytes += (static_cast<std::size_t>(entry.numRows) * entry.numColumns * entry.size + entry.numRows + entry.numColumns) * sizeof(double);
+            }
+            return bytes;
+        }
+    }
+
+    LazyCardStore::LazyCardStore(memory::MemoryManager& manager, io::IOBackend* backend) : m_manager(manager), m_backend(backend) {}
+
+    LazyCardStore::~LazyCardStore() {
+        // After this no eviction callback can reach the slots, which are destroyed next
+        for (const auto& source : m_sources) {
+            m_manager.unregisterConsumer(source->consumer);
+        }
+    }
+
+    std::size_t LazyCardStore::addSource(const std::string& filename) {
+        auto source = std::make_unique<Source>();
+        source->file = std::make_shared<OPATFileHandle>(filename);
+        source->consumer = m_manager.registerConsumer(filename);
+        m_sources.push_back(std::move(source));
+        return m_sources.size() - 1;
+    }
+
+    void LazyCardStore::addCard(const CardCatalogEntry& entry, std::size_t source) {
+        if (source >= m_sources.size()) {
+            throw std::out_of_range("Unknown card source " + std::to_string(source));
+        }
+        auto slot = std::make_unique<Slot>();
+        slot->entry = entry;
+        slot->source = source;
+        if (!m_slots.emplace(entry.index, std::move(slot)).second) {
+            throw std::invalid_argument("A card with the same index has already been added to the store.");
+        }
+    }
+
+    LazyCardStore::Slot* LazyCardStore::slotFor(const FloatIndexVector& index) const {
+        const auto it = m_slots.find(index);
+        return it == m_slots.end() ? nullptr : it->second.get();
+    }
+
+    std::shared_ptr<const DataCard> LazyCardStore::acquire(const FloatIndexVector& index) const {
+        Slot* slot = slotFor(index);
+        if (slot == nullptr) {
+            return nullptr;
+        }
+        std::unique_lock slotLock(slot->mutex);
+        if (!slot->card) {
+            return load(*slot, slotLock, false);
+        }
+        std::shared_ptr<const DataCard> card = slot->card;
+        const auto memoryEntry = slot->memoryEntry;
+        slotLock.unlock();
+        m_manager.touch(memoryEntry);
+        return card;
+    }
+
+    // The reads of one prefetch, which run in stages: card headers, then the indices the headers locate,
+    // then the requested tables. Each stage fills `requests` for the next read.
+    struct LazyCardStore::Prefetch {
+        struct Table {
+            std::shared_ptr<const DataCard> card;
+            const Slot* slot;
+            const std::string* tag;
+            TableIndexEntry entry;
+        };
+
+        std::vector<std::string> tags;
+        std::vector<Slot*> slots;
+        std::vector<Slot*> pending;
+        std::vector<CardHeader> headers;
+        std::vector<Table> tables;
+        io::ReadArena arena;
+        std::vector<io::ReadRequest> requests;
+        std::chrono::steady_clock::time_point start;
+        std::size_t loaded = 0;
+        std::function<void(std::exception_ptr, std::size_t)> done;
+    };
+
+    std::size_t LazyCardStore::prefetch(std::span<const FloatIndexVector> indices, std::span<const std::string> tags) const {
+        io::IOBackend& backend = m_backend != nullptr ? *m_backend : io::defaultBackend();
+        Prefetch batch = collect(indices, tags);
+        if (requestHeaders(batch)) {
+            backend.read(batch.requests);
+            requestIndices(batch);
+            backend.read(batch.requests);
+            installCards(batch);
+        }
+        if (requestTables(batch)) {
+            backend.read(batch.requests);
+            supplyTables(batch);
+        }
+        return batch.loaded;
+    }
+
+    void LazyCardStore::prefetchAsync(std::span<const FloatIndexVector> indices, std::span<const std::string> tags,
+                                      std::function<void(std::exception_ptr, std::size_t)> done) const {
+        auto batch = std::make_shared<Prefetch>(collect(indices, tags));
+        batch->done = std::move(done);
+        advance(std::move(batch), PrefetchStage::Headers, nullptr);
+    }
+
+    void LazyCardStore::advance(std::shared_ptr<Prefetch> batch, PrefetchStage stage, std::exception_ptr error) const {
+        // Starts the read the next stage needs, and picks up from there once the backend has completed it
+        const auto readThen = [this, &batch](PrefetchStage next) {
+            io::IOBackend& backend = m_backend != nullptr ? *m_backend : io::defaultBackend();
+            const std::span<const io::ReadRequest> requests = batch->requests;
+            backend.readAsync(requests, [this, batch = std::move(batch), next](std::exception_ptr readError) mutable {
+                advance(std::move(batch), next, readError);
+            });
+        };
+
+        try {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            switch (stage) {
+                case PrefetchStage::Headers:
+                    if (requestHeaders(*batch)) {
+                        return readThen(PrefetchStage::Indices);
+                    }
+                    break;
+                case PrefetchStage::Indices:
+                    requestIndices(*batch);
+                    return readThen(PrefetchStage::Cards);
+                case PrefetchStage::Cards:
+                    installCards(*batch);
+                    break;
+                case PrefetchStage::Tables:
+                    supplyTables(*batch);
+                    stage = PrefetchStage::Done;
+                    break;
+                case PrefetchStage::Done:
+                    break;
+            }
+            if (stage != PrefetchStage::Done && requestTables(*batch)) {
+                return readThen(PrefetchStage::Tables);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        batch->done(error, batch->loaded);
+    }
+
+    LazyCardStore::Prefetch LazyCardStore::collect(std::span<const FloatIndexVector> indices, std::span<const std::string> tags) const {
+        Prefetch batch;
+        batch.tags.assign(tags.begin(), tags.end());
+        for (const FloatIndexVector& index : indices) {
+            Slot* slot = slotFor(index);
+            if (slot == nullptr || std::ranges::find(batch.slots, slot) != batch.slots.end()) {
+                continue;
+            }
+            batch.slots.push_back(slot);
+            std::lock_guard slotLock(slot->mutex);
+            if (!slot->card) {
+                batch.pending.push_back(slot);
+            }
+        }
+        return batch;
+    }
+
+    bool LazyCardStore::requestHeaders(Prefetch& batch) const {
+        // The index sits after the tables, at an offset the header gives, so headers are read first and then
+        // the index (and statistics) of every card; the tables themselves are left deferred
+        if (batch.pending.empty()) {
+            return false;
+        }
+        batch.start = std::chrono::steady_clock::now();
+        batch.requests.reserve(batch.pending.size());
+        for (const Slot* slot : batch.pending) {
+            batch.requests.push_back({m_sources[slot->source]->file->descriptor, slot->entry.byteStart, sizeof(CardHeader),
+                                      batch.arena.allocate(sizeof(CardHeader))});
+        }
+        return true;
+    }
+
+    void LazyCardStore::requestIndices(Prefetch& batch) const {
+        std::vector<io::ReadRequest>& requests = batch.requests;
+        batch.headers.reserve(batch.pending.size());
+        for (std::size_t i = 0; i < batch.pending.size(); ++i) {
+            const CardCatalogEntry& cardEntry = batch.pending[i]->entry;
+            std::ispanstream stream(std::span(reinterpret_cast<char*>(requests[i].buffer), requests[i].length));
+            const CardHeader& header = batch.headers.emplace_back(readDataCardHeader(stream, cardEntry, requests[i].offset));
+
+            const uint64_t indexEnd = header.indexOffset + static_cast<uint64_t>(header.numTables) * sizeof(TableIndexEntry);
+            const uint64_t end = header.statsOffset == 0 ? indexEnd : header.statsOffset + static_cast<uint64_t>(header.numTables) * sizeof(TableStatistics);
+            if (end > cardEntry.byteEnd - cardEntry.byteStart || (header.statsOffset != 0 && header.statsOffset < indexEnd)) {
+                throw std::runtime_error("The header of the card at byte " + std::to_string(cardEntry.byteStart) + " is corrupt.");
+            }
+            requests[i].offset = cardEntry.byteStart + header.indexOffset;
+            requests[i].length = end - header.indexOffset;
+            requests[i].buffer = batch.arena.allocate(requests[i].length);
+        }
+    }
+
+    void LazyCardStore::installCards(Prefetch& batch) const {
+        const std::chrono::duration<double, std::micro> batchTime = std::chrono::steady_clock::now() - batch.start;
+        const double cost = batchTime.count() / static_cast<double>(batch.pending.size());
+
+        std::vector<std::shared_ptr<const DataCard>> cards;
+        cards.reserve(batch.pending.size());
+        for (std::size_t i = 0; i < batch.pending.size(); ++i) {
+            // The buffer starts at the index
+            std::ispanstream stream(std::span(reinterpret_cast<char*>(batch.requests[i].buffer), batch.requests[i].length));
+            TableIndex tableIndex = readTableIndex(stream, batch.pending[i]->entry, batch.headers[i], batch.requests[i].offset);
+            cards.push_back(std::make_shared<const DataCard>(
+                readDataCardDeferred(m_sources[batch.pending[i]->source]->file, batch.pending[i]->entry, batch.headers[i], std::move(tableIndex))));
+        }
+
+        for (std::size_t i = 0; i < batch.pending.size(); ++i) {
+            std::unique_lock slotLock(batch.pending[i]->mutex);
+            if (batch.pending[i]->card) {
+                continue; // Loaded by another thread while the batch was in flight
+            }
+            install(*batch.pending[i], slotLock, std::move(cards[i]), cost, false);
+            ++batch.loaded;
+        }
+        m_loaded.fetch_add(batch.loaded, std::memory_order_relaxed);
+    }
+
+    bool LazyCardStore::requestTables(Prefetch& batch) const {
+        for (Slot* slot : batch.slots) {
+            std::shared_ptr<const DataCard> card;
+            {
+                std::lock_guard slotLock(slot->mutex);
+                card = slot->card;
+            }
+            if (!card) {
+                continue; // Evicted since its index was read; the tables are read when it is next looked up
+            }
+            for (const std::string& tag : batch.tags) {
+                const auto it = card->tableIndex.tableIndex.find(tag);
+                if (it != card->tableIndex.tableIndex.end() && !card->isTableRead(tag)) {
+                    batch.tables.push_back({card, slot, &tag, it->second});
+                }
+            }
+        }
+        if (batch.tables.empty()) {
+            return false;
+        }
+
+        batch.arena.reset();
+        batch.requests.clear();
+        batch.requests.reserve(batch.tables.size());
+        for (const Prefetch::Table& table : batch.tables) {
+            const std::size_t length = (table.entry.numRows + table.entry.numColumns +
+                                        static_cast<std::size_t>(table.entry.numRows) * table.entry.numColumns * table.entry.size) * sizeof(double);
+            batch.requests.push_back({m_sources[table.slot->source]->file->descriptor, table.slot->entry.byteStart + table.entry.byteStart,
+                                      length, batch.arena.allocate(length)});
+        }
+        return true;
+    }
+
+    void LazyCardStore::supplyTables(Prefetch& batch) const {
+        for (std::size_t i = 0; i < batch.tables.size(); ++i) {
+            const Prefetch::Table& table = batch.tables[i];
+            // Each buffer starts at its table
+            std::ispanstream stream(std::span(reinterpret_cast<char*>(batch.requests[i].buffer), batch.requests[i].length));
+            table.card->supplyTable(*table.tag, readOPATTable(stream, table.slot->entry, table.entry, batch.requests[i].offset));
+        }
+    }
+
+    const DataCard* LazyCardStore::find(const FloatIndexVector& index) const {
+        Slot* slot = slotFor(index);
+        if (slot == nullptr) {
+            return nullptr;
+        }
+        if (const DataCard* card = slot->pinnedForever.load(std::memory_order_acquire)) {
+            return card;
+        }
+
+        std::shared_ptr<const DataCard> card = loadPinned(*slot);
+        std::unique_lock slotLock(slot->mutex);
+        if (const DataCard* pinned = slot->pinnedForever.load(std::memory_order_relaxed)) {
+            // Another thread pinned the card first; one permanent pin is enough
+            const auto memoryEntry = slot->memoryEntry;
+            slotLock.unlock();
+            m_manager.unpin(memoryEntry);
+            return pinned;
+        }
+        slot->pinnedForever.store(card.get(), std::memory_order_release);
+        return card.get();
+    }
+
+    bool LazyCardStore::pin(const FloatIndexVector& index) {
+        Slot* slot = slotFor(index);
+        if (slot == nullptr) {
+            return false;
+        }
+        loadPinned(*slot);
+        std::lock_guard slotLock(slot->mutex);
+        slot->pins++;
+        return true;
+    }
+
+    void LazyCardStore::unpin(const FloatIndexVector& index) {
+        Slot* slot = slotFor(index);
+        if (slot == nullptr) {
+            return;
+        }
+        std::unique_lock slotLock(slot->mutex);
+        if (slot->pins == 0) {
+            return;
+        }
+        slot->pins--;
+        const auto memoryEntry = slot->memoryEntry;
+        slotLock.unlock();
+        m_manager.unpin(memoryEntry);
+    }
+
+    std::shared_ptr<const DataCard> LazyCardStore::loadPinned(Slot& slot) const {
+        while (true) {
+            std::unique_lock slotLock(slot.mutex);
+            if (!slot.card) {
+                return load(slot, slotLock, true);
+            }
+            std::shared_ptr<const DataCard> card = slot.card;
+            const auto memoryEntry = slot.memoryEntry;
+            slotLock.unlock();
+            if (m_manager.pin(memoryEntry)) {
+                return card;
+            }
+            // The copy we saw was evicted, or is still being charged by the thread which loaded it
+            std::this_thread::yield();
+        }
+    }
+
+    std::shared_ptr<const DataCard> LazyCardStore::load(Slot& slot, std::unique_lock<std::mutex>& slotLock, bool pinned) const {
+        const Source& source = *m_sources[slot.source];
+        const auto start = std::chrono::steady_clock::now();
+        auto card = std::make_shared<const DataCard>(readDataCardDeferred(source.file, slot.entry));
+        const std::chrono::duration<double, std::micro> loadTime = std::chrono::steady_clock::now() - start;
+        m_loaded.fetch_add(1, std::memory_order_relaxed);
+        return install(slot, slotLock, std::move(card), loadTime.count(), pinned);
+    }
+
+    std::shared_ptr<const DataCard> LazyCardStore::install(Slot& slot, std::unique_lock<std::mutex>& slotLock,
+                                                           std::shared_ptr<const DataCard> card, double cost, bool pinned) const {
+        const auto memoryEntry = m_manager.allocateEntryID();
+        slot.card = card;
+        slot.memoryEntry = memoryEntry;
+        // Charging may evict other cards, whose callbacks take their slot locks, so this one must be released first
+        slotLock.unlock();
+        m_manager.insert(memoryEntry, m_sources[slot.source]->consumer, cardBytes(*card), cost,
+                         [&slot, memoryEntry] { evict(slot, memoryEntry); }, pinned);
+        return card;
+    }
+
+    void LazyCardStore::evict(Slot& slot, memory::MemoryManager::EntryID memoryEntry) {
+        std::lock_guard slotLock(slot.mutex);
+        if (slot.memoryEntry == memoryEntry) {
+            slot.card.reset();
+            slot.memoryEntry = 0;
+        }
+    }
+
+    bool LazyCardStore::contains(const FloatIndexVector& index) const {
+        return m_slots.contains(index);
+    }
+
+    bool LazyCardStore::isLoaded(const FloatIndexVector& index) const {
+        Slot* slot = slotFor(index);
+        if (slot == nullptr) {
+            return false;
+        }
+        std::lock_guard slotLock(slot->mutex);
+        return slot->card != nullptr;
+    }
+
+    const std::string& LazyCardStore::sourceFile(const FloatIndexVector& index) const {
+        const auto it = m_slots.find(index);
+        if (it == m_slots.end()) {
+            throw std::out_of_range("Card not found for the given index.");
+        }
+        return m_sources[it->second->source]->file->filename;
+    }
+
+}
@@ -0,0 +1,263 @@
+#include "memoryManager.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+
+namespace opat::memory {
+
+    namespace {
+        // Parses OPAT_MEMORY_BUDGET-style sizes: a byte count with an optional K, M or G suffix
+        std::size_t parseBudget(const char* value) {
+            if (value == nullptr || value[0] == '\0') {
+                return MemoryManager::UNLIMITED;
+            }
+            char* end = nullptr;
+            const unsigned long long number = std::strtoull(value, &end, 10);
+            if (end == value) {
+                return MemoryManager::UNLIMITED;
+            }
+            switch (std::toupper(static_cast<unsigned char>(*end))) {
+                case 'K': return static_cast<std::size_t>(number) << 10;
+                case 'M': return static_cast<std::size_t>(number) << 20;
+                case 'G': return static_cast<std::size_t>(number) << 30;
+                default: return static_cast<std::size_t>(number);
+            }
+        }
+    }
+
+    MemoryManager::MemoryManager(std::size_t budget) : m_budget(budget) {}
+
+    MemoryManager& MemoryManager::global() {
+        // Intentionally leaked so that caches destroyed during static destruction can still unregister
+        static auto* manager = new MemoryManager(parseBudget(std::getenv("OPAT_MEMORY_BUDGET")));
+        return *manager;
+    }
+
+    void MemoryManager::setBudget(std::size_t bytes) {
+        Victims victims;
+        {
+            std::lock_guard lock(m_mutex);
+            m_budget = bytes;
+            evictLocked(0, victims);
+        }
+        runVictims(victims);
+    }
+
+    std::size_t MemoryManager::budget() const {
+        std::lock_guard lock(m_mutex);
+        return m_budget;
+    }
+
+    std::size_t MemoryManager::usage() const {
+        std::lock_guard lock(m_mutex);
+        return m_usage;
+    }
+
+    std::vector<ConsumerUsage> MemoryManager::report() const {
+        std::map<std::string, ConsumerUsage> byName;
+        {
+            std::lock_guard lock(m_mutex);
+            for (const auto& consumer : m_consumers | std::views::values) {
+                ConsumerUsage& usage = byName[consumer.name];
+                usage.name = consumer.name;
+                usage.bytes += consumer.bytes;
+                usage.pinnedBytes += consumer.pinnedBytes;
+                usage.entries += consumer.entries;
+                usage.evictions += consumer.evictions;
+            }
+        }
+        std::vector<ConsumerUsage> report;
+        report.reserve(byName.size());
+        for (auto& usage : byName | std::views::values) {
+            report.push_back(std::move(usage));
+        }
+        return report;
+    }
+
+    MemoryManager::ConsumerID MemoryManager::registerConsumer(const std::string& name) {
+        std::lock_guard lock(m_mutex);
+        const ConsumerID id = m_nextConsumer++;
+        m_consumers[id].name = name;
+        return id;
+    }
+
+    void MemoryManager::unregisterConsumer(ConsumerID consumer) {
+        std::unique_lock lock(m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            auto next = std::next(it);
+            if (it->second.consumer == consumer) {
+                removeLocked(it);
+            }
+            it = next;
+        }
+        m_callbacksDone.wait(lock, [&] {
+            const auto it = m_consumers.find(consumer);
+            return it == m_consumers.end() || it->second.callbacksInFlight == 0;
+        });
+        m_consumers.erase(consumer);
+    }
+
+    MemoryManager::EntryID MemoryManager::allocateEntryID() {
+        std::lock_guard lock(m_mutex);
+        return m_nextEntry++;
+    }
+
+    void MemoryManager::insert(EntryID entry, ConsumerID consumer, std::size_t bytes, double cost, std::function<void()> evict, bool pinned) {
+        Victims victims;
+        {
+            std::lock_guard lock(m_mutex);
+            const auto consumerIt = m_consumers.find(consumer);
+            if (consumerIt == m_consumers.end()) {
+                throw std::out_of_range("Unknown memory consumer " + std::to_string(consumer));
+            }
+            evictLocked(bytes, victims);
+
+            Entry& added = m_entries[entry];
+            added = {consumer, bytes, cost, 0.0, pinned ? 1u : 0u, std::move(evict)};
+            added.priority = priorityOf(added);
+            if (!pinned) {
+                m_evictionQueue.emplace(added.priority, entry);
+            } else {
+                consumerIt->second.pinnedBytes += bytes;
+            }
+            consumerIt->second.bytes += bytes;
+            consumerIt->second.entries++;
+            m_usage += bytes;
+        }
+        runVictims(victims);
+    }
+
+    void MemoryManager::touch(EntryID entry) {
+        std::lock_guard lock(m_mutex);
+        const auto it = m_entries.find(entry);
+        if (it == m_entries.end() || it->second.pins > 0) {
+            return;
+        }
+        m_evictionQueue.erase({it->second.priority, entry});
+        it->second.priority = priorityOf(it->second);
+        m_evictionQueue.emplace(it->second.priority, entry);
+    }
+
+    bool MemoryManager::pin(EntryID entry) {
+        std::lock_guard lock(m_mutex);
+        const auto it = m_entries.find(entry);
+        if (it == m_entries.end()) {
+            return false;
+        }
+        if (it->second.pins++ == 0) {
+            m_evictionQueue.erase({it->second.priority, entry});
+            m_consumers.at(it->second.consumer).pinnedBytes += it->second.bytes;
+        }
+        return true;
+    }
+
+    void MemoryManager::unpin(EntryID entry) {
+        Victims victims;
+        {
+            std::lock_guard lock(m_mutex);
+            const auto it = m_entries.find(entry);
+            if (it == m_entries.end() || it->second.pins == 0) {
+                return;
+            }
+            if (--it->second.pins == 0) {
+                m_consumers.at(it->second.consumer).pinnedBytes -= it->second.bytes;
+                it->second.priority = priorityOf(it->second);
+                m_evictionQueue.emplace(it->second.priority, entry);
+                // Pinned memory may have pushed usage over budget; catch up now that it can be evicted
+                evictLocked(0, victims);
+            }
+        }
+        runVictims(victims);
+    }
+
+    void MemoryManager::erase(EntryID entry) {
+        std::lock_guard lock(m_mutex);
+        if (const auto it = m_entries.find(entry); it != m_entries.end()) {
+            removeLocked(it);
+        }
+    }
+
+    double MemoryManager::priorityOf(const Entry& entry) const {
+        return m_clock + entry.cost / static_cast<double>(std::max<std::size_t>(entry.bytes, 1));
+    }
+
+    void MemoryManager::removeLocked(std::unordered_map<EntryID, Entry>::iterator it) {
+        const Entry& entry = it->second;
+        Consumer& consumer = m_consumers.at(entry.consumer);
+        if (entry.pins > 0) {
+            consumer.pinnedBytes -= entry.bytes;
+        } else {
+            m_evictionQueue.erase({entry.priority, it->first});
+        }
+        consumer.bytes -= entry.bytes;
+        consumer.entries--;
+        m_usage -= entry.bytes;
+        m_entries.erase(it);
+    }
+
+    void MemoryManager::evictLocked(std::size_t incoming, Victims& victims) {
+        while (!m_evictionQueue.empty() && (incoming > m_budget || m_usage > m_budget - incoming)) {
+            const auto [priority, id] = *m_evictionQueue.begin();
+            const auto it = m_entries.find(id);
+            m_clock = priority;
+            Consumer& consumer = m_consumers.at(it->second.consumer);
+            consumer.evictions++;
+            consumer.callbacksInFlight++;
+            victims.emplace_back(it->second.consumer, std::move(it->second.evict));
+            removeLocked(it);
+        }
+    }
+
+    void MemoryManager::runVictims(Victims& victims) {
+        if (victims.empty()) {
+            return;
+        }
+        for (auto& [consumer, evict] : victims) {
+            if (evict) {
+                evict();
+            }
+        }
+        std::lock_guard lock(m_mutex);
+        for (const auto& consumer : victims | std::views::keys) {
+            m_consumers.at(consumer).callbacksInFlight--;
+        }
+        m_callbacksDone.notify_all();
+    }
+
+    Reservation::Reservation(MemoryManager& manager, const std::string& name, std::size_t bytes)
+        : m_manager(&manager), m_consumer(manager.registerConsumer(name)), m_bytes(bytes) {
+        manager.insert(manager.allocateEntryID(), m_consumer, bytes, 0.0, {}, true);
+    }
+
+    Reservation::Reservation(Reservation&& other) noexcept
+        : m_manager(std::exchange(other.m_manager, nullptr)),
+          m_consumer(std::exchange(other.m_consumer, 0)),
+          m_bytes(std::exchange(other.m_bytes, 0)) {}
+
+    Reservation& Reservation::operator=(Reservation&& other) noexcept {
+        if (this != &other) {
+            release();
+            m_manager = std::exchange(other.m_manager, nullptr);
+            m_consumer = std::exchange(other.m_consumer, 0);
+            m_bytes = std::exchange(other.m_bytes, 0);
+        }
+        return *this;
+    }
+
+    Reservation::~Reservation() {
+        release();
+    }
+
+    void Reservation::release() {
+        if (m_manager != nullptr) {
+            m_manager->unregisterConsumer(m_consumer);
+            m_manager = nullptr;
+        }
+    }
+
+}
@@ -0,0 +1,135 @@
+#include "merkle.h"
+
+#include "constexpr-xxh3.h"
+
+#include <algorithm>
+#include <atomic>
+#include <ranges>
+#include <stdexcept>
+#include <thread>
+
+namespace opat::merkle {
+
+    namespace {
+        // Catalog entries in the order their cards are stored
+        std::vector<const CardCatalogEntry*> storedOrder(const OPAT& opat) {
+            std::vector<const CardCatalogEntry*> entries;
+            entries.reserve(opat.cardCatalog.tableIndex.size());
+            for (const CardCatalogEntry& entry : opat.cardCatalog.tableIndex | std::views::values) {
+                entries.push_back(&entry);
+            }
+            std::ranges::sort(entries, {}, &CardCatalogEntry::byteStart);
+            return entries;
+        }
+    }
+
+    uint64_t hash(const void* data, std::size_t size, uint64_t seed) {
+        // The vendored implementation is written for constant evaluation, but its internals run as well at runtime
+        using namespace constexpr_xxh3;
+        return XXH3_64bits_internal(static_cast<const uint8_t*>(data), size, seed, kSecret, sizeof(kSecret),
+            [](const uint8_t* input, std::size_t length, uint64_t seed, const uint8_t*, std::size_t) {
+                if (seed == 0) {
+                    return hashLong_64b_internal(input, length, kSecret, sizeof(kSecret));
+                }
+                uint8_t secret[SECRET_DEFAULT_SIZE];
+                for (std::size_t i = 0; i < SECRET_DEFAULT_SIZE; i += 16) {
+                    writeLE64(secret + i, readLE64(kSecret + i) + seed);
+                    writeLE64(secret + i + 8, readLE64(kSecret + i + 8) - seed);
+                }
+                return hashLong_64b_internal(input, length, secret, sizeof(secret));
+            });
+    }
+
+    uint64_t combine(std::span<const uint64_t> children) {
+        if (children.empty() || std::ranges::find(children, uint64_t{0}) != children.end()) {
+            return 0;
+        }
+        if (!is_big_endian()) {
+            return hash(children.data(), children.size_bytes());
+        }
+        std::vector<uint64_t> little(children.begin(), children.end());
+        for (uint64_t& child : little) {
+            child = swap_bytes(child);
+        }
+        return hash(little.data(), little.size() * sizeof(uint64_t));
+    }
+
+    uint64_t cardRoot(const TableIndex& tableIndex) {
+        std::vector<const TableIndexEntry*> entries;
+        entries.reserve(tableIndex.tableIndex.size());
+        for (const TableIndexEntry& entry : tableIndex.tableIndex | std::views::values) {
+            entries.push_back(&entry);
+        }
+        std::ranges::sort(entries, {}, &TableIndexEntry::byteStart);
+        std::vector<uint64_t> checksums;
+        checksums.reserve(entries.size());
+        for (const TableIndexEntry* entry : entries) {
+            checksums.push_back(entry->checksum);
+        }
+        return combine(checksums);
+    }
+
+    uint64_t fileRoot(const OPAT& opat) {
+        std::vector<uint64_t> roots;
+        for (const CardCatalogEntry* entry : storedOrder(opat)) {
+            roots.push_back(opat.acquire(entry->index)->header.merkleRoot);
+        }
+        return combine(roots);
+    }
+
+    Report verify(const OPAT& opat, unsigned threads) {
+        const std::vector<const CardCatalogEntry*> entries = storedOrder(opat);
+        std::vector<uint64_t> roots(entries.size(), 0);
+        std::vector<char> corrupt(entries.size(), 0);
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> tables{0};
+
+        // Each card is a subtree of its own, so cards are checked independently and only their roots are combined
+        const auto check = [&] {
+            for (std::size_t i = next++; i < entries.size(); i = next++) {
+                try {
+                    const std::shared_ptr<const DataCard> card = opat.acquire(entries[i]->index);
+                    roots[i] = card->header.merkleRoot;
+                    for (const auto& [tag, entry] : card->tableIndex.tableIndex) {
+                        if (entry.checksum != 0 && computeChecksum(card->get(tag)) != entry.checksum) {
+                            corrupt[i] = 1;
+                        }
+                        ++tables;
+                    }
+                    if (cardRoot(card->tableIndex) != card->header.merkleRoot) {
+                        corrupt[i] = 1;
+                    }
+                } catch (const std::runtime_error&) {
+                    // Lazily read cards and tables are verified as they are read
+                    corrupt[i] = 1;
+                }
+            }
+        };
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::vector<std::thread> workers;
+        const std::size_t count = std::min<std::size_t>(threads, entries.size());
+        workers.reserve(count);
+        for (std::size_t i = 1; i < count; ++i) {
+            workers.emplace_back(check);
+        }
+        check();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        Report report;
+        report.root = combine(roots);
+        report.rootMatches = report.root != 0 && report.root == opat.header.merkleRoot;
+        report.tables = tables;
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (corrupt[i]) {
+                report.corruptCards.push_back(entries[i]->index);
+            }
+        }
+        return report;
+    }
+
+}
@@ -0,0 +1,458 @@
+#include "npy.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace opat::npy {
+
+    namespace {
+        constexpr char MAGIC[] = "\x93NUMPY";
+        constexpr std::size_t MAGIC_SIZE = 6;
+        constexpr std::size_t HEADER_ALIGNMENT = 64; // numpy aligns the data of arrays it writes to 64 bytes
+        constexpr uint32_t LOCAL_HEADER = 0x04034b50;
+        constexpr uint32_t CENTRAL_HEADER = 0x02014b50;
+        constexpr uint32_t END_OF_CENTRAL_DIRECTORY = 0x06054b50;
+        constexpr uint16_t ZIP_VERSION = 20;
+        constexpr uint16_t DOS_DATE = (0 << 9) | (1 << 5) | 1; // 1980-01-01, the earliest date a zip entry can hold
+
+        // CRC-32 as zip uses it, eight bytes at a time (slicing-by-8)
+        constexpr std::array<std::array<uint32_t, 256>, 8> crcTables() {
+            std::array<std::array<uint32_t, 256>, 8> tables{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320u : 0u);
+                }
+                tables[0][i] = crc;
+            }
+            for (std::size_t k = 1; k < 8; ++k) {
+                for (uint32_t i = 0; i < 256; ++i) {
+                    tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+                }
+            }
+            return tables;
+        }
+
+        constexpr auto CRC_TABLES = crcTables();
+
+        uint32_t load32(const unsigned char* p) {
+            return p[0] | (uint32_t{p[1]} << 8) | (uint32_t{p[2]} << 16) | (uint32_t{p[3]} << 24);
+        }
+
+        // Continues a CRC-32 whose running state is `crc` (start from 0xFFFFFFFF and invert the result)
+        uint32_t crc32(uint32_t crc, const void* data, std::size_t size) {
+            const auto* p = static_cast<const unsigned char*>(data);
+            const auto& t = CRC_TABLES;
+            for (; size >= 8; size -= 8, p += 8) {
+                const uint32_t one = load32(p) ^ crc;
+                const uint32_t two = load32(p + 4);
+                crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+                      t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+            }
+            for (; size > 0; --size) {
+                crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+            }
+            return crc;
+        }
+
+        // The preamble of a .npy file: magic, version, header length and the header, padded so the data is aligned
+        std::string preamble(const std::vector<std::size_t>& shape) {
+            std::string dict = std::string("{'descr': '") + (is_big_endian() ? '>' : '<') + "f8', 'fortran_order': False, 'shape': (";
+            for (std::size_t i = 0; i < shape.size(); ++i) {
+                dict += (i > 0 ? ", " : "") + std::to_string(shape[i]);
+            }
+            dict += shape.size() == 1 ? ",), }" : "), }"; // A tuple of one needs its trailing comma
+            const std::size_t unpadded = MAGIC_SIZE + 4 + dict.size() + 1;
+            dict.append((HEADER_ALIGNMENT - unpadded % HEADER_ALIGNMENT) % HEADER_ALIGNMENT, ' ');
+            dict += '\n';
+
+            std::string result(MAGIC, MAGIC_SIZE);
+            result += '\x01';
+            result += '\x00';
+            result += static_cast<char>(dict.size() & 0xFF);
+            result += static_cast<char>(dict.size() >> 8);
+            return result + dict;
+        }
+
+        std::vector<std::size_t> shapeOf(const OPATTable& table) {
+            std::vector<std::size_t> shape = {table.N_R, table.N_C};
+            if (table.m_vsize != 1) {
+                shape.push_back(table.m_vsize);
+            }
+            return shape;
+        }
+
+        void readExactly(std::istream& is, void* data, std::size_t size, uint32_t* crc) {
+            is.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+            if (static_cast<std::size_t>(is.gcount()) != size) {
+                throw std::runtime_error("Unexpected end of .npy array.");
+            }
+            if (crc != nullptr) {
+                *crc = crc32(*crc, data, size);
+            }
+        }
+
+        // The value of `key` in the header dictionary of a .npy file, as written
+        std::string_view field(std::string_view header, std::string_view key) {
+            const std::size_t at = header.find("'" + std::string(key) + "'");
+            if (at == std::string_view::npos) {
+                throw std::runtime_error("The .npy header has no '" + std::string(key) + "'.");
+            }
+            std::size_t begin = header.find(':', at);
+            begin = begin == std::string_view::npos ? begin : header.find_first_not_of(' ', begin + 1);
+            if (begin == std::string_view::npos) {
+                throw std::runtime_error("The .npy header has a malformed '" + std::string(key) + "'.");
+            }
+            const std::size_t end = header[begin] == '(' ? header.find(')', begin) + 1
+                                  : header[begin] == '\'' ? header.find('\'', begin + 1) + 1
+                                  : header.find_first_of(",}", begin);
+            if (end == std::string_view::npos || end <= begin) {
+                throw std::runtime_error("The .npy header has a malformed '" + std::string(key) + "'.");
+            }
+            return header.substr(begin, end - begin);
+        }
+
+        Array readArray(std::istream& is, uint32_t* crc) {
+            char magic[MAGIC_SIZE + 2];
+            readExactly(is, magic, sizeof(magic), crc);
+            if (std::memcmp(magic, MAGIC, MAGIC_SIZE) != 0) {
+                throw std::runtime_error("Not a .npy array.");
+            }
+            const int major = magic[MAGIC_SIZE];
+            std::size_t headerSize = 0;
+            unsigned char length[4] = {};
+            readExactly(is, length, major == 1 ? 2 : 4, crc);
+            headerSize = major == 1 ? length[0] | (length[1] << 8) : load32(length);
+            std::string header(headerSize, '\0');
+            readExactly(is, header.data(), headerSize, crc);
+
+            const std::string_view descr = field(header, "descr");
+            if (descr != "'<f8'" && descr != "'>f8'") {
+                throw std::runtime_error("Only float64 .npy arrays can be read, not " + std::string(descr) + ".");
+            }
+            if (field(header, "fortran_order") != "False") {
+                throw std::runtime_error("Only .npy arrays in C order can be read.");
+            }
+            Array array;
+            const std::string_view shape = field(header, "shape");
+            for (std::size_t i = 1; i < shape.size();) {
+                const std::size_t digit = shape.find_first_of("0123456789", i);
+                if (digit == std::string_view::npos) {
+                    break;
+                }
+                const std::size_t end = shape.find_first_not_of("0123456789", digit);
+                array.shape.push_back(std::stoull(std::string(shape.substr(digit, end - digit))));
+                i = end;
+            }
+
+            const std::size_t count = array.size();
+            array.data = std::make_unique_for_overwrite<double[]>(count);
+            readExactly(is, array.data.get(), count * sizeof(double), crc);
+            if ((descr[1] == '>') != is_big_endian()) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    array.data[i] = swap_bytes(array.data[i]);
+                }
+            }
+            return array;
+        }
+
+        // An array to store in a .npz archive
+        struct Entry {
+            std::string name;
+            std::string preamble;
+            const double* values;
+            std::size_t count;
+        };
+
+        Entry entry(std::string name, std::vector<std::size_t> shape, const double* values) {
+            const std::size_t count = std::accumulate(shape.begin(), shape.end(), std::size_t{1}, std::multiplies<>());
+            return {std::move(name) + ".npy", preamble(shape), values, count};
+        }
+
+        template <typename T>
+        void put(std::ostream& os, T value) {
+            for (std::size_t i = 0; i < sizeof(T); ++i) {
+                os.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        // An uncompressed zip archive, as numpy.savez writes
+        void writeArchive(const std::vector<Entry>& entries, const std::string& filename) {
+            std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+            if (!os.is_open()) {
+                throw std::runtime_error("Could not open file for writing: " + filename);
+            }
+            struct Written {
+                uint32_t crc;
+                uint32_t size;
+                uint32_t offset;
+            };
+            std::vector<Written> written;
+            uint64_t offset = 0;
+            for (const Entry& e : entries) {
+                const uint64_t size = e.preamble.size() + e.count * sizeof(double);
+                if (size > std::numeric_limits<uint32_t>::max() || offset > std::numeric_limits<uint32_t>::max()) {
+                    throw std::runtime_error("'" + e.name + "' is too large for a .npz archive; write it as .npy instead.");
+                }
+                const uint32_t crc = ~crc32(crc32(0xFFFFFFFFu, e.preamble.data(), e.preamble.size()), e.values, e.count * sizeof(double));
+                written.push_back({crc, static_cast<uint32_t>(size), static_cast<uint32_t>(offset)});
+
+                put<uint32_t>(os, LOCAL_HEADER);
+                put<uint16_t>(os, ZIP_VERSION);
+                put<uint16_t>(os, 0);        // Flags
+                put<uint16_t>(os, 0);        // Stored, not compressed
+                put<uint16_t>(os, 0);        // Time
+                put<uint16_t>(os, DOS_DATE);
+                put<uint32_t>(os, crc);
+                put<uint32_t>(os, static_cast<uint32_t>(size));
+                put<uint32_t>(os, static_cast<uint32_t>(size));
+                put<uint16_t>(os, static_cast<uint16_t>(e.name.size()));
+                put<uint16_t>(os, 0);        // Extra field length
+                os.write(e.name.data(), static_cast<std::streamsize>(e.name.size()));
+                os.write(e.preamble.data(), static_cast<std::streamsize>(e.preamble.size()));
+                os.write(reinterpret_cast<const char*>(e.values), static_cast<std::streamsize>(e.count * sizeof(double)));
+                offset += 30 + e.name.size() + size;
+            }
+
+            const uint64_t directory = offset;
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                put<uint32_t>(os, CENTRAL_HEADER);
+                put<uint16_t>(os, ZIP_VERSION); // Made by
+                put<uint16_t>(os, ZIP_VERSION); // Needed to extract
+                put<uint16_t>(os, 0);
+                put<uint16_t>(os, 0);
+                put<uint16_t>(os, 0);
+                put<uint16_t>(os, DOS_DATE);
+                put<uint32_t>(os, written[i].crc);
+                put<uint32_t>(os, written[i].size);
+                put<uint32_t>(os, written[i].size);
+                put<uint16_t>(os, static_cast<uint16_t>(entries[i].name.size()));
+                put<uint16_t>(os, 0);           // Extra field length
+                put<uint16_t>(os, 0);           // Comment length
+                put<uint16_t>(os, 0);           // Disk
+                put<uint16_t>(os, 0);           // Internal attributes
+                put<uint32_t>(os, 0);           // External attributes
+                put<uint32_t>(os, written[i].offset);
+                os.write(entries[i].name.data(), static_cast<std::streamsize>(entries[i].name.size()));
+                offset += 46 + entries[i].name.size();
+            }
+            if (offset > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Too much data for a .npz archive: " + filename);
+            }
+
+            put<uint32_t>(os, END_OF_CENTRAL_DIRECTORY);
+            put<uint16_t>(os, 0);
+            put<uint16_t>(os, 0);
+            put<uint16_t>(os, static_cast<uint16_t>(entries.size()));
+            put<uint16_t>(os, static_cast<uint16_t>(entries.size()));
+            put<uint32_t>(os, static_cast<uint32_t>(offset - directory));
+            put<uint32_t>(os, static_cast<uint32_t>(directory));
+            put<uint16_t>(os, 0);            // Comment length
+            if (!os) {
+                throw std::runtime_error("Error writing .npz archive: " + filename);
+            }
+        }
+
+        // Every array of an uncompressed .npz archive, by name (without ".npy"), in the order the archive lists them
+        std::vector<std::pair<std::string, Array>> readArchive(const std::string& filename) {
+            std::ifstream is(filename, std::ios::binary);
+            if (!is.is_open()) {
+                throw std::runtime_error("Could not open file: " + filename);
+            }
+            is.seekg(0, std::ios::end);
+            const std::streamoff fileSize = is.tellg();
+            const std::streamoff tailSize = std::min<std::streamoff>(fileSize, 22 + 0xFFFF);
+            std::vector<unsigned char> tail(static_cast<std::size_t>(tailSize));
+            is.seekg(fileSize - tailSize);
+            is.read(reinterpret_cast<char*>(tail.data()), tailSize);
+
+            // The end of central directory record is last, followed only by an optional comment
+            std::size_t end = std::string::npos;
+            for (std::size_t i = tail.size() >= 22 ? tail.size() - 22 + 1 : 0; i-- > 0;) {
+                if (load32(&tail[i]) == END_OF_CENTRAL_DIRECTORY) {
+                    end = i;
+                    break;
+                }
+            }
+            if (end == std::string::npos) {
+                throw std::runtime_error("Not a .npz archive: " + filename);
+            }
+            const auto load16 = [](const unsigned char* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); };
+            const uint16_t count = load16(&tail[end + 10]);
+            const uint32_t directorySize = load32(&tail[end + 12]);
+            const uint32_t directoryOffset = load32(&tail[end + 16]);
+
+            std::vector<unsigned char> directory(directorySize);
+            is.seekg(directoryOffset);
+            is.read(reinterpret_cast<char*>(directory.data()), directorySize);
+            if (static_cast<uint32_t>(is.gcount()) != directorySize) {
+                throw std::runtime_error("Truncated .npz archive: " + filename);
+            }
+
+            std::vector<std::pair<std::string, Array>> arrays;
+            std::size_t at = 0;
+            for (uint16_t i = 0; i < count; ++i) {
+                if (at + 46 > directory.size() || load32(&directory[at]) != CENTRAL_HEADER) {
+                    throw std::runtime_error("Corrupt .npz archive: " + filename);
+                }
+                const unsigned char* record = &directory[at];
+                if (load16(record + 10) != 0) {
+                    throw std::runtime_error("Compressed .npz archives cannot be read: " + filename);
+                }
+                const uint32_t crc = load32(record + 16);
+                const uint16_t nameSize = load16(record + 28);
+                const uint16_t extraSize = load16(record + 30);
+                const uint16_t commentSize = load16(record + 32);
+                const uint32_t localOffset = load32(record + 42);
+                std::string name(reinterpret_cast<const char*>(record + 46), nameSize);
+                at += 46 + nameSize + extraSize + commentSize;
+
+                unsigned char local[30];
+                is.seekg(localOffset);
+                is.read(reinterpret_cast<char*>(local), sizeof(local));
+                if (is.gcount() != sizeof(local) || load32(local) != LOCAL_HEADER) {
+                    throw std::runtime_error("Corrupt .npz archive: " + filename);
+                }
+                is.seekg(localOffset + 30 + load16(local + 26) + load16(local + 28));
+                uint32_t computed = 0xFFFFFFFFu;
+                Array array = readArray(is, &computed);
+                if (~computed != crc) {
+                    throw std::runtime_error("CRC mismatch for '" + name + "' in .npz archive: " + filename);
+                }
+                if (name.ends_with(".npy")) {
+                    name.erase(name.size() - 4);
+                }
+                arrays.emplace_back(std::move(name), std::move(array));
+            }
+            return arrays;
+        }
+
+        TableArray values(const Array& array) {
+            TableArray copy = std::make_unique<double[]>(array.size());
+            std::copy_n(array.data.get(), array.size(), copy.get());
+            return copy;
+        }
+
+        OPATTable tableOf(Array& data, const Array& rows, const Array& columns, const std::string& name) {
+            if ((data.shape.size() != 2 && data.shape.size() != 3) || rows.shape.size() != 1 || columns.shape.size() != 1 ||
+                rows.shape[0] != data.shape[0] || columns.shape[0] != data.shape[1]) {
+                throw std::runtime_error("The arrays of '" + name + "' do not form a table.");
+            }
+            OPATTable table;
+            table.N_R = static_cast<uint32_t>(data.shape[0]);
+            table.N_C = static_cast<uint32_t>(data.shape[1]);
+            table.m_vsize = data.shape.size() == 3 ? data.shape[2] : 1;
+            table.data = TableArray(data.data.release());
+            table.rowValues = values(rows);
+            table.columnValues = values(columns);
+            return table;
+        }
+    }
+
+    std::size_t Array::size() const {
+        return std::accumulate(shape.begin(), shape.end(), std::size_t{1}, std::multiplies<>());
+    }
+
+    void write(std::span<const double> values, std::ostream& os) {
+        const std::string header = preamble({values.size()});
+        os.write(header.data(), static_cast<std::streamsize>(header.size()));
+        os.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+    }
+
+    void write(const OPATTable& table, std::ostream& os) {
+        const std::string header = preamble(shapeOf(table));
+        os.write(header.data(), static_cast<std::streamsize>(header.size()));
+        os.write(reinterpret_cast<const char*>(table.data.get()),
+                 static_cast<std::streamsize>(static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize * sizeof(double)));
+    }
+
+    Array read(std::istream& is) {
+        return readArray(is, nullptr);
+    }
+
+    void writeTable(const OPATTable& table, const std::string& filename) {
+        writeArchive({entry("data", shapeOf(table), table.data.get()),
+                      entry("rows", {table.N_R}, table.rowValues.get()),
+                      entry("columns", {table.N_C}, table.columnValues.get())}, filename);
+    }
+
+    OPATTable readTable(const std::string& filename) {
+        std::unordered_map<std::string, Array> arrays;
+        for (auto& [name, array] : readArchive(filename)) {
+            arrays.emplace(std::move(name), std::move(array));
+        }
+        if (!arrays.contains("data") || !arrays.contains("rows") || !arrays.contains("columns")) {
+            throw std::runtime_error("A table archive must hold 'data', 'rows' and 'columns': " + filename);
+        }
+        return tableOf(arrays.at("data"), arrays.at("rows"), arrays.at("columns"), filename);
+    }
+
+    void writeCard(const DataCard& card, const std::string& filename) {
+        std::vector<std::pair<uint64_t, std::string>> stored;
+        for (const auto& [tag, tableEntry] : card.tableIndex.tableIndex) {
+            stored.emplace_back(tableEntry.byteStart, tag);
+        }
+        std::ranges::sort(stored);
+
+        std::vector<Entry> entries;
+        for (const std::string& tag : stored | std::views::values) {
+            const OPATTable& table = card.get(tag);
+            entries.push_back(entry(tag, shapeOf(table), table.data.get()));
+            entries.push_back(entry(tag + ".rows", {table.N_R}, table.rowValues.get()));
+            entries.push_back(entry(tag + ".columns", {table.N_C}, table.columnValues.get()));
+        }
+        writeArchive(entries, filename);
+    }
+
+    DataCard readCard(const std::string& filename) {
+        std::vector<std::pair<std::string, Array>> arrays = readArchive(filename);
+        std::unordered_map<std::string, Array*> byName;
+        for (auto& [name, array] : arrays) {
+            byName.emplace(name, &array);
+        }
+
+        DataCard card{};
+        std::memcpy(card.header.magic, "CARD", 4);
+        card.header.headerSize = sizeof(CardHeader);
+        uint64_t offset = sizeof(CardHeader);
+        for (auto& [tag, data] : arrays) {
+            if (tag.ends_with(".rows") || tag.ends_with(".columns")) {
+                continue;
+            }
+            if (tag.size() > sizeof(TableIndexEntry::tag)) {
+                throw std::runtime_error("The tag '" + tag + "' is longer than 8 characters: " + filename);
+            }
+            const auto rows = byName.find(tag + ".rows");
+            const auto columns = byName.find(tag + ".columns");
+            if (rows == byName.end() || columns == byName.end()) {
+                throw std::runtime_error("The table '" + tag + "' has no rows or columns in " + filename);
+            }
+            OPATTable table = tableOf(data, *rows->second, *columns->second, tag);
+
+            TableIndexEntry entry{};
+            std::memcpy(entry.tag, tag.data(), tag.size());
+            entry.byteStart = offset;
+            entry.byteEnd = offset + (table.N_R + table.N_C + static_cast<uint64_t>(table.N_R) * table.N_C * table.m_vsize) * sizeof(double);
+            entry.numRows = static_cast<uint16_t>(table.N_R);
+            entry.numColumns = static_cast<uint16_t>(table.N_C);
+            entry.size = table.m_vsize;
+            offset = entry.byteEnd;
+            card.tableIndex.tableIndex.emplace(tag, entry);
+            card.tableData.emplace(tag, std::move(table));
+        }
+        card.header.numTables = static_cast<uint32_t>(card.tableData.size());
+        card.header.indexOffset = offset;
+        card.header.cardSize = offset + card.header.numTables * sizeof(TableIndexEntry);
+        return card;
+    }
+
+}
@@ -0,0 +1,196 @@
+#include "numaPlacement.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <ranges>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/mempolicy.h>
+
+namespace opat::numa {
+
+    namespace {
+        // Node masks cover this many nodes, more than any kernel configures (CONFIG_NODES_SHIFT <= 10)
+        constexpr std::size_t MAX_NODES = 1024;
+        constexpr std::size_t BITS_PER_WORD = sizeof(unsigned long) * 8;
+
+        // Parses a sysfs list such as "0-3,8,10-11"
+        std::vector<int> parseList(const std::string& list) {
+            std::vector<int> values;
+            std::stringstream ranges(list);
+            for (std::string range; std::getline(ranges, range, ',');) {
+                if (range.empty() || range == "\n") {
+                    continue;
+                }
+                const auto dash = range.find('-');
+                const int first = std::stoi(range.substr(0, dash));
+                const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int value = first; value <= last; ++value) {
+                    values.push_back(value);
+                }
+            }
+            return values;
+        }
+
+        std::string readLine(const std::string& path) {
+            std::ifstream file(path);
+            std::string line;
+            std::getline(file, line);
+            return line;
+        }
+
+        std::vector<unsigned long> nodeMask(const std::vector<int>& nodes) {
+            std::vector<unsigned long> mask(MAX_NODES / BITS_PER_WORD, 0);
+            for (const int node : nodes) {
+                if (node >= 0 && static_cast<std::size_t>(node) < MAX_NODES) {
+                    mask[node / BITS_PER_WORD] |= 1UL << (node % BITS_PER_WORD);
+                }
+            }
+            return mask;
+        }
+
+        // The kernel reads one bit fewer than `maxnode`, hence the + 1 (as libnuma does)
+        bool setMemoryPolicy(int mode, const unsigned long* mask) {
+            return ::syscall(SYS_set_mempolicy, mode, mask, mask == nullptr ? 0 : MAX_NODES + 1) == 0;
+        }
+
+        // Runs the calling thread on the CPUs of `node` and allocates its memory there; best effort
+        void bindToNode(int node) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (const int cpu : parseList(readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"))) {
+                if (cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &cpus);
+                }
+            }
+            if (CPU_COUNT(&cpus) > 0) {
+                ::sched_setaffinity(0, sizeof(cpus), &cpus);
+            }
+            const std::vector<unsigned long> mask = nodeMask({node});
+            setMemoryPolicy(MPOL_BIND, mask.data());
+        }
+
+        // Deep copy, written by the calling thread so that its pages are placed by that thread's policy
+        OPATTable copyTable(const OPATTable& table) {
+            OPATTable copy;
+            copy.N_R = table.N_R;
+            copy.N_C = table.N_C;
+            copy.m_vsize = table.m_vsize;
+            const std::size_t cells = static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize;
+            copy.rowValues = std::make_unique<double[]>(table.N_R);
+            copy.columnValues = std::make_unique<double[]>(table.N_C);
+            copy.data = std::make_unique<double[]>(cells);
+            std::copy_n(table.rowValues.get(), table.N_R, copy.rowValues.get());
+            std::copy_n(table.columnValues.get(), table.N_C, copy.columnValues.get());
+            std::copy_n(table.data.get(), cells, copy.data.get());
+            return copy;
+        }
+
+        std::size_t tableBytes(const OPATTable& table) {
+            return (table.N_R + table.N_C + static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize) * sizeof(double);
+        }
+    }
+
+    std::vector<int> onlineNodes() {
+        std::vector<int> nodes = parseList(readLine("/sys/devices/system/node/online"));
+        if (nodes.empty()) {
+            nodes.push_back(0);
+        }
+        return nodes;
+    }
+
+    int currentNode() {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+            return 0;
+        }
+        return static_cast<int>(node);
+    }
+
+    InterleaveScope::InterleaveScope() {
+        const std::vector<int> nodes = onlineNodes();
+        if (nodes.size() < 2) {
+            return;
+        }
+        m_previousNodes.assign(MAX_NODES / BITS_PER_WORD, 0);
+        if (::syscall(SYS_get_mempolicy, &m_previousMode, m_previousNodes.data(), MAX_NODES, nullptr, 0UL) != 0) {
+            return;
+        }
+        const std::vector<unsigned long> mask = nodeMask(nodes);
+        m_active = setMemoryPolicy(MPOL_INTERLEAVE, mask.data());
+    }
+
+    InterleaveScope::~InterleaveScope() {
+        if (m_active) {
+            setMemoryPolicy(m_previousMode, m_previousMode == MPOL_DEFAULT ? nullptr : m_previousNodes.data());
+        }
+    }
+
+    Replicas::Replicas(const OPAT& opat, const std::vector<std::string>& tags) :
+        Replicas(opat, tags, onlineNodes().size() > 1 ? onlineNodes() : std::vector<int>{}) {}
+
+    Replicas::Replicas(const OPAT& opat, const std::vector<std::string>& tags, const std::vector<int>& nodes) :
+        m_nodes(nodes), m_copies(nodes.size()) {
+        std::vector<std::size_t> bytes(nodes.size(), 0);
+        std::vector<std::exception_ptr> errors(nodes.size());
+        std::vector<std::thread> copiers;
+        copiers.reserve(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            // A fresh thread per node, so that binding it does not affect the caller
+            copiers.emplace_back([&, i] {
+                try {
+                    bindToNode(m_nodes[i]);
+                    for (const FloatIndexVector& index : opat.cardCatalog.tableIndex | std::views::keys) {
+                        const std::shared_ptr<const DataCard> card = opat.acquire(index);
+                        for (const std::string& tag : tags) {
+                            if (!card->tableIndex.tableIndex.contains(tag)) {
+                                continue;
+                            }
+                            OPATTable copy = copyTable(card->get(tag));
+                            bytes[i] += tableBytes(copy);
+                            m_copies[i][index].emplace(tag, std::move(copy));
+                        }
+                    }
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto& copier : copiers) {
+            copier.join();
+        }
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        for (const std::size_t nodeBytes : bytes) {
+            m_bytes += nodeBytes;
+        }
+    }
+
+    const OPATTable* Replicas::local(const FloatIndexVector& index, const std::string& tag, int node) const {
+        const auto position = std::ranges::find(m_nodes, node);
+        if (position == m_nodes.end()) {
+            return nullptr;
+        }
+        const Tables& tables = m_copies[position - m_nodes.begin()];
+        const auto card = tables.find(index);
+        if (card == tables.end()) {
+            return nullptr;
+        }
+        const auto table = card->second.find(tag);
+        return table == card->second.end() ? nullptr : &table->second;
+    }
+
+}
@@ -20,21 +20,83 @@
 // *********************************************************************** */
 #include "opatIO.h"
 #include "indexVector.h"
+#include "queryTrace.h"
+#include "lazyCardStore.h"
+#include "ioBackend.h"
+#include "merkle.h"
+#include "sha256.h"
 
 #include <fstream>
 #include <iostream>
 #include <ostream>
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <limits>
 #include <unordered_map>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <cstring>
 #include <ranges>
+#include <spanstream>
+#include <sstream>
+#include <charconv>
+#include <system_error>
 
 #include "picosha2.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace opat {
+    // Tables of a card read with readDataCardDeferred. The map is filled once when the card is read and
+    // never modified afterwards, so lookups need no lock; each table is read under its own once_flag.
+    struct DeferredTables {
+        struct Table {
+            TableIndexEntry entry;
+            std::once_flag once;
+            std::unique_ptr<OPATTable> table;
+            std::atomic<bool> read{false}; ///< Set once `table` holds the table.
+        };
+
+        std::shared_ptr<OPATFileHandle> source;
+        CardCatalogEntry cardEntry;
+        std::unordered_map<std::string, Table> tables;
+
+        const OPATTable* find(const std::string& tag) {
+            const auto it = tables.find(tag);
+            if (it == tables.end()) {
+                return nullptr;
+            }
+            Table& deferred = it->second;
+            std::call_once(deferred.once, [&] {
+                std::lock_guard lock(source->mutex);
+                source->file.clear();
+                deferred.table = std::make_unique<OPATTable>(readOPATTable(source->file, cardEntry, deferred.entry));
+                deferred.read.store(true, std::memory_order_release);
+            });
+            return deferred.table.get();
+        }
+
+        bool supply(const std::string& tag, OPATTable&& table) {
+            const auto it = tables.find(tag);
+            if (it == tables.end()) {
+                return false;
+            }
+            Table& deferred = it->second;
+            bool used = false;
+            std::call_once(deferred.once, [&] {
+                deferred.table = std::make_unique<OPATTable>(std::move(table));
+                deferred.read.store(true, std::memory_order_release);
+                used = true;
+            });
+            return used;
+        }
+    };
+
     // Function to check system endianness
     // Returns true if the system is big-endian, false otherwise
     bool is_big_endian() {
@@ -59,7 +121,7 @@ namespace opat {
     std::vector<Bounds> OPAT::getBounds() const {
         std::vector<Bounds> bounds(header.numIndex);
 
-        for (const auto &iv: cards | std::views::keys) {
+        for (const auto &iv: cardCatalog.tableIndex | std::views::keys) {
             for (int dim = 0; dim < header.numIndex; ++dim) {
                 if (iv[dim] > bounds.at(dim).max) {
                     bounds.at(dim).max = iv[dim];
@@ -72,8 +134,159 @@ namespace opat {
         return bounds;
     }
 
+    TagStatistics OPAT::getStatistics(const std::string& tag) const {
+        TagStatistics result;
+        double sum = 0.0;
+        for (const auto &index: cardCatalog.tableIndex | std::views::keys) {
+            // Acquired rather than fetched with get, so that lazily loaded cards are not pinned by a scan
+            const std::shared_ptr<const DataCard> card = acquire(index);
+            const auto entry = card->tableIndex.tableIndex.find(tag);
+            if (entry == card->tableIndex.tableIndex.end()) {
+                continue;
+            }
+            ++result.cards;
+
+            TableStatistics statistics;
+            if (const auto stored = card->tableIndex.statistics.find(tag); stored != card->tableIndex.statistics.end()) {
+                statistics = stored->second;
+            } else {
+                statistics = computeStatistics(tag, card->get(tag));
+                ++result.computedCards;
+            }
+
+            const uint64_t total = static_cast<uint64_t>(entry->second.numRows) * entry->second.numColumns * entry->second.size;
+            const uint64_t values = total - std::min(statistics.nanCount, total);
+            result.nanCount += statistics.nanCount;
+            if (values == 0) {
+                continue;
+            }
+            result.min = result.valueCount == 0 ? statistics.min : std::min(result.min, statistics.min);
+            result.max = result.valueCount == 0 ? statistics.max : std::max(result.max, statistics.max);
+            result.valueCount += values;
+            sum += statistics.mean * static_cast<double>(values);
+        }
+        if (result.cards == 0) {
+            throw std::out_of_range("No card has a table with tag '" + tag + "'.");
+        }
+        if (result.valueCount > 0) {
+            result.mean = sum / static_cast<double>(result.valueCount);
+        }
+        return result;
+    }
+
     // Reads an OPAT file and constructs an OPAT object
-    OPAT readOPAT(const std::string& filename) {
+    namespace {
+        constexpr uint64_t DIRECT_ALIGNMENT = io::ReadArena::BLOCK_ALIGNMENT;
+        constexpr uint64_t DIRECT_WINDOW = uint64_t{16} << 20;
+
+        // Closes a POSIX file descriptor on scope exit
+        struct FileDescriptor {
+            int fd;
+            ~FileDescriptor() {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+        };
+
+        // Reads up to `length` bytes at `offset`, stopping early only at the end of the file
+        std::size_t readRange(int fd, std::byte* buffer, uint64_t offset, std::size_t length) {
+            std::size_t done = 0;
+            while (done < length) {
+                const ssize_t n = ::pread(fd, buffer + done, length - done, static_cast<off_t>(offset + done));
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0) {
+                    throw std::system_error(errno, std::generic_category(), "Error reading data cards from file");
+                }
+                if (n == 0) {
+                    break;
+                }
+                done += static_cast<std::size_t>(n);
+            }
+            return done;
+        }
+
+        // Reads every card in large aligned windows, in file order, without leaving the file in the page cache
+        std::unordered_map<FloatIndexVector, DataCard> readDataCardsUncached(const std::string& filename, const CardCatalog& cardCatalog) {
+            bool direct = true;
+            FileDescriptor file{::open(filename.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT)};
+            if (file.fd < 0) {
+                // Not every filesystem supports O_DIRECT (tmpfs, some network and overlay filesystems)
+                direct = false;
+                file.fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+                if (file.fd < 0) {
+                    throw std::runtime_error("Could not open file: " + filename);
+                }
+            }
+            int& fd = file.fd;
+            if (!direct) {
+                ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+
+            std::vector<const CardCatalogEntry*> entries;
+            entries.reserve(cardCatalog.tableIndex.size());
+            for (const auto& entry : cardCatalog.tableIndex | std::views::values) {
+                entries.push_back(&entry);
+            }
+            std::ranges::sort(entries, {}, &CardCatalogEntry::byteStart);
+
+            std::unordered_map<FloatIndexVector, DataCard> cards;
+            cards.reserve(entries.size());
+            io::ReadArena arena;
+            std::byte* window = nullptr;
+            std::size_t windowCapacity = 0;
+            for (std::size_t i = 0; i < entries.size();) {
+                const uint64_t start = entries[i]->byteStart & ~(DIRECT_ALIGNMENT - 1);
+                const uint64_t end = (std::max(entries[i]->byteEnd, start + DIRECT_WINDOW) + DIRECT_ALIGNMENT - 1) & ~(DIRECT_ALIGNMENT - 1);
+                const auto length = static_cast<std::size_t>(end - start);
+                if (length > windowCapacity) {
+                    arena.reset();
+                    window = arena.allocate(length, DIRECT_ALIGNMENT);
+                    windowCapacity = length;
+                }
+
+                std::size_t got;
+                try {
+                    got = readRange(fd, window, start, length);
+                } catch (const std::system_error& e) {
+                    if (!direct || e.code().value() != EINVAL) {
+                        throw;
+                    }
+                    // The filesystem accepted O_DIRECT at open but rejects direct reads; continue through the page cache
+                    const int buffered = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (buffered < 0) {
+                        throw std::runtime_error("Could not open file: " + filename);
+                    }
+                    ::close(fd);
+                    fd = buffered;
+                    direct = false;
+                    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+                    continue;
+                }
+
+                // Parse every card which lies entirely inside the window
+                const std::size_t first = i;
+                for (; i < entries.size() && entries[i]->byteEnd <= start + got; ++i) {
+                    const CardCatalogEntry& entry = *entries[i];
+                    std::ispanstream stream(std::span(reinterpret_cast<char*>(window + (entry.byteStart - start)), entry.byteEnd - entry.byteStart));
+                    cards.emplace(entry.index, readDataCard(stream, entry, entry.byteStart));
+                }
+                if (i == first) {
+                    throw std::runtime_error("Error reading data card from file: unexpected end of file");
+                }
+                if (!direct) {
+                    ::posix_fadvise(fd, static_cast<off_t>(start), static_cast<off_t>(got), POSIX_FADV_DONTNEED);
+                }
+            }
+            // Also drop the header and catalog, which were read through the page cache
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            return cards;
+        }
+    }
+
+    OPAT readOPAT(const std::string& filename, LoadMode mode) {
         // Verify the file has the correct magic number
         bool isOPAT = hasMagic(filename);
         if (!isOPAT) {
@@ -92,19 +305,216 @@ namespace opat {
             throw std::runtime_error("Invalid OPAT file: " + filename);
         }
 
-        // Read the card catalog and data cards
+        // Read the card catalog
         CardCatalog cardCatalog = readCardCatalog(file, header);
-        std::unordered_map<FloatIndexVector, DataCard> cards = readDataCards(file, header, cardCatalog);
 
-        // Construct and return the OPAT object
+        // Construct the OPAT object
         OPAT opat;
         opat.header = header;
-        opat.cardCatalog = cardCatalog;
-        opat.cards = std::move(cards);
+        opat.filename = filename;
+
+        if (mode == LoadMode::Lazy) {
+            // Defer reading the data cards until they are first requested
+            auto store = std::make_shared<LazyCardStore>();
+            const std::size_t source = store->addSource(filename);
+            for (const auto &entry : cardCatalog.tableIndex | std::views::values) {
+                store->addCard(entry, source);
+            }
+            opat.lazyCards = std::move(store);
+        } else if (mode == LoadMode::Direct) {
+            opat.cards = readDataCardsUncached(filename, cardCatalog);
+        } else {
+            opat.cards = readDataCards(file, header, cardCatalog);
+        }
+        opat.cardCatalog = std::move(cardCatalog);
 
+        // Each card index was checked against its root as it was read; lazily loaded files are checked
+        // card by card instead, since their card headers are only read on first access
+        if (mode != LoadMode::Lazy && header.merkleRoot != 0 && merkle::fileRoot(opat) != header.merkleRoot) {
+            throw std::runtime_error("The card roots of " + filename + " do not match its checksum tree; the file is corrupt.");
+        }
         return opat;
     }
 
+    namespace {
+        // Copies of the file structures with every numeric field in the byte order files are written in
+        Header littleEndian(Header header) {
+            if (is_big_endian()) {
+                header.version = swap_bytes(header.version);
+                header.numTables = swap_bytes(header.numTables);
+                header.headerSize = swap_bytes(header.headerSize);
+                header.indexOffset = swap_bytes(header.indexOffset);
+                header.numIndex = swap_bytes(header.numIndex);
+                header.merkleRoot = swap_bytes(header.merkleRoot);
+            }
+            return header;
+        }
+
+        CardHeader littleEndian(CardHeader header) {
+            if (is_big_endian()) {
+                header.numTables = swap_bytes(header.numTables);
+                header.headerSize = swap_bytes(header.headerSize);
+                header.indexOffset = swap_bytes(header.indexOffset);
+                header.cardSize = swap_bytes(header.cardSize);
+                header.statsOffset = swap_bytes(header.statsOffset);
+                header.merkleRoot = swap_bytes(header.merkleRoot);
+            }
+            return header;
+        }
+
+        TableIndexEntry littleEndian(TableIndexEntry entry) {
+            if (is_big_endian()) {
+                entry.byteStart = swap_bytes(entry.byteStart);
+                entry.byteEnd = swap_bytes(entry.byteEnd);
+                entry.numColumns = swap_bytes(entry.numColumns);
+                entry.numRows = swap_bytes(entry.numRows);
+                entry.size = swap_bytes(entry.size);
+                entry.checksum = swap_bytes(entry.checksum);
+            }
+            return entry;
+        }
+
+        TableStatistics littleEndian(TableStatistics statistics) {
+            if (is_big_endian()) {
+                statistics.min = swap_bytes(statistics.min);
+                statistics.max = swap_bytes(statistics.max);
+                statistics.mean = swap_bytes(statistics.mean);
+                statistics.nanCount = swap_bytes(statistics.nanCount);
+            }
+            return statistics;
+        }
+
+        template <typename T>
+        void writeValue(std::ofstream& file, const T& value) {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void writeValues(std::ofstream& file, const T* values, std::size_t count) {
+            if (!is_big_endian()) {
+                file.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+                return;
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                writeValue(file, swap_bytes(values[i]));
+            }
+        }
+
+        uint16_t tableDimension(std::size_t size, const std::string& tag, const char* what) {
+            if (size > std::numeric_limits<uint16_t>::max()) {
+                throw std::length_error("Table '" + tag + "' has " + std::to_string(size) + " " + what +
+                                        ", more than a table index entry can store.");
+            }
+            return static_cast<uint16_t>(size);
+        }
+    }
+
+    void writeOPAT(const OPAT& opat, const std::string& filename) {
+        std::vector<const CardCatalogEntry*> entries;
+        entries.reserve(opat.cardCatalog.tableIndex.size());
+        for (const auto& entry : opat.cardCatalog.tableIndex | std::views::values) {
+            entries.push_back(&entry);
+        }
+        std::ranges::sort(entries, {}, &CardCatalogEntry::byteStart);
+
+        // Lazily loaded tables take their shapes from 16-bit index entries, but tables built in memory
+        // may not fit one; check them before the file is replaced
+        for (const DataCard& card : opat.cards | std::views::values) {
+            for (const auto& [tag, table] : card.tableData) {
+                tableDimension(table.N_R, tag, "rows");
+                tableDimension(table.N_C, tag, "columns");
+            }
+        }
+
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open file for writing: " + filename);
+        }
+
+        // Headers are written once the offsets and roots they hold are known
+        std::vector<CardCatalogEntry> catalog;
+        catalog.reserve(entries.size());
+        std::vector<uint64_t> roots;
+        roots.reserve(entries.size());
+        uint64_t position = sizeof(Header);
+        for (const CardCatalogEntry* entry : entries) {
+            const std::shared_ptr<const DataCard> card = opat.acquire(entry->index);
+            std::vector<std::pair<uint64_t, std::string>> stored;
+            for (const auto& [tag, tableEntry] : card->tableIndex.tableIndex) {
+                stored.emplace_back(tableEntry.byteStart, tag);
+            }
+            std::ranges::sort(stored);
+
+            TableIndex tableIndex;
+            std::vector<TableIndexEntry> indexEntries;
+            std::vector<TableStatistics> statistics;
+            uint64_t offset = sizeof(CardHeader);
+            file.seekp(static_cast<std::streamoff>(position + offset));
+            for (const std::string& tag : stored | std::views::values) {
+                const OPATTable& table = card->get(tag);
+                const std::size_t cells = static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize;
+                TableIndexEntry tableEntry = card->tableIndex.tableIndex.at(tag);
+                tableEntry.byteStart = offset;
+                tableEntry.byteEnd = offset + (table.N_R + table.N_C + cells) * sizeof(double);
+                tableEntry.numRows = tableDimension(table.N_R, tag, "rows");
+                tableEntry.numColumns = tableDimension(table.N_C, tag, "columns");
+                tableEntry.size = table.m_vsize;
+                tableEntry.checksum = computeChecksum(table);
+                writeValues(file, table.rowValues.get(), table.N_R);
+                writeValues(file, table.columnValues.get(), table.N_C);
+                writeValues(file, table.data.get(), cells);
+                offset = tableEntry.byteEnd;
+
+                indexEntries.push_back(tableEntry);
+                tableIndex.tableIndex.emplace(tag, tableEntry);
+                statistics.push_back(computeStatistics(tag, table));
+            }
+
+            CardHeader cardHeader = card->header;
+            cardHeader.numTables = static_cast<uint32_t>(indexEntries.size());
+            cardHeader.headerSize = sizeof(CardHeader);
+            cardHeader.indexOffset = offset;
+            cardHeader.statsOffset = offset + indexEntries.size() * sizeof(TableIndexEntry);
+            cardHeader.cardSize = cardHeader.statsOffset + statistics.size() * sizeof(TableStatistics);
+            cardHeader.merkleRoot = merkle::cardRoot(tableIndex);
+            for (const TableIndexEntry& tableEntry : indexEntries) {
+                writeValue(file, littleEndian(tableEntry));
+            }
+            for (const TableStatistics& tableStatistics : statistics) {
+                writeValue(file, littleEndian(tableStatistics));
+            }
+            file.seekp(static_cast<std::streamoff>(position));
+            writeValue(file, littleEndian(cardHeader));
+
+            CardCatalogEntry& written = catalog.emplace_back(*entry);
+            written.byteStart = position;
+            written.byteEnd = position + cardHeader.cardSize;
+            const sha256::Digest digest = sha256::cardDigest(*card);
+            std::memcpy(written.sha256, digest.data(), digest.size());
+            roots.push_back(cardHeader.merkleRoot);
+            position = written.byteEnd;
+        }
+
+        Header header = opat.header;
+        header.numTables = static_cast<uint32_t>(catalog.size());
+        header.headerSize = sizeof(Header);
+        header.indexOffset = position;
+        header.merkleRoot = merkle::combine(roots);
+        file.seekp(static_cast<std::streamoff>(position));
+        for (const CardCatalogEntry& entry : catalog) {
+            const std::vector<double> index = entry.index.getVector();
+            writeValues(file, index.data(), index.size());
+            writeValues(file, &entry.byteStart, 1);
+            writeValues(file, &entry.byteEnd, 1);
+            file.write(entry.sha256, sizeof(entry.sha256));
+        }
+        file.seekp(0);
+        writeValue(file, littleEndian(header));
+        if (!file) {
+            throw std::runtime_error("Error writing OPAT file: " + filename);
+        }
+    }
+
     // Reads the header of the OPAT file
     Header readHeader(std::ifstream &file) {
         Header header;
@@ -119,6 +529,7 @@ namespace opat {
             header.numTables = swap_bytes(header.numTables);
             header.indexOffset = swap_bytes(header.indexOffset);
             header.numIndex = swap_bytes(header.numIndex);
+            header.merkleRoot = swap_bytes(header.merkleRoot);
         }
         return header;
     }
@@ -170,13 +581,13 @@ namespace opat {
     }
 
     // Reads a single data card from the file
-    DataCard readDataCard(std::ifstream &file, const CardCatalogEntry &entry) {
-        CardHeader header = readDataCardHeader(file, entry); // Read the card header
-        TableIndex tableIndex = readTableIndex(file, entry, header); // Read the table index
+    DataCard readDataCard(std::istream &file, const CardCatalogEntry &entry, uint64_t streamStart) {
+        CardHeader header = readDataCardHeader(file, entry, streamStart); // Read the card header
+        TableIndex tableIndex = readTableIndex(file, entry, header, streamStart); // Read the table index
 
         std::unordered_map<std::string, OPATTable> tableData;
         for (const auto &[tag, tableEntry] : tableIndex.tableIndex) {
-            OPATTable table = readOPATTable(file, entry, tableEntry); // Read each table
+            OPATTable table = readOPATTable(file, entry, tableEntry, streamStart); // Read each table
             tableData.emplace(tag, std::move(table)); // Add to the map
         }
 
@@ -188,10 +599,55 @@ namespace opat {
         return dataCard;
     }
 
+    OPATFileHandle::OPATFileHandle(const std::string& filename) : filename(filename), file(filename, std::ios::binary) {
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+        descriptor = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0) {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+    }
+
+    OPATFileHandle::~OPATFileHandle() {
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+    }
+
+    // Reads a data card's header and table index, leaving its tables to be read on first access
+    DataCard readDataCardDeferred(const std::shared_ptr<OPATFileHandle>& source, const CardCatalogEntry &entry) {
+        CardHeader header;
+        TableIndex tableIndex;
+        {
+            std::lock_guard lock(source->mutex);
+            source->file.clear();
+            header = readDataCardHeader(source->file, entry);
+            tableIndex = readTableIndex(source->file, entry, header);
+        }
+        return readDataCardDeferred(source, entry, header, std::move(tableIndex));
+    }
+
+    DataCard readDataCardDeferred(const std::shared_ptr<OPATFileHandle>& source, const CardCatalogEntry &entry,
+                                  const CardHeader &header, TableIndex tableIndex) {
+        DataCard dataCard;
+        dataCard.header = header;
+        dataCard.tableIndex = std::move(tableIndex);
+
+        auto deferred = std::make_shared<DeferredTables>();
+        deferred->source = source;
+        deferred->cardEntry = entry;
+        for (const auto &[tag, tableEntry] : dataCard.tableIndex.tableIndex) {
+            deferred->tables[tag].entry = tableEntry;
+        }
+        dataCard.deferredTables = std::move(deferred);
+        return dataCard;
+    }
+
     // Reads the header of a data card
-    CardHeader readDataCardHeader(std::ifstream &file, const CardCatalogEntry &entry) {
+    CardHeader readDataCardHeader(std::istream &file, const CardCatalogEntry &entry, uint64_t streamStart) {
         CardHeader header;
-        file.seekg(entry.byteStart, std::ios::beg);
+        file.seekg(entry.byteStart - streamStart, std::ios::beg);
         file.read(reinterpret_cast<char*>(&header), sizeof(CardHeader));
         if (file.gcount() != sizeof(CardHeader)) {
             throw std::runtime_error("Error reading data card header from file");
@@ -201,14 +657,16 @@ namespace opat {
             header.headerSize = swap_bytes(header.headerSize);
             header.indexOffset = swap_bytes(header.indexOffset);
             header.cardSize = swap_bytes(header.cardSize);
+            header.statsOffset = swap_bytes(header.statsOffset);
+            header.merkleRoot = swap_bytes(header.merkleRoot);
         }
         return header;
     }
 
     // Reads the table index of a data card
-    TableIndex readTableIndex(std::ifstream &file, const CardCatalogEntry &entry, const CardHeader &header) {
+    TableIndex readTableIndex(std::istream &file, const CardCatalogEntry &entry, const CardHeader &header, uint64_t streamStart) {
         TableIndex tableIndex;
-        file.seekg(entry.byteStart + header.indexOffset, std::ios::beg);
+        file.seekg(entry.byteStart + header.indexOffset - streamStart, std::ios::beg);
         for (uint32_t i = 0; i < header.numTables; i++) {
             TableIndexEntry indexEntry;
             file.read(reinterpret_cast<char*>(&indexEntry), sizeof(TableIndexEntry));
@@ -221,20 +679,38 @@ namespace opat {
                 indexEntry.byteStart = swap_bytes(indexEntry.byteStart);
                 indexEntry.byteEnd = swap_bytes(indexEntry.byteEnd);
                 indexEntry.size = swap_bytes(indexEntry.size);
+                indexEntry.checksum = swap_bytes(indexEntry.checksum);
             }
             tableIndex.tableIndex[indexEntry.tag] = indexEntry;
         }
+        if (header.merkleRoot != 0 && merkle::cardRoot(tableIndex) != header.merkleRoot) {
+            throw std::runtime_error("The index of the card at byte " + std::to_string(entry.byteStart) + " does not match its checksum tree; the file is corrupt.");
+        }
+
+        // The statistics section follows the index in cards whose writer recorded one
+        if (header.statsOffset != 0) {
+            file.seekg(entry.byteStart + header.statsOffset - streamStart, std::ios::beg);
+            for (uint32_t i = 0; i < header.numTables; i++) {
+                TableStatistics statistics;
+                file.read(reinterpret_cast<char*>(&statistics), sizeof(TableStatistics));
+                if (file.gcount() != sizeof(TableStatistics)) {
+                    throw std::runtime_error("Error reading table statistics from file");
+                }
+                statistics = littleEndian(statistics);
+                tableIndex.statistics.emplace(std::string(statistics.tag, strnlen(statistics.tag, sizeof(statistics.tag))), statistics);
+            }
+        }
         return tableIndex;
     }
 
     // Reads an OPAT table from the file
-    OPATTable readOPATTable(std::ifstream &file, const CardCatalogEntry &cardEntry, const TableIndexEntry &tableEntry) {
+    OPATTable readOPATTable(std::istream &file, const CardCatalogEntry &cardEntry, const TableIndexEntry &tableEntry, uint64_t streamStart) {
         // TODO : replace these with make_unique instead of raw ptr initialization
         std::unique_ptr<double[]> rowValues(new double[tableEntry.numRows]);
         std::unique_ptr<double[]> columnValues(new double[tableEntry.numColumns]);
         std::unique_ptr<double[]> data(new double[tableEntry.numRows * tableEntry.numColumns * tableEntry.size]);
 
-        file.seekg(cardEntry.byteStart + tableEntry.byteStart, std::ios::beg);
+        file.seekg(cardEntry.byteStart + tableEntry.byteStart - streamStart, std::ios::beg);
         file.read(reinterpret_cast<char*>(rowValues.get()), tableEntry.numRows * sizeof(double));
         file.read(reinterpret_cast<char*>(columnValues.get()), tableEntry.numColumns * sizeof(double));
         file.read(reinterpret_cast<char*>(data.get()), tableEntry.numRows * tableEntry.numColumns * tableEntry.size *sizeof(double));
@@ -251,6 +727,12 @@ namespace opat {
         table.N_R = tableEntry.numRows;
         table.N_C = tableEntry.numColumns;
         table.m_vsize = tableEntry.size;
+
+        // Tables written without a checksum have the field zero-filled
+        if (tableEntry.checksum != 0 && computeChecksum(table) != tableEntry.checksum) {
+            throw std::runtime_error("Checksum mismatch in table '" + std::string(tableEntry.tag, strnlen(tableEntry.tag, sizeof(tableEntry.tag))) +
+                                     "' of the card at byte " + std::to_string(cardEntry.byteStart) + "; the file is corrupt.");
+        }
         return table;
     }
 
@@ -262,6 +744,7 @@ namespace opat {
         std::cout << "  IndexOffset: " << indexOffset << "\n";
         std::cout << "  NumIndex: " << numIndex << "\n";
         std::cout << "  HashPrecision: " << static_cast<int>(hashPrecision) << "\n";
+        std::cout << "  Merkle Root: " << std::hex << merkleRoot << std::dec << "\n";
         std::cout << "  Comment: " << comment << "\n";
         std::cout << "  Source: " << sourceInfo << "\n";
         std::cout << "  Creation Date: " << creationDate << std::endl;
@@ -269,12 +752,35 @@ namespace opat {
 
     // Utility functions
     const DataCard& OPAT::get(const FloatIndexVector& index) const {
-        auto it = cards.find(index);
-        if (it != cards.end()) {
+        if (recorder) {
+            recorder->record(trace::QueryKind::Card, index);
+        }
+        return resolve(index);
+    }
+
+    const DataCard& OPAT::resolve(const FloatIndexVector& index) const {
+        if (const auto it = cards.find(index); it != cards.end()) {
             return it->second;
-        } else {
-            throw std::runtime_error("Card not found for the given index.");
         }
+        if (lazyCards) {
+            if (const DataCard* card = lazyCards->find(index)) {
+                return *card;
+            }
+        }
+        throw std::runtime_error("Card not found for the given index.");
+    }
+
+    std::shared_ptr<const DataCard> OPAT::acquire(const FloatIndexVector& index) const {
+        if (const auto it = cards.find(index); it != cards.end()) {
+            // Non-owning handle: eager cards live as long as the OPAT object
+            return {std::shared_ptr<const DataCard>(), &it->second};
+        }
+        if (lazyCards) {
+            if (auto card = lazyCards->acquire(index)) {
+                return card;
+            }
+        }
+        throw std::runtime_error("Card not found for the given index.");
     }
 
     const DataCard& OPAT::operator[](const FloatIndexVector& index) const {
@@ -284,6 +790,8 @@ namespace opat {
     const OPATTable& DataCard::get(const std::string& tag) const {
         if (const auto it = tableData.find(tag); it != tableData.end()) {
             return it->second;
+        } else if (const OPATTable* table = deferredTables ? deferredTables->find(tag) : nullptr) {
+            return *table;
         } else {
             std::ostringstream oss;
             oss << "Tag '" << tag << "' not found in TableIndex. Available tags are: [";
@@ -314,8 +822,31 @@ namespace opat {
         return get(std::string(tag));
     }
 
+    bool DataCard::isTableRead(const std::string& tag) const {
+        if (tableData.contains(tag)) {
+            return true;
+        }
+        if (deferredTables) {
+            const auto it = deferredTables->tables.find(tag);
+            return it != deferredTables->tables.end() && it->second.read.load(std::memory_order_acquire);
+        }
+        return false;
+    }
+
+    bool DataCard::supplyTable(const std::string& tag, OPATTable table) const {
+        return deferredTables && deferredTables->supply(tag, std::move(table));
+    }
+
     std::vector<std::string> DataCard::getKeys() const {
         std::vector<std::string> keys;
+        if (deferredTables) {
+            // Deferred tables are listed without reading them
+            keys.reserve(tableIndex.tableIndex.size());
+            for (const auto &key: tableIndex.tableIndex | std::views::keys) {
+                keys.push_back(key);
+            }
+            return keys;
+        }
         keys.reserve(tableData.size());
         for (const auto &key: tableData | std::views::keys) {
             keys.push_back(key);
@@ -340,6 +871,47 @@ namespace opat {
         return get(tag);
     }
 
+    const TableStatistics& TableIndex::getStatistics(const std::string& tag) const {
+        if (const auto it = statistics.find(tag); it != statistics.end()) {
+            return it->second;
+        }
+        throw std::out_of_range("No statistics stored for tag '" + tag + "'.");
+    }
+
+    uint64_t computeChecksum(const OPATTable& table) {
+        // The axes are copied into one block so that the table's arrays need not be contiguous in memory
+        std::vector<double> axes(static_cast<std::size_t>(table.N_R) + table.N_C);
+        std::copy_n(table.rowValues.get(), table.N_R, axes.begin());
+        std::copy_n(table.columnValues.get(), table.N_C, axes.begin() + table.N_R);
+        const uint64_t seed = merkle::hash(axes.data(), axes.size() * sizeof(double));
+        return merkle::hash(table.data.get(), static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize * sizeof(double), seed);
+    }
+
+    TableStatistics computeStatistics(const std::string& tag, const OPATTable& table) {
+        TableStatistics statistics{};
+        std::copy_n(tag.data(), std::min(tag.size(), sizeof(statistics.tag)), statistics.tag);
+        statistics.min = std::numeric_limits<double>::infinity();
+        statistics.max = -std::numeric_limits<double>::infinity();
+        double sum = 0.0;
+        const uint64_t total = static_cast<uint64_t>(table.N_R) * table.N_C * table.m_vsize;
+        for (uint64_t i = 0; i < total; ++i) {
+            const double value = table.data[i];
+            if (std::isnan(value)) {
+                ++statistics.nanCount;
+                continue;
+            }
+            statistics.min = std::min(statistics.min, value);
+            statistics.max = std::max(statistics.max, value);
+            sum += value;
+        }
+        if (statistics.nanCount == total) {
+            statistics.min = statistics.max = statistics.mean = std::numeric_limits<double>::quiet_NaN();
+        } else {
+            statistics.mean = sum / static_cast<double>(total - statistics.nanCount);
+        }
+        return statistics;
+    }
+
 
     OPATTable OPATTable::operator()(uint32_t row, uint32_t column) const {
         return getData(row, column);
@@ -357,8 +929,15 @@ namespace opat {
     }
 
     double OPATTable::getData(uint32_t row, uint32_t column, uint64_t zdepth) const {
-        OPATTable table = getData(row, column);
-        return table.data[zdepth];
+        // Index straight into the data array rather than going through getData(row, column), which
+        // would heap allocate a temporary OPATTable for every scalar lookup
+        if (row >= N_R || column >= N_C || zdepth >= m_vsize) {
+            throw std::out_of_range("Index out of range");
+        }
+        if (data == nullptr) {
+            throw std::runtime_error("Data not initialized");
+        }
+        return data[(static_cast<uint64_t>(row) * N_C + column) * m_vsize + zdepth];
     }
 
 
@@ -509,18 +1088,36 @@ OPATTable OPATTable::slice(const Slice& rowSlice, const Slice& colSlice) const {
         }
 
     std::string OPATTable::ascii() const {
-        std::string result;
+        std::ostringstream os;
+        writeAscii(os);
+        return std::move(os).str();
+    }
+
+    void OPATTable::writeAscii(std::ostream& os) const {
+        // Formatted into a fixed buffer which is flushed to the stream whenever it could overflow
+        constexpr std::size_t BUFFER_SIZE = 1 << 16;
+        constexpr std::size_t MAX_VALUE = 32; // Longest shortest round-trip double, with its separator
+        std::vector<char> buffer(BUFFER_SIZE);
+        char* position = buffer.data();
+        char* const end = buffer.data() + BUFFER_SIZE;
+        const double* value = data.get();
         for (uint32_t i = 0; i < N_R; ++i) {
             for (uint32_t j = 0; j < N_C; ++j) {
-                result += std::to_string(data[i * N_C + j]) + " ";
+                for (uint64_t k = 0; k < m_vsize; ++k) {
+                    if (end - position < static_cast<std::ptrdiff_t>(MAX_VALUE)) {
+                        os.write(buffer.data(), position - buffer.data());
+                        position = buffer.data();
+                    }
+                    position = std::to_chars(position, end, *value++).ptr;
+                    *position++ = k + 1 < m_vsize ? ',' : (j + 1 < N_C ? ' ' : '\n');
+                }
             }
-            result += "\n";
         }
-        return result;
+        os.write(buffer.data(), position - buffer.data());
     }
 
     void OPATTable::print() const {
-        std::cout << ascii();
+        writeAscii(std::cout);
     }
 
     // Overloading << operator for printing
@@ -530,7 +1127,8 @@ OPATTable OPATTable::slice(const Slice& rowSlice, const Slice& colSlice) const {
         << ", NumTables: " << header.numTables
         << ", IndexOffset: " << header.indexOffset
         << ", NumIndex: " << header.numIndex
-        << ", HashPrecision: " << static_cast<int>(header.hashPrecision) << ")";
+        << ", HashPrecision: " << static_cast<int>(header.hashPrecision)
+        << ", Merkle Root: " << std::hex << header.merkleRoot << std::dec << ")";
         return os;
     }
     std::ostream& operator<<(std::ostream& os, const CardHeader& header) {
@@ -539,7 +1137,8 @@ OPATTable OPATTable::slice(const Slice& rowSlice, const Slice& colSlice) const {
             << "Header Size: " << header.headerSize << "\n"
             << "Index Offset: " << header.indexOffset << "\n"
             << "Card Size: " << header.cardSize << "\n"
-            << "Comment: " << header.comment << "\n";
+            << "Comment: " << header.comment << "\n"
+            << "Merkle Root: " << std::hex << header.merkleRoot << std::dec << "\n";
         return os;
     }
 
@@ -570,7 +1169,17 @@ OPATTable OPATTable::slice(const Slice& rowSlice, const Slice& colSlice) const {
             << ", Num Columns: " << entry.numColumns
             << ", Num Rows: " << entry.numRows
             << ", Column Name: " << std::string(entry.columnName, 8)
-            << ", Row Name: " << std::string(entry.rowName, 8) << ")";
+            << ", Row Name: " << std::string(entry.rowName, 8)
+            << ", Checksum: " << std::hex << entry.checksum << std::dec << ")";
+        return os;
+    }
+
+    std::ostream& operator<<(std::ostream& os, const TableStatistics& statistics) {
+        os << "TableStatistics(Tag: " << std::string(statistics.tag, strnlen(statistics.tag, sizeof(statistics.tag)))
+            << ", Min: " << statistics.min
+            << ", Max: " << statistics.max
+            << ", Mean: " << statistics.mean
+            << ", NaN Count: " << statistics.nanCount << ")";
         return os;
     }
 
@@ -0,0 +1,135 @@
+#include "queryTrace.h"
+#include "opatIO.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace opat::trace {
+    namespace {
+        constexpr uint16_t TRACE_VERSION = 1;
+
+        // Appends the raw bytes of value to buffer, converting to little-endian if required
+        template <typename T>
+        void append(std::vector<char>& buffer, T value) {
+            if (is_big_endian()) {
+                value = swap_bytes(value);
+            }
+            const auto* bytes = reinterpret_cast<const char*>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        template <typename T>
+        bool readValue(std::ifstream& file, T& value) {
+            file.read(reinterpret_cast<char*>(&value), sizeof(T));
+            if (file.gcount() != sizeof(T)) {
+                return false;
+            }
+            if (is_big_endian()) {
+                value = swap_bytes(value);
+            }
+            return true;
+        }
+    }
+
+    QueryRecorder::QueryRecorder(const std::string& filename, std::size_t bufferSize)
+        : m_file(filename, std::ios::binary | std::ios::trunc), m_bufferSize(bufferSize) {
+        if (!m_file.is_open()) {
+            throw std::runtime_error("Could not open trace file for writing: " + filename);
+        }
+        TraceHeader header{};
+        std::memcpy(header.magic, "OPTR", 4);
+        header.version = is_big_endian() ? swap_bytes(TRACE_VERSION) : TRACE_VERSION;
+        m_file.write(reinterpret_cast<const char*>(&header), sizeof(TraceHeader));
+
+        m_buffer.reserve(m_bufferSize);
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    QueryRecorder::~QueryRecorder() {
+        try {
+            flush();
+        } catch (...) {
+            // Never throw from a destructor; a partially written trace is still readable up to the last full record
+        }
+    }
+
+    void QueryRecorder::record(QueryKind kind, const FloatIndexVector& index) {
+        const auto now = std::chrono::steady_clock::now();
+        const auto timestamp = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start).count());
+        const auto numIndex = static_cast<uint16_t>(index.size());
+
+        std::lock_guard lock(m_mutex);
+        append(m_buffer, static_cast<uint8_t>(kind));
+        append(m_buffer, numIndex);
+        append(m_buffer, timestamp);
+        for (uint16_t dim = 0; dim < numIndex; ++dim) {
+            append(m_buffer, index[dim]);
+        }
+        m_count++;
+
+        if (m_buffer.size() >= m_bufferSize) {
+            flushUnlocked();
+        }
+    }
+
+    void QueryRecorder::flush() {
+        std::lock_guard lock(m_mutex);
+        flushUnlocked();
+    }
+
+    void QueryRecorder::flushUnlocked() {
+        if (!m_buffer.empty()) {
+            m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            m_buffer.clear();
+        }
+        m_file.flush();
+        if (!m_file) {
+            throw std::runtime_error("Error writing query trace to file");
+        }
+    }
+
+    uint64_t QueryRecorder::count() const {
+        std::lock_guard lock(m_mutex);
+        return m_count;
+    }
+
+    std::vector<TraceRecord> readTrace(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open trace file: " + filename);
+        }
+
+        TraceHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(TraceHeader));
+        if (file.gcount() != sizeof(TraceHeader) || std::string(header.magic, 4) != "OPTR") {
+            throw std::runtime_error("File is not a valid OPAT query trace: " + filename);
+        }
+        if (is_big_endian()) {
+            header.version = swap_bytes(header.version);
+        }
+        if (header.version != TRACE_VERSION) {
+            throw std::runtime_error("Unsupported query trace version " + std::to_string(header.version) + " in " + filename);
+        }
+
+        std::vector<TraceRecord> records;
+        uint8_t kind;
+        while (readValue(file, kind)) {
+            TraceRecord record;
+            uint16_t numIndex;
+            if (kind > static_cast<uint8_t>(QueryKind::Lattice) ||
+                !readValue(file, numIndex) || !readValue(file, record.timestamp)) {
+                throw std::runtime_error("Truncated or corrupt record in query trace: " + filename);
+            }
+            record.kind = static_cast<QueryKind>(kind);
+            record.index.resize(numIndex);
+            for (uint16_t dim = 0; dim < numIndex; ++dim) {
+                if (!readValue(file, record.index[dim])) {
+                    throw std::runtime_error("Truncated record in query trace: " + filename);
+                }
+            }
+            records.push_back(std::move(record));
+        }
+        return records;
+    }
+}
@@ -0,0 +1,323 @@
+#include "regrid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <thread>
+
+namespace opat::regrid {
+
+    namespace {
+        // Where a value of the new axis falls between two values of the old one
+        struct Weight {
+            uint32_t lower = 0;
+            uint32_t upper = 0;
+            double fraction = 0.0; // Weight of `upper`; `lower` has 1 - fraction
+            bool inside = false;
+        };
+
+        void checkAscending(const std::vector<double>& values, const char* what) {
+            if (values.empty()) {
+                throw std::invalid_argument(std::string("Cannot resample with no ") + what + ".");
+            }
+            for (std::size_t i = 1; i < values.size(); ++i) {
+                if (!(values[i] > values[i - 1])) {
+                    throw std::invalid_argument(std::string("The ") + what + " to resample must be strictly ascending.");
+                }
+            }
+        }
+
+        uint16_t tableDimension(std::size_t size, const std::string& tag, const char* what) {
+            if (size > std::numeric_limits<uint16_t>::max()) {
+                throw std::length_error("Table '" + tag + "' would have " + std::to_string(size) + " " + what +
+                                        ", more than a table index entry can store.");
+            }
+            return static_cast<uint16_t>(size);
+        }
+
+        std::vector<Weight> weights(const std::vector<double>& from, const std::vector<double>& to) {
+            std::vector<Weight> result(to.size());
+            if (from == to) {
+                // An axis which does not change is taken as it is, ordered or not
+                for (uint32_t i = 0; i < to.size(); ++i) {
+                    result[i] = {i, i, 0.0, true};
+                }
+                return result;
+            }
+            for (std::size_t i = 0; i < to.size(); ++i) {
+                const double value = to[i];
+                if (value < from.front() || value > from.back()) {
+                    continue;
+                }
+                const auto above = std::ranges::lower_bound(from, value);
+                const auto upper = static_cast<uint32_t>(above - from.begin());
+                if (*above == value) {
+                    result[i] = {upper, upper, 0.0, true};
+                } else {
+                    result[i] = {upper - 1, upper, (value - from[upper - 1]) / (from[upper] - from[upper - 1]), true};
+                }
+            }
+            return result;
+        }
+
+        OPATTable copyOf(const OPATTable& table) {
+            const std::size_t cells = static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize;
+            OPATTable copy;
+            copy.N_R = table.N_R;
+            copy.N_C = table.N_C;
+            copy.m_vsize = table.m_vsize;
+            copy.rowValues = std::make_unique<double[]>(table.N_R);
+            copy.columnValues = std::make_unique<double[]>(table.N_C);
+            copy.data = std::make_unique_for_overwrite<double[]>(cells);
+            std::copy_n(table.rowValues.get(), table.N_R, copy.rowValues.get());
+            std::copy_n(table.columnValues.get(), table.N_C, copy.columnValues.get());
+            std::copy_n(table.data.get(), cells, copy.data.get());
+            return copy;
+        }
+
+        std::shared_ptr<const DataCard> cardWith(const OPAT& opat, const FloatIndexVector& index, const std::string& tag) {
+            std::shared_ptr<const DataCard> card = opat.acquire(index);
+            if (!card->tableIndex.tableIndex.contains(tag)) {
+                throw std::invalid_argument("Card has no table tagged '" + tag + "'.");
+            }
+            return card;
+        }
+
+        // Merges `values` into the sorted, duplicate free `merged`
+        void merge(std::vector<double>& merged, const std::vector<double>& values) {
+            merged.insert(merged.end(), values.begin(), values.end());
+            std::ranges::sort(merged);
+            const auto duplicates = std::ranges::unique(merged);
+            merged.erase(duplicates.begin(), duplicates.end());
+        }
+
+        std::vector<double> restrict(std::vector<double> values, double lower, double upper) {
+            std::erase_if(values, [lower, upper](double value) { return value < lower || value > upper; });
+            return values;
+        }
+    }
+
+    Axes axesOf(const OPATTable& table) {
+        return {std::vector<double>(table.rowValues.get(), table.rowValues.get() + table.N_R),
+                std::vector<double>(table.columnValues.get(), table.columnValues.get() + table.N_C)};
+    }
+
+    bool sharesAxes(const OPAT& opat, const std::string& tag) {
+        bool first = true;
+        uint64_t vsize = 0;
+        Axes reference;
+        for (const FloatIndexVector& index : opat.cardCatalog.tableIndex | std::views::keys) {
+            const std::shared_ptr<const DataCard> card = cardWith(opat, index, tag);
+            const OPATTable& table = card->get(tag);
+            if (first) {
+                reference = axesOf(table);
+                vsize = table.m_vsize;
+                first = false;
+            } else if (table.m_vsize != vsize || axesOf(table) != reference) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Axes commonAxes(const OPAT& opat, const std::string& tag, AxisPolicy policy) {
+        // An axis which every card shares is kept as it is stored; only axes which differ are merged
+        std::optional<Axes> shared;
+        bool sharedRows = true;
+        bool sharedColumns = true;
+        Axes merged;
+        double rowLower = -std::numeric_limits<double>::infinity();
+        double rowUpper = std::numeric_limits<double>::infinity();
+        double columnLower = rowLower;
+        double columnUpper = rowUpper;
+        for (const FloatIndexVector& index : opat.cardCatalog.tableIndex | std::views::keys) {
+            const std::shared_ptr<const DataCard> card = cardWith(opat, index, tag);
+            const OPATTable& table = card->get(tag);
+            if (table.N_R == 0 || table.N_C == 0) {
+                throw std::invalid_argument("Cannot find common axes for the empty tables tagged '" + tag + "'.");
+            }
+            const Axes axes = axesOf(table);
+            if (!shared) {
+                shared = axes;
+            }
+            sharedRows = sharedRows && axes.rows == shared->rows;
+            sharedColumns = sharedColumns && axes.columns == shared->columns;
+            merge(merged.rows, axes.rows);
+            merge(merged.columns, axes.columns);
+            rowLower = std::max(rowLower, std::ranges::min(axes.rows));
+            rowUpper = std::min(rowUpper, std::ranges::max(axes.rows));
+            columnLower = std::max(columnLower, std::ranges::min(axes.columns));
+            columnUpper = std::min(columnUpper, std::ranges::max(axes.columns));
+        }
+        if (!shared) {
+            throw std::invalid_argument("Cannot find common axes for an OPAT without cards.");
+        }
+
+        if (policy == AxisPolicy::Overlap) {
+            merged.rows = restrict(std::move(merged.rows), rowLower, rowUpper);
+            merged.columns = restrict(std::move(merged.columns), columnLower, columnUpper);
+        }
+        if (sharedRows) {
+            merged.rows = shared->rows;
+        }
+        if (sharedColumns) {
+            merged.columns = shared->columns;
+        }
+        if (merged.rows.empty() || merged.columns.empty()) {
+            throw std::invalid_argument("The tables tagged '" + tag + "' have no rows or columns in common range.");
+        }
+        return merged;
+    }
+
+    OPATTable resample(const OPATTable& table, const Axes& axes) {
+        const Axes from = axesOf(table);
+        if (from == axes) {
+            return copyOf(table);
+        }
+        if (from.rows != axes.rows) {
+            checkAscending(from.rows, "rows");
+            checkAscending(axes.rows, "rows");
+        }
+        if (from.columns != axes.columns) {
+            checkAscending(from.columns, "columns");
+            checkAscending(axes.columns, "columns");
+        }
+
+        OPATTable result;
+        result.N_R = static_cast<uint32_t>(axes.rows.size());
+        result.N_C = static_cast<uint32_t>(axes.columns.size());
+        result.m_vsize = table.m_vsize;
+        result.rowValues = std::make_unique<double[]>(result.N_R);
+        result.columnValues = std::make_unique<double[]>(result.N_C);
+        result.data = std::make_unique_for_overwrite<double[]>(static_cast<std::size_t>(result.N_R) * result.N_C * result.m_vsize);
+        std::ranges::copy(axes.rows, result.rowValues.get());
+        std::ranges::copy(axes.columns, result.columnValues.get());
+
+        const std::vector<Weight> rowWeights = weights(from.rows, axes.rows);
+        const std::vector<Weight> columnWeights = weights(from.columns, axes.columns);
+        const uint64_t vsize = table.m_vsize;
+        const auto cell = [&table, vsize](uint32_t row, uint32_t column) {
+            return table.data.get() + (static_cast<std::size_t>(row) * table.N_C + column) * vsize;
+        };
+        double* out = result.data.get();
+        for (const Weight& r : rowWeights) {
+            for (const Weight& c : columnWeights) {
+                if (!r.inside || !c.inside) {
+                    std::fill_n(out, vsize, std::numeric_limits<double>::quiet_NaN());
+                    out += vsize;
+                    continue;
+                }
+                // Corners with no weight are skipped, so that a NaN beside an exact row or column does not spread
+                const double* corners[4] = {cell(r.lower, c.lower), cell(r.lower, c.upper), cell(r.upper, c.lower), cell(r.upper, c.upper)};
+                const double cornerWeights[4] = {(1 - r.fraction) * (1 - c.fraction), (1 - r.fraction) * c.fraction,
+                                                 r.fraction * (1 - c.fraction), r.fraction * c.fraction};
+                for (uint64_t k = 0; k < vsize; ++k) {
+                    double value = 0.0;
+                    for (int corner = 0; corner < 4; ++corner) {
+                        if (cornerWeights[corner] != 0.0) {
+                            value += cornerWeights[corner] * corners[corner][k];
+                        }
+                    }
+                    out[k] = value;
+                }
+                out += vsize;
+            }
+        }
+        return result;
+    }
+
+    OPAT regrid(const OPAT& opat, const std::unordered_map<std::string, Axes>& axes, unsigned threads) {
+        for (const auto& [tag, target] : axes) {
+            tableDimension(target.rows.size(), tag, "rows");
+            tableDimension(target.columns.size(), tag, "columns");
+        }
+
+        std::vector<const CardCatalogEntry*> entries;
+        entries.reserve(opat.cardCatalog.tableIndex.size());
+        for (const CardCatalogEntry& entry : opat.cardCatalog.tableIndex | std::views::values) {
+            entries.push_back(&entry);
+        }
+
+        std::vector<DataCard> cards(entries.size());
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr failure;
+        std::mutex failureMutex;
+        const auto work = [&] {
+            for (std::size_t i = next++; i < entries.size(); i = next++) {
+                try {
+                    const std::shared_ptr<const DataCard> card = opat.acquire(entries[i]->index);
+                    DataCard& result = cards[i];
+                    result.header = card->header;
+                    result.header.merkleRoot = 0;
+                    result.tableIndex = card->tableIndex;
+                    for (const std::string& tag : axes | std::views::keys) {
+                        if (!card->tableIndex.tableIndex.contains(tag)) {
+                            throw std::invalid_argument("Card has no table tagged '" + tag + "'.");
+                        }
+                    }
+                    for (auto& [tag, entry] : result.tableIndex.tableIndex) {
+                        const OPATTable& table = card->get(tag);
+                        entry.checksum = 0;
+                        const auto target = axes.find(tag);
+                        if (target == axes.end()) {
+                            result.tableData.emplace(tag, copyOf(table));
+                            continue;
+                        }
+                        OPATTable resampled = resample(table, target->second);
+                        entry.numRows = tableDimension(resampled.N_R, tag, "rows");
+                        entry.numColumns = tableDimension(resampled.N_C, tag, "columns");
+                        if (result.tableIndex.statistics.contains(tag)) {
+                            result.tableIndex.statistics[tag] = computeStatistics(tag, resampled);
+                        }
+                        result.tableData.emplace(tag, std::move(resampled));
+                    }
+                } catch (...) {
+                    const std::lock_guard lock(failureMutex);
+                    if (!failure) {
+                        failure = std::current_exception();
+                    }
+                    next = entries.size();
+                }
+            }
+        };
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::vector<std::thread> workers;
+        const std::size_t count = std::min<std::size_t>(threads, entries.size());
+        workers.reserve(count);
+        for (std::size_t i = 1; i < count; ++i) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+
+        OPAT result;
+        result.header = opat.header;
+        result.header.merkleRoot = 0;
+        result.cards.reserve(entries.size());
+        result.cardCatalog.tableIndex.reserve(entries.size());
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            CardCatalogEntry entry = *entries[i];
+            std::memset(entry.sha256, 0, sizeof(entry.sha256));
+            result.cards.emplace(entry.index, std::move(cards[i]));
+            result.cardCatalog.tableIndex.emplace(entry.index, std::move(entry));
+        }
+        return result;
+    }
+
+}
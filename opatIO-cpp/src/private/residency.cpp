@@ -0,0 +1,175 @@
+#include "residency.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25
+#endif
+
+namespace opat::memory {
+
+    namespace {
+        struct Range {
+            std::uintptr_t start;
+            std::uintptr_t end;
+        };
+
+        // A mapping of the process, with the fields of /proc/self/smaps that residencyStats needs
+        struct Mapping {
+            std::uintptr_t start;
+            std::uintptr_t end;
+            std::size_t hugePageBytes;
+            std::size_t lockedBytes;
+        };
+
+        std::size_t hugePageSize() {
+            static const std::size_t size = [] {
+                std::ifstream file("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+                std::size_t bytes = 0;
+                file >> bytes;
+                return bytes == 0 ? std::size_t{2} << 20 : bytes;
+            }();
+            return size;
+        }
+
+        Range rangeOf(const double* values, std::size_t count) {
+            const auto start = reinterpret_cast<std::uintptr_t>(values);
+            return {start, start + count * sizeof(double)};
+        }
+
+        // The largest run of whole, aligned huge pages inside `range` (empty if there is none)
+        Range hugePageInterior(const Range& range) {
+            const std::uintptr_t size = hugePageSize();
+            const std::uintptr_t start = (range.start + size - 1) / size * size;
+            const std::uintptr_t end = range.end / size * size;
+            return start < end ? Range{start, end} : Range{start, start};
+        }
+
+        // Payload arrays of the tables of every eagerly loaded card, split into `data` and the row and column values
+        void collectTables(const OPAT& opat, std::vector<Range>& data, std::vector<Range>& axes) {
+            for (const DataCard& card : opat.cards | std::views::values) {
+                for (const OPATTable& table : card.tableData | std::views::values) {
+                    data.push_back(rangeOf(table.data.get(), static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize));
+                    axes.push_back(rangeOf(table.rowValues.get(), table.N_R));
+                    axes.push_back(rangeOf(table.columnValues.get(), table.N_C));
+                }
+            }
+        }
+
+        std::vector<Mapping> readMappings() {
+            std::vector<Mapping> mappings;
+            std::ifstream smaps("/proc/self/smaps");
+            for (std::string line; std::getline(smaps, line);) {
+                std::istringstream fields(line);
+                std::string first;
+                fields >> first;
+                if (const auto dash = first.find('-'); dash != std::string::npos && first.back() != ':') {
+                    mappings.push_back({std::stoull(first.substr(0, dash), nullptr, 16),
+                                        std::stoull(first.substr(dash + 1), nullptr, 16), 0, 0});
+                } else if (!mappings.empty() && (first == "AnonHugePages:" || first == "Locked:")) {
+                    std::size_t kilobytes = 0;
+                    fields >> kilobytes;
+                    (first == "Locked:" ? mappings.back().lockedBytes : mappings.back().hugePageBytes) = kilobytes * 1024;
+                }
+            }
+            return mappings;
+        }
+
+        // Bytes of `ranges` which fall inside `mapping`
+        std::size_t overlap(const Mapping& mapping, const std::vector<Range>& ranges) {
+            std::size_t bytes = 0;
+            for (const Range& range : ranges) {
+                const std::uintptr_t start = std::max(range.start, mapping.start);
+                const std::uintptr_t end = std::min(range.end, mapping.end);
+                bytes += start < end ? end - start : 0;
+            }
+            return bytes;
+        }
+    }
+
+    ResidencyStats applyResidency(const OPAT& opat, const ResidencyOptions& options) {
+        std::vector<Range> data;
+        std::vector<Range> axes;
+        collectTables(opat, data, axes);
+
+        if (options.hugePages) {
+            for (const Range& range : data) {
+                const Range interior = hugePageInterior(range);
+                if (interior.start == interior.end) {
+                    continue;
+                }
+                void* start = reinterpret_cast<void*>(interior.start);
+                if (::madvise(start, interior.end - interior.start, MADV_HUGEPAGE) == 0) {
+                    // Already resident pages are otherwise only collapsed later by khugepaged
+                    ::madvise(start, interior.end - interior.start, MADV_COLLAPSE);
+                }
+            }
+        }
+        if (options.lock) {
+            for (const auto* ranges : {&data, &axes}) {
+                for (const Range& range : *ranges) {
+                    if (range.start != range.end) {
+                        ::mlock(reinterpret_cast<const void*>(range.start), range.end - range.start);
+                    }
+                }
+            }
+        }
+        return residencyStats(opat);
+    }
+
+    ResidencyStats residencyStats(const OPAT& opat) {
+        std::vector<Range> data;
+        std::vector<Range> axes;
+        collectTables(opat, data, axes);
+
+        ResidencyStats stats;
+        std::vector<Range> interiors;
+        for (const Range& range : data) {
+            stats.tableBytes += range.end - range.start;
+            const Range interior = hugePageInterior(range);
+            stats.hugePageEligibleBytes += interior.end - interior.start;
+            interiors.push_back(interior);
+        }
+        for (const Range& range : axes) {
+            stats.tableBytes += range.end - range.start;
+        }
+        if (stats.tableBytes == 0) {
+            return stats;
+        }
+
+        std::vector<Range> all = data;
+        all.insert(all.end(), axes.begin(), axes.end());
+        for (const Mapping& mapping : readMappings()) {
+            if (mapping.hugePageBytes > 0) {
+                stats.hugePageBytes += std::min(mapping.hugePageBytes, overlap(mapping, interiors));
+            }
+            if (mapping.lockedBytes > 0) {
+                stats.lockedBytes += std::min(mapping.lockedBytes, overlap(mapping, all));
+            }
+        }
+        return stats;
+    }
+
+    void unlockTables(const OPAT& opat) {
+        std::vector<Range> data;
+        std::vector<Range> axes;
+        collectTables(opat, data, axes);
+        for (const auto* ranges : {&data, &axes}) {
+            for (const Range& range : *ranges) {
+                if (range.start != range.end) {
+                    ::munlock(reinterpret_cast<const void*>(range.start), range.end - range.start);
+                }
+            }
+        }
+    }
+
+}
@@ -0,0 +1,160 @@
+#include "serveClient.h"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace opat::serve {
+
+    namespace {
+        std::string readString(int fd, std::size_t length) {
+            std::string value(length, '\0');
+            readExact(fd, value.data(), length);
+            return value;
+        }
+
+        std::vector<double> flatten(const std::vector<std::vector<double>>& points, std::size_t& numIndex) {
+            numIndex = points.empty() ? 0 : points.front().size();
+            std::vector<double> flat;
+            flat.reserve(points.size() * numIndex);
+            for (const auto& point : points) {
+                if (point.size() != numIndex) {
+                    throw std::invalid_argument("All query points must have the same dimension");
+                }
+                flat.insert(flat.end(), point.begin(), point.end());
+            }
+            return flat;
+        }
+    }
+
+    Client::Client(const std::string& socketPath) {
+        sockaddr_un address{};
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Socket path is too long: " + socketPath);
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (m_fd < 0) {
+            throw std::runtime_error(std::string("Could not create socket: ") + std::strerror(errno));
+        }
+        if (::connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            const std::string reason = std::strerror(errno);
+            ::close(m_fd);
+            m_fd = -1;
+            throw std::runtime_error("Could not connect to opatServe at " + socketPath + ": " + reason);
+        }
+    }
+
+    Client::Client(Client&& other) noexcept : m_fd(std::exchange(other.m_fd, -1)) {}
+
+    Client& Client::operator=(Client&& other) noexcept {
+        if (this != &other) {
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+            m_fd = std::exchange(other.m_fd, -1);
+        }
+        return *this;
+    }
+
+    Client::~Client() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    ResponseHeader Client::request(Op op, uint32_t fileID, const std::string& tag,
+                                   const double* points, std::size_t numPoints, std::size_t numIndex) {
+        if (m_fd < 0) {
+            throw std::runtime_error("Client is not connected");
+        }
+        if (tag.size() > UINT16_MAX || numIndex > UINT16_MAX || numPoints * numIndex > MAX_REQUEST_VALUES) {
+            throw std::invalid_argument("Request is too large; split it into smaller batches");
+        }
+        RequestHeader header{};
+        std::memcpy(header.magic, "OPSQ", 4);
+        header.version = PROTOCOL_VERSION;
+        header.op = static_cast<uint16_t>(op);
+        header.fileID = fileID;
+        header.numPoints = static_cast<uint32_t>(numPoints);
+        header.numIndex = static_cast<uint16_t>(numIndex);
+        header.tagLength = static_cast<uint16_t>(tag.size());
+        writeExact(m_fd, &header, sizeof(header));
+        writeExact(m_fd, tag.data(), tag.size());
+        writeExact(m_fd, points, numPoints * numIndex * sizeof(double));
+
+        ResponseHeader response{};
+        readExact(m_fd, &response, sizeof(response));
+        if (std::memcmp(response.magic, "OPSR", 4) != 0) {
+            throw std::runtime_error("Invalid response from opatServe");
+        }
+        if (static_cast<Status>(response.status) != Status::Ok) {
+            throw std::runtime_error("opatServe rejected the request: " + readString(m_fd, response.payloadSize));
+        }
+        return response;
+    }
+
+    std::vector<ServedFileInfo> Client::info() {
+        const ResponseHeader response = request(Op::Info, 0, "", nullptr, 0, 0);
+        std::vector<ServedFileInfo> files;
+        files.reserve(response.numResults);
+        for (uint32_t i = 0; i < response.numResults; ++i) {
+            FileInfo info{};
+            readExact(m_fd, &info, sizeof(info));
+            files.push_back({readString(m_fd, info.nameLength), info.numCards, info.numIndex, info.hashPrecision});
+        }
+        return files;
+    }
+
+    std::vector<QueryResult> Client::query(Op op, uint32_t fileID, const std::string& tag,
+                                           const double* points, std::size_t numPoints, std::size_t numIndex) {
+        if (op == Op::Info) {
+            throw std::invalid_argument("Use Client::info to describe the served files");
+        }
+        const ResponseHeader response = request(op, fileID, tag, points, numPoints, numIndex);
+        std::vector<QueryResult> results(response.numResults);
+        for (auto& result : results) {
+            ResultHeader header{};
+            readExact(m_fd, &header, sizeof(header));
+            result.status = static_cast<Status>(header.status);
+            if (!result.ok()) {
+                result.error = readString(m_fd, header.messageLength);
+                continue;
+            }
+            const std::size_t numValues = static_cast<std::size_t>(header.N_R) * header.N_C * header.vsize;
+            result.table.N_R = header.N_R;
+            result.table.N_C = header.N_C;
+            result.table.m_vsize = header.vsize;
+            result.table.rowValues = std::make_unique<double[]>(header.N_R);
+            result.table.columnValues = std::make_unique<double[]>(header.N_C);
+            result.table.data = std::make_unique<double[]>(numValues);
+            readExact(m_fd, result.table.rowValues.get(), header.N_R * sizeof(double));
+            readExact(m_fd, result.table.columnValues.get(), header.N_C * sizeof(double));
+            readExact(m_fd, result.table.data.get(), numValues * sizeof(double));
+        }
+        return results;
+    }
+
+    std::vector<QueryResult> Client::get(uint32_t fileID, const std::string& tag, const std::vector<std::vector<double>>& points) {
+        std::size_t numIndex = 0;
+        const std::vector<double> flat = flatten(points, numIndex);
+        return query(Op::Get, fileID, tag, flat.data(), points.size(), numIndex);
+    }
+
+    std::vector<QueryResult> Client::interpolate(uint32_t fileID, const std::string& tag, const std::vector<std::vector<double>>& points) {
+        std::size_t numIndex = 0;
+        const std::vector<double> flat = flatten(points, numIndex);
+        return query(Op::Interpolate, fileID, tag, flat.data(), points.size(), numIndex);
+    }
+
+}
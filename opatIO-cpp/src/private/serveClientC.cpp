@@ -0,0 +1,132 @@
+/**
+ * @file serveClientC.cpp
+ * @brief Implementation of the C API in serveClientC.h on top of opat::serve::Client.
+ */
+
+#include "serveClientC.h"
+#include "serveClient.h"
+
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+static_assert(OPAT_SERVE_OK == static_cast<int>(opat::serve::Status::Ok));
+static_assert(OPAT_SERVE_BAD_REQUEST == static_cast<int>(opat::serve::Status::BadRequest));
+static_assert(OPAT_SERVE_NOT_FOUND == static_cast<int>(opat::serve::Status::NotFound));
+static_assert(OPAT_SERVE_OUT_OF_RANGE == static_cast<int>(opat::serve::Status::OutOfRange));
+static_assert(OPAT_SERVE_FAILED == static_cast<int>(opat::serve::Status::Failed));
+
+struct opat_client {
+    std::optional<opat::serve::Client> client;
+    std::vector<opat::serve::QueryResult> results;
+    std::string lastError;
+};
+
+namespace {
+    int runQuery(opat_client* handle, opat::serve::Op op, uint32_t fileID, const char* tag,
+                 const double* points, size_t numPoints, size_t numIndex) {
+        if (handle == nullptr) {
+            return -1;
+        }
+        handle->results.clear();
+        handle->lastError.clear();
+        try {
+            handle->results = handle->client->query(op, fileID, tag == nullptr ? "" : tag, points, numPoints, numIndex);
+            return 0;
+        } catch (const std::exception& e) {
+            handle->lastError = e.what();
+            return -1;
+        }
+    }
+
+    const opat::serve::QueryResult* result(const opat_client* handle, size_t i) {
+        if (handle == nullptr || i >= handle->results.size()) {
+            return nullptr;
+        }
+        return &handle->results[i];
+    }
+}
+
+extern "C" {
+
+    opat_client* opat_client_connect(const char* socket_path, char* error_out, size_t error_size) {
+        try {
+            auto handle = std::make_unique<opat_client>();
+            handle->client.emplace(socket_path != nullptr ? socket_path : opat::serve::defaultSocketPath());
+            return handle.release();
+        } catch (const std::exception& e) {
+            if (error_out != nullptr && error_size > 0) {
+                std::strncpy(error_out, e.what(), error_size - 1);
+                error_out[error_size - 1] = '\0';
+            }
+            return nullptr;
+        }
+    }
+
+    void opat_client_close(opat_client* client) {
+        delete client;
+    }
+
+    const char* opat_client_last_error(const opat_client* client) {
+        return client == nullptr ? "Invalid client handle" : client->lastError.c_str();
+    }
+
+    int opat_client_get(opat_client* client, uint32_t file_id, const char* tag,
+                        const double* points, size_t num_points, size_t num_index) {
+        return runQuery(client, opat::serve::Op::Get, file_id, tag, points, num_points, num_index);
+    }
+
+    int opat_client_interpolate(opat_client* client, uint32_t file_id, const char* tag,
+                                const double* points, size_t num_points, size_t num_index) {
+        return runQuery(client, opat::serve::Op::Interpolate, file_id, tag, points, num_points, num_index);
+    }
+
+    size_t opat_client_num_results(const opat_client* client) {
+        return client == nullptr ? 0 : client->results.size();
+    }
+
+    int opat_client_result_status(const opat_client* client, size_t i) {
+        const auto* r = result(client, i);
+        return r == nullptr ? -1 : static_cast<int>(r->status);
+    }
+
+    const char* opat_client_result_error(const opat_client* client, size_t i) {
+        const auto* r = result(client, i);
+        return r == nullptr ? "Result index out of range" : r->error.c_str();
+    }
+
+    const double* opat_client_result_data(const opat_client* client, size_t i, uint32_t* n_r, uint32_t* n_c, uint32_t* vsize) {
+        const auto* r = result(client, i);
+        if (r == nullptr || !r->ok()) {
+            return nullptr;
+        }
+        if (n_r != nullptr) {
+            *n_r = r->table.N_R;
+        }
+        if (n_c != nullptr) {
+            *n_c = r->table.N_C;
+        }
+        if (vsize != nullptr) {
+            *vsize = static_cast<uint32_t>(r->table.m_vsize);
+        }
+        return r->table.data.get();
+    }
+
+    int opat_client_result_axes(const opat_client* client, size_t i, const double** row_values, const double** column_values) {
+        const auto* r = result(client, i);
+        if (r == nullptr || !r->ok()) {
+            return -1;
+        }
+        if (row_values != nullptr) {
+            *row_values = r->table.rowValues.get();
+        }
+        if (column_values != nullptr) {
+            *column_values = r->table.columnValues.get();
+        }
+        return 0;
+    }
+
+}
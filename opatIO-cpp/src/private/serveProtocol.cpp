@@ -0,0 +1,55 @@
+#include "serveProtocol.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace opat::serve {
+
+    void readExact(int fd, void* buffer, std::size_t size) {
+        auto* out = static_cast<char*>(buffer);
+        while (size > 0) {
+            const ssize_t n = ::read(fd, out, size);
+            if (n == 0) {
+                throw std::runtime_error("Connection closed by peer");
+            }
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Error reading from socket: ") + std::strerror(errno));
+            }
+            out += n;
+            size -= static_cast<std::size_t>(n);
+        }
+    }
+
+    void writeExact(int fd, const void* buffer, std::size_t size) {
+        const auto* in = static_cast<const char*>(buffer);
+        while (size > 0) {
+            // MSG_NOSIGNAL so that a client going away surfaces as an error rather than SIGPIPE
+            const ssize_t n = ::send(fd, in, size, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Error writing to socket: ") + std::strerror(errno));
+            }
+            in += n;
+            size -= static_cast<std::size_t>(n);
+        }
+    }
+
+    std::string defaultSocketPath() {
+        if (const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR"); runtimeDir != nullptr && runtimeDir[0] != '\0') {
+            return std::string(runtimeDir) + "/opatServe.sock";
+        }
+        return "/tmp/opatServe.sock";
+    }
+
+}
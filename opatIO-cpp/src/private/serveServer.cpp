@@ -0,0 +1,296 @@
+#include "serveServer.h"
+#include "tableLattice.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace opat::serve {
+
+    struct Server::ServedFile {
+        std::string filename;
+        OPAT opat;
+        std::once_flag latticeOnce;
+        std::unique_ptr<lattice::TableLattice> lattice; ///< Built on first interpolation; copied by each connection.
+        std::string latticeError;                       ///< Why the lattice could not be built, if it could not.
+    };
+
+    namespace {
+        void append(std::vector<char>& out, const void* data, std::size_t size) {
+            const auto* bytes = static_cast<const char*>(data);
+            out.insert(out.end(), bytes, bytes + size);
+        }
+
+        void sendResponse(int fd, Status status, uint32_t numResults, const std::vector<char>& payload) {
+            ResponseHeader header{};
+            std::memcpy(header.magic, "OPSR", 4);
+            header.status = static_cast<uint16_t>(status);
+            header.numResults = numResults;
+            header.payloadSize = payload.size();
+            writeExact(fd, &header, sizeof(header));
+            if (!payload.empty()) {
+                writeExact(fd, payload.data(), payload.size());
+            }
+        }
+
+        void sendError(int fd, Status status, const std::string& message) {
+            sendResponse(fd, status, 0, std::vector<char>(message.begin(), message.end()));
+        }
+
+        void appendFailure(std::vector<char>& out, Status status, const std::string& message) {
+            ResultHeader result{};
+            result.status = static_cast<uint16_t>(status);
+            result.messageLength = static_cast<uint32_t>(message.size());
+            append(out, &result, sizeof(result));
+            append(out, message.data(), message.size());
+        }
+
+        void appendTable(std::vector<char>& out, const OPATTable& table) {
+            ResultHeader result{};
+            result.status = static_cast<uint16_t>(Status::Ok);
+            result.N_R = table.N_R;
+            result.N_C = table.N_C;
+            result.vsize = static_cast<uint32_t>(table.m_vsize);
+            append(out, &result, sizeof(result));
+            append(out, table.rowValues.get(), table.N_R * sizeof(double));
+            append(out, table.columnValues.get(), table.N_C * sizeof(double));
+            append(out, table.data.get(), static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize * sizeof(double));
+        }
+
+        void appendCardTable(std::vector<char>& out, const DataCard& card, const std::string& tag) {
+            if (card.tableIndex.tableIndex.contains(tag)) {
+                appendTable(out, card.get(tag));
+            } else {
+                appendFailure(out, Status::NotFound, "Tag '" + tag + "' not found in card");
+            }
+        }
+    }
+
+    Server::Server(const std::vector<std::string>& filenames, LoadMode mode) {
+        m_files.reserve(filenames.size());
+        for (const std::string& filename : filenames) {
+            auto file = std::make_unique<ServedFile>();
+            file->filename = filename;
+            file->opat = readOPAT(filename, mode);
+            m_files.push_back(std::move(file));
+        }
+    }
+
+    Server::~Server() {
+        stop();
+        if (m_listenFd >= 0) {
+            ::close(m_listenFd);
+            ::unlink(m_socketPath.c_str());
+        }
+    }
+
+    void Server::listen(const std::string& socketPath) {
+        sockaddr_un address{};
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Socket path is too long: " + socketPath);
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("Could not create socket: ") + std::strerror(errno));
+        }
+        ::unlink(socketPath.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+            const std::string reason = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("Could not listen on " + socketPath + ": " + reason);
+        }
+        m_listenFd = fd;
+        m_socketPath = socketPath;
+    }
+
+    void Server::run() {
+        if (m_listenFd < 0) {
+            throw std::logic_error("Server::run called before Server::listen");
+        }
+        auto backoff = std::chrono::milliseconds(1);
+        while (!m_stopping.load()) {
+            const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                const int error = errno;
+                if (m_stopping.load()) {
+                    break; // stop() shut the listening socket down
+                }
+                if (error == EINTR || error == ECONNABORTED) {
+                    continue;
+                }
+                if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM) {
+                    // Out of descriptors or memory until connections close; wait rather than give up on serving
+                    std::this_thread::sleep_for(backoff);
+                    backoff = std::min(backoff * 2, std::chrono::milliseconds(1000));
+                    continue;
+                }
+                stop(); // Lets the open connections finish, as on a normal shutdown, before the error is reported
+                std::unique_lock lock(m_connectionsMutex);
+                m_connectionsDrained.wait(lock, [this] { return m_connections.empty(); });
+                throw std::runtime_error(std::string("Could not accept connections on ") + m_socketPath + ": " + std::strerror(error));
+            }
+            backoff = std::chrono::milliseconds(1);
+            {
+                std::lock_guard lock(m_connectionsMutex);
+                if (m_stopping.load()) {
+                    ::close(fd);
+                    break;
+                }
+                m_connections.insert(fd);
+            }
+            // Connection threads are detached so that a long-running server does not accumulate finished
+            // threads; run() instead waits below for the set of open connections to drain
+            std::thread([this, fd] {
+                serveConnection(fd);
+                std::lock_guard lock(m_connectionsMutex);
+                m_connections.erase(fd);
+                ::close(fd);
+                m_connectionsDrained.notify_all();
+            }).detach();
+        }
+        std::unique_lock lock(m_connectionsMutex);
+        m_connectionsDrained.wait(lock, [this] { return m_connections.empty(); });
+    }
+
+    void Server::stop() {
+        std::lock_guard lock(m_connectionsMutex);
+        m_stopping.store(true);
+        if (m_listenFd >= 0) {
+            ::shutdown(m_listenFd, SHUT_RDWR);
+        }
+        for (const int fd : m_connections) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+    void Server::serveConnection(int fd) {
+        // Each connection interpolates with its own lattice copies, since TableLattice caches its last simplex
+        std::vector<std::unique_ptr<lattice::TableLattice>> lattices(m_files.size());
+        std::vector<double> points;
+        std::vector<double> point;
+        std::vector<char> payload;
+        std::string tag;
+
+        try {
+            while (true) {
+                RequestHeader request{};
+                readExact(fd, &request, sizeof(request));
+                if (std::memcmp(request.magic, "OPSQ", 4) != 0 || request.version != PROTOCOL_VERSION) {
+                    sendError(fd, Status::BadRequest, "Unsupported request (bad magic or protocol version)");
+                    return; // The lengths in the header cannot be trusted, so drop the connection
+                }
+                tag.resize(request.tagLength);
+                readExact(fd, tag.data(), tag.size());
+                const uint64_t numValues = static_cast<uint64_t>(request.numPoints) * request.numIndex;
+                if (numValues > MAX_REQUEST_VALUES) {
+                    sendError(fd, Status::BadRequest, "Request exceeds " + std::to_string(MAX_REQUEST_VALUES) + " values");
+                    return; // The rest of the request cannot be skipped safely, so drop the connection
+                }
+                points.resize(numValues);
+                readExact(fd, points.data(), numValues * sizeof(double));
+
+                const auto op = static_cast<Op>(request.op);
+                payload.clear();
+                if (op == Op::Info) {
+                    for (const auto& file : m_files) {
+                        FileInfo info{};
+                        info.numCards = static_cast<uint32_t>(file->opat.cardCatalog.tableIndex.size());
+                        info.numIndex = file->opat.header.numIndex;
+                        info.hashPrecision = file->opat.header.hashPrecision;
+                        info.nameLength = static_cast<uint32_t>(file->filename.size());
+                        append(payload, &info, sizeof(info));
+                        append(payload, file->filename.data(), file->filename.size());
+                    }
+                    sendResponse(fd, Status::Ok, static_cast<uint32_t>(m_files.size()), payload);
+                    continue;
+                }
+                if (op != Op::Get && op != Op::Interpolate) {
+                    sendError(fd, Status::BadRequest, "Unknown operation " + std::to_string(request.op));
+                    continue;
+                }
+                if (request.fileID >= m_files.size()) {
+                    sendError(fd, Status::BadRequest, "Unknown file ID " + std::to_string(request.fileID));
+                    continue;
+                }
+                ServedFile& file = *m_files[request.fileID];
+                if (request.numIndex != file.opat.header.numIndex) {
+                    sendError(fd, Status::BadRequest, "Points have " + std::to_string(request.numIndex) + " dimensions but " +
+                        file.filename + " is indexed by " + std::to_string(file.opat.header.numIndex));
+                    continue;
+                }
+
+                lattice::TableLattice* lattice = nullptr;
+                if (op == Op::Interpolate) {
+                    std::call_once(file.latticeOnce, [&file] {
+                        try {
+                            file.lattice = std::make_unique<lattice::TableLattice>(file.opat);
+                        } catch (const std::exception& e) {
+                            file.latticeError = e.what();
+                        }
+                    });
+                    if (!file.lattice) {
+                        sendError(fd, Status::Failed, "Could not build lattice for " + file.filename + ": " + file.latticeError);
+                        continue;
+                    }
+                    if (!lattices[request.fileID]) {
+                        lattices[request.fileID] = std::make_unique<lattice::TableLattice>(*file.lattice);
+                    }
+                    lattice = lattices[request.fileID].get();
+                }
+
+                point.resize(request.numIndex);
+                std::optional<bool> tagFound;
+                for (uint32_t i = 0; i < request.numPoints; ++i) {
+                    std::copy_n(points.data() + static_cast<std::size_t>(i) * request.numIndex, request.numIndex, point.data());
+                    try {
+                        if (op == Op::Get) {
+                            const FloatIndexVector index(point, file.opat.header.hashPrecision);
+                            if (!file.opat.cardCatalog.tableIndex.contains(index)) {
+                                std::ostringstream oss;
+                                oss << "No card at index " << index;
+                                appendFailure(payload, Status::NotFound, oss.str());
+                                continue;
+                            }
+                            appendCardTable(payload, file.opat.get(index), tag);
+                        } else {
+                            if (!tagFound) {
+                                // The cards of a lattice all have the same tags, so any one of them settles it for every point
+                                tagFound = file.opat.acquire(file.opat.cardCatalog.tableIndex.begin()->first)->tableIndex.tableIndex.contains(tag);
+                            }
+                            if (!*tagFound) {
+                                appendFailure(payload, Status::NotFound, "Tag '" + tag + "' not found in card");
+                                continue;
+                            }
+                            appendTable(payload, lattice->getTable(FloatIndexVector(point, file.opat.header.hashPrecision), tag));
+                        }
+                    } catch (const std::out_of_range& e) {
+                        appendFailure(payload, Status::OutOfRange, e.what());
+                    } catch (const std::invalid_argument& e) {
+                        appendFailure(payload, Status::BadRequest, e.what());
+                    } catch (const std::exception& e) {
+                        appendFailure(payload, Status::Failed, e.what());
+                    }
+                }
+                sendResponse(fd, Status::Ok, request.numPoints, payload);
+            }
+        } catch (const std::exception&) {
+            // The client disconnected (or the server is stopping); nothing left to do for this connection
+        }
+    }
+
+}
@@ -0,0 +1,518 @@
+#include "sha256.h"
+
+#include "picosha2.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OPAT_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace opat::sha256 {
+
+    namespace {
+        constexpr std::size_t BLOCK = 64;
+        constexpr std::size_t LANES = 8;
+
+        alignas(16) constexpr uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        constexpr uint32_t INITIAL_STATE[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+
+        /**
+         * @brief A message as the compression function sees it: its whole blocks, read in place, then one
+         * or two blocks holding the rest of the message and the padding.
+         */
+        struct Blocks {
+            const uint8_t* data = nullptr;
+            std::size_t whole = 0;
+            alignas(16) uint8_t tail[2 * BLOCK] = {};
+            std::size_t tailBlocks = 0;
+
+            Blocks() = default;
+
+            explicit Blocks(std::span<const uint8_t> message) : data(message.data()), whole(message.size() / BLOCK) {
+                const std::size_t rest = message.size() % BLOCK;
+                if (rest != 0) {
+                    std::memcpy(tail, message.data() + whole * BLOCK, rest);
+                }
+                tail[rest] = 0x80;
+                tailBlocks = rest + 9 <= BLOCK ? 1 : 2;
+                const uint64_t bits = static_cast<uint64_t>(message.size()) * 8;
+                for (std::size_t i = 0; i < 8; ++i) {
+                    tail[tailBlocks * BLOCK - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+                }
+            }
+
+            [[nodiscard]] std::size_t count() const { return whole + tailBlocks; }
+
+            [[nodiscard]] const uint8_t* block(std::size_t i) const {
+                return i < whole ? data + i * BLOCK : tail + (i - whole) * BLOCK;
+            }
+        };
+
+        Digest toDigest(const uint32_t state[8]) {
+            Digest digest;
+            for (std::size_t i = 0; i < 8; ++i) {
+                digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+                digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+                digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+                digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+            }
+            return digest;
+        }
+
+        Digest portable(std::span<const uint8_t> message) {
+            Digest digest;
+            picosha2::hash256(message.begin(), message.end(), digest.begin(), digest.end());
+            return digest;
+        }
+
+#ifdef OPAT_SHA256_X86
+        struct Features {
+            bool shaNi = false;
+            bool avx2 = false;
+        };
+
+        Features detect() {
+            Features features;
+            unsigned a = 0, b = 0, c = 0, d = 0;
+            if (!__get_cpuid(1, &a, &b, &c, &d)) {
+                return features;
+            }
+            const bool ssse3 = c & bit_SSSE3;
+            const bool sse41 = c & bit_SSE4_1;
+            // AVX registers are only usable if the OS saves them on context switches
+            bool avxState = false;
+            if ((c & bit_OSXSAVE) && (c & bit_AVX)) {
+                unsigned low = 0, high = 0;
+                __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+                avxState = (low & 0x6) == 0x6;
+            }
+            if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+                return features;
+            }
+            features.shaNi = (b & bit_SHA) && ssse3 && sse41;
+            features.avx2 = (b & bit_AVX2) && avxState;
+            return features;
+        }
+
+        const Features& features() {
+            static const Features detected = detect();
+            return detected;
+        }
+
+        // Compresses `count` consecutive blocks at `data` into `state`
+        __attribute__((target("sha,ssse3,sse4.1")))
+        void compressShaNi(uint32_t state[8], const uint8_t* data, std::size_t count) {
+            const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+            // The instructions keep the state as ABEF and CDGH
+            __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+            __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+            __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+            state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+            for (; count > 0; --count, data += BLOCK) {
+                const __m128i abef = state0;
+                const __m128i cdgh = state1;
+                __m128i w[4];
+
+                // Sixteen groups of four rounds; the schedule for later groups is computed alongside
+#pragma GCC unroll 16
+                for (int g = 0; g < 16; ++g) {
+                    if (g < 4) {
+                        w[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * g)), byteSwap);
+                    }
+                    __m128i message = _mm_add_epi32(w[g % 4], _mm_load_si128(reinterpret_cast<const __m128i*>(K + 4 * g)));
+                    state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+                    if (g >= 3 && g < 15) {
+                        __m128i& next = w[(g + 1) % 4];
+                        next = _mm_add_epi32(next, _mm_alignr_epi8(w[g % 4], w[(g + 3) % 4], 4));
+                        next = _mm_sha256msg2_epu32(next, w[g % 4]);
+                    }
+                    message = _mm_shuffle_epi32(message, 0x0E);
+                    state0 = _mm_sha256rnds2_epu32(state0, state1, message);
+                    if (g >= 1 && g < 13) {
+                        w[(g + 3) % 4] = _mm_sha256msg1_epu32(w[(g + 3) % 4], w[g % 4]);
+                    }
+                }
+
+                state0 = _mm_add_epi32(state0, abef);
+                state1 = _mm_add_epi32(state1, cdgh);
+            }
+
+            tmp = _mm_shuffle_epi32(state0, 0x1B);
+            state1 = _mm_shuffle_epi32(state1, 0xB1);
+            state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+            state1 = _mm_alignr_epi8(state1, tmp, 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+        }
+
+        Digest shaNi(std::span<const uint8_t> message) {
+            const Blocks blocks(message);
+            uint32_t state[8];
+            std::memcpy(state, INITIAL_STATE, sizeof(state));
+            compressShaNi(state, blocks.data, blocks.whole);
+            compressShaNi(state, blocks.tail, blocks.tailBlocks);
+            return toDigest(state);
+        }
+
+        __attribute__((target("avx2"), always_inline))
+        inline __m256i rotr(__m256i x, int n) {
+            return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+        }
+
+        // Transposes eight rows of eight words, so that word i of every row ends up in `rows[i]`
+        __attribute__((target("avx2"), always_inline))
+        inline void transpose(__m256i rows[8]) {
+            __m256i t[8];
+            __m256i u[8];
+            for (int i = 0; i < 8; i += 2) {
+                t[i] = _mm256_unpacklo_epi32(rows[i], rows[i + 1]);
+                t[i + 1] = _mm256_unpackhi_epi32(rows[i], rows[i + 1]);
+            }
+            for (int i = 0; i < 8; i += 4) {
+                u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+                u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+                u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+                u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+            }
+            for (int i = 0; i < 4; ++i) {
+                rows[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+                rows[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+            }
+        }
+
+        // Compresses one block of each lane into `state`, which holds word i of every lane's state in `state[i]`
+        __attribute__((target("avx2")))
+        void compressAvx2(__m256i state[8], const uint8_t* const blocks[LANES]) {
+            const __m256i byteSwap = _mm256_set_epi8(
+                12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+            __m256i w[16];
+            for (int half = 0; half < 2; ++half) {
+                __m256i* rows = w + 8 * half;
+                for (std::size_t lane = 0; lane < LANES; ++lane) {
+                    rows[lane] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blocks[lane] + 32 * half));
+                }
+                transpose(rows);
+                for (int i = 0; i < 8; ++i) {
+                    rows[i] = _mm256_shuffle_epi8(rows[i], byteSwap);
+                }
+            }
+
+            __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+            __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int t = 0; t < 64; ++t) {
+                if (t >= 16) {
+                    const __m256i w15 = w[(t - 15) % 16];
+                    const __m256i w2 = w[(t - 2) % 16];
+                    const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr(w15, 7), rotr(w15, 18)), _mm256_srli_epi32(w15, 3));
+                    const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr(w2, 17), rotr(w2, 19)), _mm256_srli_epi32(w2, 10));
+                    w[t % 16] = _mm256_add_epi32(_mm256_add_epi32(w[t % 16], s0), _mm256_add_epi32(w[(t - 7) % 16], s1));
+                }
+                const __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr(e, 6), rotr(e, 11)), rotr(e, 25));
+                const __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+                const __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1),
+                    _mm256_add_epi32(_mm256_add_epi32(choose, _mm256_set1_epi32(static_cast<int>(K[t]))), w[t % 16]));
+                const __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr(a, 2), rotr(a, 13)), rotr(a, 22));
+                const __m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+                const __m256i t2 = _mm256_add_epi32(sigma0, majority);
+                h = g;
+                g = f;
+                f = e;
+                e = _mm256_add_epi32(d, t1);
+                d = c;
+                c = b;
+                b = a;
+                a = _mm256_add_epi32(t1, t2);
+            }
+            state[0] = _mm256_add_epi32(state[0], a);
+            state[1] = _mm256_add_epi32(state[1], b);
+            state[2] = _mm256_add_epi32(state[2], c);
+            state[3] = _mm256_add_epi32(state[3], d);
+            state[4] = _mm256_add_epi32(state[4], e);
+            state[5] = _mm256_add_epi32(state[5], f);
+            state[6] = _mm256_add_epi32(state[6], g);
+            state[7] = _mm256_add_epi32(state[7], h);
+        }
+
+        // Hashes up to eight messages in the lanes of AVX2 registers; lanes past the end of their message
+        // (or without one) hash a block of zeros whose result is discarded
+        __attribute__((target("avx2")))
+        void avx2Group(const Blocks* const messages[LANES], Digest* const digests[LANES]) {
+            alignas(32) static constexpr uint8_t idle[BLOCK] = {};
+            __m256i state[8];
+            for (int i = 0; i < 8; ++i) {
+                state[i] = _mm256_set1_epi32(static_cast<int>(INITIAL_STATE[i]));
+            }
+            std::size_t blocks = 0;
+            for (std::size_t lane = 0; lane < LANES; ++lane) {
+                if (messages[lane] != nullptr) {
+                    blocks = std::max(blocks, messages[lane]->count());
+                }
+            }
+
+            const uint8_t* current[LANES];
+            for (std::size_t i = 0; i < blocks; ++i) {
+                for (std::size_t lane = 0; lane < LANES; ++lane) {
+                    current[lane] = messages[lane] != nullptr && i < messages[lane]->count() ? messages[lane]->block(i) : idle;
+                }
+                compressAvx2(state, current);
+
+                for (std::size_t lane = 0; lane < LANES; ++lane) {
+                    if (messages[lane] != nullptr && messages[lane]->count() == i + 1) {
+                        alignas(32) uint32_t words[8][LANES];
+                        for (int word = 0; word < 8; ++word) {
+                            _mm256_store_si256(reinterpret_cast<__m256i*>(words[word]), state[word]);
+                        }
+                        uint32_t laneState[8];
+                        for (int word = 0; word < 8; ++word) {
+                            laneState[word] = words[word][lane];
+                        }
+                        *digests[lane] = toDigest(laneState);
+                    }
+                }
+            }
+        }
+
+        void avx2(std::span<const std::span<const uint8_t>> messages, std::vector<Digest>& digests) {
+            // Messages are grouped by length, so that the lanes of a group finish together
+            std::vector<std::size_t> order(messages.size());
+            std::iota(order.begin(), order.end(), std::size_t{0});
+            std::ranges::stable_sort(order, std::ranges::greater{}, [&](std::size_t i) { return messages[i].size(); });
+
+            std::vector<Blocks> blocks(LANES);
+            for (std::size_t first = 0; first < order.size(); first += LANES) {
+                const Blocks* group[LANES] = {};
+                Digest* results[LANES] = {};
+                for (std::size_t lane = 0; lane < LANES && first + lane < order.size(); ++lane) {
+                    blocks[lane] = Blocks(messages[order[first + lane]]);
+                    group[lane] = &blocks[lane];
+                    results[lane] = &digests[order[first + lane]];
+                }
+                avx2Group(group, results);
+            }
+        }
+#endif
+
+        void requireSupported(Backend backend) {
+            if (!supported(backend)) {
+                throw std::invalid_argument("The SHA-256 backend '" + std::string(name(backend)) + "' is not supported by this CPU.");
+            }
+        }
+
+        // The bytes of a table's data as opatio hashes them (little-endian), swapped into `swapped` if need be
+        std::span<const uint8_t> dataBytes(const OPATTable& table, std::vector<double>& swapped) {
+            const std::size_t count = static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize;
+            const double* data = table.data.get();
+            if (is_big_endian()) {
+                swapped.resize(count);
+                std::transform(data, data + count, swapped.begin(), [](double value) { return swap_bytes(value); });
+                data = swapped.data();
+            }
+            return {reinterpret_cast<const uint8_t*>(data), count * sizeof(double)};
+        }
+
+        // The tables of a card in the order they are stored
+        std::vector<const OPATTable*> storedTables(const DataCard& card) {
+            std::vector<std::pair<uint64_t, std::string>> entries;
+            entries.reserve(card.tableIndex.tableIndex.size());
+            for (const auto& [tag, entry] : card.tableIndex.tableIndex) {
+                entries.emplace_back(entry.byteStart, tag);
+            }
+            std::ranges::sort(entries);
+            std::vector<const OPATTable*> tables;
+            tables.reserve(entries.size());
+            for (const auto& tag : entries | std::views::values) {
+                tables.push_back(&card.get(tag));
+            }
+            return tables;
+        }
+
+        // Digests of `cards`, with the tables of all of them hashed in one call
+        std::vector<Digest> cardDigests(std::span<const DataCard* const> cards, Backend backend) {
+            std::vector<std::vector<const OPATTable*>> tables;
+            std::size_t count = 0;
+            for (const DataCard* card : cards) {
+                tables.push_back(storedTables(*card));
+                count += tables.back().size();
+            }
+            std::vector<std::vector<double>> swapped(count);
+            std::vector<std::span<const uint8_t>> messages;
+            messages.reserve(count);
+            for (const auto& cardTables : tables) {
+                for (const OPATTable* table : cardTables) {
+                    messages.push_back(dataBytes(*table, swapped[messages.size()]));
+                }
+            }
+            const std::vector<Digest> tableDigests = hashMany(messages, backend);
+
+            std::vector<std::vector<uint8_t>> concatenated;
+            concatenated.reserve(cards.size());
+            std::size_t next = 0;
+            for (const auto& cardTables : tables) {
+                std::vector<uint8_t>& bytes = concatenated.emplace_back();
+                bytes.reserve(cardTables.size() * sizeof(Digest));
+                for (std::size_t i = 0; i < cardTables.size(); ++i, ++next) {
+                    bytes.insert(bytes.end(), tableDigests[next].begin(), tableDigests[next].end());
+                }
+            }
+            std::vector<std::span<const uint8_t>> cardMessages(concatenated.begin(), concatenated.end());
+            return hashMany(cardMessages, backend);
+        }
+    }
+
+    bool supported(Backend backend) {
+        switch (backend) {
+            case Backend::Portable:
+                return true;
+#ifdef OPAT_SHA256_X86
+            case Backend::ShaNi:
+                return features().shaNi;
+            case Backend::Avx2:
+                return features().avx2;
+#endif
+            default:
+                return false;
+        }
+    }
+
+    Backend fastest() {
+        if (supported(Backend::ShaNi)) {
+            return Backend::ShaNi;
+        }
+        if (supported(Backend::Avx2)) {
+            return Backend::Avx2;
+        }
+        return Backend::Portable;
+    }
+
+    std::string_view name(Backend backend) {
+        switch (backend) {
+            case Backend::ShaNi:
+                return "sha-ni";
+            case Backend::Avx2:
+                return "avx2";
+            default:
+                return "portable";
+        }
+    }
+
+    Digest hash(const void* data, std::size_t size, Backend backend) {
+        const std::span<const uint8_t> message(static_cast<const uint8_t*>(data), size);
+        return hashMany(std::span(&message, 1), backend).front();
+    }
+
+    std::vector<Digest> hashMany(std::span<const std::span<const uint8_t>> messages, Backend backend) {
+        requireSupported(backend);
+        std::vector<Digest> digests(messages.size());
+#ifdef OPAT_SHA256_X86
+        if (backend == Backend::ShaNi) {
+            std::ranges::transform(messages, digests.begin(), shaNi);
+            return digests;
+        }
+        if (backend == Backend::Avx2) {
+            avx2(messages, digests);
+            return digests;
+        }
+#endif
+        std::ranges::transform(messages, digests.begin(), portable);
+        return digests;
+    }
+
+    Digest cardDigest(const DataCard& card, Backend backend) {
+        const DataCard* cards[] = {&card};
+        return cardDigests(cards, backend).front();
+    }
+
+    std::vector<FloatIndexVector> verify(const OPAT& opat, Backend backend, unsigned threads) {
+        requireSupported(backend);
+        std::vector<const CardCatalogEntry*> entries;
+        for (const CardCatalogEntry& entry : opat.cardCatalog.tableIndex | std::views::values) {
+            if (std::ranges::any_of(entry.sha256, [](char byte) { return byte != 0; })) {
+                entries.push_back(&entry);
+            }
+        }
+        std::ranges::sort(entries, {}, &CardCatalogEntry::byteStart);
+        std::vector<char> mismatched(entries.size(), 0);
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr failure;
+        std::mutex failureMutex;
+
+        // Cards are taken in batches as large as the AVX2 backend is wide, so its lanes stay full
+        const auto check = [&] {
+            for (std::size_t first = next.fetch_add(LANES); first < entries.size(); first = next.fetch_add(LANES)) {
+                try {
+                    const std::size_t last = std::min(first + LANES, entries.size());
+                    std::vector<std::shared_ptr<const DataCard>> held;
+                    std::vector<const DataCard*> cards;
+                    for (std::size_t i = first; i < last; ++i) {
+                        held.push_back(opat.acquire(entries[i]->index));
+                        cards.push_back(held.back().get());
+                    }
+                    const std::vector<Digest> digests = cardDigests(cards, backend);
+                    for (std::size_t i = first; i < last; ++i) {
+                        mismatched[i] = std::memcmp(digests[i - first].data(), entries[i]->sha256, sizeof(Digest)) != 0;
+                    }
+                } catch (...) {
+                    const std::lock_guard lock(failureMutex);
+                    if (!failure) {
+                        failure = std::current_exception();
+                    }
+                    next = entries.size();
+                }
+            }
+        };
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::vector<std::thread> workers;
+        const std::size_t count = std::min<std::size_t>(threads, (entries.size() + LANES - 1) / LANES);
+        workers.reserve(count);
+        for (std::size_t i = 1; i < count; ++i) {
+            workers.emplace_back(check);
+        }
+        check();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+
+        std::vector<FloatIndexVector> result;
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (mismatched[i]) {
+                result.push_back(entries[i]->index);
+            }
+        }
+        return result;
+    }
+
+}
@@ -0,0 +1,72 @@
+#include "tableExpression.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace opat::expr {
+
+    namespace {
+        // Chunks handed to threads are whole cache lines of doubles, so threads never write the same line
+        constexpr std::size_t CHUNK_ALIGNMENT = 8;
+
+        bool sameValues(const double* a, const double* b, uint32_t count) {
+            return a == b || std::equal(a, a + count, b);
+        }
+    }
+
+    void checkShapes(const std::vector<const OPATTable*>& tables) {
+        if (tables.empty()) {
+            throw std::invalid_argument("An expression must contain at least one table.");
+        }
+        const OPATTable& first = *tables.front();
+        for (const OPATTable* table : tables) {
+            if (table->N_R != first.N_R || table->N_C != first.N_C || table->m_vsize != first.m_vsize) {
+                throw std::invalid_argument("Tables of shape " + std::to_string(table->N_R) + " x " + std::to_string(table->N_C) + " x " +
+                                            std::to_string(table->m_vsize) + " and " + std::to_string(first.N_R) + " x " +
+                                            std::to_string(first.N_C) + " x " + std::to_string(first.m_vsize) + " cannot be combined.");
+            }
+            if (!sameValues(table->rowValues.get(), first.rowValues.get(), first.N_R) ||
+                !sameValues(table->columnValues.get(), first.columnValues.get(), first.N_C)) {
+                throw std::invalid_argument("Tables with different row or column values cannot be combined.");
+            }
+        }
+    }
+
+    OPATTable allocateLike(const OPATTable& like) {
+        OPATTable table;
+        table.N_R = like.N_R;
+        table.N_C = like.N_C;
+        table.m_vsize = like.m_vsize;
+        table.rowValues = std::make_unique<double[]>(like.N_R);
+        table.columnValues = std::make_unique<double[]>(like.N_C);
+        table.data = std::make_unique_for_overwrite<double[]>(static_cast<std::size_t>(like.N_R) * like.N_C * like.m_vsize);
+        std::copy_n(like.rowValues.get(), like.N_R, table.rowValues.get());
+        std::copy_n(like.columnValues.get(), like.N_C, table.columnValues.get());
+        return table;
+    }
+
+    void parallelFor(std::size_t count, unsigned threads, const std::function<void(std::size_t, std::size_t)>& chunk) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        const std::size_t lines = (count + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT;
+        const std::size_t workers = std::min<std::size_t>(threads, lines);
+        if (workers <= 1) {
+            chunk(0, count);
+            return;
+        }
+        const std::size_t perWorker = (lines + workers - 1) / workers * CHUNK_ALIGNMENT;
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (std::size_t begin = perWorker; begin < count; begin += perWorker) {
+            pool.emplace_back(chunk, begin, std::min(begin + perWorker, count));
+        }
+        chunk(0, std::min(perWorker, count));
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+}
@@ -1,6 +1,7 @@
 #include <cmath>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <utility>
@@ -12,10 +13,18 @@
 #include <boost/numeric/ublas/vector.hpp>
 
 #include "tableLattice.h"
+#include "queryTrace.h"
+#include "lazyCardStore.h"
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <numeric>
 #include <ranges>
+#include <span>
+#include <sstream>
 #include <stdexcept>
 
 #include "libqhullcpp/QhullFacetList.h"
@@ -28,16 +37,22 @@
 namespace opat::lattice {
     TableLattice::TableLattice(const opat::OPAT &opat) : m_opat(opat){
         initialize();
+        checkCompatibility();
         buildDelaunay();
+        reserveMemory();
+        m_pyramids = std::make_shared<lod::Pyramids>(m_opat);
     }
 
     TableLattice::TableLattice(const opat::OPAT &opat, const InterpolationType &interpolationType) : m_opat(opat) {
         m_interpolationType = interpolationType;
-        if (m_interpolationType != InterpolationType::Linear) {
-            throw std::runtime_error("Only Linear interpolation is currently implemented.");
+        if (m_interpolationType != InterpolationType::Linear && m_interpolationType != InterpolationType::Nearest) {
+            throw std::runtime_error("Only Linear and Nearest interpolation are currently implemented.");
         }
         initialize();
+        checkCompatibility();
         buildDelaunay();
+        reserveMemory();
+        m_pyramids = std::make_shared<lod::Pyramids>(m_opat);
     }
 
     void TableLattice::initialize() {
@@ -51,6 +66,12 @@ namespace opat::lattice {
             m_indexVectors.push_back(iv);
         }
 
+        m_vertexPositions.clear();
+        m_vertexPositions.reserve(m_indexVectors.size());
+        for (std::size_t position = 0; position < m_indexVectors.size(); ++position) {
+            m_vertexPositions.emplace(m_indexVectors[position], position);
+        }
+
     }
 
     void TableLattice::buildDelaunay() {
@@ -149,6 +170,94 @@ namespace opat::lattice {
         }
     }
 
+    struct TableLattice::Compatibility {
+        // A table as every card must have it
+        struct Shape {
+            uint64_t vsize;
+            std::vector<double> rows;
+            std::vector<double> columns;
+        };
+
+        std::mutex mutex;
+        std::optional<FloatIndexVector> reference; ///< The first card checked, which the others are compared with.
+        std::unordered_map<std::string, Shape> shapes;
+        std::unique_ptr<std::atomic<bool>[]> checked;
+    };
+
+    void TableLattice::checkCompatibility() {
+        m_compatibility = std::make_shared<Compatibility>();
+        m_compatibility->checked = std::make_unique<std::atomic<bool>[]>(m_indexVectors.size());
+        if (m_opat.lazyCards) {
+            return;
+        }
+        for (std::size_t vertex = 0; vertex < m_indexVectors.size(); ++vertex) {
+            checkCard(vertex, *m_opat.acquire(m_indexVectors[vertex]));
+        }
+    }
+
+    void TableLattice::checkCard(std::size_t vertex, const DataCard &card) const {
+        Compatibility &compatibility = *m_compatibility;
+        if (compatibility.checked[vertex].load(std::memory_order_acquire)) {
+            return;
+        }
+        const std::lock_guard lock(compatibility.mutex);
+        const std::vector<std::string> keys = card.getKeys();
+        if (!compatibility.reference) {
+            compatibility.reference = m_indexVectors[vertex];
+            for (const std::string &key : keys) {
+                const OPATTable &table = card[key];
+                compatibility.shapes.emplace(key, Compatibility::Shape{table.m_vsize,
+                    std::vector<double>(table.rowValues.get(), table.rowValues.get() + table.N_R),
+                    std::vector<double>(table.columnValues.get(), table.columnValues.get() + table.N_C)});
+            }
+            compatibility.checked[vertex].store(true, std::memory_order_release);
+            return;
+        }
+
+        const auto incompatible = [&](const std::string &what) {
+            std::ostringstream message;
+            message << "TableLattice: card " << m_indexVectors[vertex] << " " << what << " than card " << *compatibility.reference
+                    << ", so their tables cannot be blended. Resample them onto common axes first (see regrid.h).";
+            return std::invalid_argument(message.str());
+        };
+        if (keys.size() != compatibility.shapes.size()) {
+            throw incompatible("has other tags");
+        }
+        for (const std::string &key : keys) {
+            const auto shape = compatibility.shapes.find(key);
+            if (shape == compatibility.shapes.end()) {
+                throw incompatible("has other tags");
+            }
+            const OPATTable &table = card[key];
+            if (table.m_vsize != shape->second.vsize ||
+                !std::ranges::equal(std::span(table.rowValues.get(), table.N_R), shape->second.rows) ||
+                !std::ranges::equal(std::span(table.columnValues.get(), table.N_C), shape->second.columns)) {
+                throw incompatible("has a table '" + key + "' of another shape or with other axes");
+            }
+        }
+        compatibility.checked[vertex].store(true, std::memory_order_release);
+    }
+
+    void TableLattice::reserveMemory() {
+        std::size_t bytes = m_indexVectors.capacity() * sizeof(FloatIndexVector);
+        for (const auto &iv : m_indexVectors) {
+            bytes += iv.size() * (sizeof(double) + sizeof(uint64_t));
+        }
+        for (const auto &simplex : m_simplices) {
+            bytes += sizeof(simplex) + simplex.capacity() * sizeof(std::size_t);
+        }
+        for (const auto &neighbors : m_simplexAdjacency) {
+            bytes += sizeof(neighbors) + neighbors.capacity() * sizeof(std::size_t);
+        }
+        // Vertex lookup: each node holds a key, its position and a next pointer, plus one bucket pointer per bucket
+        for (const auto &iv : m_vertexPositions | std::views::keys) {
+            bytes += sizeof(FloatIndexVector) + sizeof(std::size_t) + sizeof(void*) + iv.size() * (sizeof(double) + sizeof(uint64_t));
+        }
+        bytes += m_vertexPositions.bucket_count() * sizeof(void*);
+        const std::string name = m_opat.filename.empty() ? "<in-memory OPAT>" : m_opat.filename;
+        m_reservation = std::make_shared<memory::Reservation>(memory::MemoryManager::global(), name, bytes);
+    }
+
     Simplex TableLattice::findContainingSimplex(const FloatIndexVector &queryPoint) const {
         validateIndexVector(queryPoint);
 
@@ -424,14 +533,77 @@ namespace opat::lattice {
 
 
     DataCard TableLattice::get(const FloatIndexVector &indexVector) const {
+        return get(indexVector, 0);
+    }
+
+    DataCard TableLattice::get(const FloatIndexVector &indexVector, std::size_t level) const {
+        if (m_opat.recorder) {
+            m_opat.recorder->record(trace::QueryKind::Lattice, indexVector);
+        }
+        validateIndexVector(indexVector);
+        const auto [simplex, weights] = locate(indexVector);
+        return blend(simplex, weights, level);
+    }
+
+    std::shared_ptr<const DataCard> TableLattice::view(const FloatIndexVector &indexVector) const {
+        if (m_opat.recorder) {
+            m_opat.recorder->record(trace::QueryKind::Lattice, indexVector);
+        }
         validateIndexVector(indexVector);
+        const auto [simplex, weights] = locate(indexVector);
+        if (simplex.size() == 1) {
+            return m_opat.acquire(m_indexVectors[simplex.front()]);
+        }
+        return std::make_shared<const DataCard>(blend(simplex, weights, 0));
+    }
 
+    std::optional<std::size_t> TableLattice::findVertex(const FloatIndexVector &indexVector) const {
+        const auto lookup = [this](const FloatIndexVector &key) -> std::optional<std::size_t> {
+            const auto it = m_vertexPositions.find(key);
+            return it == m_vertexPositions.end() ? std::nullopt : std::optional(it->second);
+        };
+        // Catalog points are hashed at the file's precision, so queries made at another precision are requantized
+        if (indexVector.getHashPrecision() == m_opat.header.hashPrecision) {
+            return lookup(indexVector);
+        }
+        return lookup(FloatIndexVector(indexVector.getVector(), m_opat.header.hashPrecision));
+    }
+
+    std::pair<std::vector<std::size_t>, std::vector<double>> TableLattice::locate(const FloatIndexVector &indexVector) const {
+        if (const auto vertex = findVertex(indexVector)) {
+            return {{*vertex}, {1.0}};
+        }
         auto [ID, barycentricWeights] = findContainingSimplex(indexVector);
-        auto const &simplex = m_simplices[ID];
-        auto const &weights = barycentricWeights;
+        if (m_interpolationType == InterpolationType::Nearest) {
+            const auto nearest = std::ranges::max_element(barycentricWeights) - barycentricWeights.begin();
+            return {{m_simplices[ID][nearest]}, {1.0}};
+        }
+        return {m_simplices[ID], std::move(barycentricWeights)};
+    }
 
-        FloatIndexVector iv0 = m_indexVectors[simplex[0]];
-        const DataCard &baseDataCard = m_opat[iv0];
+    DataCard TableLattice::blend(const std::vector<std::size_t> &simplex, const std::vector<double> &weights, std::size_t level) const {
+        // Corner cards are acquired rather than fetched with get, so that they are not recorded as separate
+        // card queries and lazily loaded corners stay evictable once the blend is done. Coarse levels come
+        // from the pyramids, which read a corner's tables only to build its pyramid, so only the base card
+        // (for the header and index) is needed
+        if (level == 0) {
+            prefetchSimplex(simplex, true);
+        }
+        std::vector<std::shared_ptr<const DataCard>> cornerCards;
+        cornerCards.reserve(simplex.size());
+        for (const std::size_t vertex : simplex) {
+            cornerCards.push_back(m_opat.acquire(m_indexVectors[vertex]));
+            if (level > 0) {
+                break;
+            }
+        }
+        if (level == 0 && simplex.size() > 1) {
+            for (std::size_t corner = 0; corner < simplex.size(); ++corner) {
+                checkCard(simplex[corner], *cornerCards[corner]);
+            }
+        }
+        const DataCard &baseDataCard = *cornerCards[0];
+        const int node = m_replicas ? numa::currentNode() : 0;
 
         DataCard resultDataCard;
 
@@ -440,45 +612,190 @@ namespace opat::lattice {
 
         std::unordered_map<std::string, OPATTable> resultTables;
         for (const auto& key : baseDataCard.getKeys()) {
-            const OPATTable &baseTable = baseDataCard[key];
+            OPATTable resultTable = blendTable(simplex, weights, cornerCards, key, level, node);
+            if (auto entry = resultDataCard.tableIndex.tableIndex.find(key); entry != resultDataCard.tableIndex.tableIndex.end()) {
+                entry->second.numRows = static_cast<uint16_t>(resultTable.N_R);
+                entry->second.numColumns = static_cast<uint16_t>(resultTable.N_C);
+            }
+            resultTables.emplace(key, std::move(resultTable));
+        }
+        resultDataCard.tableData = std::move(resultTables);
+        return resultDataCard;
+    }
 
-            OPATTable resultTable;
-            resultTable.N_R = baseTable.N_R;
-            resultTable.N_C = baseTable.N_C;
-            resultTable.m_vsize = baseTable.m_vsize;
-            uint64_t total = resultTable.N_R * resultTable.N_C * resultTable.m_vsize;
+    OPATTable TableLattice::blendTable(const std::vector<std::size_t> &simplex, const std::vector<double> &weights,
+                                       const std::vector<std::shared_ptr<const DataCard>> &cornerCards, const std::string &key,
+                                       std::size_t level, int node) const {
+        const std::shared_ptr<const OPATTable> coarseBase = level == 0 ? nullptr : m_pyramids->table(m_indexVectors[simplex[0]], key, level);
+        const OPATTable &baseTable = coarseBase ? *coarseBase : (*cornerCards[0])[key];
+
+        OPATTable resultTable;
+        resultTable.N_R = baseTable.N_R;
+        resultTable.N_C = baseTable.N_C;
+        resultTable.m_vsize = baseTable.m_vsize;
+        uint64_t total = resultTable.N_R * resultTable.N_C * resultTable.m_vsize;
+
+        resultTable.rowValues = std::make_unique<double[]>(resultTable.N_R);
+        resultTable.columnValues = std::make_unique<double[]>(resultTable.N_C);
+        std::copy_n(baseTable.rowValues.get(), resultTable.N_R, resultTable.rowValues.get());
+        std::copy_n(baseTable.columnValues.get(), resultTable.N_C, resultTable.columnValues.get());
+
+        resultTable.data = std::make_unique<double[]>(total);
+        if (simplex.size() > 1) {
+            std::fill_n(resultTable.data.get(), total, 0.0);
+        }
 
-            resultTable.rowValues = std::make_unique<double[]>(resultTable.N_R);
-            resultTable.columnValues = std::make_unique<double[]>(resultTable.N_C);
-            std::copy_n(baseTable.rowValues.get(), resultTable.N_R, resultTable.rowValues.get());
-            std::copy_n(baseTable.columnValues.get(), resultTable.N_C, resultTable.columnValues.get());
+        for (std::size_t corner  = 0; corner < simplex.size(); ++corner) {
+            const OPATTable *replica = m_replicas && level == 0 ? m_replicas->local(m_indexVectors[simplex[corner]], key, node) : nullptr;
+            const std::shared_ptr<const OPATTable> coarse = level == 0 ? nullptr : m_pyramids->table(m_indexVectors[simplex[corner]], key, level);
+            const OPATTable &cornerTable = coarse ? *coarse : replica ? *replica : (*cornerCards[corner])[key];
+            const double *cornerData = cornerTable.data.get();
+            double *resultData = resultTable.data.get();
+
+            if (simplex.size() == 1) {
+                // A catalog point (or, in Nearest mode, the nearest one) is copied rather than blended
+                std::copy_n(cornerData, total, resultData);
+                continue;
+            }
+            for (int idx = 0; idx < total; ++idx) {
+                resultData[idx] += weights[corner] * cornerData[idx];
+            }
+        }
+        return resultTable;
+    }
 
-            resultTable.data = std::make_unique<double[]>(total);
-            std::fill_n(resultTable.data.get(), total, 0.0);
+    OPATTable TableLattice::getTable(const FloatIndexVector &indexVector, const std::string &tag) const {
+        if (m_opat.recorder) {
+            m_opat.recorder->record(trace::QueryKind::Lattice, indexVector);
+        }
+        validateIndexVector(indexVector);
+        const auto [simplex, weights] = locate(indexVector);
+        prefetchSimplex(simplex, std::span(&tag, 1));
 
-            for (std::size_t corner  = 0; corner < simplex.size(); ++corner) {
-                const FloatIndexVector &iv = m_indexVectors[simplex[corner]];
-                const OPATTable &cornerTable = m_opat[iv][key];
-                const double *cornerData = cornerTable.data.get();
-                double *resultData = resultTable.data.get();
+        std::vector<std::shared_ptr<const DataCard>> cornerCards;
+        cornerCards.reserve(simplex.size());
+        for (const std::size_t vertex : simplex) {
+            cornerCards.push_back(m_opat.acquire(m_indexVectors[vertex]));
+        }
+        // Only this table of each corner is compared, rather than the whole card as checkCard does, so that
+        // the other tables of lazily loaded corners are never read
+        const OPATTable &base = (*cornerCards[0])[tag];
+        for (std::size_t corner = 1; corner < simplex.size(); ++corner) {
+            const OPATTable &table = (*cornerCards[corner])[tag];
+            if (table.N_R != base.N_R || table.N_C != base.N_C || table.m_vsize != base.m_vsize ||
+                !std::equal(base.rowValues.get(), base.rowValues.get() + base.N_R, table.rowValues.get()) ||
+                !std::equal(base.columnValues.get(), base.columnValues.get() + base.N_C, table.columnValues.get())) {
+                std::ostringstream message;
+                message << "TableLattice: table '" << tag << "' of card " << m_indexVectors[simplex[corner]] << " has other axes than that of card "
+                        << m_indexVectors[simplex[0]] << ", so they cannot be blended. Resample them onto common axes first (see regrid.h).";
+                throw std::invalid_argument(message.str());
+            }
+        }
+        return blendTable(simplex, weights, cornerCards, tag, 0, m_replicas ? numa::currentNode() : 0);
+    }
 
-                for (int idx = 0; idx < total; ++idx) {
-                    resultData[idx] += weights[corner] * cornerData[idx];
-                }
+    std::size_t TableLattice::prefetchCorners(const FloatIndexVector &indexVector) const {
+        validateIndexVector(indexVector);
+        return prefetchSimplex(locate(indexVector).first, true);
+    }
+
+    void TableLattice::prefetchCornersAsync(const FloatIndexVector &indexVector, std::function<void(std::exception_ptr)> done) const {
+        validateIndexVector(indexVector);
+        const std::vector<std::size_t> simplex = locate(indexVector).first;
+        if (!m_opat.lazyCards) {
+            done(nullptr);
+            return;
+        }
+        auto corners = std::make_shared<std::vector<FloatIndexVector>>();
+        corners->reserve(simplex.size());
+        for (const std::size_t vertex : simplex) {
+            corners->push_back(m_indexVectors[vertex]);
+        }
+        // As prefetchSimplex: the corner cards first, then every table of the base corner from every corner
+        const LazyCardStore &store = *m_opat.lazyCards;
+        store.prefetchAsync(*corners, {}, [&store, corners, done = std::move(done)](std::exception_ptr error, std::size_t) mutable {
+            if (error || !store.isLoaded(corners->front())) {
+                // An evicted base corner is left to the blend rather than read on the backend's thread
+                done(error);
+                return;
             }
-            resultTables.emplace(key, std::move(resultTable));
+            try {
+                const std::vector<std::string> keys = store.acquire(corners->front())->getKeys();
+                store.prefetchAsync(*corners, keys, [done = std::move(done)](std::exception_ptr tableError, std::size_t) {
+                    done(tableError);
+                });
+            } catch (...) {
+                done(std::current_exception());
+            }
+        });
+    }
+
+    std::vector<Corner> TableLattice::corners(const FloatIndexVector &indexVector) const {
+        validateIndexVector(indexVector);
+        const auto [simplex, weights] = locate(indexVector);
+        prefetchSimplex(simplex);
+        std::vector<Corner> result;
+        result.reserve(simplex.size());
+        for (std::size_t corner = 0; corner < simplex.size(); ++corner) {
+            const FloatIndexVector &index = m_indexVectors[simplex[corner]];
+            result.push_back({index, m_opat.acquire(index), weights[corner]});
         }
-        resultDataCard.tableData = std::move(resultTables);
-        return resultDataCard;
+        return result;
+    }
+
+    std::size_t TableLattice::prefetchSimplex(const std::vector<std::size_t> &simplex, std::span<const std::string> tags) const {
+        if (!m_opat.lazyCards) {
+            return 0;
+        }
+        std::vector<FloatIndexVector> corners;
+        corners.reserve(simplex.size());
+        for (const std::size_t vertex : simplex) {
+            corners.push_back(m_indexVectors[vertex]);
+        }
+        const std::size_t read = m_opat.lazyCards->prefetch(corners);
+        m_opat.lazyCards->prefetch(corners, tags);
+        return read;
+    }
+
+    std::size_t TableLattice::prefetchSimplex(const std::vector<std::size_t> &simplex, bool tables) const {
+        if (!m_opat.lazyCards) {
+            return 0;
+        }
+        // Read the corners which are not resident as one batch rather than one after another
+        std::vector<FloatIndexVector> corners;
+        corners.reserve(simplex.size());
+        for (const std::size_t vertex : simplex) {
+            corners.push_back(m_indexVectors[vertex]);
+        }
+        const std::size_t read = m_opat.lazyCards->prefetch(corners);
+        if (tables) {
+            // A blend reads every table of the base corner from every corner
+            if (const auto base = m_opat.lazyCards->acquire(corners.front())) {
+                m_opat.lazyCards->prefetch(corners, base->getKeys());
+            }
+        }
+        return read;
+    }
+
+    SubLattice TableLattice::restrictTo(const std::vector<std::optional<double>> &fixed) const {
+        return SubLattice(*this, fixed);
+    }
+
+    void TableLattice::setReplicas(std::shared_ptr<const numa::Replicas> replicas) {
+        m_replicas = std::move(replicas);
     }
 
     InterpolationType TableLattice::getInterpolationType() const {
         return m_interpolationType;
     }
 
+    const OPAT& TableLattice::getOPAT() const {
+        return m_opat;
+    }
+
     void TableLattice::setInterpolationType(InterpolationType interpolationType) {
-        if (interpolationType != InterpolationType::Linear) {
-            throw std::runtime_error("Only Linear interpolation is currently implemented.");
+        if (interpolationType != InterpolationType::Linear && interpolationType != InterpolationType::Nearest) {
+            throw std::runtime_error("Only Linear and Nearest interpolation are currently implemented.");
         }
         m_interpolationType = interpolationType;
     }
@@ -514,6 +831,437 @@ namespace opat::lattice {
         }
     }
 
+    namespace {
+        constexpr double BARYCENTRIC_TOLERANCE = 1e-8; // As in TableLattice::findContainingSimplex
+        constexpr double HYPERPLANE_TOLERANCE = 1e-12; // How close to a hyperplane, relative to the extent of its dimension, a vertex lies on it
+        constexpr std::size_t NO_NEIGHBOR = static_cast<std::size_t>(-1);
+
+        // Every monotone path from (0, 0) to (rows - 1, columns - 1): the staircase triangulation of the product of two simplices
+        void staircases(std::size_t rows, std::size_t columns, std::vector<std::pair<std::size_t, std::size_t>> &path,
+                        const std::function<void(const std::vector<std::pair<std::size_t, std::size_t>> &)> &emit) {
+            const auto [row, column] = path.back();
+            if (row + 1 == rows && column + 1 == columns) {
+                emit(path);
+                return;
+            }
+            if (row + 1 < rows) {
+                path.emplace_back(row + 1, column);
+                staircases(rows, columns, path, emit);
+                path.pop_back();
+            }
+            if (column + 1 < columns) {
+                path.emplace_back(row, column + 1);
+                staircases(rows, columns, path, emit);
+                path.pop_back();
+            }
+        }
+
+        // Whether the edges from the first vertex of a simplex span less than its full dimension
+        bool isDegenerate(std::vector<std::vector<double>> edges) {
+            const std::size_t n = edges.size();
+            double scale = 0.0;
+            for (const auto &edge : edges) {
+                for (const double x : edge) {
+                    scale = std::max(scale, std::abs(x));
+                }
+            }
+            for (std::size_t column = 0; column < n; ++column) {
+                std::size_t pivot = column;
+                for (std::size_t row = column + 1; row < n; ++row) {
+                    if (std::abs(edges[row][column]) > std::abs(edges[pivot][column])) {
+                        pivot = row;
+                    }
+                }
+                if (std::abs(edges[pivot][column]) <= HYPERPLANE_TOLERANCE * scale) {
+                    return true;
+                }
+                std::swap(edges[pivot], edges[column]);
+                for (std::size_t row = column + 1; row < n; ++row) {
+                    const double factor = edges[row][column] / edges[column][column];
+                    for (std::size_t k = column; k < n; ++k) {
+                        edges[row][k] -= factor * edges[column][k];
+                    }
+                }
+            }
+            return false;
+        }
+
+        // The simplices of the Delaunay triangulation of `points`, as positions in it
+        std::vector<std::vector<std::size_t>> delaunay(const std::vector<std::vector<double>> &points, std::size_t dims) {
+            std::vector<double> coords;
+            coords.reserve(points.size() * dims);
+            for (const auto &point : points) {
+                coords.insert(coords.end(), point.begin(), point.end());
+            }
+            std::vector<std::vector<std::size_t>> simplices;
+            try {
+                orgQhull::Qhull qh;
+                qh.runQhull("", static_cast<int>(dims), static_cast<int>(points.size()), coords.data(), "d Qt");
+                for (const auto &facet : qh.facetList()) {
+                    if (!facet.isUpperDelaunay()) {
+                        std::vector<std::size_t> simplex;
+                        simplex.reserve(dims + 1);
+                        for (const auto &vertex : facet.vertices()) {
+                            simplex.push_back(static_cast<std::size_t>(vertex.point().id()));
+                        }
+                        simplices.push_back(std::move(simplex));
+                    }
+                }
+            }
+            catch (orgQhull::QhullError const &e) {
+                std::cerr << "QhullError: " << e.what() << std::endl;
+                throw;
+            }
+            return simplices;
+        }
+    }
+
+    SubLattice::SubLattice(const TableLattice &lattice, const std::vector<std::optional<double>> &fixed) : m_lattice(lattice), m_fixed(fixed) {
+        if (fixed.size() != lattice.m_indexVectorSize) {
+            throw std::invalid_argument("TableLattice::restrictTo: " + std::to_string(fixed.size()) + " coordinates given for a lattice of dimension " +
+                                        std::to_string(lattice.m_indexVectorSize) + ".");
+        }
+        const std::vector<Bounds> bounds = lattice.m_opat.getBounds();
+        for (std::size_t dim = 0; dim < fixed.size(); ++dim) {
+            if (!fixed[dim]) {
+                m_free.push_back(dim);
+            } else if (*fixed[dim] < bounds.at(dim).min || *fixed[dim] > bounds.at(dim).max) {
+                std::ostringstream message;
+                message << "TableLattice::restrictTo: coordinate " << dim << " fixed at " << *fixed[dim] << ", outside its bounds " << bounds.at(dim) << ".";
+                throw std::out_of_range(message.str());
+            }
+        }
+        if (m_free.empty() || m_free.size() == fixed.size()) {
+            throw std::invalid_argument("TableLattice::restrictTo: at least one coordinate must be fixed and one left free (use TableLattice::get for a single point).");
+        }
+        intersect();
+        triangulateGridLine();
+        finish();
+    }
+
+    void SubLattice::intersect() {
+        // Vertices keep every coordinate until all the hyperplanes are applied
+        m_vertices.clear();
+        m_vertices.reserve(m_lattice.m_indexVectors.size());
+        for (std::size_t vertex = 0; vertex < m_lattice.m_indexVectors.size(); ++vertex) {
+            m_vertices.push_back({m_lattice.m_indexVectors[vertex].getVector(), {{vertex, 1.0}}});
+        }
+        m_simplices = m_lattice.m_simplices;
+
+        const std::vector<Bounds> bounds = m_lattice.m_opat.getBounds();
+        for (std::size_t dim = 0; dim < m_fixed.size(); ++dim) {
+            if (!m_fixed[dim]) {
+                continue;
+            }
+            const double value = *m_fixed[dim];
+            const double tolerance = HYPERPLANE_TOLERANCE * std::max(1.0, bounds[dim].max - bounds[dim].min);
+
+            // The new vertex on the edge between two old ones, or at an old one on the hyperplane, made once for every simplex sharing it
+            std::vector<Vertex> vertices;
+            std::map<std::pair<std::size_t, std::size_t>, std::size_t> positions;
+            const auto vertexBetween = [&](std::size_t above, std::size_t below) {
+                const auto [it, inserted] = positions.try_emplace(std::minmax(above, below), vertices.size());
+                if (inserted) {
+                    Vertex vertex = m_vertices[above];
+                    if (above != below) {
+                        const Vertex &a = m_vertices[above];
+                        const Vertex &b = m_vertices[below];
+                        const double t = (value - b.coordinates[dim]) / (a.coordinates[dim] - b.coordinates[dim]);
+                        for (std::size_t i = 0; i < vertex.coordinates.size(); ++i) {
+                            vertex.coordinates[i] = b.coordinates[i] + t * (a.coordinates[i] - b.coordinates[i]);
+                        }
+                        std::map<std::size_t, double> sources;
+                        for (const auto &[source, weight] : a.sources) {
+                            sources[source] += t * weight;
+                        }
+                        for (const auto &[source, weight] : b.sources) {
+                            sources[source] += (1.0 - t) * weight;
+                        }
+                        vertex.sources.assign(sources.begin(), sources.end());
+                    }
+                    vertex.coordinates[dim] = value;
+                    vertices.push_back(std::move(vertex));
+                }
+                return it->second;
+            };
+
+            std::set<std::vector<std::size_t>> simplices;
+            for (const auto &simplex : m_simplices) {
+                std::vector<std::size_t> above, below, on;
+                for (const std::size_t vertex : simplex) {
+                    const double x = m_vertices[vertex].coordinates[dim];
+                    (x > value + tolerance ? above : x < value - tolerance ? below : on).push_back(vertex);
+                }
+                std::vector<std::size_t> base;
+                if (above.empty() || below.empty()) {
+                    // The simplex only touches the hyperplane; a facet lying in it is part of the intersection
+                    if (on.size() + 1 == simplex.size()) {
+                        for (const std::size_t vertex : on) {
+                            base.push_back(vertexBetween(vertex, vertex));
+                        }
+                        std::ranges::sort(base);
+                        simplices.insert(std::move(base));
+                    }
+                    continue;
+                }
+                // The intersection is the product of the faces above and below the hyperplane, joined with the vertices on it.
+                // Staircases over the vertices in a fixed order triangulate it consistently with the neighbouring simplices
+                std::ranges::sort(above);
+                std::ranges::sort(below);
+                for (const std::size_t vertex : on) {
+                    base.push_back(vertexBetween(vertex, vertex));
+                }
+                std::vector<std::pair<std::size_t, std::size_t>> path = {{0, 0}};
+                staircases(above.size(), below.size(), path, [&](const std::vector<std::pair<std::size_t, std::size_t>> &steps) {
+                    std::vector<std::size_t> piece = base;
+                    for (const auto &[i, j] : steps) {
+                        piece.push_back(vertexBetween(above[i], below[j]));
+                    }
+                    std::ranges::sort(piece);
+                    simplices.insert(std::move(piece));
+                });
+            }
+            m_simplices.assign(simplices.begin(), simplices.end());
+            m_vertices = std::move(vertices);
+        }
+
+        for (Vertex &vertex : m_vertices) {
+            std::vector<double> coordinates;
+            coordinates.reserve(m_free.size());
+            for (const std::size_t dim : m_free) {
+                coordinates.push_back(vertex.coordinates[dim]);
+            }
+            vertex.coordinates = std::move(coordinates);
+        }
+    }
+
+    void SubLattice::triangulateGridLine() {
+        const bool onlyCards = std::ranges::all_of(m_vertices, [](const Vertex &vertex) { return vertex.sources.size() == 1; });
+        if (m_simplices.empty() || !onlyCards) {
+            return;
+        }
+        // No simplex crosses the hyperplane, so the intersection is made of facets spanned by the cards on it;
+        // those cards are triangulated again in the lower dimension
+        m_gridLine = true;
+        if (m_free.size() == 1) {
+            std::vector<std::size_t> order(m_vertices.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::ranges::sort(order, {}, [this](std::size_t vertex) { return m_vertices[vertex].coordinates[0]; });
+            m_simplices.clear();
+            for (std::size_t i = 0; i + 1 < order.size(); ++i) {
+                m_simplices.push_back({order[i], order[i + 1]});
+            }
+            return;
+        }
+        std::vector<std::vector<double>> points;
+        points.reserve(m_vertices.size());
+        for (const Vertex &vertex : m_vertices) {
+            points.push_back(vertex.coordinates);
+        }
+        m_simplices = delaunay(points, m_free.size());
+    }
+
+    void SubLattice::finish() {
+        const std::size_t dims = m_free.size();
+        // Slivers (from intersections through a vertex, or left by Qt) hold no query which a neighbour does not
+        std::erase_if(m_simplices, [&](const std::vector<std::size_t> &simplex) {
+            if (simplex.size() != dims + 1) {
+                return true;
+            }
+            std::vector<std::vector<double>> edges(dims, std::vector<double>(dims));
+            for (std::size_t j = 0; j < dims; ++j) {
+                for (std::size_t i = 0; i < dims; ++i) {
+                    edges[i][j] = m_vertices[simplex[j + 1]].coordinates[i] - m_vertices[simplex[0]].coordinates[i];
+                }
+            }
+            return isDegenerate(std::move(edges));
+        });
+        if (m_simplices.empty()) {
+            throw std::out_of_range("TableLattice::restrictTo: the hyperplane does not cut through the interior of the triangulation.");
+        }
+
+        if (dims == 1) {
+            // Segments run upwards and in order, for binary search
+            for (auto &segment : m_simplices) {
+                if (m_vertices[segment[0]].coordinates[0] > m_vertices[segment[1]].coordinates[0]) {
+                    std::swap(segment[0], segment[1]);
+                }
+            }
+            std::ranges::sort(m_simplices, {}, [this](const std::vector<std::size_t> &segment) { return m_vertices[segment[0]].coordinates[0]; });
+        }
+
+        m_simplexAdjacency.assign(m_simplices.size(), std::vector<std::size_t>(dims + 1, NO_NEIGHBOR));
+        std::map<std::vector<std::size_t>, std::pair<std::size_t, std::size_t>> faces;
+        for (std::size_t simplex = 0; simplex < m_simplices.size(); ++simplex) {
+            for (std::size_t opposite = 0; opposite <= dims; ++opposite) {
+                std::vector<std::size_t> face;
+                face.reserve(dims);
+                for (std::size_t local = 0; local <= dims; ++local) {
+                    if (local != opposite) {
+                        face.push_back(m_simplices[simplex][local]);
+                    }
+                }
+                std::ranges::sort(face);
+                const auto [it, inserted] = faces.try_emplace(std::move(face), simplex, opposite);
+                if (!inserted) {
+                    m_simplexAdjacency[simplex][opposite] = it->second.first;
+                    m_simplexAdjacency[it->second.first][it->second.second] = simplex;
+                }
+            }
+        }
+
+        std::size_t bytes = m_vertices.capacity() * sizeof(Vertex);
+        for (const Vertex &vertex : m_vertices) {
+            bytes += vertex.coordinates.capacity() * sizeof(double) + vertex.sources.capacity() * sizeof(std::pair<std::size_t, double>);
+        }
+        for (const auto &simplex : m_simplices) {
+            bytes += sizeof(simplex) + simplex.capacity() * sizeof(std::size_t);
+        }
+        for (const auto &neighbors : m_simplexAdjacency) {
+            bytes += sizeof(neighbors) + neighbors.capacity() * sizeof(std::size_t);
+        }
+        const std::string name = m_lattice.m_opat.filename.empty() ? "<in-memory OPAT>" : m_lattice.m_opat.filename;
+        m_reservation = std::make_shared<memory::Reservation>(memory::MemoryManager::global(), name, bytes);
+    }
+
+    Simplex SubLattice::findContainingSimplex(const std::vector<double> &point) const {
+        const std::size_t dims = m_free.size();
+        if (dims == 1) {
+            const double x = point[0];
+            const auto it = std::ranges::upper_bound(m_simplices, x, {}, [this](const std::vector<std::size_t> &segment) {
+                return m_vertices[segment[0]].coordinates[0];
+            });
+            const std::size_t ID = it == m_simplices.begin() ? 0 : static_cast<std::size_t>(it - m_simplices.begin()) - 1;
+            const double low = m_vertices[m_simplices[ID][0]].coordinates[0];
+            const double high = m_vertices[m_simplices[ID][1]].coordinates[0];
+            if (x < low - BARYCENTRIC_TOLERANCE * (high - low) || x > high + BARYCENTRIC_TOLERANCE * (high - low)) {
+                throw std::out_of_range("SubLattice: " + std::to_string(x) + " is outside the sub-lattice.");
+            }
+            const double t = std::clamp((x - low) / (high - low), 0.0, 1.0);
+            return {ID, {1.0 - t, t}};
+        }
+
+        const auto weightsIn = [&](std::size_t ID) {
+            const std::vector<std::size_t> &simplex = m_simplices[ID];
+            const std::vector<double> &origin = m_vertices[simplex[0]].coordinates;
+            bmat M(dims, dims);
+            bvec b(dims);
+            for (std::size_t i = 0; i < dims; ++i) {
+                b(i) = point[i] - origin[i];
+                for (std::size_t j = 0; j < dims; ++j) {
+                    M(i, j) = m_vertices[simplex[j + 1]].coordinates[i] - origin[i];
+                }
+            }
+            const bvec solution = solveLinearSystem(M, b);
+            std::vector<double> weights(dims + 1);
+            weights[0] = 1.0;
+            for (std::size_t j = 0; j < dims; ++j) {
+                weights[j + 1] = solution(j);
+                weights[0] -= solution(j);
+            }
+            return weights;
+        };
+        const auto inside = [](const std::vector<double> &weights) {
+            return std::ranges::all_of(weights, [](double w) { return w >= -BARYCENTRIC_TOLERANCE; });
+        };
+
+        // Walk from the last simplex found towards the point, as TableLattice does
+        std::size_t current = m_lastFoundSimplex < m_simplices.size() ? m_lastFoundSimplex : 0;
+        std::vector<bool> visited(m_simplices.size());
+        while (!visited[current]) {
+            visited[current] = true;
+            std::vector<double> weights = weightsIn(current);
+            const std::size_t exit = std::ranges::min_element(weights) - weights.begin();
+            if (weights[exit] >= -BARYCENTRIC_TOLERANCE) {
+                m_lastFoundSimplex = current;
+                return {current, std::move(weights)};
+            }
+            const std::size_t next = m_simplexAdjacency[current][exit];
+            if (next == NO_NEIGHBOR) {
+                break;
+            }
+            current = next;
+        }
+        // The walk reached the boundary or went round in a circle, which rounding can cause near vertices
+        for (std::size_t ID = 0; ID < m_simplices.size(); ++ID) {
+            if (std::vector<double> weights = weightsIn(ID); inside(weights)) {
+                m_lastFoundSimplex = ID;
+                return {ID, std::move(weights)};
+            }
+        }
+        std::ostringstream message;
+        message << "SubLattice: " << FloatIndexVector(point) << " is outside the sub-lattice.";
+        throw std::out_of_range(message.str());
+    }
+
+    std::pair<std::vector<std::size_t>, std::vector<double>> SubLattice::locate(const FloatIndexVector &freeCoordinates) const {
+        if (const auto vertex = m_lattice.findVertex(embed(freeCoordinates))) {
+            return {{*vertex}, {1.0}};
+        }
+        const auto [ID, weights] = findContainingSimplex(freeCoordinates.getVector());
+        std::map<std::size_t, double> combined;
+        for (std::size_t corner = 0; corner < m_simplices[ID].size(); ++corner) {
+            for (const auto &[source, weight] : m_vertices[m_simplices[ID][corner]].sources) {
+                combined[source] += weights[corner] * weight;
+            }
+        }
+        std::erase_if(combined, [](const auto &entry) { return entry.second == 0.0; });
+        if (m_lattice.m_interpolationType == InterpolationType::Nearest || combined.size() == 1) {
+            const auto nearest = std::ranges::max_element(combined, {}, [](const auto &entry) { return entry.second; });
+            return {{nearest->first}, {1.0}};
+        }
+        std::pair<std::vector<std::size_t>, std::vector<double>> located;
+        for (const auto &[vertex, weight] : combined) {
+            located.first.push_back(vertex);
+            located.second.push_back(weight);
+        }
+        return located;
+    }
+
+    DataCard SubLattice::get(const FloatIndexVector &freeCoordinates) const {
+        return get(freeCoordinates, 0);
+    }
+
+    DataCard SubLattice::get(const FloatIndexVector &freeCoordinates, std::size_t level) const {
+        if (m_lattice.m_opat.recorder) {
+            m_lattice.m_opat.recorder->record(trace::QueryKind::Lattice, embed(freeCoordinates));
+        }
+        const auto [simplex, weights] = locate(freeCoordinates);
+        return m_lattice.blend(simplex, weights, level);
+    }
+
+    std::vector<Corner> SubLattice::corners(const FloatIndexVector &freeCoordinates) const {
+        const auto [simplex, weights] = locate(freeCoordinates);
+        m_lattice.prefetchSimplex(simplex);
+        std::vector<Corner> result;
+        result.reserve(simplex.size());
+        for (std::size_t corner = 0; corner < simplex.size(); ++corner) {
+            const FloatIndexVector &index = m_lattice.m_indexVectors[simplex[corner]];
+            result.push_back({index, m_lattice.m_opat.acquire(index), weights[corner]});
+        }
+        return result;
+    }
+
+    FloatIndexVector SubLattice::embed(const FloatIndexVector &freeCoordinates) const {
+        if (static_cast<std::size_t>(freeCoordinates.size()) != m_free.size()) {
+            throw std::invalid_argument("SubLattice: " + std::to_string(freeCoordinates.size()) + " coordinates given for a sub-lattice of dimension " +
+                                        std::to_string(m_free.size()) + ".");
+        }
+        std::vector<double> indexVector(m_fixed.size());
+        for (std::size_t dim = 0, free = 0; dim < m_fixed.size(); ++dim) {
+            indexVector[dim] = m_fixed[dim] ? *m_fixed[dim] : freeCoordinates[free++];
+        }
+        return FloatIndexVector(indexVector, freeCoordinates.getHashPrecision());
+    }
+
+    std::size_t SubLattice::dimension() const {
+        return m_free.size();
+    }
+
+    bool SubLattice::isGridLine() const {
+        return m_gridLine;
+    }
+
     bvec solveLinearSystem(bmat A, bvec b) {
         using boost::numeric::ublas::permutation_matrix;
 
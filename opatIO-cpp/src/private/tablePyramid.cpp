@@ -0,0 +1,156 @@
+#include "tablePyramid.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace opat::lod {
+
+    namespace {
+        // Positions kept when halving an axis of `count` values
+        std::vector<uint32_t> keptPositions(uint32_t count) {
+            std::vector<uint32_t> kept;
+            if (count < 3) {
+                for (uint32_t position = 0; position < count; ++position) {
+                    kept.push_back(position);
+                }
+                return kept;
+            }
+            for (uint32_t position = 0; position < count; position += 2) {
+                kept.push_back(position);
+            }
+            if (kept.back() != count - 1) {
+                kept.push_back(count - 1);
+            }
+            return kept;
+        }
+
+        std::size_t tableBytes(const OPATTable& table) {
+            return (table.N_R + table.N_C + static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize) * sizeof(double);
+        }
+    }
+
+    OPATTable downsample(const OPATTable& table) {
+        const std::vector<uint32_t> rows = keptPositions(table.N_R);
+        const std::vector<uint32_t> columns = keptPositions(table.N_C);
+
+        OPATTable coarse;
+        coarse.N_R = static_cast<uint32_t>(rows.size());
+        coarse.N_C = static_cast<uint32_t>(columns.size());
+        coarse.m_vsize = table.m_vsize;
+        coarse.rowValues = std::make_unique<double[]>(coarse.N_R);
+        coarse.columnValues = std::make_unique<double[]>(coarse.N_C);
+        coarse.data = std::make_unique<double[]>(static_cast<std::size_t>(coarse.N_R) * coarse.N_C * coarse.m_vsize);
+        for (uint32_t row = 0; row < coarse.N_R; ++row) {
+            coarse.rowValues[row] = table.rowValues[rows[row]];
+        }
+        for (uint32_t column = 0; column < coarse.N_C; ++column) {
+            coarse.columnValues[column] = table.columnValues[columns[column]];
+        }
+        for (uint32_t row = 0; row < coarse.N_R; ++row) {
+            for (uint32_t column = 0; column < coarse.N_C; ++column) {
+                std::copy_n(table.data.get() + (static_cast<std::size_t>(rows[row]) * table.N_C + columns[column]) * table.m_vsize,
+                            table.m_vsize,
+                            coarse.data.get() + (static_cast<std::size_t>(row) * coarse.N_C + column) * coarse.m_vsize);
+            }
+        }
+        return coarse;
+    }
+
+    TablePyramid::TablePyramid(const OPATTable& table, uint32_t minimumSize) {
+        if (minimumSize < 2) {
+            throw std::invalid_argument("The minimum size of a pyramid level must be at least 2.");
+        }
+        const OPATTable* finer = &table;
+        while (std::max(finer->N_R, finer->N_C) > minimumSize) {
+            OPATTable coarse = downsample(*finer);
+            if (coarse.N_R == finer->N_R && coarse.N_C == finer->N_C) {
+                break;
+            }
+            m_levels.push_back(std::move(coarse));
+            finer = &m_levels.back();
+        }
+    }
+
+    const OPATTable& TablePyramid::level(std::size_t level) const {
+        if (level == 0) {
+            throw std::out_of_range("Level 0 is the source table, which a pyramid does not hold.");
+        }
+        if (m_levels.empty()) {
+            throw std::out_of_range("The table is too small to have coarse levels.");
+        }
+        return m_levels[std::min(level, m_levels.size()) - 1];
+    }
+
+    std::size_t TablePyramid::bytes() const {
+        std::size_t bytes = 0;
+        for (const OPATTable& level : m_levels) {
+            bytes += tableBytes(level);
+        }
+        return bytes;
+    }
+
+    Pyramids::Pyramids(const OPAT& opat, uint32_t minimumSize) : m_opat(opat), m_minimumSize(minimumSize) {
+        if (minimumSize < 2) {
+            throw std::invalid_argument("The minimum size of a pyramid level must be at least 2.");
+        }
+    }
+
+    Pyramids::~Pyramids() {
+        if (m_consumer) {
+            memory::MemoryManager::global().unregisterConsumer(*m_consumer);
+        }
+    }
+
+    std::shared_ptr<const OPATTable> Pyramids::table(const FloatIndexVector& index, const std::string& tag, std::size_t level) const {
+        // The card's own table keeps the card alive for as long as it is held, and no longer
+        const auto cardTable = [&tag](std::shared_ptr<const DataCard> card) {
+            const OPATTable& table = card->get(tag);
+            return std::shared_ptr<const OPATTable>(std::move(card), &table);
+        };
+        if (level == 0) {
+            return cardTable(m_opat.acquire(index));
+        }
+        const TablePyramid* pyramid = nullptr;
+        {
+            std::lock_guard lock(m_mutex);
+            if (const auto card = m_pyramids.find(index); card != m_pyramids.end()) {
+                if (const auto found = card->second.find(tag); found != card->second.end()) {
+                    pyramid = found->second.get();
+                }
+            }
+        }
+
+        std::shared_ptr<const DataCard> card;
+        if (pyramid == nullptr) {
+            // Built outside the lock, so that reading one card does not hold up lookups of others
+            card = m_opat.acquire(index);
+            auto built = std::make_unique<const TablePyramid>(card->get(tag), m_minimumSize);
+
+            std::lock_guard lock(m_mutex);
+            auto [position, inserted] = m_pyramids[index].try_emplace(tag, std::move(built));
+            if (inserted) {
+                // Pyramids are rebuilt only by rereading their cards, so they are kept rather than evicted
+                memory::MemoryManager& manager = memory::MemoryManager::global();
+                if (!m_consumer) {
+                    // Registered on first use, so that lattices which never ask for coarse levels do not show up in reports
+                    const std::string name = m_opat.filename.empty() ? "<in-memory OPAT>" : m_opat.filename;
+                    m_consumer = manager.registerConsumer(name + " (pyramids)");
+                }
+                manager.insert(manager.allocateEntryID(), *m_consumer, position->second->bytes(), 0.0, {}, true);
+                m_bytes += position->second->bytes();
+            }
+            pyramid = position->second.get();
+        }
+        if (pyramid->depth() == 0) {
+            return cardTable(card ? std::move(card) : m_opat.acquire(index));
+        }
+        // Pyramids are never removed, so their levels need no owner
+        return {std::shared_ptr<const OPATTable>(), &pyramid->level(level)};
+    }
+
+    std::size_t Pyramids::bytes() const {
+        std::lock_guard lock(m_mutex);
+        return m_bytes;
+    }
+
+}
@@ -0,0 +1,122 @@
+#include "virtualOPAT.h"
+#include "lazyCardStore.h"
+#include "tableLattice.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace opat {
+
+    VirtualOPAT::VirtualOPAT(const std::vector<std::string>& filenames, ConflictPolicy policy)
+        : m_files(filenames), m_opat(std::make_unique<OPAT>()) {
+        if (m_files.empty()) {
+            throw std::invalid_argument("VirtualOPAT requires at least one file.");
+        }
+
+        auto store = std::make_shared<LazyCardStore>();
+        // Merged catalog entries along with the source they should be read from
+        std::unordered_map<FloatIndexVector, std::pair<CardCatalogEntry, std::size_t>> merged;
+
+        for (const std::string& filename : m_files) {
+            if (!hasMagic(filename)) {
+                throw std::runtime_error("File is not a valid OPAT file: " + filename);
+            }
+            std::ifstream file(filename, std::ios::binary);
+            if (!file.is_open()) {
+                throw std::runtime_error("Could not open file: " + filename);
+            }
+            const Header header = readHeader(file);
+
+            if (store->numSources() == 0) {
+                m_opat->header = header;
+            } else if (header.numIndex != m_opat->header.numIndex) {
+                throw std::invalid_argument("Cannot merge " + filename + ": it has " + std::to_string(header.numIndex) +
+                    " index dimensions but " + m_files.front() + " has " + std::to_string(m_opat->header.numIndex) + ".");
+            } else if (header.hashPrecision != m_opat->header.hashPrecision) {
+                throw std::invalid_argument("Cannot merge " + filename + ": its hash precision (" + std::to_string(header.hashPrecision) +
+                    ") differs from that of " + m_files.front() + " (" + std::to_string(m_opat->header.hashPrecision) + ").");
+            }
+
+            const std::size_t source = store->addSource(filename);
+            const CardCatalog catalog = readCardCatalog(file, header);
+            for (const auto& [index, entry] : catalog.tableIndex) {
+                auto [it, inserted] = merged.try_emplace(index, entry, source);
+                if (inserted) {
+                    continue;
+                }
+                switch (policy) {
+                    case ConflictPolicy::Error: {
+                        std::ostringstream oss;
+                        oss << "Index " << index << " appears in both " << m_files[it->second.second] << " and " << filename << ".";
+                        throw std::invalid_argument(oss.str());
+                    }
+                    case ConflictPolicy::KeepFirst:
+                        break;
+                    case ConflictPolicy::KeepLast:
+                        it->second = {entry, source};
+                        break;
+                }
+            }
+        }
+
+        m_opat->cardCatalog.tableIndex.reserve(merged.size());
+        for (const auto& [index, value] : merged) {
+            const auto& [entry, source] = value;
+            store->addCard(entry, source);
+            m_opat->cardCatalog.tableIndex.emplace(index, entry);
+        }
+
+        // The byte offsets in the merged catalog are relative to each card's own file, so the merged
+        // header does not describe a real file layout
+        m_opat->header.numTables = static_cast<uint32_t>(merged.size());
+        m_opat->header.indexOffset = 0;
+        const std::string comment = "Virtual OPAT over " + std::to_string(m_files.size()) + " file(s)";
+        std::memset(m_opat->header.comment, 0, sizeof(m_opat->header.comment));
+        std::memcpy(m_opat->header.comment, comment.data(), std::min(comment.size(), sizeof(m_opat->header.comment) - 1));
+
+        // Cards are reported under their own files; the name is only used for the lattice's triangulation
+        m_opat->filename = comment;
+        m_opat->lazyCards = std::move(store);
+    }
+
+    VirtualOPAT VirtualOPAT::fromDirectory(const std::string& directory, ConflictPolicy policy) {
+        if (!std::filesystem::is_directory(directory)) {
+            throw std::invalid_argument(directory + " is not a directory.");
+        }
+        std::vector<std::string> filenames;
+        for (const auto& dirEntry : std::filesystem::directory_iterator(directory)) {
+            if (dirEntry.is_regular_file() && dirEntry.path().extension() == ".opat") {
+                filenames.push_back(dirEntry.path().string());
+            }
+        }
+        if (filenames.empty()) {
+            throw std::invalid_argument("No .opat files found in " + directory);
+        }
+        std::ranges::sort(filenames);
+        return VirtualOPAT(filenames, policy);
+    }
+
+    VirtualOPAT::~VirtualOPAT() = default;
+
+    const lattice::TableLattice& VirtualOPAT::lattice() const {
+        std::call_once(m_latticeOnce, [this] {
+            m_lattice = std::make_unique<lattice::TableLattice>(*m_opat);
+        });
+        return *m_lattice;
+    }
+
+    DataCard VirtualOPAT::interpolate(const FloatIndexVector& index) const {
+        return lattice().get(index);
+    }
+
+    const std::string& VirtualOPAT::sourceFile(const FloatIndexVector& index) const {
+        return m_opat->lazyCards->sourceFile(index);
+    }
+
+}
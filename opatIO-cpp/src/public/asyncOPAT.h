@@ -0,0 +1,292 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+
+namespace opat::lattice {
+    class TableLattice;
+}
+
+/**
+ * @brief Namespace for C++20 coroutine access to cards, tables and lattice queries.
+ *
+ * Awaiting a lookup never blocks a thread on disk. Cards which are not resident are read with
+ * `LazyCardStore::prefetchAsync`, which hands the reads to the io::IOBackend and returns; once they
+ * complete, the awaiting coroutine is posted to the lookup's Executor and resumes there. Each store has
+ * one batch of reads in flight at a time, and lookups which arrive meanwhile are gathered into the next
+ * batch (and so one submission to the backend). Many lookups can therefore be in flight at once without
+ * a thread per request, or even a thread per read.
+ *
+ * Lookups which can be answered from memory (eagerly loaded cards, resident lazy cards) complete
+ * without suspending.
+ *
+ * The OPAT object (or lattice) must outlive every lookup awaiting it.
+ *
+ * **Example:**
+ * @code
+ * opat::async::Task<double> opacity(const opat::OPAT& opat, FloatIndexVector index) {
+ *     std::shared_ptr<const opat::DataCard> card = co_await opat.getAsync(index);
+ *     co_return (*card)["data"].getData(5, 35, 0);
+ * }
+ *
+ * opat::OPAT opat = opat::readOPAT("gs98hz.opat", opat::LoadMode::Lazy);
+ * double value = opat::async::syncWait(opacity(opat, FloatIndexVector({0.35, 0.004})));
+ * @endcode
+ */
+namespace opat::async {
+
+    /**
+     * @brief Runs the continuations of lookups which suspended, once their reads have completed.
+     *
+     * Implement this to resume coroutines on an existing event loop or worker pool. The reads themselves
+     * run on the io::IOBackend, so an executor's threads only ever run coroutine code.
+     */
+    class Executor {
+    public:
+        virtual ~Executor() = default;
+
+        /**
+         * @brief Schedules `work` to run soon on one of the executor's threads. Must be thread-safe.
+         */
+        virtual void post(std::function<void()> work) = 0;
+    };
+
+    /**
+     * @brief Executor which runs work on a fixed pool of threads.
+     */
+    class ThreadPoolExecutor final : public Executor {
+    public:
+        /**
+         * @param threads Number of worker threads (at least one).
+         */
+        explicit ThreadPoolExecutor(unsigned threads = std::thread::hardware_concurrency());
+
+        ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+        ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+
+        /**
+         * @brief Runs the work which has already been posted, then joins the workers.
+         */
+        ~ThreadPoolExecutor() override;
+
+        void post(std::function<void()> work) override;
+
+    private:
+        void work();
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<std::function<void()>> m_queue;
+        bool m_stopping = false;
+        std::vector<std::thread> m_workers;
+    };
+
+    /**
+     * @brief The executor used when none is given: a process-wide pool with one thread per core.
+     */
+    Executor& defaultExecutor();
+
+    /**
+     * @brief Awaitable card lookup, returned by `OPAT::getAsync`.
+     *
+     * Resumes with a handle to the card (see `OPAT::acquire`), or throws std::runtime_error if the
+     * OPAT has no card for the index or it cannot be read.
+     */
+    class CardAwaitable {
+    public:
+        CardAwaitable(const OPAT& opat, FloatIndexVector index, Executor& executor);
+
+        [[nodiscard]] bool await_ready() const;
+        void await_suspend(std::coroutine_handle<> continuation);
+        std::shared_ptr<const DataCard> await_resume();
+
+    private:
+        const OPAT& m_opat;
+        FloatIndexVector m_index;
+        Executor& m_executor;
+    };
+
+    /**
+     * @brief Awaitable table lookup, returned by `getTable`.
+     *
+     * Resumes with a handle to the table which keeps its card alive, or throws std::runtime_error if
+     * the card is missing or unreadable and std::out_of_range if the card has no such tag. Tables
+     * which are read on first access (see `readDataCardDeferred`) are read in the same batch as the card.
+     */
+    class TableAwaitable {
+    public:
+        TableAwaitable(const OPAT& opat, FloatIndexVector index, std::string tag, Executor& executor);
+
+        [[nodiscard]] bool await_ready() const;
+        void await_suspend(std::coroutine_handle<> continuation);
+        std::shared_ptr<const OPATTable> await_resume();
+
+    private:
+        void fetch();
+
+        const OPAT& m_opat;
+        FloatIndexVector m_index;
+        std::string m_tag;
+        Executor& m_executor;
+        std::shared_ptr<const OPATTable> m_table;
+        std::exception_ptr m_error;
+    };
+
+    /**
+     * @brief Awaitable lattice interpolation, returned by `interpolate`.
+     *
+     * The corner cards of the query and their tables are read with `TableLattice::prefetchCornersAsync`,
+     * and the coroutine is then resumed on the executor to run the blend. Resumes with the interpolated card or throws what
+     * `TableLattice::get` throws.
+     *
+     * TableLattice is not thread-safe, so a lattice must not be used by other queries while one of its
+     * interpolations is outstanding.
+     */
+    class LatticeAwaitable {
+    public:
+        LatticeAwaitable(const lattice::TableLattice& lattice, FloatIndexVector index, Executor& executor);
+
+        [[nodiscard]] bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> continuation);
+        DataCard await_resume();
+
+    private:
+        const lattice::TableLattice& m_lattice;
+        FloatIndexVector m_index;
+        Executor& m_executor;
+    };
+
+    /**
+     * @brief Looks up the table `tag` of the card at `index` without blocking the awaiting thread.
+     */
+    [[nodiscard]] TableAwaitable getTable(const OPAT& opat, const FloatIndexVector& index, const std::string& tag,
+                                          Executor& executor = defaultExecutor());
+
+    /**
+     * @brief Interpolates at `index` without blocking the awaiting thread on disk.
+     */
+    [[nodiscard]] LatticeAwaitable interpolate(const lattice::TableLattice& lattice, const FloatIndexVector& index,
+                                               Executor& executor = defaultExecutor());
+
+    /**
+     * @brief Minimal lazily started coroutine type for code which awaits OPAT lookups.
+     *
+     * A Task starts when it is awaited (or passed to `syncWait`) and resumes its awaiter when it
+     * finishes. Services with their own coroutine types can await the lookups directly instead.
+     * @tparam T The result type; must not be void.
+     */
+    template <typename T>
+    class [[nodiscard]] Task {
+    public:
+        struct promise_type {
+            std::optional<T> value;
+            std::exception_ptr error;
+            std::coroutine_handle<> continuation;
+
+            Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> finished) noexcept {
+                    const auto continuation = finished.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            template <typename U>
+            void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+            void unhandled_exception() { error = std::current_exception(); }
+        };
+
+        Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                if (m_handle) {
+                    m_handle.destroy();
+                }
+                m_handle = std::exchange(other.m_handle, {});
+            }
+            return *this;
+        }
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        ~Task() {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+        }
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+            m_handle.promise().continuation = awaiter;
+            return m_handle;
+        }
+        T await_resume() {
+            auto& promise = m_handle.promise();
+            if (promise.error) {
+                std::rethrow_exception(promise.error);
+            }
+            return std::move(*promise.value);
+        }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    namespace detail {
+        // Coroutine which starts immediately and frees itself when it finishes
+        struct Detached {
+            struct promise_type {
+                Detached get_return_object() noexcept { return {}; }
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() noexcept {}
+                void unhandled_exception() noexcept { std::terminate(); }
+            };
+        };
+
+        template <typename T>
+        Detached runInto(Task<T>& task, std::promise<T>& result) {
+            try {
+                result.set_value(co_await task);
+            } catch (...) {
+                result.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    /**
+     * @brief Runs `task` to completion, blocking the calling thread, and returns its result.
+     *
+     * For use at the boundary between synchronous and coroutine code (`main`, tests). Must not be
+     * called from an executor thread which the task needs in order to make progress.
+     * @throws Whatever the task throws.
+     */
+    template <typename T>
+    T syncWait(Task<T> task) {
+        std::promise<T> result;
+        std::future<T> future = result.get_future();
+        detail::runInto(task, result);
+        return future.get();
+    }
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+
+/**
+ * @brief Namespace for comparing OPAT files, such as two releases of a table library.
+ *
+ * `compare` streams both files card by card: only the header and card catalog of each are read up front,
+ * then threads take the cards of the first file in the order they are stored, read the matching card of
+ * each file, compare every table value by value with a vectorized kernel, and drop the cards again, so
+ * memory stays at a few cards per thread however large the files are. Differences are summarized per tag.
+ *
+ * **Example:**
+ * @code
+ * opat::diff::Options options;
+ * options.relative = 1e-12;
+ * const opat::diff::Report report = opat::diff::compare("gs98hz_old.opat", "gs98hz.opat", options);
+ * for (const auto& [tag, summary] : report.tags) {
+ *     std::cout << tag << ": " << summary.values.maxAbsolute << std::endl;
+ * }
+ * @endcode
+ */
+namespace opat::diff {
+
+    /**
+     * @brief How values are compared.
+     *
+     * Two values match if they are equal (including infinities of the same sign), both NaN, or
+     * `|a - b| <= absolute + relative * max(|a|, |b|)`.
+     */
+    struct Options {
+        double absolute = 0.0;      ///< Absolute tolerance.
+        double relative = 0.0;      ///< Relative tolerance, scaled by the larger magnitude of the two values.
+        bool trustChecksums = true; ///< Treat tables with equal, recorded checksums and the same shape as identical without reading them.
+        unsigned threads = 0;       ///< Number of threads to compare with; 0 uses one per hardware thread.
+    };
+
+    /**
+     * @brief Differences between two arrays of values.
+     *
+     * NaN compared with a number counts as a mismatch but not towards the maximum errors.
+     */
+    struct Differences {
+        std::size_t values = 0;        ///< Number of values compared.
+        std::size_t mismatches = 0;    ///< Number of values which do not match (including `nanMismatches`).
+        std::size_t nanMismatches = 0; ///< Number of values which are NaN in only one of the arrays.
+        double maxAbsolute = 0.0;      ///< Largest `|a - b|`.
+        double maxRelative = 0.0;      ///< Largest `|a - b| / max(|a|, |b|)`.
+
+        /**
+         * @brief Adds the differences of more values.
+         */
+        Differences& operator+=(const Differences& other);
+    };
+
+    /**
+     * @brief Where the largest absolute difference of a tag is.
+     */
+    struct Location {
+        FloatIndexVector card;  ///< Index vector of the card.
+        uint32_t row = 0;       ///< Row of the table.
+        uint32_t column = 0;    ///< Column of the table.
+        uint64_t component = 0; ///< Component of the cell value.
+    };
+
+    /**
+     * @brief The differences between the tables of one tag in every card of both files.
+     */
+    struct TagSummary {
+        std::size_t tables = 0;          ///< Number of pairs of tables compared.
+        std::size_t identical = 0;       ///< Of those, pairs found identical from their checksums alone (see `Options::trustChecksums`).
+        std::size_t shapeMismatches = 0; ///< Pairs of tables with different numbers of rows, columns or cell values, whose values are not compared.
+        std::size_t axisMismatches = 0;  ///< Pairs of tables of the same shape whose row or column values do not match.
+        Differences values;              ///< Differences of the values of the tables of the same shape.
+        Location worst;                  ///< Where `values.maxAbsolute` is, if it is not 0.
+    };
+
+    /**
+     * @brief Everything `compare` found.
+     */
+    struct Report {
+        std::vector<std::string> headerDifferences;                                 ///< Header fields which differ, as "field: first != second".
+        std::vector<FloatIndexVector> onlyInFirst;                                  ///< Cards in the catalog of the first file only.
+        std::vector<FloatIndexVector> onlyInSecond;                                 ///< Cards in the catalog of the second file only.
+        std::vector<std::pair<FloatIndexVector, std::string>> tagsOnlyInFirst;      ///< Tables of cards in both files which only the first has.
+        std::vector<std::pair<FloatIndexVector, std::string>> tagsOnlyInSecond;     ///< Tables of cards in both files which only the second has.
+        std::vector<std::pair<FloatIndexVector, std::string>> unreadableCards;      ///< Cards which could not be read from either file, with the reason.
+        std::map<std::string, TagSummary> tags;                                     ///< Differences per tag.
+        std::size_t cards = 0;                                                      ///< Number of cards compared.
+
+        /**
+         * @brief Whether the files hold the same cards and tables, with every value matching.
+         */
+        [[nodiscard]] bool equal() const;
+    };
+
+    /**
+     * @brief Compares `count` values of `a` and `b`.
+     *
+     * Runs the AVX2 kernel on CPUs which have it, and a portable one otherwise; both give the same result.
+     *
+     * **Example:**
+     * @code
+     * const opat::diff::Differences d = opat::diff::compareValues(t1.data.get(), t2.data.get(), cells, {.relative = 1e-9});
+     * @endcode
+     */
+    [[nodiscard]] Differences compareValues(const double* a, const double* b, std::size_t count, const Options& options = {});
+
+    /**
+     * @brief Compares two OPAT files, reading them card by card.
+     *
+     * Cards are matched by index vector, and their tables by tag. Headers are compared on the fields
+     * which describe the contents (version, number of cards, index size and hash precision), not on
+     * creation dates, comments or checksums.
+     * @param first Path of the first (e.g. previous) file.
+     * @param second Path of the second (e.g. regenerated) file.
+     * @param options Tolerances and number of threads.
+     * @return What differs.
+     * @throws std::runtime_error if either file's header or card catalog cannot be read.
+     */
+    [[nodiscard]] Report compare(const std::string& first, const std::string& second, const Options& options = {});
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "opatIO.h"
+
+/**
+ * @brief Namespace for OPAT files embedded in executables.
+ *
+ * `opatEmbed` (or the `opat_embed` meson generator, which runs it) turns an OPAT file into a C++ source
+ * file holding the file's tables as constant arrays of doubles, each 64-byte aligned, and its header,
+ * catalog and card indexes as a constant `Image` which refers to them. Everything is constant-initialized,
+ * so the image lives in the executable's read-only data and costs nothing at startup; `open` builds a
+ * read-only OPAT whose tables view the embedded arrays, without reading, parsing or copying any table data.
+ *
+ * **Example** (meson):
+ * @code
+ * executable('solver', ['solver.cpp', opat_embed.process('gs98hz.opat')], dependencies: opatio_dep)
+ * @endcode
+ */
+namespace opat::embed {
+
+    /**
+     * @brief An embedded table: its index entry and arrays.
+     */
+    struct Table {
+        TableIndexEntry entry;                  ///< The table's entry in its card index.
+        const double* rowValues;                ///< `entry.numRows` row values.
+        const double* columnValues;             ///< `entry.numColumns` column values.
+        const double* data;                     ///< `numRows * numColumns * size` values.
+        const TableStatistics* statistics;      ///< Stored statistics of the table, or null if the card has none.
+    };
+
+    /**
+     * @brief An embedded card: its catalog entry and header, and its tables in the order they were stored.
+     */
+    struct Card {
+        const double* index;    ///< `Header::numIndex` values of the card's index vector.
+        uint64_t byteStart;     ///< Byte start of the card in the source file.
+        uint64_t byteEnd;       ///< Byte end of the card in the source file.
+        char sha256[32];        ///< SHA-256 of the card, as in the source file's catalog.
+        CardHeader header;      ///< The card's header.
+        const Table* tables;    ///< `header.numTables` tables.
+    };
+
+    /**
+     * @brief An embedded OPAT file, as generated by `writeSource`.
+     */
+    struct Image {
+        Header header;          ///< The file header.
+        const Card* cards;      ///< `header.numTables` cards, in the order they were stored.
+        const char* name;       ///< Name of the source file.
+    };
+
+    /**
+     * @brief An OPAT opened from an embedded image, which can only be read.
+     *
+     * Its tables are the image's arrays, which live in read-only memory, so the OPAT is only handed out
+     * as `const`: code which would change it does not compile, rather than crashing when it runs.
+     */
+    class View {
+    public:
+        View(View&&) noexcept = default;
+        View& operator=(View&&) noexcept = default;
+
+        [[nodiscard]] const OPAT& operator*() const noexcept { return m_opat; }
+        [[nodiscard]] const OPAT* operator->() const noexcept { return &m_opat; }
+
+    private:
+        explicit View(OPAT opat) : m_opat(std::move(opat)) {}
+        friend View open(const Image& image);
+
+        OPAT m_opat;
+    };
+
+    /**
+     * @brief Opens an embedded OPAT file.
+     *
+     * The OPAT's header, catalog and card indexes are built from the image, and its tables borrow the
+     * embedded arrays. The result behaves as an eagerly loaded file.
+     *
+     * **Example:**
+     * @code
+     * namespace opat::embedded { extern const opat::embed::Image gs98hz; }
+     *
+     * const opat::embed::View opat = opat::embed::open(opat::embedded::gs98hz);
+     * const opat::OPATTable& table = opat->get(FloatIndexVector({0.35, 0.004}))["data"];
+     * opat::lattice::TableLattice lattice(*opat);
+     * @endcode
+     */
+    [[nodiscard]] View open(const Image& image);
+
+    /**
+     * @brief Writes C++ source defining `opat::embedded::<name>`, an `Image` of `opat`.
+     *
+     * `opat` must be loaded eagerly. This is what `opatEmbed` runs.
+     * @param opat The OPAT to embed.
+     * @param name Name of the image; must be a C++ identifier.
+     * @param source Name of the file `opat` was read from, recorded in the image.
+     * @param os Stream to write the source to.
+     * @throws std::invalid_argument if `name` is not an identifier or `opat` was loaded lazily.
+     */
+    void writeSource(const OPAT& opat, const std::string& name, const std::string& source, std::ostream& os);
+
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+
+namespace opat::lattice {
+    class TableLattice;
+}
+
+/**
+ * @brief Namespace for inverse lookups: finding the table coordinate at which a table takes a given value.
+ *
+ * A typical use is an equation of state stored with density along the rows and temperature along the
+ * columns: given a density and a target pressure, find the temperature. Tables are treated as bilinear
+ * surfaces over their row and column values (the same model as `TableLattice` uses within each cell),
+ * so along a line of constant row (or column) coordinate the surface is piecewise linear in the other
+ * coordinate, and a root can be found exactly.
+ *
+ * The runs along which each row (or column) of a table is monotone are computed once. A solve only looks
+ * at the runs whose value range contains the target, bisects the bracketing run for the cell holding the
+ * root and takes one secant step across that cell, which is exact on a linear cell. This replaces the
+ * dozens of forward evaluations of a bisection loop over `OPATTable` accesses with O(log N) reads of the
+ * table.
+ */
+namespace opat::inverse {
+
+    /**
+     * @brief The axis of a table along which an inverse lookup solves.
+     */
+    enum class Axis {
+        Row,    ///< Solve for a row value, given a column value.
+        Column  ///< Solve for a column value, given a row value.
+    };
+
+    /**
+     * @brief One inverse lookup.
+     */
+    struct Query {
+        double fixed;  ///< Coordinate along the other axis (a column value when solving for a row value, and vice versa).
+        double target; ///< Value the table should take.
+    };
+
+    /**
+     * @brief Inverse lookups on one table.
+     *
+     * The monotone runs of every line along the solved axis are computed on construction. The table
+     * must outlive the inverse and must not be modified. All members are const and thread-safe.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPAT opat = opat::readOPAT("eos.opat");
+     * const opat::OPATTable& pressure = opat.get(FloatIndexVector({0.7, 0.02}))["P"];
+     * // Rows are densities and columns temperatures: find the temperature at which P = 15.2 for density 3.1
+     * const opat::inverse::TableInverse inverse(pressure, opat::inverse::Axis::Column);
+     * double temperature = inverse.solve(3.1, 15.2);
+     * @endcode
+     */
+    class TableInverse {
+    public:
+        /**
+         * @brief Prepares inverse lookups on `table` along `axis`, on the values at depth `zdepth` of each cell.
+         * @throws std::invalid_argument if `zdepth` is not less than the vector size of the table's cells,
+         *         or if the values of the other axis (the one `fixed` coordinates are given along) are not
+         *         strictly increasing.
+         */
+        explicit TableInverse(const OPATTable& table, Axis axis = Axis::Column, uint64_t zdepth = 0);
+
+        /**
+         * @brief Finds the coordinate along the solved axis at which the table takes the value `target`.
+         *
+         * If the target is taken at more than one coordinate, the first in the order of the solved axis'
+         * values is returned (the smallest, when they are increasing).
+         * @param fixed Coordinate along the other axis.
+         * @param target Value to solve for.
+         * @return The coordinate, or NaN if the table does not take the value `target` at `fixed`.
+         * @throws std::out_of_range if `fixed` is outside the range of the other axis.
+         */
+        [[nodiscard]] double solve(double fixed, double target) const;
+
+        /**
+         * @brief Solves a batch of queries; equivalent to calling `solve` on each in turn.
+         * @return One coordinate (or NaN) per query, in order.
+         * @throws std::out_of_range if the `fixed` coordinate of any query is out of range.
+         */
+        [[nodiscard]] std::vector<double> solve(std::span<const Query> queries) const;
+
+        /**
+         * @brief The number of monotone runs along the solved axis, summed over every line.
+         *
+         * A table which is monotone along the solved axis has one run per line.
+         */
+        [[nodiscard]] std::size_t runCount() const;
+
+    private:
+        const OPATTable& m_table;
+        Axis m_axis;
+        uint64_t m_zdepth;
+        std::vector<std::vector<uint32_t>> m_runs; ///< Per line, the node at which each monotone run starts, followed by the last node.
+    };
+
+    /**
+     * @brief Inverse lookups on a table interpolated by a `TableLattice`.
+     *
+     * Interpolated tables are weighted sums of the corner tables of a simplex, so they are solved as such,
+     * without blending whole tables as `TableLattice::get` does. The monotone runs of each corner table are
+     * computed the first time that corner is used and kept (they are small next to the table); the corner
+     * cards themselves are acquired per solve, so lazily loaded corners stay evictable.
+     *
+     * All members are thread-safe. The lattice must outlive the inverse.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPAT opat = opat::readOPAT("eos.opat");
+     * const opat::lattice::TableLattice lattice(opat);
+     * const opat::inverse::LatticeInverse inverse(lattice, "P", opat::inverse::Axis::Column);
+     * std::vector<opat::inverse::Query> queries = {{3.1, 15.2}, {3.2, 15.2}, {3.3, 15.2}};
+     * std::vector<double> temperatures = inverse.solve(FloatIndexVector({0.71, 0.018}), queries);
+     * @endcode
+     */
+    class LatticeInverse {
+    public:
+        /**
+         * @brief Prepares inverse lookups on table `tag` of the cards interpolated by `lattice`.
+         * @throws std::invalid_argument (from `solve`, as each corner is first used) under the same
+         *         conditions as the `TableInverse` constructor.
+         */
+        LatticeInverse(const lattice::TableLattice& lattice, std::string tag, Axis axis = Axis::Column, uint64_t zdepth = 0);
+
+        /**
+         * @brief Finds the coordinate along the solved axis at which the interpolated table at `indexVector`
+         * takes the value `target`.
+         * @return The coordinate, or NaN if the interpolated table does not take the value.
+         * @throws std::out_of_range if `indexVector` is outside the lattice (as for `TableLattice::get`), if
+         *         the corner cards have no table `tag`, or if `fixed` is out of range.
+         * @throws std::invalid_argument as described for the constructor.
+         */
+        [[nodiscard]] double solve(const FloatIndexVector& indexVector, double fixed, double target) const;
+
+        /**
+         * @brief Solves a batch of queries on the interpolated table at `indexVector`.
+         *
+         * The simplex and corner tables are located once for the whole batch.
+         * @return One coordinate (or NaN) per query, in order.
+         * @throws Same as the single query form.
+         */
+        [[nodiscard]] std::vector<double> solve(const FloatIndexVector& indexVector, std::span<const Query> queries) const;
+
+    private:
+        const lattice::TableLattice& m_lattice;
+        std::string m_tag;
+        Axis m_axis;
+        uint64_t m_zdepth;
+        mutable std::mutex m_mutex;
+        mutable std::unordered_map<FloatIndexVector, std::shared_ptr<const std::vector<std::vector<uint32_t>>>> m_runs; ///< Monotone runs of each corner table used so far.
+    };
+
+}
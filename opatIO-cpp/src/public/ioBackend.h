@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Namespace for batched positional file reads.
+ */
+namespace opat::io {
+
+    /**
+     * @brief One read of `length` bytes at `offset` in the file open as `fd`, into `buffer`.
+     */
+    struct ReadRequest {
+        int fd;              ///< POSIX file descriptor to read from.
+        uint64_t offset;     ///< Byte offset in the file.
+        std::size_t length;  ///< Number of bytes to read.
+        std::byte* buffer;   ///< Destination; must have room for `length` bytes.
+    };
+
+    /**
+     * @brief Selects how batches of reads are issued.
+     */
+    enum class BackendKind {
+        Auto,       ///< io_uring if the kernel allows it, otherwise the thread pool.
+        IOUring,    ///< io_uring, with a ring for each batch being read concurrently.
+        ThreadPool  ///< `pread` calls on a pool of worker threads.
+    };
+
+    /**
+     * @brief Issues many independent reads at once, so that the device sees a deep queue.
+     *
+     * Random access to lazily loaded files turns into many small reads. Reading them one at a time
+     * leaves NVMe queues nearly empty; a backend instead keeps up to its queue depth of reads in flight
+     * and completes them in whatever order the device finishes them.
+     *
+     * All members are thread-safe.
+     *
+     * **Example:**
+     * @code
+     * opat::io::ReadArena arena;
+     * std::vector<opat::io::ReadRequest> requests;
+     * for (const auto& [offset, length] : ranges) {
+     *     requests.push_back({fd, offset, length, arena.allocate(length)});
+     * }
+     * opat::io::defaultBackend().read(requests); // returns once every buffer is filled
+     * @endcode
+     */
+    class IOBackend {
+    public:
+        virtual ~IOBackend() = default;
+
+        /**
+         * @brief Performs every request in `requests`, returning once all of them have completed.
+         *
+         * Short reads are resumed until each request is complete.
+         * @throws std::runtime_error if a read fails or reaches the end of the file early. Reads already
+         *         in flight are waited for before the exception is thrown, so no buffer is written afterwards.
+         */
+        virtual void read(std::span<const ReadRequest> requests) = 0;
+
+        /**
+         * @brief Starts every request in `requests` and returns without waiting; `done` runs once all of
+         *        them have completed.
+         *
+         * No thread of the caller is blocked while the reads are in flight: io_uring completions are reaped
+         * by one thread per backend, and the thread pool runs the reads on its own workers. `done` runs on
+         * that thread (or on the calling thread, if there is nothing to read), so it should be quick, such
+         * as posting a continuation elsewhere.
+         * @param requests The reads. The span and every buffer must stay valid until `done` has run.
+         * @param done Called with null on success, or with the error `read` would have thrown.
+         */
+        virtual void readAsync(std::span<const ReadRequest> requests, std::function<void(std::exception_ptr)> done) = 0;
+
+        /**
+         * @brief Name of the backend ("io_uring" or "threads"), for logs and benchmarks.
+         */
+        [[nodiscard]] virtual std::string_view name() const = 0;
+    };
+
+    /**
+     * @brief Creates a backend.
+     * @param kind Which backend to create. `Auto` falls back to the thread pool if io_uring is unavailable
+     *        (an old kernel, or io_uring disabled by seccomp or `kernel.io_uring_disabled`).
+     * @param queueDepth Maximum number of reads in flight (io_uring entries per ring, or pool threads).
+     * @throws std::runtime_error if `kind` is `IOUring` and io_uring is unavailable.
+     */
+    [[nodiscard]] std::unique_ptr<IOBackend> makeBackend(BackendKind kind = BackendKind::Auto, unsigned queueDepth = 64);
+
+    /**
+     * @brief The backend used by LazyCardStore::prefetch.
+     *
+     * Created on first use with `BackendKind::Auto`, unless the `OPAT_IO_BACKEND` environment variable
+     * is set to `io_uring` or `threads`.
+     */
+    IOBackend& defaultBackend();
+
+    /**
+     * @brief Bump allocator for read buffers which all die together.
+     *
+     * Buffers are carved out of page-aligned blocks, so they can also be used for `O_DIRECT` reads when
+     * their sizes and offsets are page multiples. Not thread-safe.
+     */
+    class ReadArena {
+    public:
+        static constexpr std::size_t BLOCK_ALIGNMENT = 4096;
+
+        /**
+         * @param blockSize Size of each block; larger requests get a block of their own.
+         */
+        explicit ReadArena(std::size_t blockSize = std::size_t{1} << 20);
+
+        /**
+         * @brief Returns `bytes` bytes aligned to `alignment` (a power of two no larger than BLOCK_ALIGNMENT).
+         */
+        [[nodiscard]] std::byte* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+        /**
+         * @brief Releases every buffer handed out so far.
+         */
+        void reset();
+
+        /**
+         * @brief Total bytes of the blocks currently held.
+         */
+        [[nodiscard]] std::size_t capacity() const;
+
+    private:
+        struct AlignedDelete {
+            void operator()(std::byte* block) const;
+        };
+        struct Block {
+            std::unique_ptr<std::byte[], AlignedDelete> data;
+            std::size_t size;
+            std::size_t used;
+        };
+
+        std::size_t m_blockSize;
+        std::vector<Block> m_blocks;
+    };
+
+}
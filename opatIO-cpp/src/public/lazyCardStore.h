@@ -0,0 +1,227 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+#include "memoryManager.h"
+#include "ioBackend.h"
+
+namespace opat {
+
+    /**
+     * @brief On-demand storage for DataCards which are read from disk the first time they are requested.
+     *
+     * A LazyCardStore knows the catalog entry of every card it can serve and the file (source) that
+     * card lives in, but does not read any card until it is first looked up. Cards are read with
+     * `readDataCardDeferred`, so even then only the table index is read; each table is read the
+     * first time it is retrieved from the card.
+     *
+     * Cards may come from several files, which is how `VirtualOPAT` presents many OPAT files as one.
+     * For a single file, use `readOPAT(filename, LoadMode::Lazy)`, which attaches a store to the
+     * returned OPAT object.
+     *
+     * **Memory.** Every resident card is charged to a memory::MemoryManager (the process-wide one by
+     * default), under the path of the file it was read from. Cards obtained through `acquire` are
+     * held by shared handles and may be evicted when the manager needs room; the handle keeps its
+     * copy alive, and the next lookup reads the card again. Cards returned by reference (`find`, and
+     * therefore `OPAT::get`) cannot be tracked once handed out, so they are pinned for the lifetime of
+     * the store. `pin` and `unpin` protect hot cards from eviction explicitly.
+     *
+     * The store is populated with `addSource` and `addCard` before it is shared; those calls are not
+     * thread-safe. Lookups are thread-safe: concurrent lookups of the same card read it from disk once,
+     * and `find` on a card which is already pinned takes no locks.
+     *
+     * **Example:**
+     * @code
+     * opat::OPAT opat = opat::readOPAT("gs98hz.opat", opat::LoadMode::Lazy);
+     * FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+     * std::cout << opat.lazyCards->isLoaded(index) << std::endl; // 0
+     * std::shared_ptr<const opat::DataCard> card = opat.acquire(index); // read from disk here
+     * std::cout << opat.lazyCards->isLoaded(index) << std::endl; // 1 (until evicted)
+     * @endcode
+     */
+    class LazyCardStore {
+    public:
+        /**
+         * @param manager Memory manager which resident cards are charged to.
+         * @param backend Backend used by `prefetch`. `io::defaultBackend()` is used when null.
+         */
+        explicit LazyCardStore(memory::MemoryManager& manager = memory::MemoryManager::global(), io::IOBackend* backend = nullptr);
+
+        LazyCardStore(const LazyCardStore&) = delete;
+        LazyCardStore& operator=(const LazyCardStore&) = delete;
+        LazyCardStore(LazyCardStore&&) = delete;
+        LazyCardStore& operator=(LazyCardStore&&) = delete;
+        ~LazyCardStore();
+
+        /**
+         * @brief Registers a file that cards can be read from.
+         * @param filename Path to the OPAT file.
+         * @return The source ID to pass to `addCard` for cards stored in this file.
+         * @throws std::runtime_error if the file cannot be opened.
+         */
+        std::size_t addSource(const std::string& filename);
+
+        /**
+         * @brief Registers a card which will be read from `source` on first access.
+         * @param entry The catalog entry of the card in its source file.
+         * @param source A source ID returned by `addSource`.
+         * @throws std::out_of_range if `source` is not a registered source.
+         * @throws std::invalid_argument if a card with the same index has already been added.
+         */
+        void addCard(const CardCatalogEntry& entry, std::size_t source);
+
+        /**
+         * @brief Looks up a card, reading it from its source file if it is not resident.
+         *
+         * The returned handle keeps the card alive even if the store evicts it.
+         * @param index The index vector of the card.
+         * @return A handle to the card, or null if the store has no card for `index`.
+         * @throws std::runtime_error if the card cannot be read from its source file.
+         */
+        [[nodiscard]] std::shared_ptr<const DataCard> acquire(const FloatIndexVector& index) const;
+
+        /**
+         * @brief Reads every card in `indices` which is not resident, and the tables `tags` of every card in
+         *        `indices`, issuing all of the reads at once.
+         *
+         * Use this before looking up a known set of cards (such as the corners of a simplex) so that their
+         * reads overlap instead of running one after another. Cards are read as `acquire` reads them, with
+         * their tables deferred; only the tables in `tags` are read along with them, so the I/O still scales
+         * with the tags which are used. Tags a card does not have, tables already read and indices not in the
+         * store are skipped.
+         * @param indices Index vectors of the cards.
+         * @param tags Tags of the tables to read as well. Empty to read only the card headers and indices.
+         * @return The number of cards read.
+         * @throws std::runtime_error if a read fails. No card is kept unless the headers and indices of the
+         *         whole batch were read.
+         */
+        std::size_t prefetch(std::span<const FloatIndexVector> indices, std::span<const std::string> tags = {}) const;
+
+        /**
+         * @brief Starts the same reads as `prefetch` and returns without waiting for them.
+         *
+         * The reads go to the backend's `readAsync`, so no thread waits on the disk while they are in flight;
+         * `done` runs on the thread which completes the last of them (or on the calling thread, if nothing
+         * needs to be read) and should be quick. The store must outlive the prefetch.
+         * @param indices Index vectors of the cards; copied, so the span need not outlive the call.
+         * @param tags Tags of the tables to read as well; copied.
+         * @param done Called once with null and the number of cards read, or with the error `prefetch` would
+         *        have thrown.
+         *
+         * **Example:**
+         * @code
+         * store.prefetchAsync(corners, {"data"}, [&](std::exception_ptr error, std::size_t) {
+         *     executor.post([handle] { handle.resume(); }); // look the cards up where the coroutine resumes
+         * });
+         * @endcode
+         */
+        void prefetchAsync(std::span<const FloatIndexVector> indices, std::span<const std::string> tags,
+                           std::function<void(std::exception_ptr, std::size_t)> done) const;
+
+        /**
+         * @brief Looks up a card and pins it for the lifetime of the store, so the pointer stays valid.
+         * @param index The index vector of the card.
+         * @return A pointer to the card, or nullptr if the store has no card for `index`.
+         * @throws std::runtime_error if the card cannot be read from its source file.
+         */
+        [[nodiscard]] const DataCard* find(const FloatIndexVector& index) const;
+
+        /**
+         * @brief Loads the card for `index` if needed and protects it from eviction until `unpin` is called.
+         *
+         * Pins are counted.
+         * @return False if the store has no card for `index`.
+         */
+        bool pin(const FloatIndexVector& index);
+
+        /**
+         * @brief Releases one pin taken with `pin`.
+         */
+        void unpin(const FloatIndexVector& index);
+
+        /**
+         * @brief Checks whether the store can serve a card for `index`, without loading it.
+         */
+        [[nodiscard]] bool contains(const FloatIndexVector& index) const;
+
+        /**
+         * @brief Checks whether the card for `index` is currently resident.
+         * @return False if the card has not been loaded yet, has been evicted, or is not in the store.
+         */
+        [[nodiscard]] bool isLoaded(const FloatIndexVector& index) const;
+
+        /**
+         * @brief Returns the path of the file the card for `index` is read from.
+         * @throws std::out_of_range if the store has no card for `index`.
+         */
+        [[nodiscard]] const std::string& sourceFile(const FloatIndexVector& index) const;
+
+        /**
+         * @brief Number of cards registered in the store.
+         */
+        [[nodiscard]] std::size_t size() const { return m_slots.size(); }
+
+        /**
+         * @brief Number of times a card has been read from disk, including reloads after eviction.
+         */
+        [[nodiscard]] std::size_t loadedCount() const { return m_loaded.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Number of registered source files.
+         */
+        [[nodiscard]] std::size_t numSources() const { return m_sources.size(); }
+
+    private:
+        // A source file, shared with the cards read from it so that they can read their tables later
+        struct Source {
+            std::shared_ptr<OPATFileHandle> file;
+            memory::MemoryManager::ConsumerID consumer;
+        };
+
+        // A card which may or may not be resident. `card`, `memoryEntry` and `pins` are guarded by `mutex`;
+        // `memoryEntry` is the memory manager entry charged for the resident copy (0 when not resident).
+        struct Slot {
+            CardCatalogEntry entry;
+            std::size_t source;
+            std::mutex mutex;
+            std::shared_ptr<const DataCard> card;
+            memory::MemoryManager::EntryID memoryEntry = 0;
+            unsigned pins = 0;
+            std::atomic<const DataCard*> pinnedForever{nullptr}; ///< Set once a reference has been handed out by `find`.
+        };
+
+        Slot* slotFor(const FloatIndexVector& index) const;
+        std::shared_ptr<const DataCard> load(Slot& slot, std::unique_lock<std::mutex>& slotLock, bool pinned) const;
+        std::shared_ptr<const DataCard> install(Slot& slot, std::unique_lock<std::mutex>& slotLock,
+                                                std::shared_ptr<const DataCard> card, double cost, bool pinned) const;
+        std::shared_ptr<const DataCard> loadPinned(Slot& slot) const;
+        struct Prefetch;
+        enum class PrefetchStage { Headers, Indices, Cards, Tables, Done };
+        Prefetch collect(std::span<const FloatIndexVector> indices, std::span<const std::string> tags) const;
+        bool requestHeaders(Prefetch& batch) const;
+        void requestIndices(Prefetch& batch) const;
+        void installCards(Prefetch& batch) const;
+        bool requestTables(Prefetch& batch) const;
+        void supplyTables(Prefetch& batch) const;
+        void advance(std::shared_ptr<Prefetch> batch, PrefetchStage stage, std::exception_ptr error) const;
+        static void evict(Slot& slot, memory::MemoryManager::EntryID memoryEntry);
+
+        memory::MemoryManager& m_manager;
+        io::IOBackend* m_backend;
+        std::vector<std::unique_ptr<Source>> m_sources;
+        std::unordered_map<FloatIndexVector, std::unique_ptr<Slot>> m_slots;
+        mutable std::atomic<std::size_t> m_loaded{0};
+    };
+
+}
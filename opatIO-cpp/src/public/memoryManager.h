@@ -0,0 +1,215 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Namespace for process-wide accounting and eviction of OPAT memory.
+ */
+namespace opat::memory {
+
+    /**
+     * @brief Memory held by one consumer (usually one file), as returned by MemoryManager::report.
+     */
+    struct ConsumerUsage {
+        std::string name;            ///< Name the consumer registered with (usually a file path).
+        std::size_t bytes = 0;       ///< Bytes currently charged, including pinned bytes.
+        std::size_t pinnedBytes = 0; ///< Bytes which cannot currently be evicted.
+        std::size_t entries = 0;     ///< Number of charged entries.
+        std::size_t evictions = 0;   ///< Number of entries evicted so far.
+    };
+
+    /**
+     * @brief Enforces a single byte budget across every cache that registers with it.
+     *
+     * Caches (lazily loaded cards, lattice triangulations, ...) register as consumers and charge each
+     * object they keep resident as an entry, along with the cost of recreating it and a callback which
+     * drops it. When charging an entry would take the total over budget, unpinned entries are evicted
+     * in GreedyDual-Size order: each entry's priority is `L + cost / bytes`, where `L` is the priority
+     * of the last evicted entry, so entries which are large, cheap to reload and not recently used go
+     * first. Touching an entry refreshes its priority.
+     *
+     * Pinned entries are never evicted. If pinned entries alone exceed the budget the manager
+     * overshoots rather than failing; the budget is restored as they are unpinned.
+     *
+     * Eviction callbacks run on the thread which triggered the eviction, after the manager's lock has
+     * been released, so a callback may take its own cache's locks. Callers must not hold a lock that
+     * a callback takes while calling `insert`, `unpin` or `setBudget`.
+     *
+     * All members are thread-safe.
+     *
+     * **Example:**
+     * @code
+     * // Keep every lazily loaded card of every OPAT file in the process within 2 GiB
+     * opat::memory::MemoryManager::global().setBudget(std::size_t{2} << 30);
+     * for (const auto& usage : opat::memory::MemoryManager::global().report()) {
+     *     std::cout << usage.name << ": " << usage.bytes << " bytes" << std::endl;
+     * }
+     * @endcode
+     */
+    class MemoryManager {
+    public:
+        using ConsumerID = uint64_t;
+        using EntryID = uint64_t;
+
+        static constexpr std::size_t UNLIMITED = std::numeric_limits<std::size_t>::max(); ///< Budget which never triggers eviction.
+
+        explicit MemoryManager(std::size_t budget = UNLIMITED);
+
+        MemoryManager(const MemoryManager&) = delete;
+        MemoryManager& operator=(const MemoryManager&) = delete;
+
+        /**
+         * @brief The process-wide manager used by default by every LazyCardStore and TableLattice.
+         *
+         * Its initial budget is read from the `OPAT_MEMORY_BUDGET` environment variable, in bytes with an
+         * optional `K`, `M` or `G` suffix (e.g. `OPAT_MEMORY_BUDGET=512M`), and is unlimited otherwise.
+         */
+        static MemoryManager& global();
+
+        /**
+         * @brief Changes the budget, evicting entries immediately if the new budget is exceeded.
+         */
+        void setBudget(std::size_t bytes);
+
+        [[nodiscard]] std::size_t budget() const;
+
+        /**
+         * @brief Total bytes currently charged.
+         */
+        [[nodiscard]] std::size_t usage() const;
+
+        /**
+         * @brief Memory per consumer name. Consumers registered under the same name are reported together.
+         */
+        [[nodiscard]] std::vector<ConsumerUsage> report() const;
+
+        /**
+         * @brief Registers a consumer to charge entries to.
+         * @param name Name to report the consumer's memory under, usually a file path.
+         */
+        [[nodiscard]] ConsumerID registerConsumer(const std::string& name);
+
+        /**
+         * @brief Drops every entry of `consumer` (without calling their callbacks) and forgets it.
+         *
+         * Waits for eviction callbacks of this consumer which are running on other threads, so once
+         * this returns no callback of the consumer will run again.
+         */
+        void unregisterConsumer(ConsumerID consumer);
+
+        /**
+         * @brief Returns a fresh ID to pass to `insert`.
+         *
+         * IDs are handed out before insertion so that a cache can record the ID of an entry before
+         * the entry becomes visible to (and evictable by) other threads.
+         */
+        [[nodiscard]] EntryID allocateEntryID();
+
+        /**
+         * @brief Charges an entry to `consumer`, evicting other entries first if needed to stay within budget.
+         * @param entry An ID from `allocateEntryID`.
+         * @param consumer The consumer which owns the entry.
+         * @param bytes Size of the entry.
+         * @param cost Cost of recreating the entry if it is evicted (any unit, as long as it is consistent).
+         * @param evict Callback which drops the entry. Empty for entries which are inserted pinned.
+         * @param pinned Whether the entry starts out pinned.
+         * @throws std::out_of_range if `consumer` is not registered.
+         */
+        void insert(EntryID entry, ConsumerID consumer, std::size_t bytes, double cost, std::function<void()> evict, bool pinned = false);
+
+        /**
+         * @brief Marks an entry as recently used.
+         */
+        void touch(EntryID entry);
+
+        /**
+         * @brief Protects an entry from eviction. Pins are counted.
+         * @return False if the entry no longer exists (it was evicted or erased).
+         */
+        bool pin(EntryID entry);
+
+        /**
+         * @brief Releases one pin; the entry becomes evictable once no pins remain.
+         */
+        void unpin(EntryID entry);
+
+        /**
+         * @brief Removes an entry without calling its eviction callback.
+         */
+        void erase(EntryID entry);
+
+    private:
+        struct Entry {
+            ConsumerID consumer;
+            std::size_t bytes;
+            double cost;
+            double priority;
+            unsigned pins;
+            std::function<void()> evict;
+        };
+
+        struct Consumer {
+            std::string name;
+            std::size_t bytes = 0;
+            std::size_t pinnedBytes = 0;
+            std::size_t entries = 0;
+            std::size_t evictions = 0;
+            unsigned callbacksInFlight = 0;
+        };
+
+        using Victims = std::vector<std::pair<ConsumerID, std::function<void()>>>;
+
+        double priorityOf(const Entry& entry) const;
+        void removeLocked(std::unordered_map<EntryID, Entry>::iterator it);
+        void evictLocked(std::size_t incoming, Victims& victims);
+        void runVictims(Victims& victims);
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_callbacksDone;
+        std::size_t m_budget;
+        std::size_t m_usage = 0;
+        double m_clock = 0.0; ///< GreedyDual inflation value: the priority of the last evicted entry.
+        EntryID m_nextEntry = 1;
+        ConsumerID m_nextConsumer = 1;
+        std::unordered_map<EntryID, Entry> m_entries;
+        std::set<std::pair<double, EntryID>> m_evictionQueue; ///< Unpinned entries, lowest priority first.
+        std::unordered_map<ConsumerID, Consumer> m_consumers;
+    };
+
+    /**
+     * @brief RAII charge for memory which cannot be evicted, such as a lattice's triangulation.
+     *
+     * The memory is reported under `name` for as long as the reservation is alive.
+     */
+    class Reservation {
+    public:
+        Reservation() = default;
+        Reservation(MemoryManager& manager, const std::string& name, std::size_t bytes);
+
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+        Reservation(Reservation&& other) noexcept;
+        Reservation& operator=(Reservation&& other) noexcept;
+        ~Reservation();
+
+        [[nodiscard]] std::size_t bytes() const { return m_bytes; }
+
+    private:
+        void release();
+
+        MemoryManager* m_manager = nullptr;
+        MemoryManager::ConsumerID m_consumer = 0;
+        std::size_t m_bytes = 0;
+    };
+
+}
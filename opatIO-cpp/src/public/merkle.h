@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+
+/**
+ * @brief Namespace for the checksum tree of OPAT files.
+ *
+ * The leaves of the tree are the per-table checksums stored in the card index (see `computeChecksum`).
+ * The checksums of a card's tables, in the order the tables are stored, are combined into the card's
+ * root, which is stored in its header; the card roots, in the order the cards are stored, are
+ * combined into the file's root, which is stored in the file header. A root of 0 means that the
+ * writer did not record one.
+ *
+ * Readers check each card index against its root as it is read, and each table against its checksum
+ * as it is read, so lazy and partial loads verify exactly the bytes they read. A whole-file check
+ * (`verify`) hashes the cards in parallel and combines their roots.
+ *
+ * The tree is built from XXH3-64, so it detects corruption rather than tampering; the SHA-256 of each
+ * card in the card catalog remains the archival-grade check.
+ */
+namespace opat::merkle {
+
+    /**
+     * @brief XXH3-64 of `size` bytes at `data`, the hash every node of the tree is built from.
+     *
+     * Identical to `XXH3_64bits_withSeed` from the reference implementation.
+     */
+    [[nodiscard]] uint64_t hash(const void* data, std::size_t size, uint64_t seed = 0);
+
+    /**
+     * @brief Combines the hashes of child nodes into the hash of their parent.
+     *
+     * The parent is the hash of the children as consecutive little-endian 64-bit integers.
+     * @return The parent's hash, or 0 if there are no children or any child is 0 (not recorded).
+     */
+    [[nodiscard]] uint64_t combine(std::span<const uint64_t> children);
+
+    /**
+     * @brief The root of a card: its table checksums combined in the order the tables are stored.
+     * @return The root, or 0 if any table of the card has no checksum.
+     */
+    [[nodiscard]] uint64_t cardRoot(const TableIndex& tableIndex);
+
+    /**
+     * @brief The root of a file: the roots stored in the headers of its cards, combined in the order
+     * the cards are stored.
+     *
+     * Reads the header and index of every card of a lazily loaded OPAT, but no table data.
+     * @return The root, or 0 if any card has no root.
+     */
+    [[nodiscard]] uint64_t fileRoot(const OPAT& opat);
+
+    /**
+     * @brief The outcome of a whole-file check.
+     */
+    struct Report {
+        uint64_t root = 0;                          ///< The file root computed from the cards (0 if any card has none).
+        bool rootMatches = false;                   ///< Whether `root` is the root stored in the file header.
+        std::size_t tables = 0;                     ///< Number of tables hashed.
+        std::vector<FloatIndexVector> corruptCards; ///< Cards whose tables do not match their checksums, or whose index does not match its root.
+
+        /**
+         * @brief Whether the whole file verified.
+         */
+        [[nodiscard]] bool ok() const { return rootMatches && corruptCards.empty(); }
+    };
+
+    /**
+     * @brief Hashes every table of `opat` and checks the whole tree, from the table checksums up to
+     * the file root.
+     *
+     * Cards are checked in parallel, then their roots are combined. The tables of lazily loaded cards
+     * are read (and verified) as they are hashed, without pinning the cards. A file written without
+     * checksums reports a root of 0 which does not match, since there is nothing to check it against.
+     * @param opat The OPAT to check.
+     * @param threads Number of threads to hash with; 0 uses one per hardware thread.
+     * @return What was checked and what did not match.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPAT opat = opat::readOPAT("gs98hz.opat", opat::LoadMode::Lazy);
+     * const opat::merkle::Report report = opat::merkle::verify(opat);
+     * if (!report.ok()) {
+     *     std::cerr << report.corruptCards.size() << " corrupt cards" << std::endl;
+     * }
+     * @endcode
+     */
+    [[nodiscard]] Report verify(const OPAT& opat, unsigned threads = 0);
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "opatIO.h"
+
+/**
+ * @brief Namespace for exchanging tables with NumPy.
+ *
+ * Tables are written as `.npy` arrays straight from their buffers, so exports are exact to the bit and run
+ * at the speed of the disk, and `.npz` archives (uncompressed, as `numpy.savez` writes them) bundle a table
+ * with its axes, or every table of a card. Both are read back here, and by `numpy.load`:
+ *
+ * @code{.py}
+ * card = numpy.load("card.npz")
+ * data, rows, columns = card["data"], card["data.rows"], card["data.columns"]
+ * @endcode
+ *
+ * Only little- or big-endian float64 arrays in C order are read, and `.npz` archives must be uncompressed
+ * (not written by `numpy.savez_compressed`) and smaller than 4 GiB per array.
+ */
+namespace opat::npy {
+
+    /**
+     * @brief An array read from a `.npy` file.
+     */
+    struct Array {
+        std::vector<std::size_t> shape;  ///< Length of each dimension.
+        std::unique_ptr<double[]> data;  ///< The values, in C (row-major) order.
+
+        /**
+         * @brief The number of values, the product of `shape`.
+         */
+        [[nodiscard]] std::size_t size() const;
+    };
+
+    /**
+     * @brief Writes `values` as a one-dimensional `.npy` array.
+     */
+    void write(std::span<const double> values, std::ostream& os);
+
+    /**
+     * @brief Writes the data of `table` as a `.npy` array of shape (rows, columns), or (rows, columns, values) if its cells hold more than one value.
+     *
+     * **Example:**
+     * @code
+     * std::ofstream out("data.npy", std::ios::binary);
+     * opat::npy::write(opat[index]["data"], out);
+     * @endcode
+     */
+    void write(const OPATTable& table, std::ostream& os);
+
+    /**
+     * @brief Reads a `.npy` array.
+     * @throws std::runtime_error if the stream does not hold a float64 `.npy` array in C order, or ends early.
+     */
+    [[nodiscard]] Array read(std::istream& is);
+
+    /**
+     * @brief Writes `table` as a `.npz` archive holding its values ("data"), row values ("rows") and column values ("columns").
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void writeTable(const OPATTable& table, const std::string& filename);
+
+    /**
+     * @brief Reads a table written by `writeTable`.
+     * @throws std::runtime_error if the file is not such an archive, or its arrays do not agree in shape.
+     */
+    [[nodiscard]] OPATTable readTable(const std::string& filename);
+
+    /**
+     * @brief Writes every table of `card` to a `.npz` archive, as "<tag>", "<tag>.rows" and "<tag>.columns", in the order the tables are stored.
+     * @throws std::runtime_error if the file cannot be written.
+     *
+     * **Example:**
+     * @code
+     * opat::npy::writeCard(opat[FloatIndexVector({0.35, 0.004})], "card.npz");
+     * @endcode
+     */
+    void writeCard(const DataCard& card, const std::string& filename);
+
+    /**
+     * @brief Reads a card written by `writeCard`.
+     *
+     * The index entries of the card give the shape of each table, in the order the archive holds them.
+     * @throws std::runtime_error if the file is not such an archive, or a tag has more than 8 characters.
+     */
+    [[nodiscard]] DataCard readCard(const std::string& filename);
+
+}
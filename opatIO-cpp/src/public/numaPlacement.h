@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+
+/**
+ * @brief Namespace for placing table data on the NUMA nodes of multi-socket machines.
+ *
+ * Pages are placed on the node of the thread which first touches them, so by default every table
+ * of an OPAT file ends up on the socket which called `readOPAT`, and threads on the other sockets
+ * interpolate across the interconnect. Two remedies are offered:
+ *
+ * - `InterleaveScope` spreads the pages of tables read while it is alive across all nodes, so that
+ *   every socket sees the same average latency and the file's bandwidth comes from every node.
+ * - `Replicas` keeps a copy of selected (hot) tables on every node; a lattice given the replicas
+ *   (`TableLattice::setReplicas`) reads the copy local to the querying thread.
+ *
+ * Both are built on the `set_mempolicy` and `get_mempolicy` system calls, so libnuma is not needed. On
+ * single-node machines, and on kernels without NUMA support, they do nothing.
+ */
+namespace opat::numa {
+
+    /**
+     * @brief IDs of the online NUMA nodes, in ascending order; `{0}` if the machine is not NUMA.
+     */
+    [[nodiscard]] std::vector<int> onlineNodes();
+
+    /**
+     * @brief The node of the CPU the calling thread is running on (0 if it cannot be determined).
+     */
+    [[nodiscard]] int currentNode();
+
+    /**
+     * @brief While alive, interleaves the pages of new allocations made by the calling thread across
+     * every online node.
+     *
+     * Wrap an eager (or direct) `readOPAT` in one to interleave the tables of a whole file. Cards which
+     * are loaded lazily later are placed by the thread that reads them. The thread's previous policy
+     * is restored on destruction. Does nothing on single-node machines.
+     *
+     * **Example:**
+     * @code
+     * opat::OPAT opat = [] {
+     *     opat::numa::InterleaveScope interleave;
+     *     return opat::readOPAT("gs98hz.opat");
+     * }();
+     * @endcode
+     */
+    class InterleaveScope {
+    public:
+        InterleaveScope();
+        InterleaveScope(const InterleaveScope&) = delete;
+        InterleaveScope& operator=(const InterleaveScope&) = delete;
+        ~InterleaveScope();
+
+        /**
+         * @brief Whether the interleave policy was applied (false on single-node machines).
+         */
+        [[nodiscard]] bool active() const { return m_active; }
+
+    private:
+        bool m_active = false;
+        int m_previousMode = 0;
+        std::vector<unsigned long> m_previousNodes;
+    };
+
+    /**
+     * @brief Copies of selected tables of an OPAT, one set per NUMA node.
+     *
+     * Each node's copies are made by a thread running on that node with its allocations bound to it,
+     * so that their pages are local to the node. The copies are independent of the OPAT and are not
+     * charged to the memory budget; `bytes` reports their total size.
+     *
+     * All members are const and thread-safe once constructed.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPAT opat = opat::readOPAT("gs98hz.opat");
+     * opat::lattice::TableLattice lattice(opat);
+     * lattice.setReplicas(std::make_shared<const opat::numa::Replicas>(opat, std::vector<std::string>{"data"}));
+     * opat::DataCard result = lattice.get(FloatIndexVector({0.54421, 0.077585})); // reads the local copy
+     * @endcode
+     */
+    class Replicas {
+    public:
+        /**
+         * @brief Replicates the tables `tags` of every card onto every online node.
+         *
+         * On a single-node machine nothing is copied, and `local` always returns null.
+         * @throws std::runtime_error if a card cannot be read.
+         */
+        Replicas(const OPAT& opat, const std::vector<std::string>& tags);
+
+        /**
+         * @brief Replicates the tables `tags` of every card onto each node in `nodes`.
+         *
+         * Placement is best effort: if a node cannot be bound to, its copies are placed by first touch.
+         * @throws std::runtime_error if a card cannot be read.
+         */
+        Replicas(const OPAT& opat, const std::vector<std::string>& tags, const std::vector<int>& nodes);
+
+        /**
+         * @brief The copy of table `tag` of the card at `index` on `node`, or null if there is none.
+         */
+        [[nodiscard]] const OPATTable* local(const FloatIndexVector& index, const std::string& tag, int node) const;
+
+        /**
+         * @brief The copy of table `tag` of the card at `index` on the calling thread's node, or null.
+         */
+        [[nodiscard]] const OPATTable* local(const FloatIndexVector& index, const std::string& tag) const {
+            return local(index, tag, currentNode());
+        }
+
+        /**
+         * @brief The nodes which hold copies.
+         */
+        [[nodiscard]] const std::vector<int>& nodes() const { return m_nodes; }
+
+        /**
+         * @brief Total bytes of all copies on all nodes.
+         */
+        [[nodiscard]] std::size_t bytes() const { return m_bytes; }
+
+    private:
+        using Tables = std::unordered_map<FloatIndexVector, std::unordered_map<std::string, OPATTable>>;
+
+        std::vector<int> m_nodes;
+        std::vector<Tables> m_copies; ///< Parallel to `m_nodes`.
+        std::size_t m_bytes = 0;
+    };
+
+}
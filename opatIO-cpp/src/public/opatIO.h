@@ -58,11 +58,33 @@
 #include <cstdint>
 #include <unordered_map>
 #include <limits>
+#include <mutex>
 
 #include "indexVector.h"
 
 namespace opat {
 
+namespace trace {
+    class QueryRecorder;
+}
+
+namespace async {
+    class CardAwaitable;
+    class Executor;
+}
+
+class LazyCardStore;
+struct DeferredTables;
+
+/**
+ * @brief Controls when the DataCards of an OPAT file are read from disk.
+ */
+enum class LoadMode {
+    Eager, ///< Read every card when the file is opened (the default).
+    Lazy,  ///< Read only the header and card catalog up front; each card's table index is read the first time the card is requested, and each table the first time it is requested.
+    Direct ///< Read every card up front like `Eager`, but bypass the page cache: `O_DIRECT` with aligned buffers where the filesystem supports it, otherwise `posix_fadvise` (SEQUENTIAL, then DONTNEED behind the reader). Use for one-off bulk loads of large files, so they do not occupy memory twice or evict other processes' cached data.
+};
+
 /**
  * @brief Structure to hold the header information of an OPAT file.
  *
@@ -81,7 +103,8 @@ struct Header {
     char comment[128];       ///< User-defined comment section.
     uint16_t numIndex;       ///< Size of the index vector per table.
     uint8_t hashPrecision;  ///< Precision of the hash used for table validation.
-    char reserved[23];       ///< Reserved for future use.
+    uint64_t merkleRoot;     ///< Root of the file's checksum tree (see merkle.h), or 0 if the writer recorded none.
+    char reserved[15];       ///< Reserved for future use.
 
     /**
      * @brief Stream insertion operator for printing the header.
@@ -109,7 +132,9 @@ struct CardHeader {
     uint64_t indexOffset;    ///< Offset to the index section within the card.
     uint64_t cardSize;       ///< Total size of the card in bytes.
     char comment[128];       ///< User-defined comment section.
-    char reserved[100];      ///< Reserved for future use.
+    uint64_t statsOffset;    ///< Offset to the table statistics section within the card, or 0 if the card has none.
+    uint64_t merkleRoot;     ///< Root of the checksums of the card's tables (see merkle.h), verified when the card index is read; 0 if the writer recorded none.
+    char reserved[84];       ///< Reserved for future use.
 
     /**
      * @brief Stream insertion operator for printing the card header.
@@ -174,7 +199,8 @@ struct TableIndexEntry {
     char columnName[8];      ///< Name of the columns (optional).
     char rowName[8];         ///< Name of the rows (optional).
     uint64_t size;           ///< Vector size of each cell
-    char reserved[12];       ///< Reserved for future use.
+    uint64_t checksum;       ///< XXH3-64 checksum of the table (see `computeChecksum`), verified when the table is read; 0 if the writer recorded none.
+    char reserved[4];        ///< Reserved for future use.
 
     /**
      * @brief Stream insertion operator for printing the table index entry.
@@ -186,6 +212,32 @@ struct TableIndexEntry {
 };
 #pragma pack()
 
+/**
+ * @brief Summary statistics of one table, as stored in the statistics section of its DataCard.
+ *
+ * Writers record one entry per table after the card index, so that the range of a table's values and
+ * whether it contains NaNs can be known without reading the table. The minimum, maximum and mean are
+ * taken over the non-NaN values, and are NaN if every value is NaN.
+ */
+#pragma pack(1)
+struct TableStatistics {
+    char tag[8];             ///< Tag of the table the statistics describe.
+    double min;              ///< Smallest non-NaN value.
+    double max;              ///< Largest non-NaN value.
+    double mean;             ///< Mean of the non-NaN values.
+    uint64_t nanCount;       ///< Number of NaN values.
+    char reserved[8];        ///< Reserved for future use.
+
+    /**
+     * @brief Stream insertion operator for printing the table statistics.
+     * @param os Output stream.
+     * @param statistics TableStatistics to print.
+     * @return Reference to the output stream.
+     */
+    friend std::ostream& operator<<(std::ostream& os, const TableStatistics& statistics);
+};
+#pragma pack()
+
 /**
  * @brief Structure to hold the index of tables within a DataCard.
  *
@@ -193,6 +245,7 @@ struct TableIndexEntry {
  */
 struct TableIndex {
     std::unordered_map<std::string, TableIndexEntry> tableIndex; ///< Map of table tags to index entries.
+    std::unordered_map<std::string, TableStatistics> statistics; ///< Map of table tags to their stored statistics. Empty for cards written without a statistics section.
 
     /**
      * @brief Stream insertion operator for printing the table index.
@@ -217,6 +270,15 @@ struct TableIndex {
      * @throws std::out_of_range if the tag is not found.
      */
     const TableIndexEntry& operator[](const std::string& tag) const;
+
+    /**
+     * @brief Retrieves the stored statistics of a table by tag, without reading the table.
+     * @param tag The tag of the table.
+     * @return A constant reference to the TableStatistics.
+     * @throws std::out_of_range if the card has no statistics for the tag (for example, because it was
+     *         written before statistics were recorded).
+     */
+    [[nodiscard]] const TableStatistics& getStatistics(const std::string& tag) const;
 };
 
 /**
@@ -250,6 +312,29 @@ struct Slice {
 };
 
 
+/**
+ * @brief Deleter of the arrays of an OPATTable.
+ *
+ * Arrays are owned (and freed with `delete[]`) unless the deleter is constructed as borrowing, as for
+ * tables viewing data embedded in the executable (see embed.h). Converts implicitly from the default
+ * deleter, so arrays from `std::make_unique<double[]>` can be assigned as before.
+ */
+struct TableArrayDeleter {
+    bool owning = true; ///< Whether the array is freed with the table.
+
+    TableArrayDeleter() = default;
+    TableArrayDeleter(std::default_delete<double[]>) {}
+    explicit TableArrayDeleter(bool owning) : owning(owning) {}
+
+    void operator()(double* array) const {
+        if (owning) {
+            delete[] array;
+        }
+    }
+};
+
+using TableArray = std::unique_ptr<double[], TableArrayDeleter>; ///< An array of an OPATTable, owned or borrowed.
+
 /**
  * @brief Structure to hold the data of an OPAT table.
  *
@@ -257,9 +342,9 @@ struct Slice {
  * It provides methods for accessing and slicing the data.
  */
 struct OPATTable {
-    std::unique_ptr<double[]> rowValues; ///< Array of row values.
-    std::unique_ptr<double[]> columnValues; ///< Array of column values.
-    std::unique_ptr<double[]> data; ///< Array of table data.
+    TableArray rowValues; ///< Array of row values.
+    TableArray columnValues; ///< Array of column values.
+    TableArray data; ///< Array of table data.
 
     uint32_t N_R;   ///< Number of rows in the table.
     uint32_t N_C;   ///< Number of columns in the table.
@@ -389,10 +474,28 @@ struct OPATTable {
 
     /**
      * @brief Converts the table to an ASCII representation.
+     *
+     * The same text as `writeAscii`; prefer `writeAscii` for large tables, which does not build a string.
      * @return A string containing the ASCII representation of the table.
      */
     [[nodiscard]] std::string ascii() const;
 
+    /**
+     * @brief Writes the table as text, one row per line.
+     *
+     * Cells are separated by spaces and the values of a cell (see `m_vsize`) by commas. Values are
+     * formatted with `std::to_chars` in their shortest form which reads back to the same double, so the
+     * text is exact, and are written to `os` in blocks rather than built up in a string.
+     * @param os Stream to write to.
+     *
+     * **Example:**
+     * @code
+     * std::ofstream out("data.txt");
+     * opat[index]["data"].writeAscii(out);
+     * @endcode
+     */
+    void writeAscii(std::ostream& os) const;
+
     /**
      * @brief Prints the table to the standard output.
      */
@@ -401,6 +504,28 @@ struct OPATTable {
     friend std::ostream& operator<<(std::ostream& os, const OPATTable& table);
 };
 
+/**
+ * @brief An open OPAT file which table payloads can be read from after their card has been read.
+ *
+ * Shared by every card read with `readDataCardDeferred` from the file, so that it stays open for as long as
+ * any of them may still need to read a table. Reads through `file` must hold `mutex`.
+ */
+struct OPATFileHandle {
+    std::string filename; ///< Path of the file.
+    std::ifstream file; ///< Binary stream on the file.
+    std::mutex mutex; ///< Serializes seeks and reads on `file`.
+    int descriptor = -1; ///< POSIX descriptor on the same file, for positional reads which need no lock (see ioBackend.h).
+
+    /**
+     * @brief Opens `filename` for binary reading.
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    explicit OPATFileHandle(const std::string& filename);
+    OPATFileHandle(const OPATFileHandle&) = delete;
+    OPATFileHandle& operator=(const OPATFileHandle&) = delete;
+    ~OPATFileHandle();
+};
+
 /**
  * @brief Structure to hold a DataCard, which contains multiple tables.
  *
@@ -409,7 +534,8 @@ struct OPATTable {
 struct DataCard {
     CardHeader header; ///< Header of the DataCard.
     TableIndex tableIndex; ///< Index of tables within the DataCard.
-    std::unordered_map<std::string, OPATTable> tableData; ///< Map of table tags to their data.
+    std::unordered_map<std::string, OPATTable> tableData; ///< Map of table tags to their data. Empty for cards read with `readDataCardDeferred`.
+    std::shared_ptr<DeferredTables> deferredTables; ///< Tables read from disk on their first `get` (see `readDataCardDeferred`). Null when every table is in `tableData`.
 
     /**
      * @brief Stream insertion operator for printing the DataCard.
@@ -421,9 +547,13 @@ struct DataCard {
 
     /**
      * @brief Retrieves a table from the DataCard by tag.
+     *
+     * For cards read with `readDataCardDeferred` the table is read from disk on its first retrieval.
+     * This is thread-safe: concurrent first retrievals of a table read it once.
      * @param tag The tag of the table to retrieve.
      * @return A constant reference to the OPATTable.
      * @throws std::out_of_range if the tag is not found.
+     * @throws std::runtime_error if a deferred table cannot be read.
      */
     [[nodiscard]] const OPATTable& get(const std::string& tag) const;
 
@@ -467,6 +597,22 @@ struct DataCard {
      * @endcode
      */
     [[nodiscard]] std::vector<std::string> getKeys() const;
+
+    /**
+     * @brief Checks whether the table `tag` is in memory, so that retrieving it does no I/O.
+     * @return False if the table is deferred and not yet read, or if the card has no table `tag`.
+     */
+    [[nodiscard]] bool isTableRead(const std::string& tag) const;
+
+    /**
+     * @brief Hands a deferred table that was read by other means (such as a batched read) to the card.
+     *
+     * This lets LazyCardStore::prefetch fill many cards' tables from one batch of reads. Thread-safe, like `get`.
+     * @param tag The tag of the table.
+     * @param table The table, parsed from the bytes the card's index describes for `tag`.
+     * @return False, discarding `table`, if `tag` is not deferred in this card or has already been read.
+     */
+    bool supplyTable(const std::string& tag, OPATTable table) const;
 };
 
 /**
@@ -494,15 +640,36 @@ struct Bounds {
     friend std::ostream& operator<<(std::ostream& os, const Bounds& bounds);
 };
 
+/**
+ * @brief Statistics of one tag across every card of an OPAT file, as returned by `OPAT::getStatistics`.
+ *
+ * The minimum, maximum and mean are over the non-NaN values of every table with the tag, and are NaN
+ * if there are none.
+ */
+struct TagStatistics {
+    double min = std::numeric_limits<double>::quiet_NaN();  ///< Smallest non-NaN value.
+    double max = std::numeric_limits<double>::quiet_NaN();  ///< Largest non-NaN value.
+    double mean = std::numeric_limits<double>::quiet_NaN(); ///< Mean of the non-NaN values.
+    uint64_t nanCount = 0;    ///< Number of NaN values.
+    uint64_t valueCount = 0;  ///< Number of non-NaN values.
+    std::size_t cards = 0;    ///< Number of cards with a table of the tag.
+    std::size_t computedCards = 0; ///< Number of those cards without stored statistics, whose tables had to be read.
+};
+
 /**
  * @brief Structure to hold the entire OPAT file.
  *
  * The OPAT structure contains the file header, card catalog, and all DataCards.
+ * When the file was opened with `LoadMode::Lazy`, `cards` is empty and cards are served
+ * by `lazyCards` instead; use `get` (or `resolve`) rather than `cards` to look cards up.
  */
 struct OPAT {
     Header header; ///< Header of the OPAT file.
     CardCatalog cardCatalog; ///< Catalog of DataCards in the file.
-    std::unordered_map<FloatIndexVector, DataCard> cards; ///< Map of index vectors to DataCards.
+    std::unordered_map<FloatIndexVector, DataCard> cards; ///< Map of index vectors to eagerly loaded DataCards.
+    std::shared_ptr<LazyCardStore> lazyCards; ///< Cards read on first access (see lazyCardStore.h). Null for eagerly loaded files.
+    std::shared_ptr<trace::QueryRecorder> recorder; ///< Optional query recorder (see queryTrace.h). Tracing is disabled when null.
+    std::string filename; ///< Path the OPAT was read from, used to report its memory (see memoryManager.h). Empty if it was built in memory.
 
     /**
      * @brief Stream insertion operator for printing the OPAT structure.
@@ -514,12 +681,59 @@ struct OPAT {
 
     /**
      * @brief Retrieves a DataCard from the OPAT structure by index.
+     *
+     * If `recorder` is set, the lookup is recorded as `trace::QueryKind::Card`.
      * @param index The index vector of the DataCard to retrieve.
      * @return A constant reference to the DataCard.
      * @throws std::out_of_range if the index is not found.
      */
     [[nodiscard]] const DataCard& get(const FloatIndexVector& index) const;
 
+    /**
+     * @brief Retrieves a DataCard without recording the lookup.
+     *
+     * This is the lookup used internally by `get` and by `lattice::TableLattice` to fetch the corner
+     * cards of a simplex. Cards are looked up in `cards` first, then in `lazyCards` (loading the card
+     * from disk if needed).
+     * @param index The index vector of the DataCard to retrieve.
+     * @return A constant reference to the DataCard.
+     * @throws std::runtime_error if the index is not found.
+     */
+    [[nodiscard]] const DataCard& resolve(const FloatIndexVector& index) const;
+
+    /**
+     * @brief Retrieves a DataCard as a handle which keeps it alive, without recording the lookup.
+     *
+     * Unlike `get` and `resolve`, which pin lazily loaded cards in memory for as long as the OPAT
+     * object lives, cards obtained this way stay subject to the memory budget (see memoryManager.h):
+     * once every handle is dropped the card may be evicted and is read again on the next lookup.
+     * For eagerly loaded cards the handle simply refers into `cards`.
+     * @param index The index vector of the DataCard to retrieve.
+     * @return A handle to the DataCard.
+     * @throws std::runtime_error if the index is not found.
+     */
+    [[nodiscard]] std::shared_ptr<const DataCard> acquire(const FloatIndexVector& index) const;
+
+    /**
+     * @brief Retrieves a DataCard from a coroutine without blocking the awaiting thread on disk.
+     *
+     * Awaiting the result gives the same handle as `acquire`. Resident cards are returned without
+     * suspending; otherwise the card is read by the I/O dispatcher of asyncOPAT.h, batched with the
+     * other lookups outstanding at the time, and the coroutine is resumed on `executor`. The lookup is
+     * recorded like `get` when a recorder is attached.
+     * @param index The index vector of the DataCard to retrieve.
+     * @param executor Executor on which to resume (`async::defaultExecutor()` if omitted).
+     * @return An awaitable; include asyncOPAT.h to await it.
+     * @throws std::runtime_error (when awaited) if the index is not found.
+     *
+     * **Example:**
+     * @code
+     * std::shared_ptr<const opat::DataCard> card = co_await opat.getAsync(FloatIndexVector({0.35, 0.004}));
+     * @endcode
+     */
+    [[nodiscard]] async::CardAwaitable getAsync(const FloatIndexVector& index) const;
+    [[nodiscard]] async::CardAwaitable getAsync(const FloatIndexVector& index, async::Executor& executor) const;
+
     /**
      * @brief Retrieves a DataCard from the OPAT structure by a standard vector of doubles.
      * This is a convenience overload that constructs a FloatIndexVector internally.
@@ -582,6 +796,24 @@ struct OPAT {
      * @endcode
      */
     [[nodiscard]] std::vector<Bounds> getBounds() const;
+
+    /**
+     * @brief Summarizes the values of a tag across every card.
+     *
+     * Uses the statistics stored in each card (see TableStatistics), so for files written with them
+     * no table is read; with `LoadMode::Lazy` only card headers and indices are. Tables of cards
+     * without stored statistics are read and summarized instead, and counted in `computedCards`.
+     * @param tag The tag to summarize.
+     * @return The statistics of the tag.
+     * @throws std::out_of_range if no card has a table with the tag.
+     *
+     * **Example:**
+     * @code
+     * const opat::TagStatistics stats = opat_file.getStatistics("data");
+     * std::cout << "data in [" << stats.min << ", " << stats.max << "], " << stats.nanCount << " NaNs" << std::endl;
+     * @endcode
+     */
+    [[nodiscard]] TagStatistics getStatistics(const std::string& tag) const;
 };
 
 /**
@@ -589,8 +821,11 @@ struct OPAT {
  * 
  * This function validates the file's magic number, reads the header, card catalog, 
  * and all data cards, and constructs an OPAT object representing the file's contents.
+ * With `LoadMode::Lazy` only the header and card catalog are read; the file is kept open
+ * and each card is read the first time it is requested.
  * 
  * @param filename Path to the OPAT file.
+ * @param mode When to read the DataCards (defaults to reading all of them up front).
  * @return An OPAT structure containing the file's data.
  * @throws std::runtime_error if the file cannot be opened, is invalid, or has an incorrect magic number.
  * 
@@ -600,7 +835,29 @@ struct OPAT {
  * std::cout << file.header << std::endl;
  * @endcode
  */
-OPAT readOPAT(const std::string& filename);
+OPAT readOPAT(const std::string& filename, LoadMode mode = LoadMode::Eager);
+
+/**
+ * @brief Writes an OPAT to a file, in the layout opatio writes.
+ *
+ * Cards and their tables are written in the order they are stored (by their catalog and index byte
+ * starts), with table checksums, statistics, card and file roots, and the SHA-256 of every card in the
+ * catalog computed from the tables as they are written; byte offsets are recomputed. Tables of lazily
+ * loaded cards are read as they are written.
+ *
+ * @param opat The OPAT to write.
+ * @param filename Path of the file to write, replaced if it exists.
+ * @throws std::runtime_error if the file cannot be written.
+ * @throws std::length_error if a table has more rows or columns than a table index entry can store
+ *         (65535), before the file is opened.
+ *
+ * **Example:**
+ * @code
+ * const opat::OPAT regridded = opat::regrid::regrid(opat, {{"data", axes}});
+ * opat::writeOPAT(regridded, "gs98hz_regridded.opat");
+ * @endcode
+ */
+void writeOPAT(const OPAT& opat, const std::string& filename);
 
 /**
  * @brief Reads the header of an OPAT file.
@@ -692,8 +949,10 @@ std::unordered_map<FloatIndexVector, DataCard> readDataCards(std::ifstream &file
  * 
  * This function reads the header, table index, and table data for a single DataCard.
  * 
- * @param file Input file stream.
+ * @param file Input stream positioned anywhere; `entry.byteStart - streamStart` is taken as an offset into it.
  * @param entry The CardCatalogEntry for the DataCard.
+ * @param streamStart Offset in the file of the first byte of `file`, when it holds only part of the file
+ *        (such as a card read into memory). Entries keep their offsets in the file, which errors report.
  * @return A DataCard structure.
  * @throws std::runtime_error if the DataCard cannot be read or is incomplete.
  * 
@@ -704,7 +963,42 @@ std::unordered_map<FloatIndexVector, DataCard> readDataCards(std::ifstream &file
  * opat::DataCard card = opat::readDataCard(file, entry);
  * @endcode
  */
-DataCard readDataCard(std::ifstream &file, const CardCatalogEntry &entry);
+DataCard readDataCard(std::istream &file, const CardCatalogEntry &entry, uint64_t streamStart = 0);
+
+/**
+ * @brief Reads a DataCard's header and table index, deferring each table until it is first retrieved.
+ *
+ * This is how cards are read with `LoadMode::Lazy`: I/O and memory scale with the tags which are
+ * actually used. The returned card keeps `source` open until the card and every copy of it are destroyed.
+ *
+ * @param source The open file to read the card, and later its tables, from.
+ * @param entry The CardCatalogEntry for the DataCard.
+ * @return A DataCard whose tables are read by `DataCard::get`.
+ * @throws std::runtime_error if the card header or table index cannot be read.
+ *
+ * **Example:**
+ * @code
+ * auto source = std::make_shared<opat::OPATFileHandle>("example.opat");
+ * opat::CardCatalogEntry entry = ...; // Retrieved from the catalog
+ * opat::DataCard card = opat::readDataCardDeferred(source, entry); // reads no table payloads
+ * const opat::OPATTable& table = card["data"]; // reads the "data" table only
+ * @endcode
+ */
+DataCard readDataCardDeferred(const std::shared_ptr<OPATFileHandle>& source, const CardCatalogEntry &entry);
+
+/**
+ * @brief Builds a deferred DataCard from a header and table index which have already been read.
+ *
+ * For callers which read card metadata themselves, such as LazyCardStore::prefetch, which reads the
+ * headers and indices of many cards in one batch. Tables are read from `source` as in the overload above.
+ * @param source The open file to read the card's tables from.
+ * @param entry The CardCatalogEntry for the DataCard, as in the file's catalog.
+ * @param header The card header.
+ * @param tableIndex The card's table index.
+ * @return A DataCard whose tables are read by `DataCard::get`.
+ */
+DataCard readDataCardDeferred(const std::shared_ptr<OPATFileHandle>& source, const CardCatalogEntry &entry,
+                              const CardHeader &header, TableIndex tableIndex);
 
 /**
  * @brief Reads the header of a DataCard from the file.
@@ -714,6 +1008,8 @@ DataCard readDataCard(std::ifstream &file, const CardCatalogEntry &entry);
  * 
  * @param file Input file stream.
  * @param entry The CardCatalogEntry for the DataCard.
+ * @param streamStart Offset in the file of the first byte of `file`, when it holds only part of the file
+ *        (such as a card read into memory). Entries keep their offsets in the file, which errors report.
  * @return A CardHeader structure.
  * @throws std::runtime_error if the DataCard header cannot be read or is incomplete.
  * 
@@ -724,17 +1020,19 @@ DataCard readDataCard(std::ifstream &file, const CardCatalogEntry &entry);
  * opat::CardHeader header = opat::readDataCardHeader(file, entry);
  * @endcode
  */
-CardHeader readDataCardHeader(std::ifstream &file, const CardCatalogEntry &entry);
+CardHeader readDataCardHeader(std::istream &file, const CardCatalogEntry &entry, uint64_t streamStart = 0);
 
 /**
  * @brief Reads the TableIndex from a DataCard.
  * 
  * This function reads the table index of a DataCard, which maps table tags to their 
- * metadata and locations within the card.
+ * metadata and locations within the card, and the card's table statistics if it has them.
  * 
  * @param file Input file stream.
  * @param entry The CardCatalogEntry for the DataCard.
  * @param header The CardHeader of the DataCard.
+ * @param streamStart Offset in the file of the first byte of `file`, when it holds only part of the file
+ *        (such as a card read into memory). Entries keep their offsets in the file, which errors report.
  * @return A TableIndex structure.
  * @throws std::runtime_error if the TableIndex cannot be read or is incomplete.
  * 
@@ -746,7 +1044,7 @@ CardHeader readDataCardHeader(std::ifstream &file, const CardCatalogEntry &entry
  * opat::TableIndex index = opat::readTableIndex(file, entry, header);
  * @endcode
  */
-TableIndex readTableIndex(std::ifstream &file, const CardCatalogEntry &entry, const CardHeader &header);
+TableIndex readTableIndex(std::istream &file, const CardCatalogEntry &entry, const CardHeader &header, uint64_t streamStart = 0);
 
 /**
  * @brief Reads an OPATTable from the file.
@@ -757,6 +1055,8 @@ TableIndex readTableIndex(std::ifstream &file, const CardCatalogEntry &entry, co
  * @param file Input file stream.
  * @param cardEntry The CardCatalogEntry for the DataCard.
  * @param tableEntry The TableIndexEntry for the table.
+ * @param streamStart Offset in the file of the first byte of `file`, when it holds only part of the file
+ *        (such as a card read into memory). Entries keep their offsets in the file, which errors report.
  * @return An OPATTable structure.
  * @throws std::runtime_error if the table cannot be read or is incomplete.
  * 
@@ -768,7 +1068,36 @@ TableIndex readTableIndex(std::ifstream &file, const CardCatalogEntry &entry, co
  * opat::OPATTable table = opat::readOPATTable(file, cardEntry, tableEntry);
  * @endcode
  */
-OPATTable readOPATTable(std::ifstream &file, const CardCatalogEntry &cardEntry, const TableIndexEntry &tableEntry);
+OPATTable readOPATTable(std::istream &file, const CardCatalogEntry &cardEntry, const TableIndexEntry &tableEntry, uint64_t streamStart = 0);
+
+/**
+ * @brief Computes the statistics which writers store for a table.
+ *
+ * This reads every value of the table; use the stored statistics (`TableIndex::getStatistics`) where
+ * the file has them.
+ * @param tag The tag to record in the result.
+ * @param table The table to summarize.
+ * @return The statistics of the table's data (row and column values are not included).
+ */
+[[nodiscard]] TableStatistics computeStatistics(const std::string& tag, const OPATTable& table);
+
+/**
+ * @brief Computes the checksum which writers store for a table in its index entry.
+ *
+ * The row and column values are hashed (XXH3-64, seed 0) as one block, and that hash seeds the XXH3-64
+ * hash of the data, so the checksum covers every byte of the table as stored. Tables are checked
+ * against it whenever they are read; unlike the SHA-256 of the card catalog this runs at close to
+ * memory bandwidth, so the check is left on.
+ * @param table The table to hash.
+ * @return The checksum of the table.
+ *
+ * **Example:**
+ * @code
+ * const opat::OPATTable& table = opat.get(FloatIndexVector({0.35, 0.004}))["data"];
+ * uint64_t checksum = opat::computeChecksum(table);
+ * @endcode
+ */
+[[nodiscard]] uint64_t computeChecksum(const OPATTable& table);
 
 /**
  * @brief Checks if a file has the correct magic number for an OPAT file.
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "indexVector.h"
+
+/**
+ * @brief Namespace for recording and reading OPAT query traces.
+ *
+ * A query trace is a compact binary log of the index vectors that were requested from an
+ * `opat::OPAT` (card lookups) or an `opat::lattice::TableLattice` (interpolated lookups).
+ * Traces captured from production runs can be replayed offline with the `opatReplay` tool
+ * to tune and regression-test loading configurations against real workloads.
+ *
+ * **Trace layout** (all values little-endian):
+ * - A `TraceHeader` (16 bytes).
+ * - A sequence of records, each consisting of
+ *   `uint8_t kind`, `uint16_t numIndex`, `uint64_t timestamp` (nanoseconds since the recorder was created)
+ *   followed by `numIndex` doubles.
+ */
+namespace opat::trace {
+
+    /**
+     * @brief The kind of query stored in a trace record.
+     */
+    enum class QueryKind : uint8_t {
+        Card = 0,    ///< A direct card lookup through `OPAT::get`.
+        Lattice = 1  ///< An interpolated lookup through `TableLattice::get`.
+    };
+
+#pragma pack(1)
+    /**
+     * @brief Header written at the start of every trace file.
+     */
+    struct TraceHeader {
+        char magic[4];       ///< Magic number, always "OPTR".
+        uint16_t version;    ///< Version of the trace format.
+        char reserved[10];   ///< Reserved for future use.
+    };
+#pragma pack()
+
+    /**
+     * @brief A single query read back from a trace file.
+     */
+    struct TraceRecord {
+        QueryKind kind;             ///< The kind of query.
+        uint64_t timestamp;         ///< Nanoseconds since the recorder was created.
+        std::vector<double> index;  ///< The queried index vector.
+    };
+
+    /**
+     * @brief Thread-safe, buffered writer for query traces.
+     *
+     * Recording is opt-in: attach a recorder to an `opat::OPAT` by assigning its `recorder` member.
+     * Every `OPAT::get` and every `TableLattice::get` built on that OPAT object will then append a
+     * record. Records are buffered in memory and written in blocks; the buffer is flushed when it
+     * fills, when `flush()` is called, and when the recorder is destroyed.
+     *
+     * **Example:**
+     * @code
+     * opat::OPAT file = opat::readOPAT("gs98hz.opat");
+     * file.recorder = std::make_shared<opat::trace::QueryRecorder>("queries.optr");
+     * const auto& card = file.get({0.2, 0.06});          // recorded as QueryKind::Card
+     * opat::lattice::TableLattice lattice(file);
+     * auto interpolated = lattice.get({0.275, 0.07});     // recorded as QueryKind::Lattice
+     * @endcode
+     */
+    class QueryRecorder {
+    public:
+        /**
+         * @brief Opens a trace file for writing and writes the trace header.
+         * @param filename Path to the trace file. An existing file is truncated.
+         * @param bufferSize Number of bytes to buffer before writing to disk.
+         * @throws std::runtime_error if the file cannot be opened.
+         */
+        explicit QueryRecorder(const std::string& filename, std::size_t bufferSize = 1 << 16);
+
+        QueryRecorder(const QueryRecorder&) = delete;
+        QueryRecorder& operator=(const QueryRecorder&) = delete;
+
+        /**
+         * @brief Flushes any buffered records and closes the trace file.
+         */
+        ~QueryRecorder();
+
+        /**
+         * @brief Appends a query to the trace.
+         * @param kind The kind of query.
+         * @param index The queried index vector.
+         */
+        void record(QueryKind kind, const FloatIndexVector& index);
+
+        /**
+         * @brief Writes all buffered records to disk.
+         */
+        void flush();
+
+        /**
+         * @brief Gets the number of records written so far (including buffered records).
+         * @return The number of records.
+         */
+        [[nodiscard]] uint64_t count() const;
+
+    private:
+        void flushUnlocked();
+
+        mutable std::mutex m_mutex; ///< Guards the buffer and the output stream.
+        std::ofstream m_file; ///< Output stream for the trace.
+        std::vector<char> m_buffer; ///< Pending, not yet written, records.
+        std::size_t m_bufferSize; ///< Flush threshold in bytes.
+        uint64_t m_count = 0; ///< Number of records recorded.
+        std::chrono::steady_clock::time_point m_start; ///< Reference point for record timestamps.
+    };
+
+    /**
+     * @brief Reads every record from a trace file.
+     * @param filename Path to the trace file.
+     * @return The records in the order they were recorded.
+     * @throws std::runtime_error if the file cannot be opened, has an invalid header, or is truncated.
+     *
+     * **Example:**
+     * @code
+     * for (const auto& rec : opat::trace::readTrace("queries.optr")) {
+     *     std::cout << static_cast<int>(rec.kind) << " " << rec.index.size() << std::endl;
+     * }
+     * @endcode
+     */
+    std::vector<TraceRecord> readTrace(const std::string& filename);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opatIO.h"
+
+/**
+ * @brief Namespace for resampling tables onto common axes.
+ *
+ * `lattice::TableLattice` blends the tables of the corners of a simplex value by value, which is only
+ * meaningful when the tables of a tag have the same rows and columns in every card. Files whose cards
+ * were computed on different grids are harmonized by resampling each such tag onto one set of axes,
+ * once, rather than on every query: either in memory at load time (`regrid`), or ahead of time with the
+ * `opatRegrid` tool, which writes the regridded file to be read in place of the original.
+ *
+ * **Example:**
+ * @code
+ * opat::OPAT opat = opat::readOPAT("mixed.opat");
+ * if (!opat::regrid::sharesAxes(opat, "data")) {
+ *     opat = opat::regrid::regrid(opat, {{"data", opat::regrid::commonAxes(opat, "data")}});
+ * }
+ * opat::lattice::TableLattice lattice(opat);
+ * @endcode
+ */
+namespace opat::regrid {
+
+    /**
+     * @brief The row and column values of a table.
+     */
+    struct Axes {
+        std::vector<double> rows;    ///< Row values.
+        std::vector<double> columns; ///< Column values.
+
+        bool operator==(const Axes&) const = default;
+    };
+
+    /**
+     * @brief Which values `commonAxes` keeps.
+     */
+    enum class AxisPolicy {
+        Overlap, ///< The values of every card within the range all of them cover, so that no value is extrapolated.
+        Union    ///< The values of every card; resampled tables are NaN where their card does not reach.
+    };
+
+    /**
+     * @brief The axes of `table`.
+     */
+    [[nodiscard]] Axes axesOf(const OPATTable& table);
+
+    /**
+     * @brief Whether the tables tagged `tag` have the same shape and axes in every card of `opat`.
+     *
+     * The tables of lazily loaded cards are read to compare them.
+     * @throws std::invalid_argument if a card has no table tagged `tag`.
+     */
+    [[nodiscard]] bool sharesAxes(const OPAT& opat, const std::string& tag);
+
+    /**
+     * @brief Axes onto which the tables tagged `tag` of every card of `opat` can be resampled.
+     *
+     * An axis which every card shares is returned as it is stored. The values of an axis which differs
+     * between cards are merged and sorted, so it must be ascending in every card to be resampled.
+     * @param opat The OPAT whose tables to harmonize.
+     * @param tag The tag of the tables.
+     * @param policy Whether to keep only the range every card covers, or every value.
+     * @throws std::invalid_argument if a card has no table tagged `tag`, or the cards have no rows or
+     *         columns in common range.
+     */
+    [[nodiscard]] Axes commonAxes(const OPAT& opat, const std::string& tag, AxisPolicy policy = AxisPolicy::Overlap);
+
+    /**
+     * @brief `table` resampled onto `axes` by bilinear interpolation of each cell value.
+     *
+     * Values at rows and columns of `table` are copied exactly; values outside its axes are NaN. An axis
+     * which `axes` leaves as it is, is taken as it is; the others are interpolated along.
+     * @throws std::invalid_argument if an axis to interpolate along is empty or not strictly ascending,
+     *         in `table` or in `axes`.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPATTable fine = opat::regrid::resample(table, {rows, columns});
+     * @endcode
+     */
+    [[nodiscard]] OPATTable resample(const OPATTable& table, const Axes& axes);
+
+    /**
+     * @brief An in-memory copy of `opat` whose tables tagged with the keys of `axes` are resampled onto them.
+     *
+     * Cards are resampled in parallel; other tables are copied as they are. The index entries and
+     * statistics of resampled tables describe their new shape, while checksums, card and file roots and
+     * catalog digests are cleared since they no longer match the data (`writeOPAT` records new ones).
+     * @param opat The OPAT to regrid; lazily loaded cards are read.
+     * @param axes The axes to resample each tag onto.
+     * @param threads Number of threads to resample with; 0 uses one per hardware thread.
+     * @throws std::invalid_argument if a card has no table with one of the tags, or as `resample`.
+     * @throws std::length_error if an axis of `axes` has more values than a table index entry can store (65535).
+     */
+    [[nodiscard]] OPAT regrid(const OPAT& opat, const std::unordered_map<std::string, Axes>& axes, unsigned threads = 0);
+
+}
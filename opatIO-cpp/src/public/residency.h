@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+
+#include "opatIO.h"
+
+namespace opat::memory {
+
+    /**
+     * @brief What `applyResidency` asks of the kernel for the pages of each table.
+     */
+    struct ResidencyOptions {
+        bool hugePages = false; ///< Back tables with transparent huge pages (`madvise(MADV_HUGEPAGE)`, then a synchronous `MADV_COLLAPSE` where the kernel supports it).
+        bool lock = false;      ///< `mlock` tables so they cannot be swapped out. Limited by `RLIMIT_MEMLOCK` unless the process has `CAP_IPC_LOCK`.
+    };
+
+    /**
+     * @brief How the table payloads of an OPAT are backed, as reported by `residencyStats`.
+     *
+     * Huge-page and locked figures are taken from `/proc/self/smaps`, which reports them per mapping;
+     * where a mapping holds more than tables they are attributed to the tables first, so they are
+     * upper bounds.
+     */
+    struct ResidencyStats {
+        std::size_t tableBytes = 0;          ///< Bytes of table payloads (row values, column values and data).
+        std::size_t hugePageEligibleBytes = 0; ///< Bytes of the whole, aligned huge pages which fit inside the tables. Only these can be backed by huge pages.
+        std::size_t hugePageBytes = 0;       ///< Bytes of the tables backed by huge pages.
+        std::size_t lockedBytes = 0;         ///< Bytes of the tables locked in memory.
+
+        /**
+         * @brief Fraction of table bytes backed by huge pages (0 when there are no tables).
+         */
+        [[nodiscard]] double hugePageCoverage() const {
+            return tableBytes == 0 ? 0.0 : static_cast<double>(hugePageBytes) / static_cast<double>(tableBytes);
+        }
+    };
+
+    /**
+     * @brief Requests huge pages for and/or locks the tables of the eagerly loaded cards of `opat`.
+     *
+     * The lattice blend sweeps whole tables, so on large tables most of its time goes to TLB misses
+     * with 4 KiB pages. Only tables spanning at least one whole, aligned huge page benefit; smaller ones
+     * are left alone. Requests are best effort: failures (huge pages disabled, memlock limit reached)
+     * are not errors, and the returned statistics show what was achieved.
+     *
+     * Lazily loaded cards are not covered, since they are evicted and reloaded under the memory budget.
+     * Locked tables stay locked until `unlockTables` is called, or for tables allocated from the heap
+     * rather than their own mapping, until those pages are reused.
+     * @return The residency of the tables after the requests.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPAT opat = opat::readOPAT("big.opat");
+     * const auto stats = opat::memory::applyResidency(opat, {.hugePages = true, .lock = true});
+     * std::cout << stats.hugePageCoverage() * 100 << "% of table bytes on huge pages" << std::endl;
+     * @endcode
+     */
+    ResidencyStats applyResidency(const OPAT& opat, const ResidencyOptions& options);
+
+    /**
+     * @brief Reports how the tables of the eagerly loaded cards of `opat` are currently backed.
+     */
+    [[nodiscard]] ResidencyStats residencyStats(const OPAT& opat);
+
+    /**
+     * @brief Unlocks the tables of the eagerly loaded cards of `opat` (see `applyResidency`).
+     */
+    void unlockTables(const OPAT& opat);
+
+}
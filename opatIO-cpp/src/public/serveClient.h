@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "opatIO.h"
+#include "serveProtocol.h"
+
+namespace opat::serve {
+
+    /**
+     * @brief Description of a file served by opatServe.
+     */
+    struct ServedFileInfo {
+        std::string filename;   ///< Path of the file on the server.
+        uint32_t numCards;      ///< Number of cards in the file.
+        uint16_t numIndex;      ///< Dimension of the file's index vectors.
+        uint8_t hashPrecision;  ///< Hash precision of the file's index vectors.
+    };
+
+    /**
+     * @brief The result of one query point.
+     */
+    struct QueryResult {
+        Status status = Status::Failed; ///< Whether the point could be answered.
+        std::string error;              ///< Error reported by the server if `status` is not `Status::Ok`.
+        OPATTable table;                ///< The requested table if `status` is `Status::Ok`.
+
+        [[nodiscard]] bool ok() const { return status == Status::Ok; }
+    };
+
+    /**
+     * @brief Client for an opatServe daemon.
+     *
+     * A client holds one connection; requests on a connection are answered in order. A Client is not
+     * thread-safe, but any number of clients (in any number of processes) may talk to one server.
+     *
+     * **Example:**
+     * @code
+     * opat::serve::Client client(opat::serve::defaultSocketPath());
+     * std::vector<std::vector<double>> points = {{0.275, 0.07}, {0.54421, 0.077585}};
+     * for (const auto& result : client.interpolate(0, "data", points)) {
+     *     if (result.ok()) {
+     *         std::cout << result.table.getData(5, 35, 0) << std::endl;
+     *     } else {
+     *         std::cerr << result.error << std::endl;
+     *     }
+     * }
+     * @endcode
+     */
+    class Client {
+    public:
+        /**
+         * @brief Connects to the server listening on `socketPath`.
+         * @throws std::invalid_argument if the path is too long for a Unix socket address.
+         * @throws std::runtime_error if the connection fails.
+         */
+        explicit Client(const std::string& socketPath);
+
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+        Client(Client&& other) noexcept;
+        Client& operator=(Client&& other) noexcept;
+        ~Client();
+
+        /**
+         * @brief Lists the files served, in file ID order.
+         * @throws std::runtime_error if the request fails.
+         */
+        [[nodiscard]] std::vector<ServedFileInfo> info();
+
+        /**
+         * @brief Looks up table `tag` in the cards at `points` (which must be index vectors of cards in the file).
+         * @param fileID Index of the file in the server's file list.
+         * @param tag Tag of the table to return.
+         * @param points Query points; each must have the file's `numIndex` entries.
+         * @return One result per point, in order. Points which could not be answered carry an error.
+         * @throws std::runtime_error if the request as a whole is rejected or the connection fails.
+         */
+        [[nodiscard]] std::vector<QueryResult> get(uint32_t fileID, const std::string& tag, const std::vector<std::vector<double>>& points);
+
+        /**
+         * @brief Interpolates table `tag` at `points`.
+         * @see get
+         */
+        [[nodiscard]] std::vector<QueryResult> interpolate(uint32_t fileID, const std::string& tag, const std::vector<std::vector<double>>& points);
+
+        /**
+         * @brief Sends a batched request for `numPoints` points stored row-major in `points`.
+         *
+         * This is the primitive behind `get` and `interpolate`, for callers which already hold their
+         * points in a flat array.
+         * @throws std::invalid_argument if `op` is `Op::Info` or the batch is too large.
+         * @throws std::runtime_error if the request as a whole is rejected or the connection fails.
+         */
+        [[nodiscard]] std::vector<QueryResult> query(Op op, uint32_t fileID, const std::string& tag,
+                                                     const double* points, std::size_t numPoints, std::size_t numIndex);
+
+    private:
+        ResponseHeader request(Op op, uint32_t fileID, const std::string& tag,
+                               const double* points, std::size_t numPoints, std::size_t numIndex);
+
+        int m_fd = -1;
+    };
+
+}
@@ -0,0 +1,114 @@
+/**
+ * @file serveClientC.h
+ * @brief C API for querying an opatServe daemon.
+ *
+ * This header is valid C and C++. It wraps `opat::serve::Client` (serveClient.h) behind an opaque
+ * handle. Results of the most recent request are kept inside the handle and remain valid until the
+ * next request on the same handle or until it is closed.
+ *
+ * All functions returning `int` return 0 on success and -1 on failure, in which case
+ * `opat_client_last_error` describes the failure.
+ *
+ * **Example:**
+ * @code
+ * opat_client* client = opat_client_connect("/tmp/opatServe.sock");
+ * double points[] = {0.275, 0.07, 0.54421, 0.077585};
+ * if (opat_client_interpolate(client, 0, "data", points, 2, 2) == 0) {
+ *     for (size_t i = 0; i < opat_client_num_results(client); ++i) {
+ *         uint32_t n_r, n_c, vsize;
+ *         const double* data = opat_client_result_data(client, i, &n_r, &n_c, &vsize);
+ *         if (data == NULL) {
+ *             fprintf(stderr, "%s\n", opat_client_result_error(client, i));
+ *         }
+ *     }
+ * }
+ * opat_client_close(client);
+ * @endcode
+ */
+
+#ifndef OPAT_SERVE_CLIENT_C_H
+#define OPAT_SERVE_CLIENT_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Result status codes; these mirror opat::serve::Status. */
+#define OPAT_SERVE_OK 0
+#define OPAT_SERVE_BAD_REQUEST 1
+#define OPAT_SERVE_NOT_FOUND 2
+#define OPAT_SERVE_OUT_OF_RANGE 3
+#define OPAT_SERVE_FAILED 4
+
+/** Opaque connection handle. */
+typedef struct opat_client opat_client;
+
+/**
+ * @brief Connects to an opatServe daemon.
+ * @param socket_path Path of the daemon's Unix socket, or NULL for the default path.
+ * @param error_out Optional buffer receiving an error message if the connection fails.
+ * @param error_size Size of `error_out` in bytes.
+ * @return A new handle, or NULL on failure.
+ */
+opat_client* opat_client_connect(const char* socket_path, char* error_out, size_t error_size);
+
+/**
+ * @brief Closes the connection and frees the handle. Accepts NULL.
+ */
+void opat_client_close(opat_client* client);
+
+/**
+ * @brief Describes the last failure on this handle (empty if there was none).
+ */
+const char* opat_client_last_error(const opat_client* client);
+
+/**
+ * @brief Looks up table `tag` in the cards at `num_points` index vectors stored row-major in `points`.
+ * @return 0 if the request was answered (individual points may still have failed), -1 otherwise.
+ */
+int opat_client_get(opat_client* client, uint32_t file_id, const char* tag,
+                    const double* points, size_t num_points, size_t num_index);
+
+/**
+ * @brief Interpolates table `tag` at `num_points` points stored row-major in `points`.
+ * @return 0 if the request was answered (individual points may still have failed), -1 otherwise.
+ */
+int opat_client_interpolate(opat_client* client, uint32_t file_id, const char* tag,
+                            const double* points, size_t num_points, size_t num_index);
+
+/**
+ * @brief Number of results held from the last request.
+ */
+size_t opat_client_num_results(const opat_client* client);
+
+/**
+ * @brief Status (one of the OPAT_SERVE_* codes) of result `i`, or -1 if `i` is out of range.
+ */
+int opat_client_result_status(const opat_client* client, size_t i);
+
+/**
+ * @brief Error message of result `i`, or an empty string if it succeeded.
+ */
+const char* opat_client_result_error(const opat_client* client, size_t i);
+
+/**
+ * @brief Table data of result `i` (row-major, `n_r * n_c * vsize` values).
+ * @param n_r, n_c, vsize Optional outputs receiving the shape of the table.
+ * @return A pointer to the data, or NULL if the result failed or `i` is out of range.
+ */
+const double* opat_client_result_data(const opat_client* client, size_t i, uint32_t* n_r, uint32_t* n_c, uint32_t* vsize);
+
+/**
+ * @brief Row and column values of result `i`.
+ * @return 0 on success, -1 if the result failed or `i` is out of range.
+ */
+int opat_client_result_axes(const opat_client* client, size_t i, const double** row_values, const double** column_values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Namespace for the opatServe local query service.
+ *
+ * opatServe keeps OPAT files and their lattices resident in a long-running process and answers
+ * batched card lookups and interpolations over a Unix domain socket. Short-lived scripts then pay
+ * for a `connect` rather than for `readOPAT` and the Delaunay triangulation.
+ *
+ * **Wire protocol.** Every exchange is a single request followed by a single response. Since the
+ * service only listens on a Unix socket, client and server always run on the same machine and all
+ * values are sent in native byte order.
+ *
+ * A request is a `RequestHeader` followed by `tagLength` bytes of table tag and
+ * `numPoints * numIndex` doubles (the query points, row-major).
+ *
+ * A response is a `ResponseHeader` followed by `payloadSize` bytes:
+ * - If `status` is not `Status::Ok` the payload is an error message.
+ * - For `Op::Info` the payload holds `numResults` `FileInfo` records, each followed by `nameLength`
+ *   bytes of file name.
+ * - For `Op::Get` and `Op::Interpolate` the payload holds one result per query point, in order.
+ *   Each result is a `ResultHeader` followed, if its status is `Status::Ok`, by `N_R` row values,
+ *   `N_C` column values and `N_R * N_C * vsize` table values (all doubles); otherwise by
+ *   `messageLength` bytes of error message.
+ */
+namespace opat::serve {
+
+    constexpr uint16_t PROTOCOL_VERSION = 1; ///< Version of the wire protocol described above.
+    constexpr uint64_t MAX_REQUEST_VALUES = uint64_t{1} << 24; ///< Upper limit on `numPoints * numIndex` per request.
+
+    /**
+     * @brief Operation requested by a client.
+     */
+    enum class Op : uint16_t {
+        Info = 0,       ///< Describe the files being served.
+        Get = 1,        ///< Look up tables of cards stored in the file (`OPAT::get`).
+        Interpolate = 2 ///< Interpolate tables at arbitrary points (`TableLattice::get`).
+    };
+
+    /**
+     * @brief Status of a response or of a single result within it.
+     */
+    enum class Status : uint16_t {
+        Ok = 0,         ///< Success.
+        BadRequest = 1, ///< The request was malformed (bad magic, unknown file, wrong dimension, ...).
+        NotFound = 2,   ///< No card exists at the requested index, or the card has no such tag.
+        OutOfRange = 3, ///< The point lies outside the region covered by the lattice.
+        Failed = 4      ///< Any other server-side error.
+    };
+
+#pragma pack(1)
+    /**
+     * @brief Header of every request.
+     */
+    struct RequestHeader {
+        char magic[4];      ///< Always "OPSQ".
+        uint16_t version;   ///< PROTOCOL_VERSION.
+        uint16_t op;        ///< An `Op`.
+        uint32_t fileID;    ///< Index of the file in the server's file list (ignored by `Op::Info`).
+        uint32_t numPoints; ///< Number of query points.
+        uint16_t numIndex;  ///< Dimension of each query point.
+        uint16_t tagLength; ///< Length of the table tag in bytes.
+        char reserved[8];   ///< Reserved for future use.
+    };
+
+    /**
+     * @brief Header of every response.
+     */
+    struct ResponseHeader {
+        char magic[4];        ///< Always "OPSR".
+        uint16_t status;      ///< A `Status` for the request as a whole.
+        uint16_t reserved;    ///< Reserved for future use.
+        uint32_t numResults;  ///< Number of results (or file records) in the payload.
+        uint64_t payloadSize; ///< Size of the payload in bytes.
+    };
+
+    /**
+     * @brief Description of one served file, sent in reply to `Op::Info`.
+     */
+    struct FileInfo {
+        uint32_t numCards;      ///< Number of cards in the file.
+        uint16_t numIndex;      ///< Dimension of the file's index vectors.
+        uint8_t hashPrecision;  ///< Hash precision of the file's index vectors.
+        uint8_t reserved;       ///< Reserved for future use.
+        uint32_t nameLength;    ///< Length of the file name that follows, in bytes.
+    };
+
+    /**
+     * @brief Header of the result for one query point.
+     */
+    struct ResultHeader {
+        uint16_t status;        ///< A `Status` for this point.
+        uint16_t reserved;      ///< Reserved for future use.
+        uint32_t N_R;           ///< Number of rows of the table.
+        uint32_t N_C;           ///< Number of columns of the table.
+        uint32_t vsize;         ///< Vector size of each cell.
+        uint32_t messageLength; ///< Length of the error message, if `status` is not `Status::Ok`.
+    };
+#pragma pack()
+
+    /**
+     * @brief Reads exactly `size` bytes from a socket, retrying short reads.
+     * @throws std::runtime_error if the peer closes the connection or the read fails.
+     */
+    void readExact(int fd, void* buffer, std::size_t size);
+
+    /**
+     * @brief Writes exactly `size` bytes to a socket, retrying short writes.
+     * @throws std::runtime_error if the write fails.
+     */
+    void writeExact(int fd, const void* buffer, std::size_t size);
+
+    /**
+     * @brief Socket path used when none is given: `$XDG_RUNTIME_DIR/opatServe.sock`, or `/tmp/opatServe.sock`.
+     */
+    std::string defaultSocketPath();
+
+}
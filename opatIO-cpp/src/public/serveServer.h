@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "opatIO.h"
+#include "serveProtocol.h"
+
+namespace opat::serve {
+
+    /**
+     * @brief Serves card lookups and interpolations for a set of resident OPAT files over a Unix socket.
+     *
+     * Files are read when the server is constructed. The lattice of a file is built the first time a
+     * client interpolates in it and is then kept for the lifetime of the server. Each connection is
+     * handled on its own thread with its own copy of every lattice it uses, so clients never contend
+     * on the lattice's simplex cache.
+     *
+     * The protocol is described in serveProtocol.h; `Client` (serveClient.h) and the C API in
+     * serveClientC.h implement its client side.
+     *
+     * **Example:**
+     * @code
+     * opat::serve::Server server({"gs98hz.opat"});
+     * server.listen("/tmp/opatServe.sock");
+     * std::thread worker([&] { server.run(); });
+     * // ...
+     * server.stop();
+     * worker.join();
+     * @endcode
+     */
+    class Server {
+    public:
+        /**
+         * @brief Reads the files to be served. File IDs in requests index into `filenames`.
+         * @param filenames Paths to the OPAT files to serve.
+         * @param mode Load mode used for every file.
+         * @throws std::runtime_error if a file cannot be read.
+         */
+        explicit Server(const std::vector<std::string>& filenames, LoadMode mode = LoadMode::Eager);
+
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+        Server(Server&&) = delete;
+        Server& operator=(Server&&) = delete;
+
+        /**
+         * @brief Stops the server and removes its socket file.
+         */
+        ~Server();
+
+        /**
+         * @brief Binds the server to a Unix socket. Any stale socket file at `socketPath` is replaced.
+         * @throws std::invalid_argument if the path is too long for a Unix socket address.
+         * @throws std::runtime_error if the socket cannot be created or bound.
+         */
+        void listen(const std::string& socketPath);
+
+        /**
+         * @brief Accepts and serves connections until `stop` is called.
+         *
+         * Returns once every connection thread has finished. Running out of file descriptors or memory
+         * pauses accepting (with backoff) until connections close, rather than ending the server.
+         * @throws std::logic_error if `listen` has not been called.
+         * @throws std::runtime_error if accepting a connection fails for any other reason; the server is
+         *         stopped, and open connections have finished, before it is thrown.
+         */
+        void run();
+
+        /**
+         * @brief Stops accepting connections and closes open ones. Safe to call from any thread.
+         */
+        void stop();
+
+        /**
+         * @brief Number of files being served.
+         */
+        [[nodiscard]] std::size_t numFiles() const { return m_files.size(); }
+
+    private:
+        struct ServedFile;
+
+        void serveConnection(int fd);
+
+        std::vector<std::unique_ptr<ServedFile>> m_files;
+        std::string m_socketPath;
+        int m_listenFd = -1;
+        std::atomic<bool> m_stopping{false};
+        std::mutex m_connectionsMutex;
+        std::unordered_set<int> m_connections; ///< Sockets of the connections currently being served.
+        std::condition_variable m_connectionsDrained;
+    };
+
+}
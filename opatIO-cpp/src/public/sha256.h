@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+
+/**
+ * @brief Namespace for the SHA-256 digests of cards recorded in the card catalog.
+ *
+ * The digest of a table is the SHA-256 of its data (not its axes) as little-endian doubles; the digest
+ * of a card is the SHA-256 of the digests of its tables, concatenated in the order the tables are
+ * stored. This is what opatio records in the catalog.
+ *
+ * Hashing runs on the fastest backend the CPU supports, chosen at runtime: the SHA extensions
+ * (SHA-NI) where present, otherwise AVX2, which hashes eight messages at once in the lanes of its
+ * registers, otherwise the portable picosha2. All backends give the same digests.
+ */
+namespace opat::sha256 {
+
+    using Digest = std::array<uint8_t, 32>;
+
+    /**
+     * @brief Implementations of SHA-256.
+     */
+    enum class Backend {
+        Portable, ///< picosha2, on any CPU.
+        ShaNi,    ///< The x86 SHA extensions, one message at a time.
+        Avx2      ///< AVX2, eight messages at a time.
+    };
+
+    /**
+     * @brief Whether this CPU (and OS) can run `backend`.
+     */
+    [[nodiscard]] bool supported(Backend backend);
+
+    /**
+     * @brief The fastest backend this CPU supports: SHA-NI, then AVX2, then portable.
+     */
+    [[nodiscard]] Backend fastest();
+
+    /**
+     * @brief Name of `backend` ("portable", "sha-ni" or "avx2").
+     */
+    [[nodiscard]] std::string_view name(Backend backend);
+
+    /**
+     * @brief SHA-256 of `size` bytes at `data`.
+     * @throws std::invalid_argument if this CPU does not support `backend`.
+     */
+    [[nodiscard]] Digest hash(const void* data, std::size_t size, Backend backend = fastest());
+
+    /**
+     * @brief SHA-256 of each of `messages`, in order.
+     *
+     * Independent messages are what the AVX2 backend needs to fill its lanes, so hashing many messages
+     * in one call is much faster there than hashing them one by one; messages of similar length batch
+     * best.
+     * @throws std::invalid_argument if this CPU does not support `backend`.
+     *
+     * **Example:**
+     * @code
+     * std::vector<std::span<const uint8_t>> messages = ...;
+     * const std::vector<opat::sha256::Digest> digests = opat::sha256::hashMany(messages);
+     * @endcode
+     */
+    [[nodiscard]] std::vector<Digest> hashMany(std::span<const std::span<const uint8_t>> messages, Backend backend = fastest());
+
+    /**
+     * @brief The digest of a card, as recorded in its card catalog entry.
+     * @throws std::invalid_argument if this CPU does not support `backend`.
+     */
+    [[nodiscard]] Digest cardDigest(const DataCard& card, Backend backend = fastest());
+
+    /**
+     * @brief Checks the digest of every card of `opat` against its card catalog entry.
+     *
+     * Cards are hashed in parallel, in batches whose tables are hashed together, so that the AVX2
+     * backend hashes tables of several cards at once. Cards whose catalog entry has no digest (all
+     * zeros) are skipped. The tables of lazily loaded cards are read as they are hashed, without
+     * pinning the cards.
+     * @param opat The OPAT to check.
+     * @param backend The backend to hash with.
+     * @param threads Number of threads to hash with; 0 uses one per hardware thread.
+     * @return The cards whose digest does not match their catalog entry, in the order they are stored.
+     * @throws std::invalid_argument if this CPU does not support `backend`.
+     * @throws std::runtime_error if a card cannot be read, for example when one of its tables fails its
+     *         checksum. The other threads stop at their next batch, and the first error is rethrown.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPAT opat = opat::readOPAT("gs98hz.opat", opat::LoadMode::Lazy);
+     * if (!opat::sha256::verify(opat).empty()) {
+     *     std::cerr << "Catalog digests do not match" << std::endl;
+     * }
+     * @endcode
+     */
+    [[nodiscard]] std::vector<FloatIndexVector> verify(const OPAT& opat, Backend backend = fastest(), unsigned threads = 0);
+
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "opatIO.h"
+
+/**
+ * @brief Namespace for lazy arithmetic on tables.
+ *
+ * Arithmetic operators and the functions below, applied to tables, scalars and other expressions, build
+ * an expression rather than computing anything. `evaluate` then computes every value of the result in a
+ * single pass over the tables, without intermediate tables, in a loop the compiler can vectorize, and
+ * optionally across threads. Tables may come from different tags and cards but must have the same shape
+ * and axes, which is checked once per evaluation.
+ *
+ * Expressions hold references to the tables they were built from, which must outlive them. Bring the
+ * operators into scope with `using namespace opat::expr;` to apply them to tables directly.
+ *
+ * **Example:**
+ * @code
+ * using namespace opat::expr;
+ * const opat::OPATTable& t1 = opat.get(FloatIndexVector({0.35, 0.004}))["data"];
+ * const opat::OPATTable& t2 = opat.get(FloatIndexVector({0.35, 0.006}))["data"];
+ * opat::OPATTable mixed = evaluate(0.3 * t1 + 0.7 * log(t2));
+ * @endcode
+ */
+namespace opat::expr {
+
+    /**
+     * @brief A table as a leaf of an expression.
+     */
+    class Table {
+    public:
+        explicit Table(const OPATTable& table) : m_table(&table), m_data(table.data.get()) {}
+
+        [[nodiscard]] double operator[](std::size_t i) const { return m_data[i]; }
+
+        template <typename F>
+        void forEachTable(F&& f) const { f(*m_table); }
+
+    private:
+        const OPATTable* m_table;
+        const double* m_data;
+    };
+
+    /**
+     * @brief A constant as a leaf of an expression.
+     */
+    class Scalar {
+    public:
+        explicit Scalar(double value) : m_value(value) {}
+
+        [[nodiscard]] double operator[](std::size_t) const { return m_value; }
+
+        template <typename F>
+        void forEachTable(F&&) const {}
+
+    private:
+        double m_value;
+    };
+
+    /**
+     * @brief `Op` applied to each value of an expression.
+     */
+    template <typename Op, typename E>
+    class Unary {
+    public:
+        Unary(E operand, Op op = {}) : m_operand(std::move(operand)), m_op(op) {}
+
+        [[nodiscard]] double operator[](std::size_t i) const { return m_op(m_operand[i]); }
+
+        template <typename F>
+        void forEachTable(F&& f) const { m_operand.forEachTable(f); }
+
+    private:
+        E m_operand;
+        Op m_op;
+    };
+
+    /**
+     * @brief `Op` applied to the values of two expressions, element by element.
+     */
+    template <typename Op, typename L, typename R>
+    class Binary {
+    public:
+        Binary(L left, R right) : m_left(std::move(left)), m_right(std::move(right)) {}
+
+        [[nodiscard]] double operator[](std::size_t i) const { return Op{}(m_left[i], m_right[i]); }
+
+        template <typename F>
+        void forEachTable(F&& f) const {
+            m_left.forEachTable(f);
+            m_right.forEachTable(f);
+        }
+
+    private:
+        L m_left;
+        R m_right;
+    };
+
+    template <typename T>
+    struct IsExpression : std::false_type {};
+    template <>
+    struct IsExpression<Table> : std::true_type {};
+    template <>
+    struct IsExpression<Scalar> : std::true_type {};
+    template <typename Op, typename E>
+    struct IsExpression<Unary<Op, E>> : std::true_type {};
+    template <typename Op, typename L, typename R>
+    struct IsExpression<Binary<Op, L, R>> : std::true_type {};
+
+    /**
+     * @brief An expression node (see `Table`, `Scalar`, `Unary` and `Binary`).
+     */
+    template <typename T>
+    concept Expression = IsExpression<std::remove_cvref_t<T>>::value;
+
+    /**
+     * @brief Anything an operator accepts: an expression, a table or a number.
+     */
+    template <typename T>
+    concept Operand = Expression<T> || std::same_as<std::remove_cvref_t<T>, OPATTable> || std::is_arithmetic_v<std::remove_cvref_t<T>>;
+
+    /**
+     * @brief The expression node for an operand.
+     */
+    template <Operand T>
+    [[nodiscard]] auto node(const T& operand) {
+        if constexpr (Expression<T>) {
+            return operand;
+        } else if constexpr (std::same_as<T, OPATTable>) {
+            return Table(operand);
+        } else {
+            return Scalar(static_cast<double>(operand));
+        }
+    }
+
+    /**
+     * @brief Whether two operands make an expression: at least one must not be a number.
+     */
+    template <typename L, typename R>
+    concept Operands = Operand<L> && Operand<R> && !(std::is_arithmetic_v<std::remove_cvref_t<L>> && std::is_arithmetic_v<std::remove_cvref_t<R>>);
+
+    namespace ops {
+        struct Negate { double operator()(double x) const { return -x; } };
+        struct Log { double operator()(double x) const { return std::log(x); } };
+        struct Log10 { double operator()(double x) const { return std::log10(x); } };
+        struct Exp { double operator()(double x) const { return std::exp(x); } };
+        struct Exp10 { double operator()(double x) const { return std::pow(10.0, x); } };
+        struct Sqrt { double operator()(double x) const { return std::sqrt(x); } };
+        struct Abs { double operator()(double x) const { return std::fabs(x); } };
+        struct Pow { double exponent; double operator()(double x) const { return std::pow(x, exponent); } };
+        struct Plus { double operator()(double a, double b) const { return a + b; } };
+        struct Minus { double operator()(double a, double b) const { return a - b; } };
+        struct Multiplies { double operator()(double a, double b) const { return a * b; } };
+        struct Divides { double operator()(double a, double b) const { return a / b; } };
+        struct Min { double operator()(double a, double b) const { return std::fmin(a, b); } };
+        struct Max { double operator()(double a, double b) const { return std::fmax(a, b); } };
+    }
+
+    template <typename L, typename R> requires Operands<L, R>
+    [[nodiscard]] auto operator+(const L& left, const R& right) { return Binary<ops::Plus, decltype(node(left)), decltype(node(right))>(node(left), node(right)); }
+
+    template <typename L, typename R> requires Operands<L, R>
+    [[nodiscard]] auto operator-(const L& left, const R& right) { return Binary<ops::Minus, decltype(node(left)), decltype(node(right))>(node(left), node(right)); }
+
+    template <typename L, typename R> requires Operands<L, R>
+    [[nodiscard]] auto operator*(const L& left, const R& right) { return Binary<ops::Multiplies, decltype(node(left)), decltype(node(right))>(node(left), node(right)); }
+
+    template <typename L, typename R> requires Operands<L, R>
+    [[nodiscard]] auto operator/(const L& left, const R& right) { return Binary<ops::Divides, decltype(node(left)), decltype(node(right))>(node(left), node(right)); }
+
+    /**
+     * @brief The smaller of two operands, element by element (ignoring NaN, as `std::fmin`).
+     */
+    template <typename L, typename R> requires Operands<L, R>
+    [[nodiscard]] auto min(const L& left, const R& right) { return Binary<ops::Min, decltype(node(left)), decltype(node(right))>(node(left), node(right)); }
+
+    /**
+     * @brief The larger of two operands, element by element (ignoring NaN, as `std::fmax`).
+     */
+    template <typename L, typename R> requires Operands<L, R>
+    [[nodiscard]] auto max(const L& left, const R& right) { return Binary<ops::Max, decltype(node(left)), decltype(node(right))>(node(left), node(right)); }
+
+    template <typename E> requires (Operand<E> && !std::is_arithmetic_v<E>)
+    [[nodiscard]] auto operator-(const E& operand) { return Unary<ops::Negate, decltype(node(operand))>(node(operand)); }
+
+    template <typename E> requires (Operand<E> && !std::is_arithmetic_v<E>)
+    [[nodiscard]] auto log(const E& operand) { return Unary<ops::Log, decltype(node(operand))>(node(operand)); }
+
+    template <typename E> requires (Operand<E> && !std::is_arithmetic_v<E>)
+    [[nodiscard]] auto log10(const E& operand) { return Unary<ops::Log10, decltype(node(operand))>(node(operand)); }
+
+    template <typename E> requires (Operand<E> && !std::is_arithmetic_v<E>)
+    [[nodiscard]] auto exp(const E& operand) { return Unary<ops::Exp, decltype(node(operand))>(node(operand)); }
+
+    /**
+     * @brief 10 to the power of each value, the inverse of `log10` (tables are commonly stored as log10).
+     */
+    template <typename E> requires (Operand<E> && !std::is_arithmetic_v<E>)
+    [[nodiscard]] auto exp10(const E& operand) { return Unary<ops::Exp10, decltype(node(operand))>(node(operand)); }
+
+    template <typename E> requires (Operand<E> && !std::is_arithmetic_v<E>)
+    [[nodiscard]] auto sqrt(const E& operand) { return Unary<ops::Sqrt, decltype(node(operand))>(node(operand)); }
+
+    template <typename E> requires (Operand<E> && !std::is_arithmetic_v<E>)
+    [[nodiscard]] auto abs(const E& operand) { return Unary<ops::Abs, decltype(node(operand))>(node(operand)); }
+
+    template <typename E> requires (Operand<E> && !std::is_arithmetic_v<E>)
+    [[nodiscard]] auto pow(const E& operand, double exponent) {
+        return Unary<ops::Pow, decltype(node(operand))>(node(operand), ops::Pow{exponent});
+    }
+
+    /**
+     * @brief Checks that `tables` all have the shape and axes of the first one.
+     * @throws std::invalid_argument if `tables` is empty, or any table differs from the first in its number
+     *         of rows, columns or cell values, or in its row or column values.
+     */
+    void checkShapes(const std::vector<const OPATTable*>& tables);
+
+    /**
+     * @brief A table with the shape and axes of `like` and uninitialized data.
+     */
+    [[nodiscard]] OPATTable allocateLike(const OPATTable& like);
+
+    /**
+     * @brief Runs `chunk(begin, end)` over [0, `count`) split across `threads` threads (0 for one per hardware thread).
+     */
+    void parallelFor(std::size_t count, unsigned threads, const std::function<void(std::size_t, std::size_t)>& chunk);
+
+    /**
+     * @brief Evaluates `expression` into `output`, which must have the shape of its tables.
+     *
+     * Shapes and axes are checked once; then every value is computed in one pass. `output` may be one of
+     * the expression's tables, since each value only depends on the values at the same position.
+     * @param expression The expression to evaluate; must contain at least one table.
+     * @param output The table to write to.
+     * @param threads Number of threads to evaluate with; 0 uses one per hardware thread.
+     * @throws std::invalid_argument if the tables of the expression, or `output`, differ in shape or axes.
+     */
+    template <Expression E>
+    void evaluateInto(const E& expression, OPATTable& output, unsigned threads = 1) {
+        std::vector<const OPATTable*> tables;
+        expression.forEachTable([&tables](const OPATTable& table) { tables.push_back(&table); });
+        tables.push_back(&output);
+        checkShapes(tables);
+
+        double* const out = output.data.get();
+        const std::size_t count = static_cast<std::size_t>(output.N_R) * output.N_C * output.m_vsize;
+        parallelFor(count, threads, [&expression, out](std::size_t begin, std::size_t end) {
+            // `out` may alias an input, but only at the same position, so no iteration depends on another
+#if defined(__clang__)
+#pragma clang loop vectorize(assume_safety)
+#elif defined(__GNUC__)
+#pragma GCC ivdep
+#endif
+            for (std::size_t i = begin; i < end; ++i) {
+                out[i] = expression[i];
+            }
+        });
+    }
+
+    /**
+     * @brief Evaluates `expression` into a new table, with the axes of its tables.
+     * @param expression The expression to evaluate; must contain at least one table.
+     * @param threads Number of threads to evaluate with; 0 uses one per hardware thread.
+     * @throws std::invalid_argument if the tables of the expression differ in shape or axes.
+     */
+    template <Expression E>
+    [[nodiscard]] OPATTable evaluate(const E& expression, unsigned threads = 1) {
+        std::vector<const OPATTable*> tables;
+        expression.forEachTable([&tables](const OPATTable& table) { tables.push_back(&table); });
+        checkShapes(tables);
+        OPATTable output = allocateLike(*tables.front());
+        evaluateInto(expression, output, threads);
+        return output;
+    }
+
+    /**
+     * @brief Evaluates a single table, which copies it.
+     */
+    [[nodiscard]] inline OPATTable evaluate(const OPATTable& table, unsigned threads = 1) {
+        return evaluate(Table(table), threads);
+    }
+
+}
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <exception>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
 #include "opatIO.h"
 #include "indexVector.h"
+#include "memoryManager.h"
+#include "numaPlacement.h"
+#include "tablePyramid.h"
 
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/vector.hpp>
@@ -40,15 +49,27 @@ namespace opat::lattice {
         std::vector<double> barycentricWeights; ///< Barycentric weights of the point within this simplex.
     };
 
+    /**
+     * @brief A corner of the simplex containing a query point, as blended by `TableLattice::get`.
+     */
+    struct Corner {
+        FloatIndexVector index;                ///< Index vector of the corner card.
+        std::shared_ptr<const DataCard> card;  ///< The corner card, acquired from the OPAT.
+        double weight;                         ///< Barycentric weight of the corner.
+    };
+
     /**
      * @brief Defines the type of interpolation to be used.
      */
     enum class InterpolationType {
         Linear,    ///< Linear interpolation.
+        Nearest,   ///< The card at the vertex with the largest barycentric weight in the containing simplex, without blending.
         Quadratic, ///< Quadratic interpolation (Not yet implemented).
         Cubic      ///< Cubic interpolation (Not yet implemented).
     };
 
+    class SubLattice;
+
     /**
      * @brief Represents a lattice structure for interpolating data from an OPAT object.
      *
@@ -118,6 +139,9 @@ namespace opat::lattice {
          * @throws std::runtime_error if Delaunay triangulation construction fails (e.g., due to Qhull errors,
          *         which could be caused by insufficient or degenerate input points from the OPAT file).
          *         Resolution: Ensure the OPAT file contains valid and sufficient index points for triangulation.
+         * @throws std::invalid_argument if the OPAT is eagerly loaded and its cards differ in their tags, or
+         *         in the shape or axes of a table (lazily loaded cards are checked when first blended).
+         *         Resolution: Resample the tables onto common axes first (see regrid.h and `opatRegrid`).
          *
          * **Example:**
          * @code
@@ -134,12 +158,13 @@ namespace opat::lattice {
          * and builds a Delaunay triangulation using Qhull.
          * @param opat The OPAT object containing the data.
          * @param interpolationType The type of interpolation to use.
-         * @throws std::runtime_error if the specified `interpolationType` is not `InterpolationType::Linear`,
-         *         as other types are not yet implemented.
+         * @throws std::runtime_error if the specified `interpolationType` is not `InterpolationType::Linear`
+         *         or `InterpolationType::Nearest`, as other types are not yet implemented.
          * @throws std::runtime_error if Delaunay triangulation construction fails (e.g., due to Qhull errors,
          *         which could be caused by insufficient or degenerate input points from the OPAT file).
          *         Resolution: Ensure the OPAT file contains valid and sufficient index points for triangulation.
-         *                     Use `InterpolationType::Linear`.
+         *                     Use `InterpolationType::Linear` or `InterpolationType::Nearest`.
+         * @throws std::invalid_argument as `TableLattice(opat)` if the cards differ in their tags or tables.
          *
          * **Example:**
          * @code
@@ -161,6 +186,10 @@ namespace opat::lattice {
          *
          * Finds the containing simplex for the index vector and performs
          * barycentric interpolation of the data from the simplex vertices.
+         * If the index vector is a catalog point (once quantized to the file's hash precision), or the
+         * interpolation type is `InterpolationType::Nearest`, the tables of that one card are copied instead.
+         * If the underlying OPAT object has a query recorder attached, the query is recorded as
+         * `trace::QueryKind::Lattice`.
          * @param indexVector The index vector for which to interpolate data.
          * @return A DataCard containing the interpolated data.
          * @throws std::out_of_range if the `indexVector` is outside the bounds of the table data (as determined by `validateIndexVector`),
@@ -177,6 +206,9 @@ namespace opat::lattice {
          *         Resolution: These errors often indicate issues with the underlying triangulation or extreme numerical conditions.
          *                     Verify the integrity of the input OPAT file's index data.
          * @throws std::logic_error if `calculateBarycentricWeights` returns an unexpected number of weights (internal logic error).
+         * @throws std::invalid_argument if a lazily loaded corner card, blended for the first time, differs from the
+         *         cards blended before it in its tags or in the shape or axes of a table.
+         *         Resolution: Resample the tables onto common axes first (see regrid.h and `opatRegrid`).
          *
          * **Example:**
          * @code
@@ -189,18 +221,158 @@ namespace opat::lattice {
          * @endcode
          */
         [[nodiscard]] DataCard get(const FloatIndexVector& indexVector) const;
+
+        /**
+         * @brief Retrieves interpolated data for a given index vector at a level of detail.
+         *
+         * Blends level `level` of the corner tables (see `lod::Pyramids`), so the tables of the result have
+         * the coarse grid of that level, and their index entries say so. Level 0 is the same as `get(indexVector)`.
+         * The pyramid of each corner table is built the first time a coarse level of it is requested, and is
+         * shared by copies of the lattice. Replicas (`setReplicas`) are only read at level 0.
+         * @param indexVector The index vector for which to interpolate data.
+         * @param level The level of detail; each level halves the resolution of the tables, down to 2 x 2.
+         * @return A DataCard containing the interpolated data.
+         * @throws Same as `get(indexVector)`.
+         *
+         * **Example:**
+         * @code
+         * // Cheap early iterations on a coarse grid, then full resolution for the final one
+         * opat::DataCard preview = lattice.get(FloatIndexVector({0.25, 0.75}), 2);
+         * opat::DataCard result = lattice.get(FloatIndexVector({0.25, 0.75}));
+         * @endcode
+         */
+        [[nodiscard]] DataCard get(const FloatIndexVector& indexVector, std::size_t level) const;
+
+        /**
+         * @brief Interpolates only the table `tag` at a given index vector.
+         *
+         * Gives the same table as `get(indexVector)[tag]`, but blends (and, for lazily loaded OPATs, reads) only
+         * that table of the corner cards, so a query for one tag costs the same however many the cards hold.
+         * Replicas (`setReplicas`) are read as by `get`.
+         * @param indexVector The index vector for which to interpolate data.
+         * @param tag The tag of the table to interpolate.
+         * @return The interpolated table.
+         * @throws Same as `get(indexVector)`.
+         * @throws std::out_of_range if the cards have no table `tag`.
+         * @throws std::invalid_argument if the table `tag` of the corners differs in shape or axes.
+         *
+         * **Example:**
+         * @code
+         * opat::OPATTable table = lattice.getTable(FloatIndexVector({0.25, 0.75}, opat.header.hashPrecision), "data");
+         * @endcode
+         */
+        [[nodiscard]] OPATTable getTable(const FloatIndexVector& indexVector, const std::string& tag) const;
+
+        /**
+         * @brief The card for a given index vector, without copying it when it is stored in the OPAT.
+         *
+         * For a catalog point (once quantized to the file's hash precision), or for any point when the
+         * interpolation type is `InterpolationType::Nearest`, this is the stored card itself (as
+         * `opat.acquire`, which keeps a lazily loaded card resident while the pointer is held). Other
+         * points are interpolated as by `get(indexVector)`. Replicas (`setReplicas`) are not read.
+         * @param indexVector The index vector to look up.
+         * @return The stored card, or a newly interpolated one.
+         * @throws Same as `get(indexVector)`.
+         *
+         * **Example:**
+         * @code
+         * // Sweeps over catalog points read the stored tables in place
+         * std::shared_ptr<const opat::DataCard> card = lattice.view(FloatIndexVector({0.35, 0.004}));
+         * double value = (*card)["data"].getData(5, 35);
+         * @endcode
+         */
+        [[nodiscard]] std::shared_ptr<const DataCard> view(const FloatIndexVector& indexVector) const;
+
+        /**
+         * @brief Reads the corner cards which `get(indexVector)` would blend, and their tables, if they are not resident.
+         *
+         * Lets the disk reads of a query happen ahead of (or on a different thread from) the blend itself,
+         * as `async::interpolate` does. The query is not recorded. Does nothing for eagerly loaded OPATs.
+         * @param indexVector The index vector which will be interpolated.
+         * @return The number of corner cards read from disk.
+         * @throws Same as `get`.
+         */
+        std::size_t prefetchCorners(const FloatIndexVector& indexVector) const;
+
+        /**
+         * @brief Starts the reads of `prefetchCorners` and returns without waiting for them.
+         *
+         * The point is located on the calling thread; the reads go to the backend with
+         * `LazyCardStore::prefetchAsync`, and `done` runs on the thread which completes them, so it should be
+         * quick. Calls `done` at once for eagerly loaded OPATs. The lattice must outlive the prefetch.
+         * @param indexVector The index vector which will be interpolated.
+         * @param done Called once with null, or with the error a read failed with.
+         * @throws std::invalid_argument, std::out_of_range Same as `get`, before anything is read.
+         */
+        void prefetchCornersAsync(const FloatIndexVector& indexVector, std::function<void(std::exception_ptr)> done) const;
+
+        /**
+         * @brief The corner cards and weights which `get(indexVector)` blends.
+         *
+         * Lets callers which need only part of an interpolated card (such as `inverse::LatticeInverse`)
+         * work on the corners directly instead of blending every table. The query is not recorded.
+         * @param indexVector The index vector to locate.
+         * @return One entry per vertex of the containing simplex; the weights sum to 1. A catalog point, or any
+         *         point in `InterpolationType::Nearest` mode, gives the single card `get` copies, with weight 1.
+         * @throws Same as `get`.
+         */
+        [[nodiscard]] std::vector<Corner> corners(const FloatIndexVector& indexVector) const;
+
+        /**
+         * @brief Makes `get` read replicated tables from the copy on the querying thread's NUMA node.
+         *
+         * Tables without a local copy are read from the OPAT as usual. Copies of the lattice share the
+         * replicas. Pass null to stop using them.
+         * @param replicas Per-node copies of tables of the OPAT this lattice was built from.
+         *
+         * **Example:**
+         * @code
+         * lattice.setReplicas(std::make_shared<const opat::numa::Replicas>(opat, std::vector<std::string>{"data"}));
+         * @endcode
+         */
+        void setReplicas(std::shared_ptr<const numa::Replicas> replicas);
+
+        /**
+         * @brief Restricts the lattice to the hyperplane where some index coordinates are fixed.
+         *
+         * For runs which hold coordinates fixed (such as Z over a whole evolution), the returned `SubLattice`
+         * locates queries over the free coordinates only, in its own, lower-dimensional triangulation, and
+         * blends the same cards with the same weights as `get` would at the full index vector. It is built by
+         * intersecting the simplices of this lattice with the hyperplane; when no simplex crosses the
+         * hyperplane (it is a grid line of the catalog, every point of it lying on faces spanned by cards on
+         * it), the cards on it are triangulated again in the lower dimension instead.
+         * The sub-lattice refers to this lattice, which must outlive it.
+         * @param fixed One entry per index dimension: the value of a fixed coordinate, or `std::nullopt` for a free one.
+         * @return The lattice over the free coordinates, in the order they appear in the index vector.
+         * @throws std::invalid_argument if `fixed` does not have one entry per index dimension, or fixes none or all of them.
+         * @throws std::out_of_range if a fixed value is outside the bounds of its dimension, or the hyperplane
+         *         does not cut through the interior of the triangulation.
+         *
+         * **Example:**
+         * @code
+         * // Every query of this run has Z = 0.02
+         * const opat::lattice::SubLattice constantZ = lattice.restrictTo({std::nullopt, 0.02});
+         * opat::DataCard card = constantZ.get(FloatIndexVector({0.7}));
+         * @endcode
+         */
+        [[nodiscard]] SubLattice restrictTo(const std::vector<std::optional<double>>& fixed) const;
         /**
          * @brief Gets the current interpolation type.
          * @return The current InterpolationType.
          */
         [[nodiscard]] InterpolationType getInterpolationType() const;
 
+        /**
+         * @brief Gets the OPAT object the lattice interpolates.
+         */
+        [[nodiscard]] const OPAT& getOPAT() const;
+
         /**
          * @brief Sets the interpolation type.
          * @param interpolationType The new InterpolationType to set.
-         * @throws std::runtime_error if `interpolationType` is not `InterpolationType::Linear`,
-         *         as other types are not currently implemented.
-         *         Resolution: Only use `InterpolationType::Linear`.
+         * @throws std::runtime_error if `interpolationType` is not `InterpolationType::Linear` or
+         *         `InterpolationType::Nearest`, as other types are not currently implemented.
+         *         Resolution: Only use `InterpolationType::Linear` or `InterpolationType::Nearest`.
          *
          * **Example:**
          * @code
@@ -231,14 +403,23 @@ namespace opat::lattice {
          */
         void dumpTriangulationToAscii(const std::string &points_file, const std::string &simplices_file) const;
     private:
+        friend class SubLattice;
+
         const opat::OPAT &m_opat; ///< Reference to the OPAT object.
         std::size_t m_indexVectorSize{}; ///< The dimensionality of the index vectors.
         InterpolationType m_interpolationType{InterpolationType::Linear}; ///< The type of interpolation to use.
         std::vector<FloatIndexVector> m_indexVectors; ///< Stores all unique index vectors from the OPAT file, serving as the vertices of the triangulation.
+        std::unordered_map<FloatIndexVector, std::size_t> m_vertexPositions; ///< Position in `m_indexVectors` of each catalog point, so exact hits skip the simplex walk.
         std::vector<std::vector<double>> m_axisValues; ///< Stores the unique values for each axis/dimension (Not currently used by Delaunay approach).
         std::size_t m_numCorners{}; ///< The number of corners in a hypercube (2^m_indexVectorSize), relevant for hypercube-based approaches (not Delaunay).
         std::vector<std::vector<std::size_t>> m_simplices; ///< Stores the simplices of the Delaunay triangulation. Each inner vector is a list of global vertex indices (indices into `m_indexVectors`).
         std::vector<std::vector<std::size_t>> m_simplexAdjacency; ///< Adjacency list for simplices. `m_simplexAdjacency[i][j]` stores the ID of the simplex adjacent to simplex `i` across the face opposite to its `j`-th local vertex. A value of `static_cast<std::size_t>(-1)` indicates no neighbor (boundary).
+        std::shared_ptr<memory::Reservation> m_reservation; ///< Charge for the triangulation in the global memory manager, shared by copies of the lattice.
+        std::shared_ptr<const numa::Replicas> m_replicas; ///< Optional per-node copies of hot tables, read in preference to the OPAT's own (see `setReplicas`).
+        std::shared_ptr<lod::Pyramids> m_pyramids; ///< Coarse levels of the corner tables, built as they are first requested and shared by copies of the lattice.
+
+        struct Compatibility;
+        std::shared_ptr<Compatibility> m_compatibility; ///< The tags, shapes and axes every card must have, and which cards have been checked against them; shared by copies of the lattice.
 
         /**
          * @brief Initializes the TableLattice internal structures.
@@ -263,6 +444,30 @@ namespace opat::lattice {
          *                     Ensure there are enough non-degenerate points for the given number of dimensions.
          */
         void buildDelaunay();
+
+        /**
+         * @brief Charges the memory held by the triangulation to the global memory manager.
+         *
+         * The triangulation cannot be evicted, so it is charged as a `memory::Reservation` reported under
+         * the OPAT's filename. This method is called by the constructors after `buildDelaunay()`.
+         */
+        void reserveMemory();
+
+        /**
+         * @brief Checks once that the cards can be blended, value by value, with each other.
+         *
+         * The tables of every eagerly loaded card are compared with those of the first card, here. Lazily
+         * loaded cards are not read to be checked; `checkCard` checks each the first time it is blended.
+         * This method is called by the constructors after `initialize()`.
+         * @throws std::invalid_argument as `checkCard`.
+         */
+        void checkCompatibility();
+
+        /**
+         * @brief Checks that the card at `vertex` has the tags, shapes and axes of the first card checked, unless it was checked before.
+         * @throws std::invalid_argument if the card has other tags, or a table of another shape or with other axes.
+         */
+        void checkCard(std::size_t vertex, const DataCard& card) const;
         /**
          * @brief Finds the simplex containing the given index vector using a walk algorithm.
          *
@@ -309,6 +514,20 @@ namespace opat::lattice {
          */
         void validateIndexVector(const FloatIndexVector &indexVector) const;
 
+        /**
+         * @brief Reads the cards at the vertices of `simplex` which are not resident, as one batch.
+         * @param simplex Global vertex indices of a simplex (an element of `m_simplices`).
+         * @param tables Whether to read every table of the corners too, as a second batch, for a blend.
+         * @return The number of cards read from disk (always 0 for eagerly loaded OPATs).
+         */
+        std::size_t prefetchSimplex(const std::vector<std::size_t>& simplex, bool tables = false) const;
+
+        /**
+         * @brief Reads the cards at the vertices of `simplex` which are not resident, then their tables `tags`.
+         * @return The number of cards read from disk (always 0 for eagerly loaded OPATs).
+         */
+        std::size_t prefetchSimplex(const std::vector<std::size_t>& simplex, std::span<const std::string> tags) const;
+
         /**
          * @brief Calculates the barycentric weights of a query point with respect to the vertices of a given simplex.
          *
@@ -330,10 +549,146 @@ namespace opat::lattice {
          */
         std::vector<double> calculateBarycentricWeights(const FloatIndexVector& queryPoint, const std::vector<FloatIndexVector>& simplexActualVertices) const;
 
+        /**
+         * @brief The position in `m_indexVectors` of `indexVector`, quantized to the file's hash precision, if it is a catalog point.
+         */
+        [[nodiscard]] std::optional<std::size_t> findVertex(const FloatIndexVector& indexVector) const;
+
+        /**
+         * @brief The vertices (positions in `m_indexVectors`) and weights to blend for `indexVector`.
+         *
+         * A single vertex with weight 1 for catalog points and in `InterpolationType::Nearest` mode,
+         * otherwise the containing simplex and its barycentric weights.
+         */
+        [[nodiscard]] std::pair<std::vector<std::size_t>, std::vector<double>> locate(const FloatIndexVector& indexVector) const;
+
+        /**
+         * @brief Blends level `level` of the tables of the cards at `simplex` with `weights`; a single vertex is copied.
+         */
+        [[nodiscard]] DataCard blend(const std::vector<std::size_t>& simplex, const std::vector<double>& weights, std::size_t level) const;
+
+        /**
+         * @brief Blends level `level` of the table `key` of the cards at `simplex`, reading replicas local to NUMA node `node`.
+         */
+        [[nodiscard]] OPATTable blendTable(const std::vector<std::size_t>& simplex, const std::vector<double>& weights,
+                                           const std::vector<std::shared_ptr<const DataCard>>& cornerCards, const std::string& key,
+                                           std::size_t level, int node) const;
+
         mutable Simplex m_lastFoundSimplex; ///< Stores the last found simplex (ID and barycentric weights) as a starting point for the `findContainingSimplex` walk algorithm, optimizing searches for spatially coherent query points. Initialized with an invalid ID.
 
     };
 
+    /**
+     * @brief A `TableLattice` restricted to the hyperplane where some index coordinates are fixed (see `TableLattice::restrictTo`).
+     *
+     * Queries give the free coordinates only. Each vertex of the sub-lattice is a card of the catalog, or
+     * (where the hyperplane crosses an edge of a simplex) a weighted pair of cards, so the cards blended
+     * for a query are those `TableLattice::get` would blend at the full index vector, in a triangulation
+     * of one dimension less per fixed coordinate. A single free coordinate is located by binary search.
+     * Like `TableLattice`, a sub-lattice is not thread-safe; copies may be used on different threads.
+     *
+     * **Example:**
+     * @code
+     * const opat::lattice::TableLattice lattice(opat);
+     * const opat::lattice::SubLattice constantZ = lattice.restrictTo({std::nullopt, 0.02});
+     * for (const double x : {0.5, 0.6, 0.7}) {
+     *     opat::DataCard card = constantZ.get(FloatIndexVector({x})); // The same as lattice.get({x, 0.02})
+     * }
+     * @endcode
+     */
+    class SubLattice {
+    public:
+        /**
+         * @brief Retrieves interpolated data for the free coordinates of an index vector.
+         *
+         * Blends as `TableLattice::get` does, honouring its interpolation type; a query which falls on a
+         * single card copies it. If the OPAT has a query recorder attached, the full index vector is
+         * recorded as `trace::QueryKind::Lattice`.
+         * @param freeCoordinates The free coordinates, in the order they appear in the index vector.
+         * @return A DataCard containing the interpolated data.
+         * @throws std::invalid_argument if `freeCoordinates` does not have `dimension()` entries.
+         * @throws std::out_of_range if the point is outside the sub-lattice.
+         * @throws std::invalid_argument as `TableLattice::get` if the cards blended cannot be blended with each other.
+         */
+        [[nodiscard]] DataCard get(const FloatIndexVector& freeCoordinates) const;
+
+        /**
+         * @brief Retrieves interpolated data for the free coordinates of an index vector at a level of detail (see `TableLattice::get`).
+         * @throws Same as `get(freeCoordinates)`.
+         */
+        [[nodiscard]] DataCard get(const FloatIndexVector& freeCoordinates, std::size_t level) const;
+
+        /**
+         * @brief The cards and weights which `get(freeCoordinates)` blends, as `TableLattice::corners`.
+         * @throws Same as `get(freeCoordinates)`.
+         */
+        [[nodiscard]] std::vector<Corner> corners(const FloatIndexVector& freeCoordinates) const;
+
+        /**
+         * @brief The full index vector of a point of the sub-lattice, with the fixed coordinates filled in.
+         * @throws std::invalid_argument if `freeCoordinates` does not have `dimension()` entries.
+         */
+        [[nodiscard]] FloatIndexVector embed(const FloatIndexVector& freeCoordinates) const;
+
+        /**
+         * @brief The number of free coordinates.
+         */
+        [[nodiscard]] std::size_t dimension() const;
+
+        /**
+         * @brief Whether the hyperplane is a grid line of the catalog, so the sub-lattice triangulates the cards on it rather than intersecting simplices.
+         */
+        [[nodiscard]] bool isGridLine() const;
+
+    private:
+        friend class TableLattice;
+
+        /**
+         * @brief A vertex of the sub-lattice.
+         */
+        struct Vertex {
+            std::vector<double> coordinates;                      ///< Its free coordinates.
+            std::vector<std::pair<std::size_t, double>> sources;  ///< The vertices of the lattice (positions in its `m_indexVectors`) it is a blend of, with their weights.
+        };
+
+        SubLattice(const TableLattice& lattice, const std::vector<std::optional<double>>& fixed);
+
+        const TableLattice& m_lattice; ///< The lattice restricted.
+        std::vector<std::optional<double>> m_fixed; ///< The fixed value of each index dimension, or `std::nullopt` for a free one.
+        std::vector<std::size_t> m_free; ///< The index dimensions which are free, in order.
+        std::vector<Vertex> m_vertices; ///< The vertices of the triangulation of the hyperplane.
+        std::vector<std::vector<std::size_t>> m_simplices; ///< The simplices of that triangulation, as positions in `m_vertices`. With one free coordinate, sorted along it.
+        std::vector<std::vector<std::size_t>> m_simplexAdjacency; ///< As `TableLattice::m_simplexAdjacency`, for `m_simplices`.
+        bool m_gridLine{}; ///< Whether the cards on the hyperplane were triangulated again (see `isGridLine`).
+        std::shared_ptr<memory::Reservation> m_reservation; ///< Charge for the triangulation in the global memory manager, shared by copies.
+        mutable std::size_t m_lastFoundSimplex{}; ///< Where the walk to the next query starts.
+
+        /**
+         * @brief Builds `m_vertices` and `m_simplices` by intersecting the simplices of the lattice with the hyperplane, one fixed coordinate at a time.
+         */
+        void intersect();
+
+        /**
+         * @brief Replaces the triangulation with a Delaunay triangulation of the cards on the hyperplane, if they are its only vertices.
+         */
+        void triangulateGridLine();
+
+        /**
+         * @brief Drops degenerate simplices, sorts them along a single free coordinate, and links neighbours across faces.
+         */
+        void finish();
+
+        /**
+         * @brief The vertices of the lattice and their weights to blend for `freeCoordinates`.
+         */
+        [[nodiscard]] std::pair<std::vector<std::size_t>, std::vector<double>> locate(const FloatIndexVector& freeCoordinates) const;
+
+        /**
+         * @brief The simplex of `m_simplices` containing `point`, with its barycentric weights.
+         */
+        [[nodiscard]] Simplex findContainingSimplex(const std::vector<double>& point) const;
+    };
+
     /**
      * @brief Solves a linear system of equations Ax = b.
      *
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+#include "memoryManager.h"
+
+/**
+ * @brief Namespace for level-of-detail (multi-resolution) access to tables.
+ *
+ * Level 0 of a table is the table itself; each further level halves its resolution along both axes by
+ * keeping every other row and column (and always the last), down to a minimum size. Values at the
+ * rows and columns which are kept are exact, so coarse levels interpolate the same surface as the full
+ * table on a coarser grid. Early solver iterations and previews can run on coarse levels, whose data
+ * fits in cache, and switch to level 0 for final convergence.
+ *
+ * Levels are built in memory the first time they are requested; they are not stored in OPAT files.
+ */
+namespace opat::lod {
+
+    /**
+     * @brief Halves the resolution of `table`: keeps rows and columns 0, 2, 4, ... and always the last.
+     *
+     * Axes with fewer than 3 values are kept as they are.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPATTable& table = opat.get(FloatIndexVector({0.35, 0.004}))["data"];
+     * opat::OPATTable coarse = opat::lod::downsample(table); // 19 x 70 -> 10 x 36
+     * @endcode
+     */
+    [[nodiscard]] OPATTable downsample(const OPATTable& table);
+
+    /**
+     * @brief The coarse levels of one table.
+     *
+     * All levels are built on construction and are owned by the pyramid, so the source table may be
+     * released afterwards. All members are const and thread-safe.
+     */
+    class TablePyramid {
+    public:
+        /**
+         * @brief Builds levels of `table` until neither axis has more than `minimumSize` values.
+         * @throws std::invalid_argument if `minimumSize` is less than 2.
+         */
+        explicit TablePyramid(const OPATTable& table, uint32_t minimumSize = 2);
+
+        /**
+         * @brief The number of coarse levels (0 if the table is already no larger than the minimum size).
+         */
+        [[nodiscard]] std::size_t depth() const { return m_levels.size(); }
+
+        /**
+         * @brief The table at `level`; levels past `depth()` give the coarsest level.
+         * @throws std::out_of_range if `level` is 0 (the source table, which the pyramid does not hold)
+         *         or the pyramid has no coarse levels.
+         */
+        [[nodiscard]] const OPATTable& level(std::size_t level) const;
+
+        /**
+         * @brief Bytes held by the coarse levels.
+         */
+        [[nodiscard]] std::size_t bytes() const;
+
+    private:
+        std::vector<OPATTable> m_levels; ///< Level 1 first.
+    };
+
+    /**
+     * @brief Tables of the cards of an OPAT at any level of detail, with pyramids built on first use.
+     *
+     * Pyramids are built from the cards as they are acquired, so lazily loaded cards stay evictable
+     * once their pyramid is built. The memory held by pyramids is charged to the global memory manager
+     * (reported under the OPAT's filename with a " (pyramids)" suffix) and is not evicted. The OPAT must
+     * outlive this object. All members are thread-safe.
+     *
+     * **Example:**
+     * @code
+     * const opat::OPAT opat = opat::readOPAT("gs98hz.opat", opat::LoadMode::Lazy);
+     * const opat::lod::Pyramids pyramids(opat);
+     * const std::shared_ptr<const opat::OPATTable> preview = pyramids.table(FloatIndexVector({0.35, 0.004}), "data", 2);
+     * @endcode
+     */
+    class Pyramids {
+    public:
+        /**
+         * @throws std::invalid_argument if `minimumSize` is less than 2.
+         */
+        explicit Pyramids(const OPAT& opat, uint32_t minimumSize = 2);
+        Pyramids(const Pyramids&) = delete;
+        Pyramids& operator=(const Pyramids&) = delete;
+        ~Pyramids();
+
+        /**
+         * @brief Table `tag` of the card at `index`, at `level`.
+         *
+         * Level 0 is the card's own table, and the returned pointer shares ownership of the card (as
+         * `opat.acquire(index)`): the table stays valid while it is held, and once it is released a lazily
+         * loaded card is left to the memory budget rather than pinned.
+         * Levels past the depth of the table's pyramid give its coarsest level, which lives as long as
+         * this object; tables too small to have coarse levels are returned at level 0.
+         * @throws std::out_of_range if there is no card at `index` or it has no table `tag`.
+         */
+        [[nodiscard]] std::shared_ptr<const OPATTable> table(const FloatIndexVector& index, const std::string& tag, std::size_t level) const;
+
+        /**
+         * @brief Bytes held by all pyramids built so far.
+         */
+        [[nodiscard]] std::size_t bytes() const;
+
+    private:
+        const OPAT& m_opat;
+        uint32_t m_minimumSize;
+        mutable std::mutex m_mutex;
+        mutable std::optional<memory::MemoryManager::ConsumerID> m_consumer; ///< Pyramids are charged to the global memory manager as pinned entries of this consumer, registered with the first pyramid.
+        mutable std::unordered_map<FloatIndexVector, std::unordered_map<std::string, std::unique_ptr<const TablePyramid>>> m_pyramids;
+        mutable std::size_t m_bytes = 0;
+    };
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+
+namespace opat {
+
+    namespace lattice {
+        class TableLattice;
+    }
+
+    /**
+     * @brief How VirtualOPAT resolves a card index which appears in more than one file.
+     */
+    enum class ConflictPolicy {
+        Error,     ///< Throw std::invalid_argument when two files contain the same index (the default).
+        KeepFirst, ///< Keep the card from the file which appears first in the file list.
+        KeepLast   ///< Keep the card from the file which appears last in the file list.
+    };
+
+    /**
+     * @brief Presents a set of OPAT files as a single logical OPAT file.
+     *
+     * The card catalogs of every file are merged into one index space when the VirtualOPAT is
+     * constructed; no card payload is read at that point. Each card is read lazily from the file it
+     * belongs to the first time it is requested, and is then shared by every lookup (see
+     * LazyCardStore). This allows large grids which are split across files (for example one file
+     * per composition) to be queried and interpolated across as if they were one file.
+     *
+     * All files must have the same number of index dimensions and the same hash precision. The
+     * merged header is a copy of the first file's header with `numTables` set to the number of
+     * merged cards.
+     *
+     * `opat()` exposes the merged catalog as an ordinary OPAT object, so it can be used anywhere an
+     * OPAT is expected, including `lattice::TableLattice`.
+     *
+     * **Example:**
+     * @code
+     * opat::VirtualOPAT grid = opat::VirtualOPAT::fromDirectory("tables/", opat::ConflictPolicy::KeepLast);
+     * FloatIndexVector index({0.35, 0.004}, grid.opat().header.hashPrecision);
+     * const opat::DataCard& card = grid.get(index);
+     * std::cout << "Read from " << grid.sourceFile(index) << std::endl;
+     *
+     * opat::DataCard interpolated = grid.interpolate(FloatIndexVector({0.5, 0.01}));
+     * @endcode
+     */
+    class VirtualOPAT {
+    public:
+        /**
+         * @brief Opens `filenames` and merges their card catalogs.
+         * @param filenames Paths to the OPAT files, in priority order for `ConflictPolicy`.
+         * @param policy How to resolve indices which appear in more than one file.
+         * @throws std::invalid_argument if `filenames` is empty, if the files disagree on `numIndex` or
+         *         `hashPrecision`, or if an index appears in several files and `policy` is `ConflictPolicy::Error`.
+         * @throws std::runtime_error if a file cannot be opened or is not a valid OPAT file.
+         */
+        explicit VirtualOPAT(const std::vector<std::string>& filenames, ConflictPolicy policy = ConflictPolicy::Error);
+
+        /**
+         * @brief Opens every `*.opat` file in `directory`, in lexicographic order of their file names.
+         * @param directory Directory to scan (not recursive).
+         * @param policy How to resolve indices which appear in more than one file.
+         * @throws std::invalid_argument if `directory` is not a directory or contains no OPAT files.
+         * @see VirtualOPAT(const std::vector<std::string>&, ConflictPolicy)
+         */
+        static VirtualOPAT fromDirectory(const std::string& directory, ConflictPolicy policy = ConflictPolicy::Error);
+
+        VirtualOPAT(const VirtualOPAT&) = delete;
+        VirtualOPAT& operator=(const VirtualOPAT&) = delete;
+        VirtualOPAT(VirtualOPAT&&) = delete;
+        VirtualOPAT& operator=(VirtualOPAT&&) = delete;
+        ~VirtualOPAT();
+
+        /**
+         * @brief The merged OPAT object. Cards are served lazily through its `lazyCards` store.
+         */
+        [[nodiscard]] const OPAT& opat() const { return *m_opat; }
+
+        /**
+         * @brief Retrieves a DataCard from whichever file contains it.
+         * @param index The index vector of the DataCard to retrieve.
+         * @return A constant reference to the DataCard, valid for the lifetime of the VirtualOPAT.
+         * @throws std::runtime_error if no file contains the index.
+         */
+        [[nodiscard]] const DataCard& get(const FloatIndexVector& index) const { return m_opat->get(index); }
+
+        /**
+         * @brief Accesses a DataCard from whichever file contains it.
+         * @see get
+         */
+        const DataCard& operator[](const FloatIndexVector& index) const { return m_opat->get(index); }
+
+        /**
+         * @brief Interpolates a DataCard across the union of all files.
+         *
+         * The lattice over the merged index space is built on the first call. Like TableLattice::get,
+         * this is not safe to call concurrently; threads should interpolate with their own copy of `lattice()`.
+         * @param index The index vector at which to interpolate.
+         * @return The interpolated DataCard.
+         * @throws See lattice::TableLattice::get.
+         */
+        [[nodiscard]] DataCard interpolate(const FloatIndexVector& index) const;
+
+        /**
+         * @brief The lattice over the merged index space, built on first use.
+         */
+        [[nodiscard]] const lattice::TableLattice& lattice() const;
+
+        /**
+         * @brief The files backing this VirtualOPAT, in the order they were given.
+         */
+        [[nodiscard]] const std::vector<std::string>& files() const { return m_files; }
+
+        /**
+         * @brief Path of the file the card for `index` is read from.
+         * @throws std::out_of_range if no file contains the index.
+         */
+        [[nodiscard]] const std::string& sourceFile(const FloatIndexVector& index) const;
+
+        /**
+         * @brief Number of cards in the merged catalog.
+         */
+        [[nodiscard]] std::size_t size() const { return m_opat->cardCatalog.tableIndex.size(); }
+
+    private:
+        std::vector<std::string> m_files;
+        std::unique_ptr<OPAT> m_opat; ///< Heap allocated so the lattice can hold a stable reference to it.
+        mutable std::once_flag m_latticeOnce;
+        mutable std::unique_ptr<lattice::TableLattice> m_lattice;
+    };
+
+}
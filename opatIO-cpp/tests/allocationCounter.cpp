@@ -0,0 +1,83 @@
+#include "allocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    // Per-thread tallies. These are plain integers so that touching them never allocates.
+    thread_local std::size_t activeCounters = 0;
+    thread_local std::size_t allocationCount = 0;
+    thread_local std::size_t deallocationCount = 0;
+    thread_local std::size_t allocatedBytes = 0;
+
+    void countAllocation(std::size_t size) {
+        if (activeCounters > 0) {
+            allocationCount++;
+            allocatedBytes += size;
+        }
+    }
+
+    void countDeallocation(const void* ptr) {
+        if (activeCounters > 0 && ptr != nullptr) {
+            deallocationCount++;
+        }
+    }
+
+    void* allocate(std::size_t size) {
+        countAllocation(size);
+        if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+        countAllocation(size);
+        const auto align = static_cast<std::size_t>(alignment);
+        // aligned_alloc requires the size to be a multiple of the alignment
+        const std::size_t padded = ((size == 0 ? 1 : size) + align - 1) / align * align;
+        if (void* ptr = std::aligned_alloc(align, padded)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+namespace opat::testing {
+    AllocationCounter::AllocationCounter()
+        : m_allocationsAtStart(allocationCount),
+          m_deallocationsAtStart(deallocationCount),
+          m_bytesAtStart(allocatedBytes) {
+        activeCounters++;
+    }
+
+    AllocationCounter::~AllocationCounter() {
+        activeCounters--;
+    }
+
+    std::size_t AllocationCounter::allocations() const {
+        return allocationCount - m_allocationsAtStart;
+    }
+
+    std::size_t AllocationCounter::deallocations() const {
+        return deallocationCount - m_deallocationsAtStart;
+    }
+
+    std::size_t AllocationCounter::bytes() const {
+        return allocatedBytes - m_bytesAtStart;
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+void operator delete(void* ptr) noexcept { countDeallocation(ptr); std::free(ptr); }
+void operator delete[](void* ptr) noexcept { countDeallocation(ptr); std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { countDeallocation(ptr); std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { countDeallocation(ptr); std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { countDeallocation(ptr); std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { countDeallocation(ptr); std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { countDeallocation(ptr); std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { countDeallocation(ptr); std::free(ptr); }
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @file allocationCounter.h
+ * @brief Test utility for counting heap allocations made by a block of code.
+ *
+ * allocationCounter.cpp replaces the global operator new / operator delete for every test
+ * executable. Allocations are only counted on the calling thread and only while an
+ * AllocationCounter is alive, so the replacement is a no-op for the rest of the test suite.
+ *
+ * **Example:**
+ * @code
+ * const auto& table = opat[index]["data"];
+ * EXPECT_MAX_ALLOCATIONS(0, table.getData(5, 35, 0));
+ * @endcode
+ */
+namespace opat::testing {
+
+    /**
+     * @brief Counts the heap allocations made by the current thread during its lifetime.
+     *
+     * Counters may be nested; each counter only sees the allocations made while it is alive.
+     */
+    class AllocationCounter {
+    public:
+        AllocationCounter();
+        ~AllocationCounter();
+
+        AllocationCounter(const AllocationCounter&) = delete;
+        AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+        /**
+         * @brief Number of calls to operator new since this counter was created.
+         */
+        [[nodiscard]] std::size_t allocations() const;
+
+        /**
+         * @brief Number of calls to operator delete (with a non-null pointer) since this counter was created.
+         */
+        [[nodiscard]] std::size_t deallocations() const;
+
+        /**
+         * @brief Total number of bytes requested from operator new since this counter was created.
+         */
+        [[nodiscard]] std::size_t bytes() const;
+
+    private:
+        std::size_t m_allocationsAtStart;
+        std::size_t m_deallocationsAtStart;
+        std::size_t m_bytesAtStart;
+    };
+}
+
+/**
+ * @brief Expects that evaluating `statement` performs at most `maxAllocations` heap allocations.
+ *
+ * The statement is evaluated exactly once and its result (if any) is discarded, including the
+ * destruction of any temporaries it creates.
+ */
+#define EXPECT_MAX_ALLOCATIONS(maxAllocations, statement)                                      \
+    do {                                                                                       \
+        std::size_t opatAllocationCount_;                                                      \
+        {                                                                                      \
+            opat::testing::AllocationCounter opatAllocationCounter_;                           \
+            static_cast<void>(statement);                                                      \
+            opatAllocationCount_ = opatAllocationCounter_.allocations();                       \
+        }                                                                                      \
+        EXPECT_LE(opatAllocationCount_, static_cast<std::size_t>(maxAllocations))              \
+            << "`" #statement "` performed " << opatAllocationCount_ << " heap allocation(s)"; \
+    } while (false)
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "allocationCounter.h"
+
+#include <memory>
+#include <string>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file allocationTest.cpp
+ * @brief Locks in the heap allocation behaviour of the fast-path APIs.
+ *
+ * Every API covered here is expected to perform no heap allocations once its inputs exist.
+ * New fast-path APIs should add a case here so that regressions are caught by the test suite.
+ */
+
+class allocationTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        s_opat = std::make_unique<opat::OPAT>(opat::readOPAT(EXAMPLE_FILENAME));
+    }
+    static void TearDownTestSuite() {
+        s_opat.reset();
+    }
+    static std::unique_ptr<opat::OPAT> s_opat;
+};
+
+std::unique_ptr<opat::OPAT> allocationTest::s_opat;
+
+/**
+ * @test Verify the harness itself counts allocations on the current thread.
+ */
+TEST_F(allocationTest, counterSeesAllocations) {
+    opat::testing::AllocationCounter counter;
+    auto value = std::make_unique<double[]>(16);
+    EXPECT_EQ(counter.allocations(), 1);
+    EXPECT_GE(counter.bytes(), 16 * sizeof(double));
+    value.reset();
+    EXPECT_EQ(counter.deallocations(), 1);
+}
+
+TEST_F(allocationTest, cardLookup) {
+    const FloatIndexVector index({0.35, 0.004}, s_opat->header.hashPrecision);
+    EXPECT_MAX_ALLOCATIONS(0, s_opat->get(index));
+    EXPECT_MAX_ALLOCATIONS(0, (*s_opat)[index]);
+}
+
+TEST_F(allocationTest, indexVectorHash) {
+    const FloatIndexVector index({0.35, 0.004});
+    EXPECT_MAX_ALLOCATIONS(0, index.hash());
+    EXPECT_MAX_ALLOCATIONS(0, index == index);
+}
+
+TEST_F(allocationTest, tableLookup) {
+    const opat::DataCard& card = s_opat->get(FloatIndexVector({0.35, 0.004}, s_opat->header.hashPrecision));
+    const std::string tag = "data";
+    EXPECT_MAX_ALLOCATIONS(0, card.get(tag));
+    EXPECT_MAX_ALLOCATIONS(0, card[tag]);
+}
+
+TEST_F(allocationTest, scalarCellAccess) {
+    const opat::OPATTable& table = s_opat->get(FloatIndexVector({0.35, 0.004}, s_opat->header.hashPrecision))["data"];
+    EXPECT_MAX_ALLOCATIONS(0, table.getData(5, 35, 0));
+    EXPECT_MAX_ALLOCATIONS(0, table(5, 35, 0));
+    EXPECT_MAX_ALLOCATIONS(0, table());
+    EXPECT_MAX_ALLOCATIONS(0, table.getRawData());
+    EXPECT_DOUBLE_EQ(table.getData(5, 35, 0), -0.402);
+    EXPECT_THROW(static_cast<void>(table.getData(5, 35, 1)), std::out_of_range);
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "asyncOPAT.h"
+#include "lazyCardStore.h"
+#include "tableLattice.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file asyncTest.cpp
+ * @brief Unit tests for the coroutine API of asyncOPAT.h.
+ */
+
+namespace {
+    // Runs work on the posting thread and counts how often it was asked to
+    class CountingExecutor final : public opat::async::Executor {
+    public:
+        void post(std::function<void()> work) override {
+            ++posts;
+            work();
+        }
+
+        std::atomic<int> posts = 0;
+    };
+
+    // Holds work until the test runs it
+    class ManualExecutor final : public opat::async::Executor {
+    public:
+        void post(std::function<void()> work) override {
+            std::lock_guard lock(m_mutex);
+            m_queue.push_back(std::move(work));
+        }
+
+        std::size_t pending() {
+            std::lock_guard lock(m_mutex);
+            return m_queue.size();
+        }
+
+        void runOne() {
+            std::function<void()> work;
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_queue.empty()) {
+                    return;
+                }
+                work = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            work();
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::deque<std::function<void()>> m_queue;
+    };
+
+    opat::async::Task<double> readValue(const opat::OPAT& opat, FloatIndexVector index, opat::async::Executor& executor) {
+        const std::shared_ptr<const opat::DataCard> card = co_await opat.getAsync(index, executor);
+        co_return (*card)["data"].getData(5, 35, 0);
+    }
+
+    opat::async::Task<std::shared_ptr<const opat::OPATTable>> readTable(const opat::OPAT& opat, FloatIndexVector index, std::string tag) {
+        co_return co_await opat::async::getTable(opat, index, tag);
+    }
+
+    opat::async::Task<opat::DataCard> interpolateAt(const opat::lattice::TableLattice& lattice, FloatIndexVector index) {
+        co_return co_await opat::async::interpolate(lattice, index);
+    }
+}
+
+class asyncTest : public ::testing::Test {};
+
+TEST_F(asyncTest, residentCardsDoNotSuspend) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    CountingExecutor executor;
+    const FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+    EXPECT_DOUBLE_EQ(opat::async::syncWait(readValue(opat, index, executor)), -0.402);
+    EXPECT_EQ(executor.posts.load(), 0);
+}
+
+TEST_F(asyncTest, lazyCardResumesOnExecutor) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    CountingExecutor executor;
+    const FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+    EXPECT_DOUBLE_EQ(opat::async::syncWait(readValue(opat, index, executor)), -0.402);
+    EXPECT_EQ(executor.posts.load(), 1);
+    EXPECT_TRUE(opat.lazyCards->isLoaded(index));
+
+    // Now resident, so answered without suspending
+    EXPECT_DOUBLE_EQ(opat::async::syncWait(readValue(opat, index, executor)), -0.402);
+    EXPECT_EQ(executor.posts.load(), 1);
+}
+
+TEST_F(asyncTest, readsDoNotRunOnTheExecutor) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    ManualExecutor executor;
+    const FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+    auto value = std::async(std::launch::async, [&] {
+        return opat::async::syncWait(readValue(opat, index, executor));
+    });
+
+    // The IO backend reads the card without the executor running anything, then posts only the continuation
+    while (executor.pending() == 0) {
+        std::this_thread::yield();
+    }
+    EXPECT_TRUE(opat.lazyCards->isLoaded(index));
+    EXPECT_EQ(executor.pending(), 1u);
+    executor.runOne();
+    EXPECT_DOUBLE_EQ(value.get(), -0.402);
+}
+
+TEST_F(asyncTest, concurrentLookupsMatchEagerCards) {
+    const opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+
+    std::vector<FloatIndexVector> indices;
+    std::vector<std::future<double>> values;
+    for (const auto& index : lazy.cardCatalog.tableIndex | std::views::keys) {
+        indices.push_back(index);
+        values.push_back(std::async(std::launch::async, [&lazy, index] {
+            return opat::async::syncWait(readValue(lazy, index, opat::async::defaultExecutor()));
+        }));
+    }
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        const double expected = eager.get(indices[i])["data"].getData(5, 35, 0);
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(values[i].get()));
+        } else {
+            EXPECT_DOUBLE_EQ(values[i].get(), expected);
+        }
+    }
+    EXPECT_EQ(lazy.lazyCards->loadedCount(), lazy.cardCatalog.tableIndex.size());
+}
+
+TEST_F(asyncTest, tableLookup) {
+    const opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    const FloatIndexVector index({0.35, 0.004}, lazy.header.hashPrecision);
+
+    const auto table = opat::async::syncWait(readTable(lazy, index, "data"));
+    const opat::OPATTable& expected = eager.get(index)["data"];
+    ASSERT_EQ(table->N_R, expected.N_R);
+    ASSERT_EQ(table->N_C, expected.N_C);
+    EXPECT_EQ(std::memcmp(table->getRawData(), expected.getRawData(), table->N_R * table->N_C * sizeof(double)), 0);
+
+    EXPECT_NE(opat::async::syncWait(readTable(eager, index, "data")), nullptr);
+    EXPECT_THROW(opat::async::syncWait(readTable(lazy, index, "missing")), std::out_of_range);
+    EXPECT_THROW(opat::async::syncWait(readTable(lazy, FloatIndexVector({9.0, 9.0}), "data")), std::runtime_error);
+}
+
+TEST_F(asyncTest, unknownCardThrows) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    CountingExecutor executor;
+    EXPECT_THROW(opat::async::syncWait(readValue(opat, FloatIndexVector({9.0, 9.0}), executor)), std::runtime_error);
+}
+
+TEST_F(asyncTest, interpolate) {
+    const opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    const opat::lattice::TableLattice eagerLattice(eager);
+    const opat::lattice::TableLattice lazyLattice(lazy);
+    const FloatIndexVector target({0.54421, 0.077585});
+
+    const opat::DataCard expected = eagerLattice.get(target);
+    const opat::DataCard interpolated = opat::async::syncWait(interpolateAt(lazyLattice, target));
+    const opat::OPATTable& expectedTable = expected["data"];
+    const opat::OPATTable& table = interpolated["data"];
+    ASSERT_EQ(table.N_R, expectedTable.N_R);
+    ASSERT_EQ(table.N_C, expectedTable.N_C);
+    EXPECT_EQ(std::memcmp(table.getRawData(), expectedTable.getRawData(), table.N_R * table.N_C * sizeof(double)), 0);
+    EXPECT_THROW(opat::async::syncWait(interpolateAt(lazyLattice, FloatIndexVector({0.54421, 0.77585}))), std::out_of_range);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "diff.h"
+
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file diffTest.cpp
+ * @brief Unit tests for comparing OPAT files.
+ */
+
+class diffTest : public ::testing::Test {
+protected:
+    opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    FloatIndexVector first = FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision);
+    FloatIndexVector second = FloatIndexVector({0.2, 0.06}, opat.header.hashPrecision);
+    std::string filename = (std::filesystem::temp_directory_path() / "diffTest.opat").string();
+
+    void TearDown() override {
+        std::filesystem::remove(filename);
+    }
+
+    double& value(const FloatIndexVector& index, uint32_t row, uint32_t column) {
+        opat::OPATTable& table = opat.cards.at(index).tableData.at("data");
+        return table.data[static_cast<std::size_t>(row) * table.N_C + column];
+    }
+};
+
+TEST_F(diffTest, compareValues) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+    // Enough values for the vector kernel and a remainder; the mismatches sit in both
+    const std::vector<double> a = {1.0, nan, nan, inf, 1.0, 2.0, 100.0, 0.0, -3.0, 5.0, 7.0};
+    const std::vector<double> b = {1.0, nan, 1.0, inf, inf, 2.0 + 1e-9, 100.5, 0.0, -3.0, 5.0, 7.25};
+
+    const opat::diff::Differences exact = opat::diff::compareValues(a.data(), b.data(), a.size());
+    EXPECT_EQ(exact.values, a.size());
+    EXPECT_EQ(exact.nanMismatches, 1);
+    EXPECT_EQ(exact.mismatches, 5);
+    EXPECT_EQ(exact.maxAbsolute, inf);
+    EXPECT_DOUBLE_EQ(exact.maxRelative, 0.25 / 7.25);
+
+    // Tolerances never hide NaN against a number, nor a number against infinity
+    const opat::diff::Differences tolerant = opat::diff::compareValues(a.data(), b.data(), a.size(), {.absolute = 1e-6, .relative = 0.01});
+    EXPECT_EQ(tolerant.mismatches, 3);
+    EXPECT_EQ(tolerant.nanMismatches, 1);
+
+    // The kernels agree on every length
+    for (std::size_t count = 0; count <= a.size(); ++count) {
+        const opat::diff::Differences prefix = opat::diff::compareValues(a.data(), b.data(), count);
+        opat::diff::Differences expected;
+        for (std::size_t i = 0; i < count; ++i) {
+            expected += opat::diff::compareValues(a.data() + i, b.data() + i, 1);
+        }
+        EXPECT_EQ(prefix.mismatches, expected.mismatches) << count;
+        EXPECT_EQ(prefix.maxAbsolute, expected.maxAbsolute) << count;
+        EXPECT_EQ(prefix.maxRelative, expected.maxRelative) << count;
+    }
+}
+
+TEST_F(diffTest, identicalFiles) {
+    const opat::diff::Report report = opat::diff::compare(EXAMPLE_FILENAME, EXAMPLE_FILENAME, {.threads = 4});
+    EXPECT_TRUE(report.equal());
+    EXPECT_EQ(report.cards, opat.header.numTables);
+    ASSERT_EQ(report.tags.size(), 1);
+    const opat::diff::TagSummary& summary = report.tags.at("data");
+    EXPECT_EQ(summary.tables, opat.header.numTables);
+    EXPECT_EQ(summary.values.values, opat.header.numTables * 19 * 70);
+    EXPECT_EQ(summary.values.maxAbsolute, 0.0);
+    // The example records no checksums, so every table is read
+    EXPECT_EQ(summary.identical, 0);
+
+    opat::writeOPAT(opat, filename);
+    EXPECT_EQ(opat::diff::compare(EXAMPLE_FILENAME, filename).tags.at("data").identical, 0);
+    EXPECT_EQ(opat::diff::compare(filename, filename).tags.at("data").identical, opat.header.numTables);
+    EXPECT_EQ(opat::diff::compare(filename, filename, {.trustChecksums = false}).tags.at("data").identical, 0);
+}
+
+TEST_F(diffTest, changedValues) {
+    ASSERT_FALSE(std::isnan(value(first, 5, 35)));
+    ASSERT_FALSE(std::isnan(value(second, 5, 35)));
+    value(first, 5, 35) += 1e-9;
+    value(second, 5, 35) += 0.5;
+    opat::writeOPAT(opat, filename);
+
+    const opat::diff::Report report = opat::diff::compare(EXAMPLE_FILENAME, filename);
+    EXPECT_FALSE(report.equal());
+    EXPECT_TRUE(report.headerDifferences.empty());
+    const opat::diff::TagSummary& summary = report.tags.at("data");
+    EXPECT_EQ(summary.values.mismatches, 2);
+    EXPECT_NEAR(summary.values.maxAbsolute, 0.5, 1e-12);
+    EXPECT_EQ(summary.worst.card, second);
+    EXPECT_EQ(summary.worst.row, 5);
+    EXPECT_EQ(summary.worst.column, 35);
+
+    const opat::diff::Report tolerant = opat::diff::compare(EXAMPLE_FILENAME, filename, {.absolute = 1e-6});
+    EXPECT_EQ(tolerant.tags.at("data").values.mismatches, 1);
+}
+
+TEST_F(diffTest, missingCards) {
+    opat.cards.erase(first);
+    opat.cardCatalog.tableIndex.erase(first);
+    opat::writeOPAT(opat, filename);
+
+    const opat::diff::Report report = opat::diff::compare(EXAMPLE_FILENAME, filename);
+    EXPECT_FALSE(report.equal());
+    ASSERT_EQ(report.onlyInFirst.size(), 1);
+    EXPECT_EQ(report.onlyInFirst.front(), first);
+    EXPECT_TRUE(report.onlyInSecond.empty());
+    EXPECT_EQ(report.headerDifferences.size(), 1);
+    EXPECT_EQ(report.cards, opat.header.numTables - 1);
+    EXPECT_EQ(report.tags.at("data").values.mismatches, 0);
+    EXPECT_EQ(opat::diff::compare(filename, EXAMPLE_FILENAME).onlyInSecond.size(), 1);
+}
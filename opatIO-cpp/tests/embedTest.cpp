@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "embed.h"
+#include "sha256.h"
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file embedTest.cpp
+ * @brief Unit tests for OPAT files embedded in executables; gs98hz.opat is embedded in this test by opatEmbed.
+ */
+
+namespace opat::embedded {
+    extern const opat::embed::Image gs98hz;
+}
+
+namespace {
+    template <typename T>
+    concept Mutable = requires(T& opat) { opat.cards.clear(); };
+}
+
+class embedTest : public ::testing::Test {};
+
+TEST_F(embedTest, openMatchesFile) {
+    const opat::OPAT file = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::embed::View view = opat::embed::open(opat::embedded::gs98hz);
+    const opat::OPAT& embedded = *view;
+    EXPECT_STREQ(opat::embedded::gs98hz.name, "gs98hz.opat");
+    EXPECT_EQ(std::memcmp(&embedded.header, &file.header, sizeof(opat::Header)), 0);
+    ASSERT_EQ(embedded.cards.size(), file.cards.size());
+
+    for (const auto& [index, entry] : file.cardCatalog.tableIndex) {
+        const opat::CardCatalogEntry& embeddedEntry = embedded.cardCatalog.tableIndex.at(index);
+        EXPECT_EQ(embeddedEntry.byteStart, entry.byteStart);
+        EXPECT_EQ(std::memcmp(embeddedEntry.sha256, entry.sha256, sizeof(entry.sha256)), 0);
+
+        const opat::DataCard& card = file.get(index);
+        const opat::DataCard& embeddedCard = embedded.get(index);
+        EXPECT_EQ(std::memcmp(&embeddedCard.header, &card.header, sizeof(opat::CardHeader)), 0);
+        for (const auto& [tag, table] : card.tableData) {
+            const opat::OPATTable& embeddedTable = embeddedCard[tag];
+            ASSERT_EQ(embeddedTable.N_R, table.N_R);
+            ASSERT_EQ(embeddedTable.N_C, table.N_C);
+            const std::size_t cells = static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize;
+            EXPECT_EQ(std::memcmp(embeddedTable.data.get(), table.data.get(), cells * sizeof(double)), 0);
+            EXPECT_EQ(std::memcmp(embeddedTable.rowValues.get(), table.rowValues.get(), table.N_R * sizeof(double)), 0);
+            EXPECT_EQ(std::memcmp(embeddedTable.columnValues.get(), table.columnValues.get(), table.N_C * sizeof(double)), 0);
+        }
+    }
+
+    const FloatIndexVector index({0.35, 0.004}, embedded.header.hashPrecision);
+    EXPECT_DOUBLE_EQ(embedded.get(index)["data"].getData(5, 35, 0), -0.402);
+    EXPECT_TRUE(opat::sha256::verify(embedded).empty());
+}
+
+TEST_F(embedTest, tablesViewImage) {
+    // Every open views the same aligned arrays, which outlive the OPATs
+    const FloatIndexVector index({0.35, 0.004}, opat::embedded::gs98hz.header.hashPrecision);
+    const double* data = nullptr;
+    {
+        const opat::embed::View first = opat::embed::open(opat::embedded::gs98hz);
+        data = first->get(index)["data"].data.get();
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(data) % 64, 0);
+    }
+    const opat::embed::View second = opat::embed::open(opat::embedded::gs98hz);
+    EXPECT_EQ(second->get(index)["data"].data.get(), data);
+    EXPECT_FALSE(second->get(index)["data"].data.get_deleter().owning);
+}
+
+TEST_F(embedTest, viewIsReadOnly) {
+    // The OPAT is only reachable as const, and cannot be moved or copied out of its view
+    static_assert(Mutable<opat::OPAT>);
+    static_assert(!Mutable<decltype(*std::declval<opat::embed::View&>())>);
+    static_assert(!Mutable<std::remove_pointer_t<decltype(std::declval<opat::embed::View&>().operator->())>>);
+    static_assert(!std::is_constructible_v<opat::OPAT, opat::embed::View&&>);
+    static_assert(!std::is_copy_constructible_v<opat::embed::View>);
+
+    opat::embed::View view = opat::embed::open(opat::embedded::gs98hz);
+    const opat::embed::View moved = std::move(view);
+    EXPECT_EQ(moved->cards.size(), opat::embedded::gs98hz.header.numTables);
+}
+
+TEST_F(embedTest, writeSourceChecksArguments) {
+    const opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    std::ostringstream source;
+    EXPECT_THROW(opat::embed::writeSource(eager, "9lives", EXAMPLE_FILENAME, source), std::invalid_argument);
+    EXPECT_THROW(opat::embed::writeSource(eager, "gs98hz.opat", EXAMPLE_FILENAME, source), std::invalid_argument);
+
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    EXPECT_THROW(opat::embed::writeSource(lazy, "gs98hz", EXAMPLE_FILENAME, source), std::invalid_argument);
+
+    opat::embed::writeSource(eager, "gs98hz", EXAMPLE_FILENAME, source);
+    EXPECT_NE(source.str().find("const opat::embed::Image gs98hz = {"), std::string::npos);
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "inverseLookup.h"
+#include "tableLattice.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file inverseLookupTest.cpp
+ * @brief Unit tests for inverse lookups on tables and lattice-interpolated tables.
+ */
+
+namespace {
+    opat::OPATTable makeTable(uint32_t rows, uint32_t columns, const std::function<double(double, double)>& value) {
+        opat::OPATTable table;
+        table.N_R = rows;
+        table.N_C = columns;
+        table.m_vsize = 1;
+        table.rowValues = std::make_unique<double[]>(rows);
+        table.columnValues = std::make_unique<double[]>(columns);
+        table.data = std::make_unique<double[]>(static_cast<std::size_t>(rows) * columns);
+        for (uint32_t row = 0; row < rows; ++row) {
+            table.rowValues[row] = 0.5 * row;
+        }
+        for (uint32_t column = 0; column < columns; ++column) {
+            table.columnValues[column] = 0.25 * column;
+        }
+        for (uint32_t row = 0; row < rows; ++row) {
+            for (uint32_t column = 0; column < columns; ++column) {
+                table.data[row * columns + column] = value(table.rowValues[row], table.columnValues[column]);
+            }
+        }
+        return table;
+    }
+
+    // Bilinear forward evaluation, the model inverse lookups invert
+    double forward(const opat::OPATTable& table, double row, double column) {
+        const auto locate = [](const double* values, uint32_t count, double x) {
+            const uint32_t cell = static_cast<uint32_t>(std::min<std::ptrdiff_t>(std::upper_bound(values, values + count, x) - values, count - 1) - 1);
+            return std::pair{cell, (x - values[cell]) / (values[cell + 1] - values[cell])};
+        };
+        const auto [r, t] = locate(table.rowValues.get(), table.N_R, row);
+        const auto [c, s] = locate(table.columnValues.get(), table.N_C, column);
+        const auto at = [&](uint32_t i, uint32_t j) { return table.data[i * table.N_C + j]; };
+        return (1 - t) * ((1 - s) * at(r, c) + s * at(r, c + 1)) + t * ((1 - s) * at(r + 1, c) + s * at(r + 1, c + 1));
+    }
+}
+
+class inverseLookupTest : public ::testing::Test {};
+
+TEST_F(inverseLookupTest, linearTableRoundTrip) {
+    const opat::OPATTable table = makeTable(5, 10, [](double row, double column) { return row + 2.0 * column; });
+    const opat::inverse::TableInverse columns(table, opat::inverse::Axis::Column);
+    EXPECT_EQ(columns.runCount(), 5);
+    EXPECT_NEAR(columns.solve(1.3, 1.3 + 2.0 * 0.8), 0.8, 1e-12);
+    EXPECT_NEAR(columns.solve(2.0, 2.0), 0.0, 1e-12);
+    EXPECT_NEAR(columns.solve(2.0, 2.0 + 2.0 * 2.25), 2.25, 1e-12);
+
+    const opat::inverse::TableInverse rows(table, opat::inverse::Axis::Row);
+    EXPECT_EQ(rows.runCount(), 10);
+    EXPECT_NEAR(rows.solve(0.6, 1.7 + 2.0 * 0.6), 1.7, 1e-12);
+}
+
+TEST_F(inverseLookupTest, smallestRootOfNonMonotoneLine) {
+    const opat::OPATTable table = makeTable(2, 17, [](double, double column) { return (column - 2.0) * (column - 2.0); });
+    const opat::inverse::TableInverse inverse(table);
+    EXPECT_EQ(inverse.runCount(), 4);
+    EXPECT_NEAR(inverse.solve(0.25, 1.0), 1.0, 1e-12);
+    EXPECT_NEAR(inverse.solve(0.25, 0.0), 2.0, 1e-12);
+}
+
+TEST_F(inverseLookupTest, unreachableTargetAndErrors) {
+    const opat::OPATTable table = makeTable(3, 4, [](double row, double column) { return row * column; });
+    const opat::inverse::TableInverse inverse(table);
+    EXPECT_TRUE(std::isnan(inverse.solve(0.5, 100.0)));
+    EXPECT_TRUE(std::isnan(inverse.solve(0.5, -1.0)));
+    EXPECT_THROW((void)inverse.solve(1.5, 0.0), std::out_of_range);
+    EXPECT_THROW((void)inverse.solve(-0.1, 0.0), std::out_of_range);
+    EXPECT_THROW(opat::inverse::TableInverse(table, opat::inverse::Axis::Column, 1), std::invalid_argument);
+
+    opat::OPATTable gaps = makeTable(2, 5, [](double, double column) { return column; });
+    gaps.data[1] = gaps.data[6] = std::numeric_limits<double>::quiet_NaN();
+    const opat::inverse::TableInverse gapped(gaps);
+    EXPECT_TRUE(std::isnan(gapped.solve(0.25, 0.1)));
+    EXPECT_NEAR(gapped.solve(0.25, 0.6), 0.6, 1e-12);
+
+    // A missing value before the root, in a line rising and in one falling past it
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (const auto& [line, target, root] : {std::tuple{std::vector<double>{0, 1, nan, 3, 4, 5}, 3.5, 0.875},
+                                             std::tuple{std::vector<double>{5, 4, nan, 1, 2, 3}, 1.5, 0.875}}) {
+        opat::OPATTable missing = makeTable(2, 6, [](double, double) { return 0.0; });
+        std::ranges::copy(line, missing.data.get());
+        std::ranges::copy(line, missing.data.get() + 6);
+        const opat::inverse::TableInverse inverse(missing);
+        EXPECT_NEAR(inverse.solve(0.25, target), root, 1e-12);
+    }
+}
+
+TEST_F(inverseLookupTest, agreesWithForwardEvaluation) {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    const opat::OPATTable table = makeTable(40, 60, [&](double row, double column) { return row - column + noise(generator); });
+    const opat::inverse::TableInverse inverse(table, opat::inverse::Axis::Column);
+    EXPECT_GT(inverse.runCount(), table.N_R);
+
+    std::uniform_real_distribution<double> rows(table.rowValues[0], table.rowValues[table.N_R - 1]);
+    std::uniform_real_distribution<double> columns(table.columnValues[0], table.columnValues[table.N_C - 1]);
+    std::vector<opat::inverse::Query> queries;
+    std::vector<double> sources;
+    for (int i = 0; i < 500; ++i) {
+        const double row = rows(generator);
+        sources.push_back(columns(generator));
+        queries.push_back({row, forward(table, row, sources.back())});
+    }
+
+    const std::vector<double> solved = inverse.solve(queries);
+    ASSERT_EQ(solved.size(), queries.size());
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        ASSERT_FALSE(std::isnan(solved[i])) << "query " << i;
+        EXPECT_LE(solved[i], sources[i] + 1e-9) << "query " << i;
+        EXPECT_NEAR(forward(table, queries[i].fixed, solved[i]), queries[i].target, 1e-9) << "query " << i;
+        EXPECT_EQ(solved[i], inverse.solve(queries[i].fixed, queries[i].target));
+    }
+}
+
+TEST_F(inverseLookupTest, latticeMatchesBlendedTableInterpolate) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(opat);
+    const FloatIndexVector target({0.54421, 0.077585});
+    const opat::DataCard blended = lattice.get(target);
+    const opat::OPATTable& table = blended["data"];
+    const opat::inverse::TableInverse expected(table, opat::inverse::Axis::Column);
+    const opat::inverse::LatticeInverse inverse(lattice, "data", opat::inverse::Axis::Column);
+
+    // Targets taken half way between two rows, at the middle column
+    std::vector<opat::inverse::Query> queries;
+    for (uint32_t row = 0; row + 1 < table.N_R; ++row) {
+        const uint32_t column = table.N_C / 2;
+        const double value = 0.5 * (table.data[row * table.N_C + column] + table.data[(row + 1) * table.N_C + column]);
+        if (!std::isnan(value)) {
+            queries.push_back({0.5 * (table.rowValues[row] + table.rowValues[row + 1]), value});
+        }
+    }
+    ASSERT_FALSE(queries.empty());
+    const std::vector<double> solved = inverse.solve(target, queries);
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        EXPECT_NEAR(solved[i], expected.solve(queries[i].fixed, queries[i].target), 1e-9) << "query " << i;
+    }
+    EXPECT_NEAR(inverse.solve(target, queries[0].fixed, queries[0].target), solved[0], 1e-12);
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "ioBackend.h"
+#include "lazyCardStore.h"
+
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file ioBackendTest.cpp
+ * @brief Unit tests for the batched read backends and LazyCardStore::prefetch(Async).
+ */
+
+class ioBackendTest : public ::testing::TestWithParam<opat::io::BackendKind> {
+protected:
+    void SetUp() override {
+        try {
+            m_backend = opat::io::makeBackend(GetParam(), 8);
+        } catch (const std::runtime_error& e) {
+            GTEST_SKIP() << e.what();
+        }
+        m_fd = ::open(EXAMPLE_FILENAME.c_str(), O_RDONLY);
+        ASSERT_GE(m_fd, 0);
+    }
+
+    void TearDown() override {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    std::unique_ptr<opat::io::IOBackend> m_backend;
+    int m_fd = -1;
+};
+
+TEST_P(ioBackendTest, readsMatchStream) {
+    std::ifstream file(EXAMPLE_FILENAME, std::ios::binary);
+    const std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // More requests than the queue depth, of assorted sizes, so that several submissions are needed
+    opat::io::ReadArena arena(4096);
+    std::vector<opat::io::ReadRequest> requests;
+    for (std::size_t i = 0; i < 50; ++i) {
+        const std::size_t length = 1 + (i * 7919) % 20000;
+        const uint64_t offset = (i * 104729) % (contents.size() - length);
+        requests.push_back({m_fd, offset, length, arena.allocate(length)});
+    }
+    requests.push_back({m_fd, 0, 0, nullptr});
+    m_backend->read(requests);
+    for (const auto& request : requests) {
+        EXPECT_EQ(std::memcmp(request.buffer, contents.data() + request.offset, request.length), 0);
+    }
+}
+
+TEST_P(ioBackendTest, readPastEndOfFileThrows) {
+    std::byte buffer[16];
+    const opat::io::ReadRequest request{m_fd, uint64_t{1} << 40, sizeof(buffer), buffer};
+    EXPECT_THROW(m_backend->read({&request, 1}), std::runtime_error);
+}
+
+TEST_P(ioBackendTest, readAsyncCompletesEveryBatch) {
+    std::ifstream file(EXAMPLE_FILENAME, std::ios::binary);
+    const std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Several batches in flight at once, more reads than the queue depth, and one batch which fails
+    constexpr std::size_t batches = 6;
+    opat::io::ReadArena arena(4096);
+    std::vector<std::vector<opat::io::ReadRequest>> requests(batches);
+    for (std::size_t batch = 0; batch < batches; ++batch) {
+        for (std::size_t i = 0; i < 20; ++i) {
+            const std::size_t length = 1 + (batch * 131 + i * 7919) % 20000;
+            const uint64_t offset = (batch * 31 + i * 104729) % (contents.size() - length);
+            requests[batch].push_back({m_fd, offset, length, arena.allocate(length)});
+        }
+    }
+    std::byte pastEnd[16];
+    requests.back().push_back({m_fd, uint64_t{1} << 40, sizeof(pastEnd), pastEnd});
+
+    std::vector<std::promise<std::exception_ptr>> done(batches);
+    for (std::size_t batch = 0; batch < batches; ++batch) {
+        m_backend->readAsync(requests[batch], [&done, batch](std::exception_ptr error) { done[batch].set_value(error); });
+    }
+    for (std::size_t batch = 0; batch < batches; ++batch) {
+        const std::exception_ptr error = done[batch].get_future().get();
+        if (batch + 1 == batches) {
+            EXPECT_THROW(std::rethrow_exception(error), std::runtime_error);
+            continue;
+        }
+        EXPECT_FALSE(error);
+        for (const auto& request : requests[batch]) {
+            EXPECT_EQ(std::memcmp(request.buffer, contents.data() + request.offset, request.length), 0);
+        }
+    }
+
+    // Nothing to read completes on the calling thread
+    bool empty = false;
+    m_backend->readAsync({}, [&empty](std::exception_ptr error) { empty = !error; });
+    EXPECT_TRUE(empty);
+}
+
+TEST_P(ioBackendTest, concurrentBatches) {
+    std::ifstream file(EXAMPLE_FILENAME, std::ios::binary);
+    const std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Batches from several threads at once, some of which fail, all complete with their own results
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches = 0;
+    std::atomic<int> failures = 0;
+    for (std::size_t t = 0; t < 6; ++t) {
+        threads.emplace_back([&, t] {
+            for (std::size_t round = 0; round < 10; ++round) {
+                opat::io::ReadArena arena(4096);
+                std::vector<opat::io::ReadRequest> requests;
+                for (std::size_t i = 0; i < 20; ++i) {
+                    const std::size_t length = 1 + ((t + 1) * (round + 3) * (i + 1) * 7919) % 20000;
+                    const uint64_t offset = ((t + 1) * (i + round) * 104729) % (contents.size() - length);
+                    requests.push_back({m_fd, offset, length, arena.allocate(length)});
+                }
+                if (t % 3 == 2) {
+                    requests.push_back({m_fd, uint64_t{1} << 40, 16, arena.allocate(16)});
+                    try {
+                        m_backend->read(requests);
+                    } catch (const std::runtime_error&) {
+                        ++failures;
+                    }
+                    continue;
+                }
+                m_backend->read(requests);
+                for (const auto& request : requests) {
+                    mismatches += std::memcmp(request.buffer, contents.data() + request.offset, request.length) != 0;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_EQ(failures, 20);
+}
+
+INSTANTIATE_TEST_SUITE_P(backends, ioBackendTest,
+                         ::testing::Values(opat::io::BackendKind::IOUring, opat::io::BackendKind::ThreadPool));
+
+TEST(readArenaTest, alignment) {
+    opat::io::ReadArena arena(8192);
+    const std::byte* first = arena.allocate(3);
+    const std::byte* aligned = arena.allocate(100, 4096);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % opat::io::ReadArena::BLOCK_ALIGNMENT, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 4096, 0);
+    EXPECT_NE(arena.allocate(1 << 20), nullptr);
+    EXPECT_GE(arena.capacity(), (1 << 20) + 8192);
+    arena.reset();
+    EXPECT_EQ(arena.capacity(), 0);
+    EXPECT_THROW(static_cast<void>(arena.allocate(8, 3)), std::invalid_argument);
+}
+
+TEST(prefetchTest, matchesEagerCards) {
+    const opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+
+    std::vector<FloatIndexVector> indices;
+    for (const auto& index : lazy.cardCatalog.tableIndex | std::views::keys) {
+        indices.push_back(index);
+    }
+    indices.push_back(indices.front()); // duplicates are read once
+    EXPECT_EQ(lazy.lazyCards->prefetch(indices), lazy.cardCatalog.tableIndex.size());
+    EXPECT_EQ(lazy.lazyCards->prefetch(indices), 0);
+    EXPECT_EQ(lazy.lazyCards->loadedCount(), lazy.cardCatalog.tableIndex.size());
+
+    // Only the headers and indices were read; tables are read when named
+    const std::vector<std::string> tags = {"data", "missing"};
+    EXPECT_FALSE(lazy.acquire(indices.front())->isTableRead("data"));
+    EXPECT_EQ(lazy.lazyCards->prefetch(std::span(indices).first(3), tags), 0);
+    for (const auto& index : std::span(indices).first(3)) {
+        EXPECT_TRUE(lazy.acquire(index)->isTableRead("data"));
+    }
+    EXPECT_FALSE(lazy.acquire(indices[3])->isTableRead("data"));
+
+    for (const auto& index : lazy.cardCatalog.tableIndex | std::views::keys) {
+        const auto card = lazy.acquire(index);
+        const opat::OPATTable& expected = eager.get(index)["data"];
+        const opat::OPATTable& table = (*card)["data"];
+        ASSERT_EQ(table.N_R, expected.N_R);
+        ASSERT_EQ(table.N_C, expected.N_C);
+        EXPECT_EQ(std::memcmp(table.getRawData(), expected.getRawData(), table.N_R * table.N_C * sizeof(double)), 0);
+    }
+    EXPECT_EQ(lazy.lazyCards->loadedCount(), lazy.cardCatalog.tableIndex.size());
+}
+
+TEST(prefetchTest, asyncReadsCardsAndTables) {
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    std::vector<FloatIndexVector> indices;
+    for (const auto& index : lazy.cardCatalog.tableIndex | std::views::keys | std::views::take(4)) {
+        indices.push_back(index);
+    }
+
+    // Cards and tables in one go; the indices and tags are copied, so they may go out of scope at once
+    std::promise<std::size_t> loaded;
+    {
+        const std::vector<FloatIndexVector> copy = indices;
+        const std::vector<std::string> tags = {"data"};
+        lazy.lazyCards->prefetchAsync(copy, tags, [&loaded](std::exception_ptr error, std::size_t count) {
+            if (error) {
+                loaded.set_exception(error);
+            } else {
+                loaded.set_value(count);
+            }
+        });
+    }
+    EXPECT_EQ(loaded.get_future().get(), indices.size());
+    for (const auto& index : indices) {
+        EXPECT_TRUE(lazy.lazyCards->isLoaded(index));
+        EXPECT_TRUE(lazy.acquire(index)->isTableRead("data"));
+    }
+    EXPECT_EQ(lazy.lazyCards->loadedCount(), indices.size());
+}
@@ -2,8 +2,14 @@
 #include "opatIO.h"
 #include "tableLattice.h"
 #include "indexVector.h"
+#include "regrid.h"
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
 
@@ -342,6 +348,146 @@ TEST_F(tableLatticeTest, nearDegenerateControlPoint) {
     }
 }
 
+TEST_F(tableLatticeTest, viewOfCatalogPointIsStoredCard) {
+    const opat::OPAT opatObj = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(opatObj);
+    const FloatIndexVector targetVector({0.35, 0.004});
+    const std::shared_ptr<const opat::DataCard> card = lattice.view(targetVector);
+    EXPECT_EQ(card.get(), opatObj.acquire(targetVector).get());
+
+    const std::vector<opat::lattice::Corner> corners = lattice.corners(targetVector);
+    ASSERT_EQ(corners.size(), 1);
+    EXPECT_EQ(corners[0].weight, 1.0);
+
+    const opat::DataCard copied = lattice.get(targetVector);
+    EXPECT_NE(&copied["data"], &(*card)["data"]);
+    EXPECT_EQ(copied["data"](5, 35, 0), (*card)["data"](5, 35, 0));
+
+    // Off catalog points the view is a fresh interpolation
+    const FloatIndexVector offTarget({0.54421, 0.077585});
+    EXPECT_EQ(lattice.view(offTarget)->tableData.size(), lattice.get(offTarget).tableData.size());
+}
+
+TEST_F(tableLatticeTest, getTableMatchesGet) {
+    const opat::OPAT opatObj = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(opatObj);
+    for (const FloatIndexVector& target : {FloatIndexVector({0.54421, 0.077585}), FloatIndexVector({0.35, 0.004})}) {
+        const opat::DataCard card = lattice.get(target);
+        const opat::OPATTable& expected = card["data"];
+        const opat::OPATTable table = lattice.getTable(FloatIndexVector(target.getVector(), opatObj.header.hashPrecision), "data");
+        ASSERT_EQ(table.size(), expected.size());
+        for (int row = 0; row < expected.size().first; ++row) {
+            for (int col = 0; col < expected.size().second; ++col) {
+                EXPECT_TRUE(table(row, col, 0) == expected(row, col, 0) ||
+                            (std::isnan(table(row, col, 0)) && std::isnan(expected(row, col, 0))))
+                    << "Row: " << row << ", Col: " << col;
+            }
+        }
+    }
+    EXPECT_THROW(static_cast<void>(lattice.getTable(FloatIndexVector({0.54421, 0.077585}), "missing")), std::out_of_range);
+    EXPECT_THROW(static_cast<void>(lattice.getTable(FloatIndexVector({0.54421, 0.77585}), "data")), std::out_of_range);
+
+    // Only the requested table of each lazily loaded corner is read
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    const opat::lattice::TableLattice lazyLattice(lazy);
+    static_cast<void>(lazyLattice.getTable(FloatIndexVector({0.54421, 0.077585}), "data"));
+    for (const opat::lattice::Corner& corner : lazyLattice.corners(FloatIndexVector({0.54421, 0.077585}))) {
+        for (const std::string& key : corner.card->getKeys()) {
+            EXPECT_EQ(corner.card->isTableRead(key), key == "data") << key;
+        }
+    }
+}
+
+TEST_F(tableLatticeTest, nearestModeReturnsLargestWeightCorner) {
+    const opat::OPAT opatObj = opat::readOPAT(EXAMPLE_FILENAME);
+    opat::lattice::TableLattice lattice(opatObj);
+    const FloatIndexVector targetVector({0.54421, 0.077585});
+    const std::vector<opat::lattice::Corner> blended = lattice.corners(targetVector);
+    const auto nearest = std::ranges::max_element(blended, {}, &opat::lattice::Corner::weight);
+
+    lattice.setInterpolationType(opat::lattice::InterpolationType::Nearest);
+    EXPECT_EQ(lattice.getInterpolationType(), opat::lattice::InterpolationType::Nearest);
+    EXPECT_EQ(lattice.view(targetVector).get(), nearest->card.get());
+    const opat::DataCard card = lattice.get(targetVector);
+    const opat::OPATTable &expected = (*nearest->card)["data"];
+    for (int row = 0; row < expected.size().first; ++row) {
+        for (int col = 0; col < expected.size().second; ++col) {
+            EXPECT_TRUE(card["data"](row, col, 0) == expected(row, col, 0) ||
+                        (std::isnan(card["data"](row, col, 0)) && std::isnan(expected(row, col, 0))))
+                << "Row: " << row << ", Col: " << col;
+        }
+    }
+}
+
+TEST_F(tableLatticeTest, mismatchedAxesRejected) {
+    // One card on a grid with every other row, as a file mixing grids would have
+    opat::OPAT opatObj = opat::readOPAT(EXAMPLE_FILENAME);
+    const FloatIndexVector coarse({0.35, 0.004}, opatObj.header.hashPrecision);
+    opat::regrid::Axes axes = opat::regrid::axesOf(opatObj[coarse]["data"]);
+    std::vector<double> rows;
+    for (std::size_t i = 0; i < axes.rows.size(); i += 2) {
+        rows.push_back(axes.rows[i]);
+    }
+    axes.rows = rows;
+    opatObj.cards.at(coarse).tableData.at("data") = opat::regrid::resample(opatObj[coarse]["data"], axes);
+    EXPECT_THROW(opat::lattice::TableLattice lattice(opatObj), std::invalid_argument);
+
+    // Once regridded, the cards blend again
+    const opat::OPAT regridded = opat::regrid::regrid(opatObj, {{"data", opat::regrid::commonAxes(opatObj, "data")}});
+    const opat::lattice::TableLattice lattice(regridded);
+    EXPECT_NO_THROW(static_cast<void>(lattice.get(FloatIndexVector({0.54421, 0.077585}))));
+}
+
+TEST_F(tableLatticeTest, subLatticeMatchesFullLattice) {
+    const opat::OPAT opatObj = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(opatObj);
+    const auto expectSameData = [](const opat::DataCard &actual, const opat::DataCard &expected) {
+        const opat::OPATTable &a = actual["data"];
+        const opat::OPATTable &e = expected["data"];
+        ASSERT_EQ(a.size(), e.size());
+        for (int row = 0; row < e.size().first; ++row) {
+            for (int col = 0; col < e.size().second; ++col) {
+                if (std::isnan(e(row, col, 0))) {
+                    EXPECT_TRUE(std::isnan(a(row, col, 0))) << "Row: " << row << ", Col: " << col;
+                } else {
+                    EXPECT_NEAR(a(row, col, 0), e(row, col, 0), 1e-12) << "Row: " << row << ", Col: " << col;
+                }
+            }
+        }
+    };
+
+    // Z on a row of cards, and between two rows, where every vertex blends a card above and one below
+    for (const double z : {0.06, 0.05}) {
+        const opat::lattice::SubLattice constantZ = lattice.restrictTo({std::nullopt, z});
+        EXPECT_EQ(constantZ.dimension(), 1);
+        for (const double x : {0.2, 0.275, 0.6, 0.85}) {
+            expectSameData(constantZ.get(FloatIndexVector({x})), lattice.get(FloatIndexVector({x, z})));
+        }
+    }
+    EXPECT_FALSE(lattice.restrictTo({std::nullopt, 0.05}).isGridLine());
+
+    // A catalog point on the hyperplane is its card
+    const opat::lattice::SubLattice constantX = lattice.restrictTo({0.2, std::nullopt});
+    EXPECT_EQ(constantX.embed(FloatIndexVector({0.06})), FloatIndexVector({0.2, 0.06}));
+    const std::vector<opat::lattice::Corner> corners = constantX.corners(FloatIndexVector({0.06}));
+    ASSERT_EQ(corners.size(), 1);
+    EXPECT_EQ(corners.front().weight, 1.0);
+    expectSameData(constantX.get(FloatIndexVector({0.06})), opatObj[FloatIndexVector({0.2, 0.06})]);
+}
+
+TEST_F(tableLatticeTest, subLatticeRejectsInvalidRestrictions) {
+    const opat::OPAT opatObj = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(opatObj);
+    EXPECT_THROW(static_cast<void>(lattice.restrictTo({0.3})), std::invalid_argument);
+    EXPECT_THROW(static_cast<void>(lattice.restrictTo({std::nullopt, std::nullopt})), std::invalid_argument);
+    EXPECT_THROW(static_cast<void>(lattice.restrictTo({0.3, 0.06})), std::invalid_argument);
+    EXPECT_THROW(static_cast<void>(lattice.restrictTo({std::nullopt, 5.0})), std::out_of_range);
+
+    const opat::lattice::SubLattice constantZ = lattice.restrictTo({std::nullopt, 0.06});
+    EXPECT_THROW(static_cast<void>(constantZ.get(FloatIndexVector({0.3, 0.06}))), std::invalid_argument);
+    EXPECT_THROW(static_cast<void>(constantZ.get(FloatIndexVector({5.0}))), std::out_of_range);
+}
+
 TEST_F(tableLatticeTest, outputUtility_thisTestDoesNotTestAnything) {
     opat::OPAT opatObj = opat::readOPAT(EXAMPLE_FILENAME);
     opat::lattice::TableLattice lattice(opatObj);
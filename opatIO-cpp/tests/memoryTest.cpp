@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "lazyCardStore.h"
+#include "memoryManager.h"
+
+#include <memory>
+#include <ranges>
+#include <string>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file memoryTest.cpp
+ * @brief Unit tests for the memory manager and for lazily loaded cards under a memory budget.
+ */
+
+class memoryTest : public ::testing::Test {};
+
+TEST_F(memoryTest, evictsCheapestPerByteFirst) {
+    opat::memory::MemoryManager manager(300);
+    const auto consumer = manager.registerConsumer("test");
+    std::vector<int> evicted;
+    const auto insert = [&](int tag, std::size_t bytes, double cost) {
+        manager.insert(manager.allocateEntryID(), consumer, bytes, cost, [&evicted, tag] { evicted.push_back(tag); });
+    };
+
+    insert(1, 100, 1000.0); // expensive to reload
+    insert(2, 100, 10.0);   // cheap to reload
+    insert(3, 100, 500.0);
+    EXPECT_EQ(manager.usage(), 300);
+    EXPECT_TRUE(evicted.empty());
+
+    insert(4, 100, 500.0);
+    ASSERT_EQ(evicted, std::vector<int>({2}));
+    insert(5, 150, 500.0);
+    EXPECT_EQ(evicted, std::vector<int>({2, 3, 4}));
+    EXPECT_LE(manager.usage(), 300);
+    manager.unregisterConsumer(consumer);
+    EXPECT_EQ(manager.usage(), 0);
+}
+
+TEST_F(memoryTest, pinnedEntriesAreNotEvicted) {
+    opat::memory::MemoryManager manager(100);
+    const auto consumer = manager.registerConsumer("test");
+    bool firstEvicted = false;
+    const auto first = manager.allocateEntryID();
+    manager.insert(first, consumer, 100, 1.0, [&] { firstEvicted = true; });
+    ASSERT_TRUE(manager.pin(first));
+
+    // Pinned memory alone may exceed the budget; nothing else is evictable, so the manager overshoots
+    manager.insert(manager.allocateEntryID(), consumer, 50, 1.0, {});
+    EXPECT_FALSE(firstEvicted);
+    EXPECT_EQ(manager.usage(), 150);
+
+    // Once unpinned the manager catches up with its budget
+    manager.unpin(first);
+    EXPECT_LE(manager.usage(), 100);
+    EXPECT_FALSE(manager.pin(manager.allocateEntryID()));
+    manager.unregisterConsumer(consumer);
+}
+
+TEST_F(memoryTest, reportIsMergedByName) {
+    opat::memory::MemoryManager manager;
+    const auto a = manager.registerConsumer("a.opat");
+    const auto b = manager.registerConsumer("b.opat");
+    const auto alsoA = manager.registerConsumer("a.opat");
+    manager.insert(manager.allocateEntryID(), a, 10, 1.0, {});
+    manager.insert(manager.allocateEntryID(), alsoA, 20, 1.0, {}, true);
+    manager.insert(manager.allocateEntryID(), b, 5, 1.0, {});
+    {
+        const opat::memory::Reservation reservation(manager, "b.opat", 7);
+        const auto report = manager.report();
+        ASSERT_EQ(report.size(), 2);
+        EXPECT_EQ(report[0].name, "a.opat");
+        EXPECT_EQ(report[0].bytes, 30);
+        EXPECT_EQ(report[0].pinnedBytes, 20);
+        EXPECT_EQ(report[0].entries, 2);
+        EXPECT_EQ(report[1].name, "b.opat");
+        EXPECT_EQ(report[1].bytes, 12);
+        EXPECT_EQ(report[1].pinnedBytes, 7);
+    }
+    EXPECT_EQ(manager.usage(), 35);
+    for (const auto consumer : {a, b, alsoA}) {
+        manager.unregisterConsumer(consumer);
+    }
+}
+
+TEST_F(memoryTest, lazyCardsStayWithinBudget) {
+    const opat::OPAT catalog = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    const FloatIndexVector index({0.35, 0.004}, catalog.header.hashPrecision);
+
+    // Find out how large one card is, then allow room for three of them
+    opat::memory::MemoryManager manager;
+    auto store = std::make_unique<opat::LazyCardStore>(manager);
+    const std::size_t source = store->addSource(EXAMPLE_FILENAME);
+    for (const auto& entry : catalog.cardCatalog.tableIndex | std::views::values) {
+        store->addCard(entry, source);
+    }
+    ASSERT_NE(store->acquire(index), nullptr);
+    const std::size_t cardBytes = manager.usage();
+    ASSERT_GT(cardBytes, 0);
+    manager.setBudget(3 * cardBytes);
+
+    std::shared_ptr<const opat::DataCard> held = store->acquire(index);
+    for (const auto& iv : catalog.cardCatalog.tableIndex | std::views::keys) {
+        EXPECT_NE(store->acquire(iv), nullptr);
+        EXPECT_LE(manager.usage(), 3 * cardBytes);
+    }
+    EXPECT_EQ(manager.report().front().name, EXAMPLE_FILENAME);
+    EXPECT_GT(manager.report().front().evictions, 0);
+    // An evicted card remains valid through the handle that was already held
+    EXPECT_DOUBLE_EQ((*held)["data"].getData(5, 35, 0), -0.402);
+
+    // Pinned cards survive a full sweep and are reloaded on demand once evicted
+    ASSERT_TRUE(store->pin(index));
+    for (const auto& iv : catalog.cardCatalog.tableIndex | std::views::keys) {
+        (void)store->acquire(iv);
+    }
+    EXPECT_TRUE(store->isLoaded(index));
+    store->unpin(index);
+    const std::size_t loadsBefore = store->loadedCount();
+    for (const auto& iv : catalog.cardCatalog.tableIndex | std::views::keys) {
+        (void)store->acquire(iv);
+    }
+    EXPECT_FALSE(store->isLoaded(index));
+    EXPECT_DOUBLE_EQ(store->acquire(index)->get("data").getData(5, 35, 0), -0.402);
+    EXPECT_GT(store->loadedCount(), loadsBefore);
+
+    // Cards handed out by reference are pinned for the lifetime of the store
+    const opat::DataCard* card = store->find(index);
+    for (const auto& iv : catalog.cardCatalog.tableIndex | std::views::keys) {
+        (void)store->acquire(iv);
+    }
+    EXPECT_EQ(store->find(index), card);
+    EXPECT_DOUBLE_EQ((*card)["data"].getData(5, 35, 0), -0.402);
+
+    store.reset();
+    EXPECT_EQ(manager.usage(), 0);
+}
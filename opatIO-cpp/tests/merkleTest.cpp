@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "merkle.h"
+#include "testFiles.h"
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file merkleTest.cpp
+ * @brief Unit tests for the checksum tree of OPAT files.
+ */
+
+class merkleTest : public ::testing::Test {};
+
+TEST_F(merkleTest, combineChildren) {
+    // Reference value of XXH3-64 for empty input
+    EXPECT_EQ(opat::merkle::hash(nullptr, 0), 0x2D06800538D394C2ULL);
+
+    const std::vector<uint64_t> children{1, 2, 3};
+    EXPECT_EQ(opat::merkle::combine(children), opat::merkle::hash(children.data(), children.size() * sizeof(uint64_t)));
+    // As computed by opatio (merkle_combine), so both writers build the same tree
+    EXPECT_EQ(opat::merkle::combine(children), 0x7C68B4906E7EA780ULL);
+    EXPECT_NE(opat::merkle::combine(children), opat::merkle::combine(std::vector<uint64_t>{3, 2, 1}));
+    EXPECT_EQ(opat::merkle::combine({}), 0);
+    EXPECT_EQ(opat::merkle::combine(std::vector<uint64_t>{1, 0, 3}), 0);
+}
+
+TEST_F(merkleTest, verifiedTree) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "merkleTest_tree.opat").string();
+    opat::testing::writeCopy(EXAMPLE_FILENAME, filename);
+    const opat::OPAT eager = opat::readOPAT(filename);
+    EXPECT_NE(eager.header.merkleRoot, 0);
+    EXPECT_EQ(opat::merkle::fileRoot(eager), eager.header.merkleRoot);
+    const FloatIndexVector index({0.35, 0.004}, eager.header.hashPrecision);
+    EXPECT_EQ(opat::merkle::cardRoot(eager.get(index).tableIndex), eager.get(index).header.merkleRoot);
+
+    const opat::merkle::Report report = opat::merkle::verify(eager, 4);
+    EXPECT_TRUE(report.ok());
+    EXPECT_EQ(report.root, eager.header.merkleRoot);
+    EXPECT_EQ(report.tables, eager.cards.size());
+
+    const opat::OPAT lazy = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    EXPECT_TRUE(opat::merkle::verify(lazy, 1).ok());
+    std::filesystem::remove(filename);
+}
+
+TEST_F(merkleTest, corruptTableLocated) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "merkleTest_table.opat").string();
+    const opat::OPAT example = opat::readOPAT(EXAMPLE_FILENAME);
+    const FloatIndexVector index({0.35, 0.004}, example.header.hashPrecision);
+    opat::testing::writeCopy(EXAMPLE_FILENAME, filename, opat::testing::Damage::TableData, index);
+    EXPECT_THROW(static_cast<void>(opat::readOPAT(filename)), std::runtime_error);
+
+    const opat::OPAT lazy = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    const opat::merkle::Report report = opat::merkle::verify(lazy);
+    EXPECT_FALSE(report.ok());
+    EXPECT_TRUE(report.rootMatches);
+    ASSERT_EQ(report.corruptCards.size(), 1);
+    EXPECT_EQ(report.corruptCards.front(), index);
+    std::filesystem::remove(filename);
+}
+
+TEST_F(merkleTest, tamperedIndexRejected) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "merkleTest_index.opat").string();
+    const opat::OPAT example = opat::readOPAT(EXAMPLE_FILENAME);
+    const FloatIndexVector index({0.35, 0.004}, example.header.hashPrecision);
+    const FloatIndexVector other({0.2, 0.06}, example.header.hashPrecision);
+    opat::testing::writeCopy(EXAMPLE_FILENAME, filename, opat::testing::Damage::TableIndex, index);
+    EXPECT_THROW(static_cast<void>(opat::readOPAT(filename)), std::runtime_error);
+
+    // Only the damaged card is rejected, and before any of its tables is read
+    const opat::OPAT lazy = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    EXPECT_NO_THROW(static_cast<void>(lazy.acquire(other)));
+    EXPECT_THROW(static_cast<void>(lazy.acquire(index)), std::runtime_error);
+    std::filesystem::remove(filename);
+}
+
+TEST_F(merkleTest, fileWithoutTree) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    EXPECT_EQ(opat.header.merkleRoot, 0);
+    EXPECT_EQ(opat::merkle::fileRoot(opat), 0);
+    const opat::merkle::Report report = opat::merkle::verify(opat);
+    EXPECT_EQ(report.root, 0);
+    EXPECT_FALSE(report.rootMatches);
+    EXPECT_TRUE(report.corruptCards.empty());
+    EXPECT_EQ(report.tables, opat.cards.size());
+}
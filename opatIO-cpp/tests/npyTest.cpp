@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "npy.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file npyTest.cpp
+ * @brief Unit tests for exchanging tables with NumPy and writing them as text.
+ */
+
+class npyTest : public ::testing::Test {
+protected:
+    opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    FloatIndexVector index = FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision);
+    std::string filename = (std::filesystem::temp_directory_path() / "npyTest.npz").string();
+
+    void TearDown() override {
+        std::filesystem::remove(filename);
+    }
+
+    const opat::OPATTable& table() const {
+        return opat.get(index).get("data");
+    }
+
+    static bool sameTable(const opat::OPATTable& a, const opat::OPATTable& b) {
+        return a.N_R == b.N_R && a.N_C == b.N_C && a.m_vsize == b.m_vsize &&
+               std::memcmp(a.rowValues.get(), b.rowValues.get(), a.N_R * sizeof(double)) == 0 &&
+               std::memcmp(a.columnValues.get(), b.columnValues.get(), a.N_C * sizeof(double)) == 0 &&
+               std::memcmp(a.data.get(), b.data.get(), a.N_R * a.N_C * a.m_vsize * sizeof(double)) == 0;
+    }
+};
+
+TEST_F(npyTest, arrayRoundTrip) {
+    std::stringstream stream;
+    opat::npy::write(table(), stream);
+
+    const std::string bytes = stream.str();
+    ASSERT_EQ(bytes.compare(0, 6, "\x93NUMPY"), 0);
+    const std::size_t headerSize = static_cast<unsigned char>(bytes[8]) | (static_cast<unsigned char>(bytes[9]) << 8);
+    EXPECT_EQ((10 + headerSize) % 64, 0);
+    EXPECT_NE(bytes.find("'shape': (19, 70)"), std::string::npos);
+    EXPECT_EQ(bytes.size(), 10 + headerSize + 19 * 70 * sizeof(double));
+
+    const opat::npy::Array array = opat::npy::read(stream);
+    EXPECT_EQ(array.shape, (std::vector<std::size_t>{19, 70}));
+    EXPECT_EQ(std::memcmp(array.data.get(), table().data.get(), array.size() * sizeof(double)), 0);
+    EXPECT_EQ(array.data[5 * 70 + 35], table()(5, 35, 0));
+
+    std::stringstream vector;
+    const std::vector<double> values = {1.0, -2.5, 3.0};
+    opat::npy::write(values, vector);
+    EXPECT_NE(vector.str().find("'shape': (3,)"), std::string::npos);
+    EXPECT_EQ(opat::npy::read(vector).shape, std::vector<std::size_t>{3});
+}
+
+TEST_F(npyTest, tableAndCardRoundTrip) {
+    opat::npy::writeTable(table(), filename);
+    EXPECT_TRUE(sameTable(opat::npy::readTable(filename), table()));
+
+    const opat::DataCard& card = opat.get(index);
+    opat::npy::writeCard(card, filename);
+    const opat::DataCard read = opat::npy::readCard(filename);
+    EXPECT_EQ(read.header.numTables, 1);
+    const opat::TableIndexEntry& entry = read.tableIndex.get("data");
+    EXPECT_EQ(entry.numRows, 19);
+    EXPECT_EQ(entry.numColumns, 70);
+    EXPECT_EQ(entry.size, 1);
+    EXPECT_TRUE(sameTable(read.get("data"), table()));
+
+    // A table archive is not a card archive
+    opat::npy::writeTable(table(), filename);
+    EXPECT_THROW(static_cast<void>(opat::npy::readCard(filename)), std::runtime_error);
+}
+
+TEST_F(npyTest, vectorCells) {
+    opat::OPATTable cells;
+    cells.N_R = 2;
+    cells.N_C = 3;
+    cells.m_vsize = 2;
+    cells.rowValues = std::make_unique<double[]>(2);
+    cells.columnValues = std::make_unique<double[]>(3);
+    cells.data = std::make_unique<double[]>(12);
+    for (int i = 0; i < 12; ++i) {
+        cells.data[i] = 0.1 * i - 1.0 / 3.0;
+    }
+
+    opat::npy::writeTable(cells, filename);
+    const opat::OPATTable read = opat::npy::readTable(filename);
+    EXPECT_TRUE(sameTable(read, cells));
+
+    std::stringstream stream;
+    opat::npy::write(cells, stream);
+    EXPECT_EQ(opat::npy::read(stream).shape, (std::vector<std::size_t>{2, 3, 2}));
+
+    // Text holds two lines of three cells of two values each, and reads back exactly
+    const std::string text = cells.ascii();
+    std::vector<double> parsed;
+    const char* p = text.data();
+    const char* end = text.data() + text.size();
+    int lines = 0;
+    while (p < end) {
+        double value;
+        const auto [next, error] = std::from_chars(p, end, value);
+        ASSERT_EQ(error, std::errc());
+        parsed.push_back(value);
+        lines += *next == '\n';
+        p = next + 1;
+    }
+    EXPECT_EQ(lines, 2);
+    ASSERT_EQ(parsed.size(), 12);
+    EXPECT_EQ(std::memcmp(parsed.data(), cells.data.get(), sizeof(double) * 12), 0);
+    EXPECT_EQ(text.substr(0, text.find(' ')).find(','), text.substr(0, text.find(' ')).rfind(','));
+}
+
+TEST_F(npyTest, asciiIsExact) {
+    std::ostringstream out;
+    table().writeAscii(out);
+    EXPECT_EQ(out.str(), table().ascii());
+
+    std::istringstream lines(out.str());
+    std::string line;
+    uint32_t row = 0;
+    while (std::getline(lines, line)) {
+        const char* p = line.data();
+        for (uint32_t column = 0; column < table().N_C; ++column) {
+            double value;
+            const auto [next, error] = std::from_chars(p, line.data() + line.size(), value);
+            ASSERT_EQ(error, std::errc());
+            const double expected = table()(row, column, 0);
+            EXPECT_TRUE(value == expected || (std::isnan(value) && std::isnan(expected))) << row << ", " << column;
+            p = next + 1;
+        }
+        ++row;
+    }
+    EXPECT_EQ(row, table().N_R);
+}
+
+TEST_F(npyTest, rejectsUnsupportedInput) {
+    std::stringstream notNpy("not an array");
+    EXPECT_THROW(static_cast<void>(opat::npy::read(notNpy)), std::runtime_error);
+
+    // A float32 array
+    const std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (1,), }\n";
+    std::stringstream float32(std::string("\x93NUMPY\x01\x00", 8) + static_cast<char>(header.size()) + '\0' + header + "abcd");
+    EXPECT_THROW(static_cast<void>(opat::npy::read(float32)), std::runtime_error);
+
+    // A truncated array
+    std::stringstream stream;
+    opat::npy::write(table(), stream);
+    std::stringstream truncated(stream.str().substr(0, stream.str().size() - 8));
+    EXPECT_THROW(static_cast<void>(opat::npy::read(truncated)), std::runtime_error);
+
+    // A corrupted archive fails its CRC
+    opat::npy::writeTable(table(), filename);
+    {
+        std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(200);
+        file.put('\x7f');
+    }
+    EXPECT_THROW(static_cast<void>(opat::npy::readTable(filename)), std::runtime_error);
+    EXPECT_THROW(static_cast<void>(opat::npy::readTable(EXAMPLE_FILENAME)), std::runtime_error);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "numaPlacement.h"
+#include "tableLattice.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file numaTest.cpp
+ * @brief Unit tests for NUMA interleaving and per-node table replicas.
+ */
+
+class numaTest : public ::testing::Test {};
+
+TEST_F(numaTest, topology) {
+    const std::vector<int> nodes = opat::numa::onlineNodes();
+    ASSERT_FALSE(nodes.empty());
+    EXPECT_TRUE(std::ranges::is_sorted(nodes));
+    EXPECT_NE(std::ranges::find(nodes, opat::numa::currentNode()), nodes.end());
+}
+
+TEST_F(numaTest, interleavedLoad) {
+    const opat::OPAT opat = [] {
+        const opat::numa::InterleaveScope interleave;
+        if (opat::numa::onlineNodes().size() < 2) {
+            EXPECT_FALSE(interleave.active());
+        }
+        return opat::readOPAT(EXAMPLE_FILENAME);
+    }();
+    EXPECT_DOUBLE_EQ(opat.get(FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision))["data"].getData(5, 35, 0), -0.402);
+}
+
+TEST_F(numaTest, noReplicasOnSingleNode) {
+    if (opat::numa::onlineNodes().size() > 1) {
+        GTEST_SKIP() << "machine has more than one NUMA node";
+    }
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::numa::Replicas replicas(opat, {"data"});
+    EXPECT_TRUE(replicas.nodes().empty());
+    EXPECT_EQ(replicas.bytes(), 0);
+    EXPECT_EQ(replicas.local(FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision), "data"), nullptr);
+}
+
+TEST_F(numaTest, replicasMatchSource) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    const int node = opat::numa::currentNode();
+    const opat::numa::Replicas replicas(opat, {"data", "missing"}, {node});
+    EXPECT_EQ(replicas.nodes(), std::vector<int>{node});
+    EXPECT_GT(replicas.bytes(), 0);
+
+    const FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+    const opat::OPATTable* copy = replicas.local(index, "data", node);
+    ASSERT_NE(copy, nullptr);
+    const opat::OPATTable& source = opat.get(index)["data"];
+    ASSERT_EQ(copy->N_R, source.N_R);
+    ASSERT_EQ(copy->N_C, source.N_C);
+    EXPECT_NE(copy->getRawData(), source.getRawData());
+    EXPECT_EQ(std::memcmp(copy->getRawData(), source.getRawData(), source.N_R * source.N_C * sizeof(double)), 0);
+    EXPECT_EQ(replicas.local(index, "missing", node), nullptr);
+    EXPECT_EQ(replicas.local(index, "data", node + 1), nullptr);
+}
+
+TEST_F(numaTest, latticeReadsReplicasInterpolate) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(opat);
+    opat::lattice::TableLattice replicated(opat);
+    replicated.setReplicas(std::make_shared<const opat::numa::Replicas>(
+        opat, std::vector<std::string>{"data"}, opat::numa::onlineNodes()));
+
+    const FloatIndexVector target({0.54421, 0.077585});
+    const opat::DataCard expected = lattice.get(target);
+    const opat::DataCard interpolated = replicated.get(target);
+    const opat::OPATTable& expectedTable = expected["data"];
+    const opat::OPATTable& table = interpolated["data"];
+    ASSERT_EQ(table.N_R, expectedTable.N_R);
+    ASSERT_EQ(table.N_C, expectedTable.N_C);
+    EXPECT_EQ(std::memcmp(table.getRawData(), expectedTable.getRawData(), table.N_R * table.N_C * sizeof(double)), 0);
+}
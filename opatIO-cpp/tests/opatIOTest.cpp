@@ -2,9 +2,25 @@
 #include "opatIO.h"
 #include "indexVector.h"
 #include "picosha2.h"
+#include "queryTrace.h"
+#include "lazyCardStore.h"
+#include "merkle.h"
+#include "sha256.h"
+#include "testFiles.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
 
@@ -158,3 +174,260 @@ TEST_F(opatIOTest, badKey) {
     FloatIndexVector index({0.35, 0.004});
     EXPECT_THROW(opat[index]["non_existent_key"], std::out_of_range);
 }
+
+TEST_F(opatIOTest, recordQueryTrace) {
+    const std::string tracePath = (std::filesystem::temp_directory_path() / "opatIOTest_queries.optr").string();
+    opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    opat.recorder = std::make_shared<opat::trace::QueryRecorder>(tracePath);
+
+    const auto& card = opat.get(FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision));
+    static_cast<void>(card);
+    EXPECT_THROW(static_cast<void>(opat.get(FloatIndexVector({0.351, 0.004}))), std::runtime_error);
+    EXPECT_EQ(opat.recorder->count(), 2);
+    opat.recorder.reset();
+
+    const auto records = opat::trace::readTrace(tracePath);
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].kind, opat::trace::QueryKind::Card);
+    ASSERT_EQ(records[0].index.size(), 2);
+    EXPECT_DOUBLE_EQ(records[0].index[0], 0.35);
+    EXPECT_DOUBLE_EQ(records[0].index[1], 0.004);
+    EXPECT_DOUBLE_EQ(records[1].index[0], 0.351);
+    EXPECT_LE(records[0].timestamp, records[1].timestamp);
+    std::filesystem::remove(tracePath);
+}
+
+TEST_F(opatIOTest, readInvalidQueryTrace) {
+    EXPECT_THROW(static_cast<void>(opat::trace::readTrace(EXAMPLE_FILENAME)), std::runtime_error);
+}
+
+TEST_F(opatIOTest, lazyLoad) {
+    opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    ASSERT_NE(lazy.lazyCards, nullptr);
+    EXPECT_TRUE(lazy.cards.empty());
+    EXPECT_EQ(lazy.lazyCards->size(), 126);
+    EXPECT_EQ(lazy.lazyCards->loadedCount(), 0);
+
+    const FloatIndexVector index({0.35, 0.004}, lazy.header.hashPrecision);
+    EXPECT_FALSE(lazy.lazyCards->isLoaded(index));
+    const opat::DataCard& card = lazy.get(index);
+    EXPECT_TRUE(lazy.lazyCards->isLoaded(index));
+    EXPECT_EQ(lazy.lazyCards->loadedCount(), 1);
+    EXPECT_EQ(&lazy.get(index), &card);
+    EXPECT_DOUBLE_EQ(card["data"].getData(5, 35, 0), eager.get(index)["data"].getData(5, 35, 0));
+
+    EXPECT_THROW(static_cast<void>(lazy.get(FloatIndexVector({0.351, 0.004}))), std::runtime_error);
+    EXPECT_EQ(lazy.getBounds().size(), eager.getBounds().size());
+    EXPECT_DOUBLE_EQ(lazy.getBounds()[0].max, eager.getBounds()[0].max);
+}
+
+TEST_F(opatIOTest, deferredTables) {
+    const opat::OPAT catalog = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    const FloatIndexVector index({0.35, 0.004}, catalog.header.hashPrecision);
+    const auto source = std::make_shared<opat::OPATFileHandle>(EXAMPLE_FILENAME);
+    const opat::DataCard card = opat::readDataCardDeferred(source, catalog.cardCatalog.tableIndex.at(index));
+
+    // Only the table index has been read
+    ASSERT_NE(card.deferredTables, nullptr);
+    EXPECT_TRUE(card.tableData.empty());
+    EXPECT_EQ(card.getKeys(), std::vector<std::string>({"data"}));
+
+    // Concurrent first retrievals read the table once
+    std::vector<const opat::OPATTable*> tables(4);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < tables.size(); ++i) {
+        threads.emplace_back([&, i] { tables[i] = &card.get("data"); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto* table : tables) {
+        EXPECT_EQ(table, tables[0]);
+    }
+    EXPECT_DOUBLE_EQ(card["data"].getData(5, 35, 0), -0.402);
+    EXPECT_THROW(static_cast<void>(card.get("missing")), std::out_of_range);
+}
+
+TEST_F(opatIOTest, directLoad) {
+    const opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPAT direct = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Direct);
+    ASSERT_EQ(direct.cards.size(), eager.cards.size());
+    EXPECT_EQ(direct.lazyCards, nullptr);
+    for (const auto& [index, card] : eager.cards) {
+        const opat::OPATTable& expected = card["data"];
+        const opat::OPATTable& table = direct.get(index)["data"];
+        ASSERT_EQ(table.N_R, expected.N_R);
+        ASSERT_EQ(table.N_C, expected.N_C);
+        EXPECT_EQ(std::memcmp(table.getRawData(), expected.getRawData(), table.N_R * table.N_C * sizeof(double)), 0);
+    }
+}
+
+TEST_F(opatIOTest, computedStatistics) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::TagStatistics stats = opat.getStatistics("data");
+    EXPECT_EQ(stats.cards, opat.cards.size());
+    EXPECT_EQ(stats.computedCards, stats.cards);
+
+    double min = INFINITY;
+    double max = -INFINITY;
+    uint64_t nanCount = 0;
+    for (const opat::DataCard& card : opat.cards | std::views::values) {
+        const opat::OPATTable& table = card["data"];
+        for (uint32_t i = 0; i < table.N_R * table.N_C; ++i) {
+            const double value = table.getRawData()[i];
+            nanCount += std::isnan(value);
+            min = std::isnan(value) ? min : std::min(min, value);
+            max = std::isnan(value) ? max : std::max(max, value);
+        }
+    }
+    EXPECT_EQ(stats.min, min);
+    EXPECT_EQ(stats.max, max);
+    EXPECT_EQ(stats.nanCount, nanCount);
+    EXPECT_TRUE(std::isfinite(stats.mean));
+    EXPECT_THROW(static_cast<void>(opat.getStatistics("missing")), std::out_of_range);
+}
+
+TEST_F(opatIOTest, storedStatistics) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "opatIOTest_statistics.opat").string();
+    opat::testing::writeCopy(EXAMPLE_FILENAME, filename);
+    const opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPAT lazy = opat::readOPAT(filename, opat::LoadMode::Lazy);
+
+    // Summarized from the stored statistics alone
+    const opat::TagStatistics stored = lazy.getStatistics("data");
+    const opat::TagStatistics computed = eager.getStatistics("data");
+    EXPECT_EQ(stored.computedCards, 0);
+    EXPECT_EQ(stored.cards, computed.cards);
+    EXPECT_EQ(stored.min, computed.min);
+    EXPECT_EQ(stored.max, computed.max);
+    EXPECT_EQ(stored.nanCount, computed.nanCount);
+    EXPECT_EQ(stored.valueCount, computed.valueCount);
+    EXPECT_NEAR(stored.mean, computed.mean, 1e-12 * std::abs(computed.mean));
+
+    const FloatIndexVector index({0.35, 0.004}, lazy.header.hashPrecision);
+    const auto source = std::make_shared<opat::OPATFileHandle>(filename);
+    const opat::DataCard card = opat::readDataCardDeferred(source, lazy.cardCatalog.tableIndex.at(index));
+    const opat::TableStatistics& statistics = card.tableIndex.getStatistics("data");
+    const opat::TableStatistics expected = opat::computeStatistics("data", eager.get(index)["data"]);
+    EXPECT_EQ(statistics.min, expected.min);
+    EXPECT_EQ(statistics.max, expected.max);
+    EXPECT_EQ(statistics.nanCount, expected.nanCount);
+    EXPECT_THROW(static_cast<void>(card.tableIndex.getStatistics("missing")), std::out_of_range);
+
+    // The statistics section does not disturb reading the tables
+    EXPECT_DOUBLE_EQ(card["data"].getData(5, 35, 0), -0.402);
+    EXPECT_DOUBLE_EQ(opat::readOPAT(filename).get(index)["data"].getData(5, 35, 0), -0.402);
+    std::filesystem::remove(filename);
+}
+
+TEST_F(opatIOTest, verifiedChecksums) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "opatIOTest_checksums.opat").string();
+    opat::testing::writeCopy(EXAMPLE_FILENAME, filename);
+    const opat::OPAT opat = opat::readOPAT(filename);
+    const FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+    const opat::DataCard& card = opat.get(index);
+    EXPECT_NE(card.tableIndex["data"].checksum, 0);
+    EXPECT_EQ(card.tableIndex["data"].checksum, opat::computeChecksum(card["data"]));
+    EXPECT_DOUBLE_EQ(card["data"].getData(5, 35, 0), -0.402);
+
+    // The checksum covers the axes as well as the data
+    opat::OPATTable table = card["data"].slice({0, card["data"].N_R}, {0, card["data"].N_C});
+    const uint64_t checksum = opat::computeChecksum(table);
+    EXPECT_EQ(checksum, card.tableIndex["data"].checksum);
+    table.columnValues[0] += 1.0;
+    EXPECT_NE(opat::computeChecksum(table), checksum);
+
+    // Files written without checksums are read as before
+    EXPECT_EQ(opat::readOPAT(EXAMPLE_FILENAME).get(index).tableIndex["data"].checksum, 0);
+    std::filesystem::remove(filename);
+}
+
+TEST_F(opatIOTest, corruptTableRejected) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "opatIOTest_corrupt.opat").string();
+    const opat::OPAT example = opat::readOPAT(EXAMPLE_FILENAME);
+    const FloatIndexVector index({0.35, 0.004}, example.header.hashPrecision);
+    opat::testing::writeCopy(EXAMPLE_FILENAME, filename, opat::testing::Damage::TableData, index);
+    EXPECT_THROW(static_cast<void>(opat::readOPAT(filename)), std::runtime_error);
+
+    // Lazily loaded cards are checked when their tables are first read
+    const opat::OPAT lazy = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    const FloatIndexVector other({0.2, 0.06}, example.header.hashPrecision);
+    EXPECT_NO_THROW(static_cast<void>(lazy.get(other)["data"]));
+    EXPECT_THROW(static_cast<void>(lazy.get(index)["data"]), std::runtime_error);
+    std::filesystem::remove(filename);
+}
+
+TEST_F(opatIOTest, corruptCardReportedByOffset) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "opatIOTest_offset.opat").string();
+    const opat::OPAT example = opat::readOPAT(EXAMPLE_FILENAME);
+    const FloatIndexVector index({0.35, 0.004}, example.header.hashPrecision);
+    const auto errorOf = [](const auto& read) {
+        try {
+            read();
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    // Cards read from memory, by direct loads and lazy prefetches, are reported where they are in the file
+    opat::testing::writeCopy(EXAMPLE_FILENAME, filename, opat::testing::Damage::TableData, index);
+    const opat::OPAT lazy = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    const std::string where = "card at byte " + std::to_string(lazy.cardCatalog.tableIndex.at(index).byteStart) + ";";
+    const std::vector<FloatIndexVector> indices{index};
+    const std::vector<std::string> tags{"data"};
+    EXPECT_NE(errorOf([&] { static_cast<void>(opat::readOPAT(filename, opat::LoadMode::Direct)); }).find(where), std::string::npos);
+    EXPECT_NE(errorOf([&] { static_cast<void>(lazy.lazyCards->prefetch(indices, tags)); }).find(where), std::string::npos);
+
+    opat::testing::writeCopy(EXAMPLE_FILENAME, filename, opat::testing::Damage::TableIndex, index);
+    const opat::OPAT damagedIndex = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    const std::string indexWhere = "card at byte " + std::to_string(damagedIndex.cardCatalog.tableIndex.at(index).byteStart) + " ";
+    EXPECT_NE(errorOf([&] { static_cast<void>(opat::readOPAT(filename, opat::LoadMode::Direct)); }).find(indexWhere), std::string::npos);
+    EXPECT_NE(errorOf([&] { static_cast<void>(damagedIndex.lazyCards->prefetch(indices)); }).find(indexWhere), std::string::npos);
+    std::filesystem::remove(filename);
+}
+
+TEST_F(opatIOTest, writeRoundTrip) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "opatIOTest_written.opat").string();
+    const opat::OPAT source = opat::readOPAT(EXAMPLE_FILENAME);
+    opat::writeOPAT(source, filename);
+    const opat::OPAT written = opat::readOPAT(filename);
+    EXPECT_EQ(written.header.numTables, source.header.numTables);
+    EXPECT_EQ(std::filesystem::file_size(filename), std::filesystem::file_size(EXAMPLE_FILENAME) +
+              source.header.numTables * sizeof(opat::TableStatistics));
+
+    for (const auto& [index, entry] : source.cardCatalog.tableIndex) {
+        // The catalog digests of the example are those of the tables as written
+        EXPECT_EQ(std::memcmp(written.cardCatalog.tableIndex.at(index).sha256, entry.sha256, sizeof(entry.sha256)), 0);
+        const opat::OPATTable& table = source.get(index)["data"];
+        const opat::OPATTable& writtenTable = written.get(index)["data"];
+        const std::size_t cells = static_cast<std::size_t>(table.N_R) * table.N_C * table.m_vsize;
+        EXPECT_EQ(std::memcmp(writtenTable.data.get(), table.data.get(), cells * sizeof(double)), 0);
+        EXPECT_EQ(written.get(index).tableIndex["data"].checksum, opat::computeChecksum(table));
+    }
+    EXPECT_TRUE(opat::merkle::verify(written).ok());
+    EXPECT_TRUE(opat::sha256::verify(written).empty());
+
+    const FloatIndexVector index({0.35, 0.004}, written.header.hashPrecision);
+    const opat::OPAT lazy = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    EXPECT_EQ(lazy.getStatistics("data").computedCards, 0);
+    EXPECT_DOUBLE_EQ(lazy.get(index)["data"].getData(5, 35, 0), -0.402);
+    std::filesystem::remove(filename);
+}
+
+TEST_F(opatIOTest, writeOversizedTable) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "opatIOTest_oversized.opat").string();
+    std::filesystem::remove(filename);
+    opat::OPAT source = opat::readOPAT(EXAMPLE_FILENAME);
+    opat::OPATTable& table = source.cards.at(FloatIndexVector({0.35, 0.004}, source.header.hashPrecision)).tableData.at("data");
+    table.N_R = std::numeric_limits<uint16_t>::max() + 1;
+    table.N_C = 1;
+    table.rowValues = std::make_unique<double[]>(table.N_R);
+    table.columnValues = std::make_unique<double[]>(table.N_C);
+    table.data = std::make_unique<double[]>(table.N_R * table.m_vsize);
+
+    // Rejected before anything is written, rather than recording a truncated row count
+    EXPECT_THROW(opat::writeOPAT(source, filename), std::length_error);
+    EXPECT_FALSE(std::filesystem::exists(filename));
+}
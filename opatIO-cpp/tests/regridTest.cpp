@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "regrid.h"
+#include "merkle.h"
+
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file regridTest.cpp
+ * @brief Unit tests for resampling tables onto common axes.
+ */
+
+class regridTest : public ::testing::Test {
+protected:
+    opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    FloatIndexVector coarse = FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision);
+    FloatIndexVector other = FloatIndexVector({0.2, 0.06}, opat.header.hashPrecision);
+
+    // Keeps every other row of the table of `coarse`, as a card computed on a coarser grid would have
+    void coarsen() {
+        opat::OPATTable& table = opat.cards.at(coarse).tableData.at("data");
+        opat::regrid::Axes axes = opat::regrid::axesOf(table);
+        std::vector<double> rows;
+        for (std::size_t i = 0; i < axes.rows.size(); i += 2) {
+            rows.push_back(axes.rows[i]);
+        }
+        axes.rows = rows;
+        table = opat::regrid::resample(table, axes);
+        opat.cards.at(coarse).tableIndex.tableIndex.at("data").numRows = static_cast<uint16_t>(table.N_R);
+    }
+};
+
+TEST_F(regridTest, resampleBilinear) {
+    const opat::OPATTable& table = opat.get(coarse)["data"];
+    opat::regrid::Axes axes = opat::regrid::axesOf(table);
+    axes.rows = {table.rowValues[5], 0.5 * (table.rowValues[5] + table.rowValues[6]), table.rowValues[table.N_R - 1] + 1.0};
+    const opat::OPATTable resampled = opat::regrid::resample(table, axes);
+    ASSERT_EQ(resampled.N_R, 3);
+    ASSERT_EQ(resampled.N_C, table.N_C);
+
+    // Nodes of the table are copied, values between them blended, values beyond them NaN; the columns,
+    // which are left as they are, are taken as they are
+    EXPECT_EQ(resampled.getData(0, 35, 0), table.getData(5, 35, 0));
+    EXPECT_DOUBLE_EQ(resampled.getData(0, 35, 0), -0.402);
+    EXPECT_NEAR(resampled.getData(1, 35, 0), 0.5 * (table.getData(5, 35, 0) + table.getData(6, 35, 0)), 1e-12);
+    EXPECT_TRUE(std::isnan(resampled.getData(2, 35, 0)));
+
+    // Both axes at once, on a 2 x 2 table with two values per cell
+    opat::OPATTable square;
+    square.N_R = 2;
+    square.N_C = 2;
+    square.m_vsize = 2;
+    square.rowValues = std::make_unique<double[]>(2);
+    square.columnValues = std::make_unique<double[]>(2);
+    square.data = std::make_unique<double[]>(8);
+    square.rowValues[1] = 1.0;
+    square.columnValues[1] = 2.0;
+    for (int i = 0; i < 8; ++i) {
+        square.data[i] = i;
+    }
+    const opat::OPATTable centre = opat::regrid::resample(square, {{0.25}, {1.5}});
+    // (1 - 0.25) * ((1 - 0.75) * v00 + 0.75 * v01) + 0.25 * ((1 - 0.75) * v10 + 0.75 * v11)
+    EXPECT_DOUBLE_EQ(centre.getData(0, 0, 0), 0.75 * (0.25 * 0 + 0.75 * 2) + 0.25 * (0.25 * 4 + 0.75 * 6));
+    EXPECT_DOUBLE_EQ(centre.getData(0, 0, 1), 0.75 * (0.25 * 1 + 0.75 * 3) + 0.25 * (0.25 * 5 + 0.75 * 7));
+
+    axes.rows = {axes.rows[1], axes.rows[0]};
+    EXPECT_THROW(static_cast<void>(opat::regrid::resample(table, axes)), std::invalid_argument);
+    axes = opat::regrid::axesOf(table);
+    axes.columns.pop_back();
+    EXPECT_THROW(static_cast<void>(opat::regrid::resample(table, axes)), std::invalid_argument);
+}
+
+TEST_F(regridTest, commonAxes) {
+    EXPECT_TRUE(opat::regrid::sharesAxes(opat, "data"));
+    const opat::regrid::Axes original = opat::regrid::axesOf(opat.get(coarse)["data"]);
+    EXPECT_EQ(opat::regrid::commonAxes(opat, "data"), original);
+
+    coarsen();
+    EXPECT_FALSE(opat::regrid::sharesAxes(opat, "data"));
+    EXPECT_EQ(opat::regrid::commonAxes(opat, "data", opat::regrid::AxisPolicy::Union), original);
+    // The coarse card stops at the last even row, so the overlap does too
+    const opat::regrid::Axes overlap = opat::regrid::commonAxes(opat, "data");
+    EXPECT_EQ(overlap.columns, original.columns);
+    EXPECT_EQ(overlap.rows.back(), original.rows[(original.rows.size() - 1) / 2 * 2]);
+    EXPECT_THROW(static_cast<void>(opat::regrid::commonAxes(opat, "missing")), std::invalid_argument);
+}
+
+TEST_F(regridTest, regridCards) {
+    const opat::OPAT source = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::regrid::Axes original = opat::regrid::axesOf(source.get(coarse)["data"]);
+    coarsen();
+    const opat::OPAT regridded = opat::regrid::regrid(opat, {{"data", opat::regrid::commonAxes(opat, "data", opat::regrid::AxisPolicy::Union)}}, 4);
+    EXPECT_TRUE(opat::regrid::sharesAxes(regridded, "data"));
+    EXPECT_EQ(regridded.cards.size(), source.cards.size());
+    EXPECT_EQ(regridded.header.merkleRoot, 0);
+
+    // Cards already on the common axes are unchanged; the coarse one is filled in between its rows
+    const opat::OPATTable& unchanged = regridded.get(other)["data"];
+    const opat::OPATTable& filled = regridded.get(coarse)["data"];
+    const opat::OPATTable& expected = source.get(coarse)["data"];
+    EXPECT_EQ(regridded.get(coarse).tableIndex["data"].numRows, original.rows.size());
+    const auto same = [](double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); };
+    for (uint32_t column = 0; column < expected.N_C; ++column) {
+        EXPECT_TRUE(same(unchanged.getData(3, column, 0), source.get(other)["data"].getData(3, column, 0)));
+        EXPECT_TRUE(same(filled.getData(4, column, 0), expected.getData(4, column, 0)));
+        const double a = expected.getData(4, column, 0);
+        const double b = expected.getData(6, column, 0);
+        const double fraction = (original.rows[5] - original.rows[4]) / (original.rows[6] - original.rows[4]);
+        if (!std::isnan(a) && !std::isnan(b)) {
+            EXPECT_DOUBLE_EQ(filled.getData(5, column, 0), (1 - fraction) * a + fraction * b);
+        }
+    }
+
+    // Written out, the regridded file records checksums for its new tables
+    const std::string filename = (std::filesystem::temp_directory_path() / "regridTest.opat").string();
+    opat::writeOPAT(regridded, filename);
+    const opat::OPAT written = opat::readOPAT(filename);
+    EXPECT_TRUE(opat::merkle::verify(written).ok());
+    EXPECT_TRUE(opat::regrid::sharesAxes(written, "data"));
+    std::filesystem::remove(filename);
+}
+
+TEST_F(regridTest, regridTooManyRows) {
+    opat::regrid::Axes axes = opat::regrid::axesOf(opat.get(other)["data"]);
+    axes.rows.resize(std::size_t{std::numeric_limits<uint16_t>::max()} + 1);
+    for (std::size_t i = 0; i < axes.rows.size(); ++i) {
+        axes.rows[i] = static_cast<double>(i);
+    }
+    EXPECT_THROW(static_cast<void>(opat::regrid::regrid(opat, {{"data", axes}})), std::length_error);
+}
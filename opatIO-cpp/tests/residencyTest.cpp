@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "residency.h"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <ranges>
+#include <string>
+
+#include <sys/resource.h>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file residencyTest.cpp
+ * @brief Unit tests for huge page and mlock requests on table memory.
+ */
+
+class residencyTest : public ::testing::Test {};
+
+TEST_F(residencyTest, smallTablesAreNotEligible) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    std::size_t expected = 0;
+    for (const opat::DataCard& card : opat.cards | std::views::values) {
+        for (const opat::OPATTable& table : card.tableData | std::views::values) {
+            expected += (table.N_R + table.N_C + table.N_R * table.N_C * table.m_vsize) * sizeof(double);
+        }
+    }
+    const opat::memory::ResidencyStats stats = opat::memory::applyResidency(opat, {.hugePages = true});
+    EXPECT_EQ(stats.tableBytes, expected);
+    EXPECT_EQ(stats.hugePageEligibleBytes, 0);
+    EXPECT_EQ(stats.hugePageBytes, 0);
+    EXPECT_EQ(stats.hugePageCoverage(), 0.0);
+
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    EXPECT_EQ(opat::memory::residencyStats(lazy).tableBytes, 0);
+}
+
+TEST_F(residencyTest, lockAndUnlock) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const std::size_t tableBytes = opat::memory::residencyStats(opat).tableBytes;
+    rlimit limit{};
+    ::getrlimit(RLIMIT_MEMLOCK, &limit);
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < 2 * tableBytes) {
+        GTEST_SKIP() << "RLIMIT_MEMLOCK too low";
+    }
+    EXPECT_EQ(opat::memory::applyResidency(opat, {.lock = true}).lockedBytes, tableBytes);
+    opat::memory::unlockTables(opat);
+    EXPECT_EQ(opat::memory::residencyStats(opat).lockedBytes, 0);
+}
+
+TEST_F(residencyTest, largeTableUsesHugePages) {
+    opat::OPAT opat;
+    opat::OPATTable table;
+    table.N_R = 1024;
+    table.N_C = 1024;
+    table.m_vsize = 1;
+    table.rowValues = std::make_unique<double[]>(table.N_R);
+    table.columnValues = std::make_unique<double[]>(table.N_C);
+    table.data = std::make_unique<double[]>(table.N_R * table.N_C);
+    opat.cards[FloatIndexVector({0.0})].tableData.emplace("big", std::move(table));
+
+    const opat::memory::ResidencyStats stats = opat::memory::applyResidency(opat, {.hugePages = true});
+    // 8 MiB holds at least three whole, aligned 2 MiB pages wherever it starts
+    EXPECT_GE(stats.hugePageEligibleBytes, std::size_t{6} << 20);
+    EXPECT_LE(stats.hugePageBytes, stats.hugePageEligibleBytes);
+
+    std::ifstream enabled("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string modes((std::istreambuf_iterator<char>(enabled)), std::istreambuf_iterator<char>());
+    if (modes.find("[never]") == std::string::npos) {
+        std::cout << "Huge page coverage: " << stats.hugePageCoverage() << std::endl;
+    }
+}
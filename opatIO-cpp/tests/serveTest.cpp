@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "tableLattice.h"
+#include "serveServer.h"
+#include "serveClient.h"
+#include "serveClientC.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file serveTest.cpp
+ * @brief Unit tests for the opatServe server and its C++ and C clients.
+ */
+
+class serveTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        s_socketPath = (std::filesystem::temp_directory_path() / ("serveTest_" + std::to_string(getpid()) + ".sock")).string();
+        s_server = std::make_unique<opat::serve::Server>(std::vector<std::string>{EXAMPLE_FILENAME});
+        s_server->listen(s_socketPath);
+        s_thread = std::thread([] { s_server->run(); });
+    }
+    static void TearDownTestSuite() {
+        s_server->stop();
+        s_thread.join();
+        s_server.reset();
+    }
+    static std::string s_socketPath;
+    static std::unique_ptr<opat::serve::Server> s_server;
+    static std::thread s_thread;
+};
+
+std::string serveTest::s_socketPath;
+std::unique_ptr<opat::serve::Server> serveTest::s_server;
+std::thread serveTest::s_thread;
+
+TEST_F(serveTest, info) {
+    opat::serve::Client client(s_socketPath);
+    const auto files = client.info();
+    ASSERT_EQ(files.size(), 1);
+    EXPECT_EQ(files[0].filename, EXAMPLE_FILENAME);
+    EXPECT_EQ(files[0].numCards, 126);
+    EXPECT_EQ(files[0].numIndex, 2);
+}
+
+TEST_F(serveTest, batchedGet) {
+    opat::serve::Client client(s_socketPath);
+    const auto results = client.get(0, "data", {{0.35, 0.004}, {0.351, 0.004}});
+    ASSERT_EQ(results.size(), 2);
+    ASSERT_TRUE(results[0].ok()) << results[0].error;
+    EXPECT_EQ(results[0].table.N_R, 19);
+    EXPECT_EQ(results[0].table.N_C, 70);
+    EXPECT_DOUBLE_EQ(results[0].table.getData(5, 35, 0), -0.402);
+    EXPECT_EQ(results[1].status, opat::serve::Status::NotFound);
+    EXPECT_FALSE(results[1].error.empty());
+
+    // The connection stays usable for further requests
+    const auto badTag = client.get(0, "nope", {{0.35, 0.004}});
+    ASSERT_EQ(badTag.size(), 1);
+    EXPECT_EQ(badTag[0].status, opat::serve::Status::NotFound);
+}
+
+TEST_F(serveTest, rejectedRequests) {
+    opat::serve::Client client(s_socketPath);
+    EXPECT_THROW(static_cast<void>(client.get(7, "data", {{0.35, 0.004}})), std::runtime_error);
+    EXPECT_THROW(static_cast<void>(client.get(0, "data", {{0.35, 0.004, 1.0}})), std::runtime_error);
+    EXPECT_EQ(client.get(0, "data", {{0.35, 0.004}}).size(), 1);
+    EXPECT_THROW(opat::serve::Client("/nonexistent/opatServe.sock"), std::runtime_error);
+}
+
+TEST_F(serveTest, cClient) {
+    char error[256] = {0};
+    opat_client* client = opat_client_connect(s_socketPath.c_str(), error, sizeof(error));
+    ASSERT_NE(client, nullptr) << error;
+
+    const double points[] = {0.35, 0.004, 0.351, 0.004};
+    ASSERT_EQ(opat_client_get(client, 0, "data", points, 2, 2), 0) << opat_client_last_error(client);
+    ASSERT_EQ(opat_client_num_results(client), 2);
+
+    uint32_t n_r = 0, n_c = 0, vsize = 0;
+    const double* data = opat_client_result_data(client, 0, &n_r, &n_c, &vsize);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(n_r, 19);
+    EXPECT_EQ(n_c, 70);
+    EXPECT_EQ(vsize, 1);
+    EXPECT_DOUBLE_EQ(data[5 * n_c + 35], -0.402);
+    EXPECT_EQ(opat_client_result_status(client, 1), OPAT_SERVE_NOT_FOUND);
+    EXPECT_EQ(opat_client_result_data(client, 1, nullptr, nullptr, nullptr), nullptr);
+
+    EXPECT_EQ(opat_client_get(client, 3, "data", points, 1, 2), -1);
+    EXPECT_STRNE(opat_client_last_error(client), "");
+    opat_client_close(client);
+
+    EXPECT_EQ(opat_client_connect("/nonexistent/opatServe.sock", nullptr, 0), nullptr);
+}
+
+TEST_F(serveTest, interpolate) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(opat);
+    const opat::DataCard expected = lattice.get(FloatIndexVector({0.54421, 0.077585}));
+
+    opat::serve::Client client(s_socketPath);
+    const auto results = client.interpolate(0, "data", {{0.54421, 0.077585}, {10.0, 10.0}});
+    ASSERT_EQ(results.size(), 2);
+    ASSERT_TRUE(results[0].ok()) << results[0].error;
+    EXPECT_DOUBLE_EQ(results[0].table.getData(5, 35, 0), expected["data"].getData(5, 35, 0));
+    EXPECT_EQ(results[1].status, opat::serve::Status::OutOfRange);
+
+    const auto badTag = client.interpolate(0, "nope", {{0.54421, 0.077585}});
+    ASSERT_EQ(badTag.size(), 1);
+    EXPECT_EQ(badTag[0].status, opat::serve::Status::NotFound);
+}
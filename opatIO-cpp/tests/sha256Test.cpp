@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "sha256.h"
+
+#include "picosha2.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file sha256Test.cpp
+ * @brief Unit tests for the SHA-256 backends and the card digests of the card catalog.
+ */
+
+namespace {
+    std::vector<opat::sha256::Backend> supportedBackends() {
+        std::vector<opat::sha256::Backend> backends;
+        for (const auto backend : {opat::sha256::Backend::Portable, opat::sha256::Backend::ShaNi, opat::sha256::Backend::Avx2}) {
+            if (opat::sha256::supported(backend)) {
+                backends.push_back(backend);
+            }
+        }
+        return backends;
+    }
+
+    std::string hex(const opat::sha256::Digest& digest) {
+        return picosha2::bytes_to_hex_string(digest.begin(), digest.end());
+    }
+}
+
+class sha256Test : public ::testing::Test {};
+
+TEST_F(sha256Test, knownDigests) {
+    const std::string abc = "abc";
+    const std::string twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    for (const auto backend : supportedBackends()) {
+        SCOPED_TRACE(std::string(opat::sha256::name(backend)));
+        EXPECT_EQ(hex(opat::sha256::hash(nullptr, 0, backend)), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        EXPECT_EQ(hex(opat::sha256::hash(abc.data(), abc.size(), backend)), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        EXPECT_EQ(hex(opat::sha256::hash(twoBlocks.data(), twoBlocks.size(), backend)), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    }
+    EXPECT_TRUE(opat::sha256::supported(opat::sha256::fastest()));
+}
+
+TEST_F(sha256Test, backendsMatchPicosha2) {
+    // Every padding case (lengths around the block boundaries) and messages of mixed lengths in one batch
+    std::mt19937 generator(42);
+    std::vector<std::vector<uint8_t>> buffers;
+    for (std::size_t length = 0; length <= 200; ++length) {
+        buffers.emplace_back(length);
+    }
+    buffers.emplace_back(10000);
+    buffers.emplace_back(65536 + 55);
+    for (auto& buffer : buffers) {
+        for (uint8_t& byte : buffer) {
+            byte = static_cast<uint8_t>(generator());
+        }
+    }
+    const std::vector<std::span<const uint8_t>> messages(buffers.begin(), buffers.end());
+
+    std::vector<opat::sha256::Digest> expected;
+    for (const auto& buffer : buffers) {
+        opat::sha256::Digest digest;
+        picosha2::hash256(buffer.begin(), buffer.end(), digest.begin(), digest.end());
+        expected.push_back(digest);
+    }
+    for (const auto backend : supportedBackends()) {
+        SCOPED_TRACE(std::string(opat::sha256::name(backend)));
+        EXPECT_EQ(opat::sha256::hashMany(messages, backend), expected);
+        EXPECT_EQ(opat::sha256::hash(buffers.back().data(), buffers.back().size(), backend), expected.back());
+    }
+}
+
+TEST_F(sha256Test, cardDigestsMatchCatalog) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+    const opat::CardCatalogEntry& entry = opat.cardCatalog.tableIndex.at(index);
+    const opat::sha256::Digest digest = opat::sha256::cardDigest(opat.get(index));
+    EXPECT_EQ(std::memcmp(digest.data(), entry.sha256, digest.size()), 0);
+
+    const opat::OPAT lazy = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    for (const auto backend : supportedBackends()) {
+        SCOPED_TRACE(std::string(opat::sha256::name(backend)));
+        EXPECT_TRUE(opat::sha256::verify(opat, backend, 4).empty());
+        EXPECT_TRUE(opat::sha256::verify(lazy, backend, 1).empty());
+    }
+}
+
+TEST_F(sha256Test, corruptCardLocated) {
+    const std::string filename = (std::filesystem::temp_directory_path() / "sha256Test_corrupt.opat").string();
+    const opat::OPAT example = opat::readOPAT(EXAMPLE_FILENAME);
+    const FloatIndexVector index({0.35, 0.004}, example.header.hashPrecision);
+    {
+        std::ifstream input(EXAMPLE_FILENAME, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        const opat::CardCatalogEntry& entry = example.cardCatalog.tableIndex.at(index);
+        const opat::DataCard& card = example.get(index);
+        const opat::TableIndexEntry& table = card.tableIndex.tableIndex.at("data");
+        bytes[entry.byteStart + table.byteStart + (table.numRows + table.numColumns) * sizeof(double) + 3] ^= 0x10;
+        std::ofstream(filename, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    const opat::OPAT corrupt = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    for (const auto backend : supportedBackends()) {
+        SCOPED_TRACE(std::string(opat::sha256::name(backend)));
+        const std::vector<FloatIndexVector> mismatched = opat::sha256::verify(corrupt, backend);
+        ASSERT_EQ(mismatched.size(), 1);
+        EXPECT_EQ(mismatched.front(), index);
+    }
+    std::filesystem::remove(filename);
+}
+
+TEST_F(sha256Test, unreadableCardThrows) {
+    // Written with table checksums, so that a corrupt table fails to read rather than hashing differently
+    const std::string filename = (std::filesystem::temp_directory_path() / "sha256Test_unreadable.opat").string();
+    const opat::OPAT example = opat::readOPAT(EXAMPLE_FILENAME);
+    opat::writeOPAT(example, filename);
+    {
+        const opat::OPAT written = opat::readOPAT(filename);
+        const FloatIndexVector index({0.35, 0.004}, written.header.hashPrecision);
+        const opat::CardCatalogEntry& entry = written.cardCatalog.tableIndex.at(index);
+        const opat::TableIndexEntry& table = written.get(index).tableIndex.tableIndex.at("data");
+        std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekg(static_cast<std::streamoff>(entry.byteStart + table.byteStart + (table.numRows + table.numColumns) * sizeof(double) + 3));
+        const char byte = static_cast<char>(file.get() ^ 0x10);
+        file.seekp(static_cast<std::streamoff>(entry.byteStart + table.byteStart + (table.numRows + table.numColumns) * sizeof(double) + 3));
+        file.put(byte);
+    }
+
+    const opat::OPAT corrupt = opat::readOPAT(filename, opat::LoadMode::Lazy);
+    for (const auto backend : supportedBackends()) {
+        SCOPED_TRACE(std::string(opat::sha256::name(backend)));
+        EXPECT_THROW(static_cast<void>(opat::sha256::verify(corrupt, backend, 4)), std::runtime_error);
+    }
+    std::filesystem::remove(filename);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "tableExpression.h"
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file tableExpressionTest.cpp
+ * @brief Unit tests for lazy arithmetic on tables.
+ */
+
+using namespace opat::expr;
+
+class tableExpressionTest : public ::testing::Test {
+protected:
+    opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPATTable& t1 = opat.get(FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision))["data"];
+    const opat::OPATTable& t2 = opat.get(FloatIndexVector({0.2, 0.06}, opat.header.hashPrecision))["data"];
+
+    [[nodiscard]] std::size_t cells() const { return static_cast<std::size_t>(t1.N_R) * t1.N_C * t1.m_vsize; }
+};
+
+TEST_F(tableExpressionTest, fusedMatchesElementwise) {
+    // Tables from two cards, combined into one output in one pass
+    const auto expression = 0.3 * t1 + 0.7 * log(exp10(t2)) - t1 / 2.0;
+    const opat::OPATTable result = evaluate(expression);
+    ASSERT_EQ(result.N_R, t1.N_R);
+    ASSERT_EQ(result.N_C, t1.N_C);
+    EXPECT_EQ(result.rowValues[3], t1.rowValues[3]);
+    EXPECT_EQ(result.columnValues[7], t1.columnValues[7]);
+
+    const double* a = t1.data.get();
+    const double* b = t2.data.get();
+    for (std::size_t i = 0; i < cells(); ++i) {
+        const double expected = 0.3 * a[i] + 0.7 * std::log(std::pow(10.0, b[i])) - a[i] / 2.0;
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(result.data[i]));
+        } else {
+            EXPECT_DOUBLE_EQ(result.data[i], expected);
+        }
+    }
+
+    const opat::OPATTable threaded = evaluate(expression, 4);
+    for (std::size_t i = 0; i < cells(); ++i) {
+        EXPECT_TRUE(threaded.data[i] == result.data[i] || (std::isnan(threaded.data[i]) && std::isnan(result.data[i])));
+    }
+}
+
+TEST_F(tableExpressionTest, functions) {
+    const opat::OPATTable negated = evaluate(-t1);
+    const opat::OPATTable bounded = evaluate(max(min(t1, 0.0), -1.0));
+    const opat::OPATTable squared = evaluate(pow(abs(t1), 2.0) + 1);
+    for (std::size_t i = 0; i < cells(); ++i) {
+        const double value = t1.data[i];
+        if (std::isnan(value)) {
+            continue;
+        }
+        EXPECT_EQ(negated.data[i], -value);
+        EXPECT_EQ(bounded.data[i], std::fmax(std::fmin(value, 0.0), -1.0));
+        EXPECT_DOUBLE_EQ(squared.data[i], value * value + 1);
+    }
+    EXPECT_DOUBLE_EQ(evaluate(t1).getData(5, 35, 0), -0.402);
+}
+
+TEST_F(tableExpressionTest, shapesCheckedOnce) {
+    const opat::OPATTable row = t1.getRow(0);
+    EXPECT_THROW(static_cast<void>(evaluate(t1 + row)), std::invalid_argument);
+
+    opat::OPATTable shifted = evaluate(t1);
+    shifted.rowValues[0] += 1.0;
+    EXPECT_THROW(static_cast<void>(evaluate(t2 * shifted)), std::invalid_argument);
+}
+
+TEST_F(tableExpressionTest, evaluateInPlace) {
+    opat::OPATTable output = evaluate(t1);
+    evaluateInto(2.0 * output + t2, output);
+    for (std::size_t i = 0; i < cells(); ++i) {
+        const double expected = 2.0 * t1.data[i] + t2.data[i];
+        if (!std::isnan(expected)) {
+            EXPECT_DOUBLE_EQ(output.data[i], expected);
+        }
+    }
+
+    opat::OPATTable row = t1.getRow(0);
+    EXPECT_THROW(evaluateInto(t1 * 2.0, row), std::invalid_argument);
+}
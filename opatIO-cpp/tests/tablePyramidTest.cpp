@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "lazyCardStore.h"
+#include "memoryManager.h"
+#include "tableLattice.h"
+#include "tablePyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+
+std::string EXAMPLE_FILENAME = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests/gs98hz.opat";
+
+/**
+ * @file tablePyramidTest.cpp
+ * @brief Unit tests for level-of-detail table pyramids.
+ */
+
+namespace {
+    // NaN-aware equality, since the example tables have missing values
+    bool same(double a, double b) {
+        return a == b || (std::isnan(a) && std::isnan(b));
+    }
+}
+
+class tablePyramidTest : public ::testing::Test {};
+
+TEST_F(tablePyramidTest, downsampleKeepsEveryOtherNodeAndTheLast) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPATTable& table = opat.get(FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision))["data"];
+    ASSERT_EQ(table.N_R, 19);
+    ASSERT_EQ(table.N_C, 70);
+
+    const opat::OPATTable coarse = opat::lod::downsample(table);
+    ASSERT_EQ(coarse.N_R, 10);
+    ASSERT_EQ(coarse.N_C, 36);
+    EXPECT_EQ(coarse.rowValues[coarse.N_R - 1], table.rowValues[table.N_R - 1]);
+    EXPECT_EQ(coarse.columnValues[coarse.N_C - 1], table.columnValues[table.N_C - 1]);
+    for (uint32_t row = 0; row + 1 < coarse.N_R; ++row) {
+        EXPECT_EQ(coarse.rowValues[row], table.rowValues[2 * row]);
+        for (uint32_t column = 0; column + 1 < coarse.N_C; ++column) {
+            EXPECT_TRUE(same(coarse.getData(row, column, 0), table.getData(2 * row, 2 * column, 0)));
+        }
+        EXPECT_TRUE(same(coarse.getData(row, coarse.N_C - 1, 0), table.getData(2 * row, table.N_C - 1, 0)));
+    }
+}
+
+TEST_F(tablePyramidTest, pyramidLevels) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::OPATTable& table = opat.get(FloatIndexVector({0.35, 0.004}, opat.header.hashPrecision))["data"];
+    const opat::lod::TablePyramid pyramid(table);
+    // 70 -> 36 -> 19 -> 10 -> 6 -> 4 -> 3 -> 2 columns
+    EXPECT_EQ(pyramid.depth(), 7);
+    EXPECT_EQ(pyramid.level(1).N_C, 36);
+    EXPECT_EQ(pyramid.level(7).N_R, 2);
+    EXPECT_EQ(pyramid.level(7).N_C, 2);
+    EXPECT_EQ(&pyramid.level(100), &pyramid.level(7));
+    EXPECT_GT(pyramid.bytes(), 0);
+    EXPECT_THROW((void)pyramid.level(0), std::out_of_range);
+
+    const opat::lod::TablePyramid shallow(table, 40);
+    EXPECT_EQ(shallow.depth(), 1);
+    EXPECT_THROW(opat::lod::TablePyramid(table, 1), std::invalid_argument);
+}
+
+TEST_F(tablePyramidTest, pyramidsBuiltOnceAndCharged) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    const FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+    const opat::lod::Pyramids pyramids(opat);
+    EXPECT_EQ(pyramids.bytes(), 0);
+
+    const std::shared_ptr<const opat::OPATTable> coarse = pyramids.table(index, "data", 2);
+    EXPECT_EQ(coarse->N_C, 19);
+    EXPECT_EQ(pyramids.table(index, "data", 2), coarse);
+    EXPECT_EQ(pyramids.table(index, "data", 0).get(), &opat.acquire(index)->get("data"));
+    const std::size_t bytes = pyramids.bytes();
+    EXPECT_GT(bytes, 0);
+    (void)pyramids.table(index, "data", 1);
+    EXPECT_EQ(pyramids.bytes(), bytes);
+    EXPECT_THROW((void)pyramids.table(index, "missing", 1), std::out_of_range);
+
+    const auto report = opat::memory::MemoryManager::global().report();
+    EXPECT_TRUE(std::ranges::any_of(report, [&](const auto& usage) {
+        return usage.name == opat.filename + " (pyramids)" && usage.bytes == bytes;
+    }));
+}
+
+TEST_F(tablePyramidTest, cardTablesDoNotPinCards) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME, opat::LoadMode::Lazy);
+    const FloatIndexVector index({0.35, 0.004}, opat.header.hashPrecision);
+    const opat::lod::Pyramids pyramids(opat, 100); // No coarse levels, so every level is the card's own table
+    opat::memory::MemoryManager& manager = opat::memory::MemoryManager::global();
+    const std::size_t budget = manager.budget();
+
+    std::shared_ptr<const opat::OPATTable> table = pyramids.table(index, "data", 0);
+    std::shared_ptr<const opat::OPATTable> coarse = pyramids.table(index, "data", 1);
+    EXPECT_EQ(coarse, table);
+    manager.setBudget(manager.usage());
+    const auto sweep = [&opat] {
+        for (const FloatIndexVector& other : opat.cardCatalog.tableIndex | std::views::keys) {
+            static_cast<void>(opat.acquire(other));
+        }
+    };
+
+    // A held table stays valid even if its card is evicted; once released, the card is not kept resident
+    sweep();
+    EXPECT_DOUBLE_EQ(table->getData(5, 35, 0), -0.402);
+    table.reset();
+    coarse.reset();
+    sweep();
+    EXPECT_FALSE(opat.lazyCards->isLoaded(index));
+    EXPECT_DOUBLE_EQ(pyramids.table(index, "data", 0)->getData(5, 35, 0), -0.402);
+    manager.setBudget(budget);
+}
+
+TEST_F(tablePyramidTest, coarseLatticeMatchesFullAtKeptNodesInterpolate) {
+    const opat::OPAT opat = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(opat);
+    const FloatIndexVector target({0.54421, 0.077585});
+    const opat::DataCard full = lattice.get(target);
+    const opat::DataCard coarse = lattice.get(target, 1);
+
+    const opat::OPATTable& fullTable = full["data"];
+    const opat::OPATTable& coarseTable = coarse["data"];
+    ASSERT_EQ(coarseTable.N_R, 10);
+    ASSERT_EQ(coarseTable.N_C, 36);
+    EXPECT_EQ(coarse.tableIndex.tableIndex.at("data").numColumns, 36);
+    for (uint32_t row = 0; row + 1 < coarseTable.N_R; ++row) {
+        for (uint32_t column = 0; column + 1 < coarseTable.N_C; ++column) {
+            const double value = coarseTable.getData(row, column, 0);
+            const double expected = fullTable.getData(2 * row, 2 * column, 0);
+            EXPECT_TRUE((std::isnan(value) && std::isnan(expected)) ||
+                        (std::isfinite(value) && std::isfinite(expected) && std::abs(value - expected) <= 1e-12))
+                << row << ", " << column << ": " << value << " vs " << expected;
+        }
+    }
+}
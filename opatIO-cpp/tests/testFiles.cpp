@@ -0,0 +1,49 @@
+#include "testFiles.h"
+#include "opatIO.h"
+
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    template <typename T>
+    T readAt(std::fstream& file, uint64_t position) {
+        T value;
+        file.seekg(static_cast<std::streamoff>(position));
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    }
+
+    // Flips one bit of the byte at `position`
+    void flipAt(std::fstream& file, uint64_t position) {
+        char byte = readAt<char>(file, position);
+        byte ^= 0x10;
+        file.seekp(static_cast<std::streamoff>(position));
+        file.write(&byte, 1);
+    }
+}
+
+namespace opat::testing {
+
+    void writeCopy(const std::string& source, const std::string& output, Damage damage, const FloatIndexVector& damaged) {
+        writeOPAT(readOPAT(source), output);
+        if (damage == Damage::None) {
+            return;
+        }
+
+        // The written file is little-endian, as are the hosts the tests run on
+        const uint64_t cardStart = readOPAT(output, LoadMode::Lazy).cardCatalog.tableIndex.at(damaged).byteStart;
+        std::fstream file(output, std::ios::binary | std::ios::in | std::ios::out);
+        const auto cardHeader = readAt<CardHeader>(file, cardStart);
+        const uint64_t entryStart = cardStart + cardHeader.indexOffset;
+        const auto entry = readAt<TableIndexEntry>(file, entryStart);
+        if (damage == Damage::TableData) {
+            flipAt(file, cardStart + entry.byteStart + (entry.numRows + entry.numColumns) * sizeof(double) + 3);
+        } else {
+            flipAt(file, entryStart + offsetof(TableIndexEntry, checksum));
+        }
+        if (!file) {
+            throw std::runtime_error("Could not damage " + output);
+        }
+    }
+}
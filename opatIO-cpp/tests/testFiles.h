@@ -0,0 +1,38 @@
+#pragma once
+
+#include "indexVector.h"
+
+#include <string>
+
+/**
+ * @file testFiles.h
+ * @brief Test utility for writing OPAT files, intact or damaged, for tests to read back.
+ *
+ * Files are written with `opat::writeOPAT`, so they carry everything the writer records (table
+ * checksums and statistics, card and file roots, and catalog digests) and follow its layout.
+ *
+ * **Example:**
+ * @code
+ * opat::testing::writeCopy(EXAMPLE_FILENAME, filename, opat::testing::Damage::TableData, index);
+ * EXPECT_THROW(static_cast<void>(opat::readOPAT(filename)), std::runtime_error);
+ * @endcode
+ */
+namespace opat::testing {
+
+    /**
+     * @brief What `writeCopy` damages in the card it is given.
+     */
+    enum class Damage {
+        None,
+        TableData,  ///< One data value of the card's first table is changed.
+        TableIndex  ///< The checksum of the card's first table is changed in its index.
+    };
+
+    /**
+     * @brief Reads `source` and writes it to `output` with `opat::writeOPAT`, then damages the card at
+     *        `damaged` as asked.
+     * @throws std::runtime_error if either file cannot be read or written.
+     */
+    void writeCopy(const std::string& source, const std::string& output, Damage damage = Damage::None,
+                   const FloatIndexVector& damaged = {});
+}
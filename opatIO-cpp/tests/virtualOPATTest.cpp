@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "opatIO.h"
+#include "indexVector.h"
+#include "lazyCardStore.h"
+#include "tableLattice.h"
+#include "virtualOPAT.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+std::string TEST_DIRECTORY = std::string(getenv("MESON_SOURCE_ROOT")) + "/opatIO-cpp/tests";
+std::string EXAMPLE_FILENAME = TEST_DIRECTORY + "/gs98hz.opat";
+
+/**
+ * @file virtualOPATTest.cpp
+ * @brief Unit tests for VirtualOPAT, which presents several OPAT files as one.
+ */
+
+class virtualOPATTest : public ::testing::Test {};
+
+TEST_F(virtualOPATTest, singleFile) {
+    const opat::VirtualOPAT grid({EXAMPLE_FILENAME});
+    EXPECT_EQ(grid.size(), 126);
+    EXPECT_EQ(grid.opat().header.numTables, 126);
+    EXPECT_EQ(grid.opat().lazyCards->loadedCount(), 0);
+
+    const FloatIndexVector index({0.35, 0.004}, grid.opat().header.hashPrecision);
+    EXPECT_DOUBLE_EQ(grid.get(index)["data"].getData(5, 35, 0), -0.402);
+    EXPECT_EQ(grid.opat().lazyCards->loadedCount(), 1);
+    EXPECT_EQ(grid.sourceFile(index), EXAMPLE_FILENAME);
+}
+
+TEST_F(virtualOPATTest, duplicateIndicesAreAnErrorByDefault) {
+    EXPECT_THROW(opat::VirtualOPAT({EXAMPLE_FILENAME, EXAMPLE_FILENAME}), std::invalid_argument);
+}
+
+TEST_F(virtualOPATTest, conflictPolicies) {
+    // A copy under a different path so that the source of each card can be told apart
+    const std::string copyFilename = (std::filesystem::temp_directory_path() / "virtualOPATTest_copy.opat").string();
+    std::filesystem::copy_file(EXAMPLE_FILENAME, copyFilename, std::filesystem::copy_options::overwrite_existing);
+
+    const FloatIndexVector index({0.35, 0.004});
+    const opat::VirtualOPAT keepFirst({EXAMPLE_FILENAME, copyFilename}, opat::ConflictPolicy::KeepFirst);
+    EXPECT_EQ(keepFirst.size(), 126);
+    EXPECT_EQ(keepFirst.sourceFile(index), EXAMPLE_FILENAME);
+
+    const opat::VirtualOPAT keepLast({EXAMPLE_FILENAME, copyFilename}, opat::ConflictPolicy::KeepLast);
+    EXPECT_EQ(keepLast.size(), 126);
+    EXPECT_EQ(keepLast.sourceFile(index), copyFilename);
+    EXPECT_DOUBLE_EQ(keepLast[index]["data"].getData(5, 35, 0), -0.402);
+
+    std::filesystem::remove(copyFilename);
+}
+
+TEST_F(virtualOPATTest, incompatibleFiles) {
+    // synthetic_tables.opat sits next to gs98hz.opat but was written with a different hash precision
+    EXPECT_THROW(opat::VirtualOPAT::fromDirectory(TEST_DIRECTORY), std::invalid_argument);
+    EXPECT_THROW(opat::VirtualOPAT(std::vector<std::string>{}), std::invalid_argument);
+}
+
+TEST_F(virtualOPATTest, interpolate) {
+    const opat::OPAT eager = opat::readOPAT(EXAMPLE_FILENAME);
+    const opat::lattice::TableLattice lattice(eager);
+    const opat::VirtualOPAT grid({EXAMPLE_FILENAME});
+
+    const FloatIndexVector point({0.54421, 0.077585});
+    const opat::DataCard expected = lattice.get(point);
+    const opat::DataCard result = grid.interpolate(point);
+    for (uint32_t row = 0; row < expected["data"].N_R; ++row) {
+        for (uint32_t column = 0; column < expected["data"].N_C; ++column) {
+            EXPECT_DOUBLE_EQ(result["data"].getData(row, column, 0), expected["data"].getData(row, column, 0));
+        }
+    }
+    // Only the corners of the containing simplex are ever read from disk
+    EXPECT_LE(grid.opat().lazyCards->loadedCount(), 3);
+}
@@ -0,0 +1,113 @@
+#include <cxxopts.hpp>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "opatIO.h"
+#include "diff.h"
+
+int main(int argc, char* argv[]) {
+    /**
+     * @brief Entry point for the OPAT comparison tool.
+     *
+     * Compares two OPAT files, such as a regenerated table library and the previous release, card by card
+     * (see diff.h): headers, card catalogs, the tags of each card and every table value. Prints what differs
+     * structurally, then the largest absolute and relative error of each tag and where the largest absolute
+     * one is. Only a few cards per thread are in memory at a time, so files of any size can be compared.
+     *
+     * Command-line options:
+     * - `-a` or `--first`: Path to the first (e.g. previous) OPAT file.
+     * - `-b` or `--second`: Path to the second (e.g. regenerated) OPAT file.
+     * - `--atol`: Absolute tolerance (default 0).
+     * - `--rtol`: Relative tolerance, scaled by the larger magnitude of the two values (default 0).
+     * - `--no-checksums`: Read and compare tables even when their recorded checksums are equal.
+     * - `-j` or `--threads`: Number of threads (default: one per hardware thread).
+     *
+     * @param argc Number of command-line arguments.
+     * @param argv Array of command-line argument strings.
+     * @return int 0 if the files match within the tolerances, 1 if they differ, 2 if they could not be compared.
+     */
+    cxxopts::Options options("OpatIO Diff", "Compare the tables of two OPAT files");
+
+    options.add_options()
+    ("a,first", "First file name", cxxopts::value<std::string>())
+    ("b,second", "Second file name", cxxopts::value<std::string>())
+    ("atol", "Absolute tolerance", cxxopts::value<double>()->default_value("0"))
+    ("rtol", "Relative tolerance", cxxopts::value<double>()->default_value("0"))
+    ("no-checksums", "Compare tables even when their recorded checksums are equal")
+    ("j,threads", "Number of threads", cxxopts::value<unsigned>()->default_value("0"));
+
+    auto result = options.parse(argc, argv);
+
+    if (!result.count("first") || !result.count("second")) {
+        std::cout << "Two files must be provided (i.e. opatDiff -a <path/to/old.opat> -b <path/to/new.opat>)..." << std::endl;
+        return 2;
+    }
+    const std::string first = result["first"].as<std::string>();
+    const std::string second = result["second"].as<std::string>();
+    for (const std::string& path : {first, second}) {
+        if (!std::filesystem::is_regular_file(path)) {
+            std::cout << "The file path provided does not exist or is not a regular file: " << path << std::endl;
+            return 2;
+        }
+    }
+
+    opat::diff::Options diffOptions;
+    diffOptions.absolute = result["atol"].as<double>();
+    diffOptions.relative = result["rtol"].as<double>();
+    diffOptions.trustChecksums = !result.count("no-checksums");
+    diffOptions.threads = result["threads"].as<unsigned>();
+
+    const auto start = std::chrono::steady_clock::now();
+    opat::diff::Report report;
+    try {
+        report = opat::diff::compare(first, second, diffOptions);
+    } catch (const std::exception& e) {
+        std::cout << "Could not compare the files: " << e.what() << std::endl;
+        return 2;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const std::string& difference : report.headerDifferences) {
+        std::cout << "header " << difference << std::endl;
+    }
+    for (const FloatIndexVector& index : report.onlyInFirst) {
+        std::cout << "card only in first: " << index << std::endl;
+    }
+    for (const FloatIndexVector& index : report.onlyInSecond) {
+        std::cout << "card only in second: " << index << std::endl;
+    }
+    for (const auto& [index, tag] : report.tagsOnlyInFirst) {
+        std::cout << "table '" << tag << "' only in first: " << index << std::endl;
+    }
+    for (const auto& [index, tag] : report.tagsOnlyInSecond) {
+        std::cout << "table '" << tag << "' only in second: " << index << std::endl;
+    }
+    for (const auto& [index, reason] : report.unreadableCards) {
+        std::cout << "card could not be read: " << index << ": " << reason << std::endl;
+    }
+
+    std::cout << std::left << std::setw(10) << "tag" << std::right << std::setw(8) << "tables" << std::setw(14) << "values"
+              << std::setw(12) << "mismatches" << std::setw(8) << "NaN" << std::setw(8) << "shape" << std::setw(8) << "axes"
+              << std::setw(14) << "max abs" << std::setw(14) << "max rel" << "  worst" << std::endl;
+    for (const auto& [tag, summary] : report.tags) {
+        std::cout << std::left << std::setw(10) << tag << std::right << std::setw(8) << summary.tables
+                  << std::setw(14) << summary.values.values << std::setw(12) << summary.values.mismatches
+                  << std::setw(8) << summary.values.nanMismatches << std::setw(8) << summary.shapeMismatches
+                  << std::setw(8) << summary.axisMismatches << std::scientific << std::setprecision(3)
+                  << std::setw(14) << summary.values.maxAbsolute << std::setw(14) << summary.values.maxRelative
+                  << std::defaultfloat;
+        if (summary.values.maxAbsolute > 0) {
+            std::cout << "  " << summary.worst.card << " [" << summary.worst.row << ", " << summary.worst.column << ", "
+                      << summary.worst.component << "]";
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << report.cards << " cards compared in " << std::fixed << std::setprecision(2) << seconds << " s: "
+              << (report.equal() ? "the files match." : "the files differ.") << std::endl;
+    return report.equal() ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <cxxopts.hpp>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "opatIO.h"
+#include "embed.h"
+
+namespace {
+    // The file's stem, with every character that may not appear in an identifier replaced by '_'
+    std::string defaultName(const std::string& filePath) {
+        std::string name = std::filesystem::path(filePath).stem().string();
+        for (char& c : name) {
+            if (!std::isalnum(static_cast<unsigned char>(c))) {
+                c = '_';
+            }
+        }
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name.front()))) {
+            name.insert(name.begin(), '_');
+        }
+        return name;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    /**
+     * @brief Entry point for the OPAT embedding tool.
+     *
+     * Reads an OPAT file and writes C++ source defining `opat::embedded::<name>`, an image of the file
+     * which `opat::embed::open` opens without any I/O (see embed.h). Compile the source into the
+     * executable which uses the tables; the `opat_embed` meson generator does both.
+     *
+     * Command-line options:
+     * - `-f` or `--file`: Path to the OPAT file to embed.
+     * - `-o` or `--output`: Path of the C++ source to write.
+     * - `-n` or `--name`: Name of the image (default: the file's stem, made an identifier).
+     *
+     * @param argc Number of command-line arguments.
+     * @param argv Array of command-line argument strings.
+     * @return int Exit code (0 for success, non-zero for errors).
+     */
+    cxxopts::Options options("OpatIO Embed", "Write an OPAT file as C++ source to compile into an executable");
+
+    options.add_options()
+    ("f,file", "File name", cxxopts::value<std::string>())
+    ("o,output", "Output C++ source file", cxxopts::value<std::string>())
+    ("n,name", "Name of the embedded image", cxxopts::value<std::string>());
+
+    auto result = options.parse(argc, argv);
+
+    if (!result.count("file") || !result.count("output")) {
+        std::cout << "No file or output path provided (i.e. opatEmbed -f <path/to/file.opat> -o <path/to/output.cpp>)..." << std::endl;
+        return 1;
+    }
+
+    const std::string filePath = result["file"].as<std::string>();
+    if (!std::filesystem::is_regular_file(filePath)) {
+        throw std::invalid_argument("The file path provided does not exist or is not a regular file: " + filePath);
+    }
+    const std::string name = result.count("name") ? result["name"].as<std::string>() : defaultName(filePath);
+
+    const opat::OPAT opat = opat::readOPAT(filePath);
+    std::ofstream output(result["output"].as<std::string>());
+    if (!output) {
+        throw std::runtime_error("Could not open output file: " + result["output"].as<std::string>());
+    }
+    opat::embed::writeSource(opat, name, filePath, output);
+    return 0;
+}
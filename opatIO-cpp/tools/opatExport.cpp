@@ -0,0 +1,93 @@
+#include <cxxopts.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "opatIO.h"
+#include "indexVector.h"
+#include "npy.h"
+
+int main(int argc, char* argv[]) {
+    /**
+     * @brief Entry point for the OPAT export tool.
+     *
+     * Writes one card, or one table of it, of an OPAT file in a form other programs read directly. The
+     * extension of the output picks the format:
+     * - `.npz`: every table of the card, with its axes (see npy.h), or only the table given by `--tag`.
+     * - `.npy`: the values of the table given by `--tag`, exact to the bit.
+     * - anything else: the table given by `--tag` as text, one row per line, with every value written
+     *   in its shortest form that reads back exactly.
+     *
+     * Only the card asked for is read from the file.
+     *
+     * Command-line options:
+     * - `-f` or `--file`: Path to the OPAT file.
+     * - `-i` or `--index`: Index vector of the card (comma separated).
+     * - `-t` or `--tag`: Tag of the table to export.
+     * - `-o` or `--output`: Path of the file to write.
+     *
+     * @param argc Number of command-line arguments.
+     * @param argv Array of command-line argument strings.
+     * @return int Exit code (0 for success, non-zero for errors).
+     */
+    cxxopts::Options options("OpatIO Export", "Export a card or table of an OPAT file to NumPy or text");
+
+    options.add_options()
+    ("f,file", "File name", cxxopts::value<std::string>())
+    ("i,index", "Index vector of the card (comma separated)", cxxopts::value<std::vector<double>>())
+    ("t,tag", "Tag of the table", cxxopts::value<std::string>())
+    ("o,output", "Output file name (.npz, .npy or text)", cxxopts::value<std::string>());
+
+    auto result = options.parse(argc, argv);
+
+    if (!result.count("file") || !result.count("index") || !result.count("output")) {
+        std::cout << "A file, index and output must be provided (i.e. opatExport -f <path/to/file.opat> -i 0.35,0.004 -o card.npz)..." << std::endl;
+        return 1;
+    }
+    const std::string filename = result["file"].as<std::string>();
+    if (!std::filesystem::is_regular_file(filename)) {
+        std::cout << "The file path provided does not exist or is not a regular file: " << filename << std::endl;
+        return 1;
+    }
+    const std::string output = result["output"].as<std::string>();
+    const std::string extension = std::filesystem::path(output).extension().string();
+    if (extension != ".npz" && !result.count("tag")) {
+        std::cout << "A tag must be provided to export a single table (i.e. -t data)..." << std::endl;
+        return 1;
+    }
+
+    try {
+        opat::OPAT opat = opat::readOPAT(filename, opat::LoadMode::Lazy);
+        const FloatIndexVector index(result["index"].as<std::vector<double>>(), opat.header.hashPrecision);
+        const opat::DataCard& card = opat.get(index);
+        if (!result.count("tag")) {
+            opat::npy::writeCard(card, output);
+        } else {
+            const opat::OPATTable& table = card.get(result["tag"].as<std::string>());
+            if (extension == ".npz") {
+                opat::npy::writeTable(table, output);
+            } else {
+                std::ofstream out(output, std::ios::binary | std::ios::trunc);
+                if (!out.is_open()) {
+                    throw std::runtime_error("Could not open file for writing: " + output);
+                }
+                if (extension == ".npy") {
+                    opat::npy::write(table, out);
+                } else {
+                    table.writeAscii(out);
+                }
+                if (!out) {
+                    throw std::runtime_error("Error writing file: " + output);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Could not export: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << output << std::endl;
+    return 0;
+}
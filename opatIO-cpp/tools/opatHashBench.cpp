@@ -0,0 +1,102 @@
+#include <cxxopts.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "opatIO.h"
+#include "sha256.h"
+
+namespace {
+    constexpr double MIB = 1024.0 * 1024.0;
+
+    // Bytes of table data the card digests of `opat` are computed over
+    std::size_t hashedBytes(const opat::OPAT& opat) {
+        std::size_t bytes = 0;
+        for (const opat::DataCard& card : opat.cards | std::views::values) {
+            for (const opat::TableIndexEntry& entry : card.tableIndex.tableIndex | std::views::values) {
+                bytes += static_cast<std::size_t>(entry.numRows) * entry.numColumns * entry.size * sizeof(double);
+            }
+        }
+        return bytes;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    /**
+     * @brief Entry point for the OPAT SHA-256 benchmark.
+     *
+     * Loads an OPAT file and checks the digests of all its cards against the card catalog with each
+     * SHA-256 backend this CPU supports, reporting per run the time, the throughput over the hashed
+     * table data, the speedup over the portable backend (picosha2), and whether the file verified.
+     * The file is loaded once beforehand, so that only hashing is timed.
+     *
+     * Command-line options:
+     * - `-f` or `--file`: Path to the OPAT file to hash.
+     * - `-n` or `--repetitions`: Runs per backend (default 3); the fastest run is reported.
+     * - `-t` or `--threads`: Threads to hash with (default 1; 0 uses one per hardware thread).
+     *
+     * @param argc Number of command-line arguments.
+     * @param argv Array of command-line argument strings.
+     * @return int Exit code (0 for success, non-zero for errors).
+     */
+    cxxopts::Options options("OpatIO Hash Benchmark", "Compare the SHA-256 backends on the card digests of an OPAT file");
+
+    options.add_options()
+    ("f,file", "File name", cxxopts::value<std::string>())
+    ("n,repetitions", "Runs per backend", cxxopts::value<int>()->default_value("3"))
+    ("t,threads", "Threads to hash with (0 for one per hardware thread)", cxxopts::value<unsigned>()->default_value("1"));
+
+    auto result = options.parse(argc, argv);
+
+    if (!result.count("file")) {
+        std::cout << "No file path provided (Note that you must provide a file path as a flag, i.e. opatHashBench -f <path/to/file>)..." << std::endl;
+        return 1;
+    }
+
+    const std::string filePath = result["file"].as<std::string>();
+    if (!std::filesystem::is_regular_file(filePath)) {
+        throw std::invalid_argument("The file path provided does not exist or is not a regular file: " + filePath);
+    }
+    const int repetitions = std::max(1, result["repetitions"].as<int>());
+    const unsigned threads = result["threads"].as<unsigned>();
+
+    const opat::OPAT opat = opat::readOPAT(filePath);
+    const double dataMiB = static_cast<double>(hashedBytes(opat)) / MIB;
+
+    std::cout << filePath << " (" << opat.cards.size() << " cards, " << std::fixed << std::setprecision(1) << dataMiB << " MiB of table data)" << std::endl;
+    std::cout << std::left << std::setw(10) << "backend" << std::right
+              << std::setw(10) << "time(s)" << std::setw(12) << "MiB/s"
+              << std::setw(10) << "speedup" << std::setw(10) << "verified" << std::endl;
+
+    double portableTime = 0.0;
+    for (const auto backend : {opat::sha256::Backend::Portable, opat::sha256::Backend::ShaNi, opat::sha256::Backend::Avx2}) {
+        if (!opat::sha256::supported(backend)) {
+            std::cout << std::left << std::setw(10) << opat::sha256::name(backend) << std::right << std::setw(10) << "-"
+                      << "  (not supported by this CPU)" << std::endl;
+            continue;
+        }
+        double best = 0.0;
+        bool verified = true;
+        for (int run = 0; run < repetitions; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            verified = opat::sha256::verify(opat, backend, threads).empty();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = run == 0 ? elapsed.count() : std::min(best, elapsed.count());
+        }
+        if (backend == opat::sha256::Backend::Portable) {
+            portableTime = best;
+        }
+        std::cout << std::left << std::setw(10) << opat::sha256::name(backend) << std::right << std::setprecision(4)
+                  << std::setw(10) << best << std::setprecision(1)
+                  << std::setw(12) << dataMiB / best
+                  << std::setw(9) << portableTime / best << "x"
+                  << std::setw(10) << (verified ? "yes" : "no") << std::endl;
+    }
+    return 0;
+}
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <string>
 #include <filesystem>
+#include <ranges>
+#include <set>
 #include <stdexcept>
 
 #include "opatIO.h"
@@ -16,6 +18,8 @@ int main(int argc, char* argv[]) {
      * 
      * Command-line options:
      * - `-f` or `--file`: Specifies the path to the OPAT file to inspect.
+     * - `-s` or `--stats`: Also summarizes every tag across all cards (min, max, mean and NaN count),
+     *   from the statistics stored in the cards where the file has them.
      * 
      * Functionality:
      * 1. Parse the command-line arguments to retrieve the file path.
@@ -39,7 +43,8 @@ int main(int argc, char* argv[]) {
                              "Simple utility to view OPAT Header and Card Catalog information");
 
     options.add_options()
-    ("f,file", "File name", cxxopts::value<std::string>());
+    ("f,file", "File name", cxxopts::value<std::string>())
+    ("s,stats", "Summarize the values of every tag");
 
     // Parse command-line arguments
     auto result = options.parse(argc, argv);
@@ -65,6 +70,29 @@ int main(int argc, char* argv[]) {
                 for (const auto& entry : opat.cardCatalog.tableIndex) {
                     std::cout << entry.second << std::endl;
                 }
+
+                if (result.count("stats")) {
+                    // Only card headers and indices are read for files with stored statistics
+                    const opat::OPAT catalog = opat::readOPAT(filePath, opat::LoadMode::Lazy);
+                    std::set<std::string> tags;
+                    for (const auto& index : catalog.cardCatalog.tableIndex | std::views::keys) {
+                        for (const std::string& tag : catalog.acquire(index)->getKeys()) {
+                            tags.insert(tag);
+                        }
+                    }
+                    std::cout << std::dec << ANSI_COLOR_GREEN << "== OPAT Tag Statistics =="
+                              << ANSI_COLOR_RESET << std::endl;
+                    for (const std::string& tag : tags) {
+                        const opat::TagStatistics stats = catalog.getStatistics(tag);
+                        std::cout << tag << ": min " << stats.min << ", max " << stats.max << ", mean " << stats.mean
+                                  << ", NaNs " << stats.nanCount << " (" << stats.cards << " cards";
+                        if (stats.computedCards > 0) {
+                            std::cout << ANSI_COLOR_YELLOW << ", " << stats.computedCards << " without stored statistics"
+                                      << ANSI_COLOR_RESET;
+                        }
+                        std::cout << ")" << std::endl;
+                    }
+                }
             } else {
                 // Error: Provided path is not a regular file
                 throw std::invalid_argument("The file path provided is not a regular file.");
@@ -0,0 +1,144 @@
+#include <cxxopts.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "opatIO.h"
+
+namespace {
+    constexpr double MIB = 1024.0 * 1024.0;
+
+    // Resident set size of this process, in bytes
+    std::size_t residentBytes() {
+        std::ifstream statm("/proc/self/statm");
+        std::size_t size = 0;
+        std::size_t resident = 0;
+        statm >> size >> resident;
+        return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    }
+
+    // Bytes of `filename` currently held in the page cache
+    std::size_t cachedBytes(const std::string& filename) {
+        const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+        const auto size = static_cast<std::size_t>(std::filesystem::file_size(filename));
+        const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        std::size_t cached = 0;
+        if (void* map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0); map != MAP_FAILED) {
+            std::vector<unsigned char> pages((size + pageSize - 1) / pageSize);
+            if (::mincore(map, size, pages.data()) == 0) {
+                for (const unsigned char page : pages) {
+                    cached += (page & 1) * pageSize;
+                }
+            }
+            ::munmap(map, size);
+        }
+        ::close(fd);
+        return std::min(cached, size);
+    }
+
+    // Asks the kernel to drop the file's clean pages, so that every run starts from a cold cache
+    void evictFromPageCache(const std::string& filename) {
+        const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fdatasync(fd);
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+
+    opat::LoadMode parseMode(const std::string& name) {
+        if (name == "eager") {
+            return opat::LoadMode::Eager;
+        }
+        if (name == "direct") {
+            return opat::LoadMode::Direct;
+        }
+        throw std::invalid_argument("Unknown load mode '" + name + "' (expected eager or direct)");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    /**
+     * @brief Entry point for the OPAT bulk load benchmark.
+     *
+     * Loads an OPAT file repeatedly with each requested LoadMode and reports, per run, the load time,
+     * throughput, growth of the process's resident memory, and how much of the file is left in the page
+     * cache afterwards. The sum of the last two is the system memory the load costs; buffered loads
+     * (`eager`) hold the file twice, uncached loads (`direct`) only once.
+     *
+     * The file's pages are dropped from the page cache before every run so that runs start cold. This
+     * only works for clean pages, and other processes reading the file at the same time will skew results.
+     *
+     * Command-line options:
+     * - `-f` or `--file`: Path to the OPAT file to load.
+     * - `-m` or `--modes`: Comma-separated load modes to compare (default `eager,direct`).
+     * - `-n` or `--repetitions`: Runs per mode (default 3).
+     *
+     * @param argc Number of command-line arguments.
+     * @param argv Array of command-line argument strings.
+     * @return int Exit code (0 for success, non-zero for errors).
+     */
+    cxxopts::Options options("OpatIO Load Benchmark", "Compare buffered and page-cache-bypassing bulk loads of an OPAT file");
+
+    options.add_options()
+    ("f,file", "File name", cxxopts::value<std::string>())
+    ("m,modes", "Comma-separated load modes (eager, direct)", cxxopts::value<std::string>()->default_value("eager,direct"))
+    ("n,repetitions", "Runs per mode", cxxopts::value<int>()->default_value("3"));
+
+    auto result = options.parse(argc, argv);
+
+    if (!result.count("file")) {
+        std::cout << "No file path provided (Note that you must provide a file path as a flag, i.e. opatLoadBench -f <path/to/file>)..." << std::endl;
+        return 1;
+    }
+
+    const std::string filePath = result["file"].as<std::string>();
+    if (!std::filesystem::is_regular_file(filePath)) {
+        throw std::invalid_argument("The file path provided does not exist or is not a regular file: " + filePath);
+    }
+    std::vector<std::string> modes;
+    std::stringstream modeList(result["modes"].as<std::string>());
+    for (std::string mode; std::getline(modeList, mode, ',');) {
+        parseMode(mode);
+        modes.push_back(mode);
+    }
+    const int repetitions = result["repetitions"].as<int>();
+    const double fileMiB = static_cast<double>(std::filesystem::file_size(filePath)) / MIB;
+
+    std::cout << filePath << " (" << std::fixed << std::setprecision(1) << fileMiB << " MiB)" << std::endl;
+    std::cout << std::left << std::setw(8) << "mode" << std::right
+              << std::setw(10) << "time(s)" << std::setw(12) << "MiB/s"
+              << std::setw(12) << "RSS(MiB)" << std::setw(14) << "cache(MiB)" << std::setw(14) << "total(MiB)" << std::endl;
+
+    for (int run = 0; run < repetitions; ++run) {
+        for (const std::string& mode : modes) {
+            evictFromPageCache(filePath);
+            const std::size_t rssBefore = residentBytes();
+
+            const auto start = std::chrono::steady_clock::now();
+            const opat::OPAT opat = opat::readOPAT(filePath, parseMode(mode));
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            const double rss = static_cast<double>(residentBytes() - std::min(rssBefore, residentBytes())) / MIB;
+            const double cached = static_cast<double>(cachedBytes(filePath)) / MIB;
+            std::cout << std::left << std::setw(8) << mode << std::right << std::setprecision(3)
+                      << std::setw(10) << elapsed.count() << std::setprecision(1)
+                      << std::setw(12) << fileMiB / elapsed.count()
+                      << std::setw(12) << rss << std::setw(14) << cached << std::setw(14) << rss + cached << std::endl;
+        }
+    }
+    return 0;
+}
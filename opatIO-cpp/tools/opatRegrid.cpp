@@ -0,0 +1,78 @@
+#include <cxxopts.hpp>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opatIO.h"
+#include "regrid.h"
+
+int main(int argc, char* argv[]) {
+    /**
+     * @brief Entry point for the OPAT regridding tool.
+     *
+     * Resamples every tag whose tables do not share their axes across the cards of a file onto common
+     * axes (see regrid.h), and writes the result as a new OPAT file, so that the resampling is done once
+     * rather than on every load. Tags which already share their axes are copied as they are.
+     *
+     * Command-line options:
+     * - `-f` or `--file`: Path to the OPAT file to regrid.
+     * - `-o` or `--output`: Path of the regridded OPAT file to write.
+     * - `-t` or `--tags`: Tags to consider (default: every tag of the file).
+     * - `-u` or `--union`: Keep every row and column value of every card, rather than the range all cards cover.
+     * - `-j` or `--threads`: Number of threads to resample with (default: one per hardware thread).
+     *
+     * @param argc Number of command-line arguments.
+     * @param argv Array of command-line argument strings.
+     * @return int Exit code (0 for success, non-zero for errors).
+     */
+    cxxopts::Options options("OpatIO Regrid", "Resample the tables of an OPAT file onto axes shared by every card");
+
+    options.add_options()
+    ("f,file", "File name", cxxopts::value<std::string>())
+    ("o,output", "Output file name", cxxopts::value<std::string>())
+    ("t,tags", "Tags to regrid (comma separated)", cxxopts::value<std::vector<std::string>>())
+    ("u,union", "Keep every axis value of every card, with NaN where a card does not reach")
+    ("j,threads", "Number of threads", cxxopts::value<unsigned>()->default_value("0"));
+
+    auto result = options.parse(argc, argv);
+
+    if (!result.count("file") || !result.count("output")) {
+        std::cout << "No file or output path provided (i.e. opatRegrid -f <path/to/file.opat> -o <path/to/output.opat>)..." << std::endl;
+        return 1;
+    }
+
+    const std::string filePath = result["file"].as<std::string>();
+    if (!std::filesystem::is_regular_file(filePath)) {
+        throw std::invalid_argument("The file path provided does not exist or is not a regular file: " + filePath);
+    }
+
+    const opat::OPAT opat = opat::readOPAT(filePath);
+    if (opat.cardCatalog.tableIndex.empty()) {
+        std::cout << "The file has no cards to regrid." << std::endl;
+        return 1;
+    }
+    std::vector<std::string> tags;
+    if (result.count("tags")) {
+        tags = result["tags"].as<std::vector<std::string>>();
+    } else {
+        tags = opat.get(opat.cardCatalog.tableIndex.begin()->first).getKeys();
+    }
+
+    const opat::regrid::AxisPolicy policy = result.count("union") ? opat::regrid::AxisPolicy::Union : opat::regrid::AxisPolicy::Overlap;
+    std::unordered_map<std::string, opat::regrid::Axes> axes;
+    for (const std::string& tag : tags) {
+        if (opat::regrid::sharesAxes(opat, tag)) {
+            std::cout << tag << ": shared by every card" << std::endl;
+            continue;
+        }
+        const opat::regrid::Axes& common = axes.emplace(tag, opat::regrid::commonAxes(opat, tag, policy)).first->second;
+        std::cout << tag << ": resampling onto " << common.rows.size() << " x " << common.columns.size() << std::endl;
+    }
+
+    opat::writeOPAT(opat::regrid::regrid(opat, axes, result["threads"].as<unsigned>()), result["output"].as<std::string>());
+    std::cout << "Wrote " << result["output"].as<std::string>() << std::endl;
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <cxxopts.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opatIO.h"
+#include "queryTrace.h"
+#include "tableLattice.h"
+
+namespace {
+    struct ReplayResult {
+        std::vector<uint64_t> cardLatencies;    ///< Nanoseconds per card query.
+        std::vector<uint64_t> latticeLatencies; ///< Nanoseconds per lattice query.
+        uint64_t failures = 0;                  ///< Queries which threw (missing card, out of bounds, ...).
+    };
+
+    // Returns the value at the requested percentile of an already sorted sample
+    uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        const auto rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    void report(const std::string& label, std::vector<uint64_t>& latencies) {
+        if (latencies.empty()) {
+            return;
+        }
+        std::ranges::sort(latencies);
+        long double total = 0;
+        for (const uint64_t latency : latencies) {
+            total += latency;
+        }
+        std::cout << std::left << std::setw(10) << label
+                  << " n=" << latencies.size()
+                  << " mean=" << static_cast<uint64_t>(total / latencies.size()) << "ns"
+                  << " p50=" << percentile(latencies, 50.0) << "ns"
+                  << " p90=" << percentile(latencies, 90.0) << "ns"
+                  << " p99=" << percentile(latencies, 99.0) << "ns"
+                  << " p99.9=" << percentile(latencies, 99.9) << "ns"
+                  << " max=" << latencies.back() << "ns" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    /**
+     * @brief Entry point for the OPAT query trace replay tool.
+     *
+     * This utility replays a query trace (recorded with opat::trace::QueryRecorder) against an
+     * OPAT file and reports per-query latency percentiles. It is intended for tuning and
+     * regression-testing against real workloads offline.
+     *
+     * Command-line options:
+     * - `-f` or `--file`: Path to the OPAT file to replay against.
+     * - `-t` or `--trace`: Path to the query trace.
+     * - `-j` or `--threads`: Number of replay threads (default 1). The trace is split into contiguous
+     *   chunks, one per thread, so that each thread keeps the spatial coherence of the original workload.
+     * - `-r` or `--repeat`: Number of times to replay the trace (default 1).
+     * - `-l` or `--lazy`: Open the file with `LoadMode::Lazy`, so that cards are read on first access.
+     *
+     * Card queries are replayed with OPAT::get, lattice queries with TableLattice::get. Each thread uses
+     * its own copy of the lattice, since the simplex walk caches the last simplex it found.
+     *
+     * @param argc Number of command-line arguments.
+     * @param argv Array of command-line argument strings.
+     * @return int Exit code (0 for success, non-zero for errors).
+     */
+    cxxopts::Options options("OpatIO Query Replay", "Replay a recorded query trace against an OPAT file and report latency percentiles");
+
+    options.add_options()
+    ("f,file", "File name", cxxopts::value<std::string>())
+    ("t,trace", "Query trace file name", cxxopts::value<std::string>())
+    ("j,threads", "Number of replay threads", cxxopts::value<unsigned>()->default_value("1"))
+    ("r,repeat", "Number of times to replay the trace", cxxopts::value<unsigned>()->default_value("1"))
+    ("l,lazy", "Read cards on first access instead of when the file is opened");
+
+    auto result = options.parse(argc, argv);
+
+    if (!result.count("file") || !result.count("trace")) {
+        std::cout << "No file or trace path provided (Note that you must provide paths as flags, i.e. opatReplay -f <path/to/file> -t <path/to/trace>)..." << std::endl;
+        return 1;
+    }
+
+    const std::string filePath = result["file"].as<std::string>();
+    const std::string tracePath = result["trace"].as<std::string>();
+    if (!std::filesystem::is_regular_file(filePath) || !std::filesystem::is_regular_file(tracePath)) {
+        throw std::invalid_argument("The file or trace path provided does not exist or is not a regular file.");
+    }
+    const unsigned numThreads = std::max(1u, result["threads"].as<unsigned>());
+    const unsigned repeat = std::max(1u, result["repeat"].as<unsigned>());
+
+    const auto loadStart = std::chrono::steady_clock::now();
+    const opat::LoadMode loadMode = result.count("lazy") ? opat::LoadMode::Lazy : opat::LoadMode::Eager;
+    const opat::OPAT opat = opat::readOPAT(filePath, loadMode);
+    const auto loadEnd = std::chrono::steady_clock::now();
+
+    const std::vector<opat::trace::TraceRecord> records = opat::trace::readTrace(tracePath);
+
+    // Build the query keys up front so that only the library lookups are timed
+    std::vector<FloatIndexVector> queries;
+    queries.reserve(records.size());
+    bool needsLattice = false;
+    for (const auto& record : records) {
+        queries.emplace_back(record.index, opat.header.hashPrecision);
+        needsLattice |= record.kind == opat::trace::QueryKind::Lattice;
+    }
+
+    std::optional<opat::lattice::TableLattice> lattice;
+    const auto latticeStart = std::chrono::steady_clock::now();
+    if (needsLattice) {
+        lattice.emplace(opat);
+    }
+    const auto latticeEnd = std::chrono::steady_clock::now();
+
+    std::vector<ReplayResult> results(numThreads);
+    auto replay = [&](unsigned threadID) {
+        ReplayResult& out = results[threadID];
+        std::optional<opat::lattice::TableLattice> localLattice;
+        if (lattice) {
+            localLattice.emplace(*lattice);
+        }
+        const std::size_t chunk = (records.size() + numThreads - 1) / numThreads;
+        const std::size_t begin = std::min(records.size(), threadID * chunk);
+        const std::size_t end = std::min(records.size(), begin + chunk);
+
+        for (unsigned pass = 0; pass < repeat; ++pass) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const bool isCard = records[i].kind == opat::trace::QueryKind::Card;
+                const auto start = std::chrono::steady_clock::now();
+                try {
+                    if (isCard) {
+                        const opat::DataCard& card = opat.get(queries[i]);
+                        static_cast<void>(card);
+                    } else {
+                        const opat::DataCard card = localLattice->get(queries[i]);
+                        static_cast<void>(card);
+                    }
+                } catch (const std::exception&) {
+                    out.failures++;
+                    continue;
+                }
+                const auto stop = std::chrono::steady_clock::now();
+                const auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+                (isCard ? out.cardLatencies : out.latticeLatencies).push_back(elapsed);
+            }
+        }
+    };
+
+    const auto replayStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (unsigned t = 0; t < numThreads; ++t) {
+        threads.emplace_back(replay, t);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto replayEnd = std::chrono::steady_clock::now();
+
+    ReplayResult merged;
+    for (auto& r : results) {
+        merged.cardLatencies.insert(merged.cardLatencies.end(), r.cardLatencies.begin(), r.cardLatencies.end());
+        merged.latticeLatencies.insert(merged.latticeLatencies.end(), r.latticeLatencies.begin(), r.latticeLatencies.end());
+        merged.failures += r.failures;
+    }
+
+    const auto toMs = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    const double replaySeconds = std::chrono::duration<double>(replayEnd - replayStart).count();
+    const uint64_t completed = merged.cardLatencies.size() + merged.latticeLatencies.size();
+
+    std::cout << "Trace: " << tracePath << " (" << records.size() << " queries, " << repeat << " pass(es), "
+              << numThreads << " thread(s))" << std::endl;
+    std::cout << "Load (" << (loadMode == opat::LoadMode::Lazy ? "lazy" : "eager") << "): " << toMs(loadEnd - loadStart) << " ms";
+    if (needsLattice) {
+        std::cout << ", lattice build: " << toMs(latticeEnd - latticeStart) << " ms";
+    }
+    std::cout << std::endl;
+    std::cout << "Replay: " << replaySeconds * 1000.0 << " ms, "
+              << (replaySeconds > 0 ? static_cast<double>(completed) / replaySeconds : 0.0) << " queries/s, "
+              << merged.failures << " failed" << std::endl;
+    report("card", merged.cardLatencies);
+    report("lattice", merged.latticeLatencies);
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <cxxopts.hpp>
+#include <csignal>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include "opatIO.h"
+#include "serveProtocol.h"
+#include "serveServer.h"
+
+int main(int argc, char* argv[]) {
+    /**
+     * @brief Entry point for the OPAT query daemon.
+     *
+     * opatServe keeps one or more OPAT files (and, once used, their lattices) resident and answers
+     * batched card lookups and interpolations over a Unix domain socket. Clients connect with
+     * `opat::serve::Client` (serveClient.h) or the C API in serveClientC.h.
+     *
+     * Command-line options:
+     * - `-f` or `--file`: Path to an OPAT file to serve. May be repeated; file IDs follow the order given.
+     * - `-s` or `--socket`: Path of the Unix socket to listen on (default `$XDG_RUNTIME_DIR/opatServe.sock`,
+     *   or `/tmp/opatServe.sock`).
+     * - `-l` or `--lazy`: Read cards on first access instead of at startup.
+     *
+     * The daemon runs until it receives SIGINT or SIGTERM, at which point it closes open connections
+     * and removes its socket file.
+     *
+     * @param argc Number of command-line arguments.
+     * @param argv Array of command-line argument strings.
+     * @return int Exit code (0 for success, non-zero for errors).
+     */
+    cxxopts::Options options("OpatIO Query Server", "Serve OPAT card lookups and interpolations over a Unix socket");
+
+    options.add_options()
+    ("f,file", "File name (may be repeated)", cxxopts::value<std::vector<std::string>>())
+    ("s,socket", "Unix socket path", cxxopts::value<std::string>()->default_value(opat::serve::defaultSocketPath()))
+    ("l,lazy", "Read cards on first access instead of at startup");
+
+    auto result = options.parse(argc, argv);
+
+    if (!result.count("file")) {
+        std::cout << "No file path provided (Note that you must provide file paths as flags, i.e. opatServe -f <path/to/file> [-f <path/to/other/file>])..." << std::endl;
+        return 1;
+    }
+
+    const std::vector<std::string> filePaths = result["file"].as<std::vector<std::string>>();
+    for (const auto& filePath : filePaths) {
+        if (!std::filesystem::is_regular_file(filePath)) {
+            throw std::invalid_argument("The file path provided does not exist or is not a regular file: " + filePath);
+        }
+    }
+    const std::string socketPath = result["socket"].as<std::string>();
+    const opat::LoadMode loadMode = result.count("lazy") ? opat::LoadMode::Lazy : opat::LoadMode::Eager;
+
+    // Block the shutdown signals before any thread is started so that only the waiter below receives them
+    sigset_t shutdownSignals;
+    sigemptyset(&shutdownSignals);
+    sigaddset(&shutdownSignals, SIGINT);
+    sigaddset(&shutdownSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &shutdownSignals, nullptr);
+
+    opat::serve::Server server(filePaths, loadMode);
+    server.listen(socketPath);
+    for (std::size_t fileID = 0; fileID < filePaths.size(); ++fileID) {
+        std::cout << "[" << fileID << "] " << filePaths[fileID] << std::endl;
+    }
+    std::cout << "Listening on " << socketPath << std::endl;
+
+    std::thread signalWaiter([&] {
+        int signal = 0;
+        sigwait(&shutdownSignals, &signal);
+        server.stop();
+    });
+
+    try {
+        server.run();
+    } catch (const std::exception& e) {
+        // The server could no longer accept connections; wake the signal waiter so that it can be joined
+        pthread_kill(signalWaiter.native_handle(), SIGTERM);
+        signalWaiter.join();
+        std::cout << "Could not serve: " << e.what() << std::endl;
+        return 1;
+    }
+    // run() only returns after stop(), which only the signal waiter calls
+    signalWaiter.join();
+    std::cout << "Shutting down" << std::endl;
+    return 0;
+}
@@ -3,8 +3,10 @@
 #include <string>
 #include <filesystem>
 #include <stdexcept>
+#include <vector>
 
 #include "opatIO.h"
+#include "sha256.h"
 
 int main(int argc, char* argv[]) {
     /**
@@ -18,10 +20,12 @@ int main(int argc, char* argv[]) {
      * 1. Parse command-line arguments to retrieve the file path.
      * 2. Check if the file path exists and is a regular file.
      * 3. Attempt to read the file as an OPAT file using the opatIO library.
-     * 4. Print the result of the validation to the console.
+     * 4. Optionally, check the SHA-256 digest of every card against the card catalog.
+     * 5. Print the result of the validation to the console.
      *
      * Command-line arguments:
      * - `--file` or `-f`: Specifies the path to the file to be validated.
+     * - `--sha256` or `-s`: Also checks the card digests, on the fastest SHA-256 backend of this CPU.
      *
      * Error handling:
      * - If the file path does not exist or is not a regular file, an exception is thrown.
@@ -35,7 +39,8 @@ int main(int argc, char* argv[]) {
 
     // Define the command-line options
     options.add_options()
-    ("f,file", "File name", cxxopts::value<std::string>());
+    ("f,file", "File name", cxxopts::value<std::string>())
+    ("s,sha256", "Also check the SHA-256 digest of every card");
 
     // Parse the command-line arguments
     auto result = options.parse(argc, argv);
@@ -51,6 +56,17 @@ int main(int argc, char* argv[]) {
                     // Attempt to read the file as an OPAT file
                     opat::OPAT opat = opat::readOPAT(filePath);
                     std::cout << "The file is a valid OPAT file." << std::endl;
+                    if (result.count("sha256")) {
+                        const std::vector<FloatIndexVector> mismatched = opat::sha256::verify(opat);
+                        if (mismatched.empty()) {
+                            std::cout << "All card digests match (" << opat::sha256::name(opat::sha256::fastest()) << ")." << std::endl;
+                        } else {
+                            std::cout << mismatched.size() << " card digests do not match:" << std::endl;
+                            for (const FloatIndexVector& index : mismatched) {
+                                std::cout << "  " << index << std::endl;
+                            }
+                        }
+                    }
                 } catch (const std::exception &e) {
                     // Handle errors during OPAT file reading
                     std::cout << "The file is not a valid OPAT file: " << e.what() << std::endl;
@@ -30,8 +30,10 @@ class Header(OPATEntity):
         Number of values to use when indexing the table.
     hashPrecision : int
         Precision of the hash.
+    merkleRoot : int
+        Card roots combined with merkle_combine, in the order the cards are stored (0 if any card has none).
     reserved : bytes
-        Reserved for future use (default is 23 null bytes).
+        Reserved for future use (default is 15 null bytes).
     magic : str
         Magic number to identify the file format (default is "OPAT").
 
@@ -56,7 +58,8 @@ class Header(OPATEntity):
     comment: str
     numIndex: int
     hashPrecision: int
-    reserved: bytes = b"\x00"*23
+    merkleRoot: int = 0
+    reserved: bytes = b"\x00"*15
     magic: str = "OPAT"
 
     def set_comment(self, comment: str):
@@ -129,7 +132,7 @@ class Header(OPATEntity):
         >>> header_bytes = bytes(header)
         """
         headerBytes = struct.pack(
-            "<4s H I I Q 16s 64s 128s H B 23s",
+            "<4s H I I Q 16s 64s 128s H B Q 15s",
             self.magic.encode('utf-8'),
             self.version,
             self.numCards,
@@ -140,6 +143,7 @@ class Header(OPATEntity):
             self.comment.encode('utf-8'),
             self.numIndex,
             self.hashPrecision,
+            self.merkleRoot,
             self.reserved
         )
         assert len(headerBytes) == 256, (
@@ -7,6 +7,7 @@ from opatio.index.floatvectorindex import FloatVectorIndex
 from opatio.catalog.entry import CardCatalogEntry
 from opatio.card.datacard import DataCard
 from opatio.card.datacard import OPATTable
+from opatio.misc.misc import merkle_combine
 
 class OPAT():
     """
@@ -226,6 +227,7 @@ class OPAT():
             currentByteStart = currentByteEnd
             self.header.catalogOffset = currentByteStart
         self.header.numCards = len(self.catalog)
+        self.header.merkleRoot = merkle_combine(card.header.merkleRoot for card in self.cards.values())
 
     def pop_card(self, indexVector: Union[FloatVectorIndex, Iterable[float]]) -> DataCard:
         """
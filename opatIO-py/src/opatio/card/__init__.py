@@ -3,12 +3,12 @@ The card subpackage for the opatio library.
 
 This module organizes classes related to the structure and handling
 of individual data cards within an OPAT file. It typically makes
-key classes like DataCard, CardHeader, CardIndexEntry, and OPATTable
+key classes like DataCard, CardHeader, CardIndexEntry, TableStatistics, and OPATTable
 available directly under the 'opatio.card' namespace.
 
 Modules
 -------
 datacard
-    Defines the DataCard, CardHeader, CardIndexEntry, and OPATTable classes
+    Defines the DataCard, CardHeader, CardIndexEntry, TableStatistics, and OPATTable classes
     representing the components of a data card.
 """
\ No newline at end of file
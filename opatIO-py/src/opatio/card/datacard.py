@@ -1,12 +1,14 @@
 from dataclasses import dataclass
 import struct
 import hashlib
+import xxhash
 import numpy as np
 import numpy.typing as npt
 
 from typing import Dict, Iterable, Tuple, Union, List
 
 from opatio.misc.opatentity import OPATEntity
+from opatio.misc.misc import merkle_combine
 
 
 @dataclass
@@ -24,8 +26,13 @@ class CardHeader(OPATEntity):
         Total size of the data card in bytes.
     comment : str
         Comment section of the header.
+    statsOffset : int
+        Offset to the statistics section in bytes, relative to the start of the card (0 if the card has none).
+    merkleRoot : int
+        Checksums of the card's tables combined with merkle_combine, in the order the tables are stored
+        (0 if any table has no checksum).
     reserved : bytes
-        Reserved for future use (default is 100 null bytes).
+        Reserved for future use (default is 84 null bytes).
     magicNumber : str
         Magic number to validate the data card (default is "CARD").
     headerSize : int
@@ -36,7 +43,9 @@ class CardHeader(OPATEntity):
     indexOffset: int
     cardSize: int
     comment: str
-    reserved: bytes = b"\x00"*100
+    statsOffset: int = 0
+    merkleRoot: int = 0
+    reserved: bytes = b"\x00"*84
     magicNumber: str = "CARD"
     headerSize: int = 256
 
@@ -83,13 +92,15 @@ class CardHeader(OPATEntity):
         >>> bytes(header)
         """
         headerBytes = struct.pack(
-            "<4s I I Q Q 128s 100s",
+            "<4s I I Q Q 128s Q Q 84s",
             self.magicNumber.encode('utf-8'),
             self.numTables,
             self.headerSize,
             self.indexOffset,
             self.cardSize,
             self.comment.encode('utf-8'),
+            self.statsOffset,
+            self.merkleRoot,
             self.reserved
         )
         assert len(headerBytes) == 256, f"Header must be 256 bytes. Due to an unknown error the header has {len(headerBytes)} bytes"
@@ -131,6 +142,8 @@ class CardHeader(OPATEntity):
         >> Header Size: 256
         >> Index Offset: 256
         >> Card Size: 512
+        >> Stats Offset: 0
+        >> Merkle Root: 0000000000000000
         >> Comment: Example
         """
         asciiString = f"""========== Card Header ==========
@@ -139,6 +152,8 @@ class CardHeader(OPATEntity):
 >> Header Size: {self.headerSize}
 >> Index Offset: {self.indexOffset}
 >> Card Size: {self.cardSize}
+>> Stats Offset: {self.statsOffset}
+>> Merkle Root: {self.merkleRoot:016x}
 >> Comment: {self.comment}
 """
         return asciiString
@@ -164,6 +179,8 @@ class CardHeader(OPATEntity):
             indexOffset=self.indexOffset,
             cardSize=self.cardSize,
             comment=self.comment,
+            statsOffset=self.statsOffset,
+            merkleRoot=self.merkleRoot,
             reserved=self.reserved
         )
 
@@ -190,8 +207,10 @@ class CardIndexEntry(OPATEntity):
         Name of the row.
     size : int
         Length of the row entry (default is 1). Maximum is 2^64 - 1.
+    checksum : int
+        XXH3-64 checksum of the table (see OPATTable.checksum), or 0 if none is recorded (default is 0).
     reserved : bytes
-        Reserved for future use (default is 12 null bytes).
+        Reserved for future use (default is 4 null bytes).
     """
 
     tag: str
@@ -202,7 +221,8 @@ class CardIndexEntry(OPATEntity):
     columnName: str
     rowName: str
     size: int = 1
-    reserved: bytes = b"\x00"*12
+    checksum: int = 0
+    reserved: bytes = b"\x00"*4
 
     def __bytes__(self) -> bytes:
         """
@@ -226,10 +246,10 @@ class CardIndexEntry(OPATEntity):
         nullPaddedTag = self.tag.ljust(8, '\x00').encode('utf-8')
         nullPaddedColumnName = self.columnName.ljust(8, '\x00').encode('utf-8')
         nullPaddedRowName = self.rowName.ljust(8, '\x00').encode('utf-8')
-        if not self.size.is_integer():
+        if not float(self.size).is_integer():
             raise TypeError(f"Due to an unknown error the size of the index entry is not an integer. The size is {self.size}. This is a opatio bug and should be reported.")
         indexBytes = struct.pack(
-            f"<8s Q Q H H 8s 8s Q 12s",
+            f"<8s Q Q H H 8s 8s Q Q 4s",
             nullPaddedTag,
             self.byteStart,
             self.byteEnd,
@@ -238,6 +258,7 @@ class CardIndexEntry(OPATEntity):
             nullPaddedColumnName,
             nullPaddedRowName,
             int(self.size),
+            self.checksum,
             self.reserved
         )
         assert len(indexBytes) == 64, f"Card index entry must be 64 bytes. Due to an unknown error the card index entry has {len(indexBytes)} bytes"
@@ -302,6 +323,137 @@ class CardIndexEntry(OPATEntity):
             columnName=self.columnName,
             rowName=self.rowName,
             size = self.size,
+            checksum=self.checksum,
+            reserved=self.reserved
+        )
+
+@dataclass
+class TableStatistics(OPATEntity):
+    """
+    Represents the summary statistics of one table, stored in the statistics section of a data card.
+
+    Attributes
+    ----------
+    tag : str
+        Tag of the table the statistics describe.
+    minimum : float
+        Smallest non-NaN value in the table (NaN if the table has none).
+    maximum : float
+        Largest non-NaN value in the table (NaN if the table has none).
+    mean : float
+        Mean of the non-NaN values in the table (NaN if the table has none).
+    nanCount : int
+        Number of NaN values in the table.
+    reserved : bytes
+        Reserved for future use (default is 8 null bytes).
+    """
+
+    tag: str
+    minimum: float
+    maximum: float
+    mean: float
+    nanCount: int
+    reserved: bytes = b"\x00"*8
+
+    @classmethod
+    def from_table(cls, tag: str, table: "OPATTable") -> "TableStatistics":
+        """
+        Compute the statistics of a table.
+
+        Parameters
+        ----------
+        tag : str
+            Tag of the table.
+        table : OPATTable
+            The table to summarize.
+
+        Returns
+        -------
+        TableStatistics
+            The statistics of the table.
+
+        Examples
+        --------
+        >>> table = OPATTable(columnValues=[1.0, 2.0], rowValues=[3.0, 4.0], data=np.array([[5.0, np.nan], [7.0, 8.0]]))
+        >>> TableStatistics.from_table("Example", table)
+        TableStatistics(Tag=Example, minimum=5.0, maximum=8.0, mean=6.666666666666667, nanCount=1)
+        """
+        data = np.asarray(table.data, dtype=np.float64).flatten()
+        nan = np.isnan(data)
+        values = data[~nan]
+        if values.size == 0:
+            return cls(tag=tag, minimum=np.nan, maximum=np.nan, mean=np.nan, nanCount=int(nan.sum()))
+        return cls(
+            tag=tag,
+            minimum=float(values.min()),
+            maximum=float(values.max()),
+            mean=float(values.mean()),
+            nanCount=int(nan.sum())
+        )
+
+    def __bytes__(self) -> bytes:
+        """
+        Convert the table statistics to bytes.
+
+        Returns
+        -------
+        bytes
+            The table statistics as bytes.
+
+        Raises
+        ------
+        AssertionError
+            If the statistics entry size is not 48 bytes.
+        """
+        statsBytes = struct.pack(
+            "<8s d d d Q 8s",
+            self.tag.ljust(8, '\x00').encode('utf-8'),
+            self.minimum,
+            self.maximum,
+            self.mean,
+            self.nanCount,
+            self.reserved
+        )
+        assert len(statsBytes) == 48, f"Table statistics entry must be 48 bytes. Due to an unknown error the entry has {len(statsBytes)} bytes"
+        return statsBytes
+
+    def __repr__(self) -> str:
+        """
+        Get the string representation of the table statistics.
+
+        Returns
+        -------
+        str
+            The string representation.
+        """
+        return f"TableStatistics(Tag={self.tag}, minimum={self.minimum}, maximum={self.maximum}, mean={self.mean}, nanCount={self.nanCount})"
+
+    def ascii(self) -> str:
+        """
+        Get the ASCII representation of the table statistics.
+
+        Returns
+        -------
+        str
+            The ASCII representation.
+        """
+        return f"{self.tag:8} | {self.minimum:12.5e} | {self.maximum:12.5e} | {self.mean:12.5e} | {self.nanCount:8}\n"
+
+    def copy(self):
+        """
+        Create a copy of the table statistics.
+
+        Returns
+        -------
+        TableStatistics
+            A copy of the table statistics.
+        """
+        return TableStatistics(
+            tag=self.tag,
+            minimum=self.minimum,
+            maximum=self.maximum,
+            mean=self.mean,
+            nanCount=self.nanCount,
             reserved=self.reserved
         )
 
@@ -410,6 +562,28 @@ class OPATTable(OPATEntity):
         flatData = self.data.flatten()
         return hashlib.sha256(flatData.tobytes())
 
+    def checksum(self) -> int:
+        """
+        Compute the XXH3-64 checksum stored in the table's index entry.
+
+        The row and column values are hashed together, and that hash seeds the hash of the data,
+        so the checksum covers every byte of the table as written.
+
+        Returns
+        -------
+        int
+            The checksum, as an unsigned 64-bit integer.
+
+        Examples
+        --------
+        >>> table = OPATTable(columnValues=[1.0, 2.0], rowValues=[3.0, 4.0], data=[[5.0, 6.0], [7.0, 8.0]])
+        >>> table.checksum()
+        """
+        tableBytes = bytes(self)
+        axisLength = 8 * (len(self.rowValues) + len(self.columnValues))
+        seed = xxhash.xxh3_64_intdigest(tableBytes[:axisLength])
+        return xxhash.xxh3_64_intdigest(tableBytes[axisLength:], seed=seed)
+
     def __bytes__(self) -> bytes:
         """
         Convert the single OPAT format table to bytes.
@@ -593,6 +767,8 @@ class DataCard(OPATEntity):
         Index of the data card, mapping tags to index entries.
     tables : Dict[str, OPATTable]
         Tables in the data card, mapped by their tags.
+    statistics : Dict[str, TableStatistics]
+        Summary statistics of the tables, mapped by their tags. Written after the index.
 
     Methods
     -------
@@ -617,8 +793,9 @@ class DataCard(OPATEntity):
         self.header = CardHeader(numTables=0, indexOffset=256, cardSize=256, comment="")
         self.index = {}
         self.tables = {}
+        self.statistics = {}
 
-    def add_table(self, tag: str, table: OPATTable, columnName: str = "columnValues", rowName: str = "rowValues"):
+    def add_table(self, tag: str, table: OPATTable, columnName: str = "columnValues", rowName: str = "rowValues", checksum: bool = True):
         """
         Add a table to the data card.
 
@@ -632,6 +809,9 @@ class DataCard(OPATEntity):
             Name of the column (default is "columnValues").
         rowName : str, optional
             Name of the row (default is "rowValues").
+        checksum : bool, optional
+            Record the table's XXH3-64 checksum in its index entry, so that readers verify the table
+            whenever they read it (default is True).
 
         Raises
         ------
@@ -669,11 +849,13 @@ class DataCard(OPATEntity):
             numRows=len(table.rowValues),
             columnName=columnName,
             rowName=rowName,
-            size=table.size
+            size=table.size,
+            checksum=table.checksum() if checksum else 0
         )
 
         # Add the index entry to the data card
         self.index[tag] = index
+        self.statistics[tag] = TableStatistics.from_table(tag, table)
 
         # Update the header information
         self.header.numTables += 1
@@ -682,9 +864,12 @@ class DataCard(OPATEntity):
         for tag in self.tables:
             cardSize += len(self.tables[tag])
             cardSize += len(self.index[tag])
+            cardSize += len(self.statistics[tag])
             indexOffset += len(self.tables[tag])
         self.header.cardSize = cardSize
         self.header.indexOffset = indexOffset
+        self.header.statsOffset = indexOffset + sum(len(entry) for entry in self.index.values())
+        self.header.merkleRoot = merkle_combine(entry.checksum for entry in self.index.values())
 
     def sha256(self) -> bytes:
         """
@@ -710,7 +895,7 @@ class DataCard(OPATEntity):
 
     def __bytes__(self) -> bytes:
         """
-        Convert the entire data card to bytes, including header, tables, and index.
+        Convert the entire data card to bytes, including header, tables, index, and statistics.
 
         Returns
         -------
@@ -727,7 +912,8 @@ class DataCard(OPATEntity):
         headerBytes = bytes(self.header)
         indexBytes = b"".join(bytes(index) for _, index in self.index.items())
         tablesBytes = b"".join(bytes(table) for _, table in self.tables.items())
-        return headerBytes + tablesBytes + indexBytes
+        statsBytes = b"".join(bytes(self.statistics[tag]) for tag in self.index)
+        return headerBytes + tablesBytes + indexBytes + statsBytes
 
     def __getitem__(self, key: str) -> OPATTable:
         """
@@ -808,6 +994,10 @@ class DataCard(OPATEntity):
         for tag, index in self.index.items():
             asciiRepr += index.ascii()
 
+        asciiRepr += "======== Table Statistics ========\n"
+        for tag in self.index:
+            asciiRepr += self.statistics[tag].ascii()
+
         asciiRepr += "========= END Data Card =========\n"
         return asciiRepr
 
@@ -831,6 +1021,7 @@ class DataCard(OPATEntity):
         newCard.header = self.header.copy()
         newCard.index = {tag: index.copy() for tag, index in self.index.items()}
         newCard.tables = {tag: table.copy() for tag, table in self.tables.items()}
+        newCard.statistics = {tag: stats.copy() for tag, stats in self.statistics.items()}
         return newCard
 
     def keys(self) -> List[str]:
@@ -25,6 +25,11 @@ def read_opat(filename: str) -> OPAT:
     OPAT
         The loaded OPAT object.
 
+    Raises
+    ------
+    ValueError
+        If a card or table does not match its checksums, or the cards do not match the file root.
+
     Examples
     --------
     >>> opat = read_opat("example.opat")
@@ -37,7 +42,7 @@ def read_opat(filename: str) -> OPAT:
     opat = OPAT()
     with open(filename, 'rb') as f:
         headerBytes: bytes = f.read(256)
-        unpackedHeader = struct.unpack("<4s H I I Q 16s 64s 128s H B 23s", headerBytes)
+        unpackedHeader = struct.unpack("<4s H I I Q 16s 64s 128s H B Q 15s", headerBytes)
         loadedHeader = Header(
             magic = unpackedHeader[0].decode().replace("\x00", ""),
             version = unpackedHeader[1],
@@ -49,7 +54,8 @@ def read_opat(filename: str) -> OPAT:
             comment = unpackedHeader[7].decode().replace("\x00", ""),
             numIndex = unpackedHeader[8],
             hashPrecision = unpackedHeader[9],
-            reserved = unpackedHeader[10]
+            merkleRoot = unpackedHeader[10],
+            reserved = unpackedHeader[11]
         )
         opat.header = loadedHeader
         f.seek(opat.header.catalogOffset)
@@ -68,8 +74,9 @@ def read_opat(filename: str) -> OPAT:
             )
             tableIndices.append(tableIndexEntry)
         
-        # Read the card tables
-        for entry in tableIndices:
+        # Read the card tables, in the order they are stored so that the file root is recomputed in the same order
+        storedRoot = loadedHeader.merkleRoot
+        for entry in sorted(tableIndices, key=lambda entry: entry.byteStart):
             startByte = entry.byteStart
             endByte = entry.byteEnd
             f.seek(startByte)
@@ -77,6 +84,8 @@ def read_opat(filename: str) -> OPAT:
             card = load_data_card(cardBytes)
             opat.add_card(entry.index, card)
 
+    if storedRoot != 0 and opat.header.merkleRoot != storedRoot:
+        raise ValueError(f"The card roots of {filename} do not match its checksum tree; the file is corrupt.")
     return opat
 
 def load_data_card(b: bytes) -> DataCard:
@@ -93,6 +102,12 @@ def load_data_card(b: bytes) -> DataCard:
     DataCard
         The loaded DataCard object.
 
+    Raises
+    ------
+    ValueError
+        If a table does not match the checksum recorded in its index entry, or the index does not
+        match the card's root.
+
     Examples
     --------
     >>> with open("example.datacard", "rb") as f:
@@ -107,20 +122,22 @@ def load_data_card(b: bytes) -> DataCard:
     used by load_opat.
     """
     newCard = DataCard()
-    headerUnpacked = struct.unpack("<4s I I Q Q 128s 100s", b[:256])
+    headerUnpacked = struct.unpack("<4s I I Q Q 128s Q Q 84s", b[:256])
     header = CardHeader(
         numTables = 0,
         headerSize = headerUnpacked[2],
         indexOffset = headerUnpacked[3],
         cardSize = headerUnpacked[4],
         comment = headerUnpacked[5].decode().replace("\x00", ""),
-        reserved= headerUnpacked[6]
+        statsOffset = headerUnpacked[6],
+        merkleRoot = headerUnpacked[7],
+        reserved= headerUnpacked[8]
     )
     newCard.header = header.copy()
     for indexEntry in range(headerUnpacked[1]):
         startByte = header.indexOffset + indexEntry*64
         indexBytes = b[startByte:startByte+64]
-        unpackedIndexEntry = struct.unpack("<8s Q Q H H 8s 8s Q 12s", indexBytes)
+        unpackedIndexEntry = struct.unpack("<8s Q Q H H 8s 8s Q Q 4s", indexBytes)
 
         tableTag = unpackedIndexEntry[0].decode().replace("\x00", "")
         tableByteStart = unpackedIndexEntry[1]
@@ -130,6 +147,7 @@ def load_data_card(b: bytes) -> DataCard:
         tableColumnName = unpackedIndexEntry[5].decode().replace("\x00", "")
         tableRowName = unpackedIndexEntry[6].decode().replace("\x00", "")
         tableCellVectorSize = unpackedIndexEntry[7]
+        tableChecksum = unpackedIndexEntry[8]
 
         tableBytes = b[tableByteStart:tableByteEnd]
         rawData = struct.unpack(f"<{tableNumRows}d{tableNumColumns}d{tableNumRows*tableNumColumns*tableCellVectorSize}d", tableBytes)
@@ -143,6 +161,11 @@ def load_data_card(b: bytes) -> DataCard:
 
         newTable = OPATTable(rowValues=rowValues, columnValues=columnValues, data=dataArray)
 
-        newCard.add_table(tableTag, newTable, columnName=tableColumnName, rowName=tableRowName)
+        newCard.add_table(tableTag, newTable, columnName=tableColumnName, rowName=tableRowName, checksum=tableChecksum != 0)
+        if tableChecksum != 0 and newCard.index[tableTag].checksum != tableChecksum:
+            raise ValueError(f"Checksum mismatch in table {tableTag}; the file is corrupt.")
+
+    if header.merkleRoot != 0 and newCard.header.merkleRoot != header.merkleRoot:
+        raise ValueError("The card index does not match its checksum tree; the file is corrupt.")
 
     return newCard
@@ -7,8 +7,8 @@ used throughout the opatio package.
 Modules
 -------
 misc
-    Contains miscellaneous utility functions like `is_float_castable` and
-    `print_table_indexes`. 
+    Contains miscellaneous utility functions like `is_float_castable`,
+    `merkle_combine`, and `print_table_indexes`. 
 opatentity
     Defines the base `OPATEntitity` class. This is a base class which just
     enforces that for its children the definition of length is the
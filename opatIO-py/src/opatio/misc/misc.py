@@ -1,4 +1,6 @@
-from typing import List, Any
+import struct
+import xxhash
+from typing import Iterable, List, Any
 
 from opatio.catalog.entry import CardCatalogEntry
 
@@ -30,6 +32,37 @@ def is_float_castable(value: Any) -> bool:
         return False
 
 
+def merkle_combine(children: Iterable[int]) -> int:
+    """
+    Combine the checksums of child nodes of the checksum tree into the checksum of their parent.
+
+    The parent is the XXH3-64 hash of the children packed as consecutive little-endian 64-bit integers.
+    Table checksums combine into card roots, and card roots into the file root, both in the order the
+    tables and cards are stored.
+
+    Parameters
+    ----------
+    children : Iterable[int]
+        The checksums of the children, in the order they are stored.
+
+    Returns
+    -------
+    int
+        The checksum of the parent, or 0 if there are no children or any child is 0 (not recorded).
+
+    Examples
+    --------
+    >>> merkle_combine([1, 2, 3]) == merkle_combine([3, 2, 1])
+    False
+    >>> merkle_combine([1, 0])
+    0
+    """
+    children = list(children)
+    if not children or 0 in children:
+        return 0
+    return xxhash.xxh3_64_intdigest(struct.pack(f"<{len(children)}Q", *children))
+
+
 def print_table_indexes(table_indexes: List[CardCatalogEntry]) -> str:
     """
     Generate a formatted string representation of table indexes.
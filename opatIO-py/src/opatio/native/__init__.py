@@ -0,0 +1,31 @@
+"""
+The native subpackage for the opatio library.
+
+This module exposes the C++ OPAT reader and TableLattice (libopatio) through the
+``opatio_native`` extension module. Tables are returned as read-only NumPy arrays
+which share memory with the C++ buffers, and lattice queries can be batched by
+passing a 2D NumPy array of points. File semantics are identical to
+``opatio.read_opat``; only the implementation differs.
+
+The extension is built as part of opat-core with
+``meson setup build -Dbuild_python_bindings=true`` (requires the NumPy headers).
+
+Examples
+--------
+>>> import numpy as np
+>>> from opatio.native import read_opat, TableLattice
+>>> opat = read_opat("gs98hz.opat")
+>>> table = opat[(0.35, 0.004)]["data"]
+>>> table.data.shape
+(19, 70)
+>>> lattice = TableLattice(opat)
+>>> lattice.get_batch(np.array([[0.275, 0.07], [0.5, 0.05]]), "data").shape
+(2, 19, 70)
+"""
+try:
+    from opatio_native import Header, OPAT, DataCard, OPATTable, TableLattice, read_opat
+except ImportError as e:
+    raise ImportError(
+        "The native opatio backend (opatio_native) is not installed. Build opat-core with "
+        "'-Dbuild_python_bindings=true' to enable it, or use the pure python opatio.read_opat."
+    ) from e
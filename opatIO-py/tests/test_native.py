@@ -0,0 +1,114 @@
+"""
+Tests for the opatio_native extension (opatIO-cpp/bindings/python).
+
+The extension is imported if it is already installed; otherwise it is built from this
+checkout with meson (``-Dbuild_python_bindings=true``) into a temporary directory. The
+tests are skipped if neither is possible (no meson, or the NumPy headers are missing).
+"""
+import gc
+import importlib
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+import pytest
+
+np = pytest.importorskip("numpy")
+
+REPO_ROOT = Path(__file__).resolve().parents[2]
+EXAMPLE_FILENAME = str(REPO_ROOT / "opatIO-cpp" / "tests" / "gs98hz.opat")
+POINTS = np.array([[0.275, 0.07], [0.5, 0.05], [0.35, 0.004]])
+
+
+@pytest.fixture(scope="module")
+def native(tmp_path_factory):
+    try:
+        return importlib.import_module("opatio_native")
+    except ImportError:
+        pass
+
+    meson = shutil.which("meson")
+    if meson is None:
+        pytest.skip("opatio_native is not installed and meson is not available to build it")
+    build = tmp_path_factory.mktemp("native-build")
+    setup = subprocess.run([meson, "setup", str(build), str(REPO_ROOT), "-Dbuild_python_bindings=true"],
+                           capture_output=True, text=True)
+    if setup.returncode != 0:
+        pytest.skip(f"could not configure opatio_native (is NumPy installed?):\n{setup.stdout[-2000:]}")
+    subprocess.run([meson, "compile", "-C", str(build), "opatio_native"], check=True)
+
+    sys.path.insert(0, str(build / "opatIO-cpp" / "bindings" / "python"))
+    return importlib.import_module("opatio_native")
+
+
+@pytest.fixture(scope="module")
+def opat(native):
+    return native.read_opat(EXAMPLE_FILENAME)
+
+
+@pytest.fixture(scope="module")
+def lattice(native, opat):
+    return native.TableLattice(opat)
+
+
+def test_card_tables(opat):
+    table = opat[(0.35, 0.004)]["data"]
+    assert table.shape == (19, 70)
+    assert table.data.shape == (19, 70)
+    assert table.data.dtype == np.float64
+    assert not table.data.flags.writeable
+    assert table.data[5, 35] == pytest.approx(-0.402)
+    assert table.rowValues.shape == (19,)
+    assert table.columnValues.shape == (70,)
+
+
+def test_get_batch_matches_single_queries(opat, lattice):
+    batch = lattice.get_batch(POINTS, "data")
+    assert batch.shape == (len(POINTS), 19, 70)
+    assert batch.dtype == np.float64
+    for point, interpolated in zip(POINTS, batch):
+        np.testing.assert_array_equal(interpolated, lattice.get(list(point))["data"].data)
+
+    # A catalog point is returned exactly as it is stored
+    np.testing.assert_array_equal(batch[2], opat[(0.35, 0.004)]["data"].data)
+
+
+def test_get_batch_empty(lattice):
+    batch = lattice.get_batch(np.empty((0, 2)), "data")
+    assert batch.shape == (0, 19, 70)
+    assert batch.dtype == np.float64
+
+    with pytest.raises(IndexError):
+        lattice.get_batch(np.empty((0, 2)), "missing")
+    with pytest.raises(ValueError):
+        lattice.get_batch(np.empty((0, 3)), "data")
+    with pytest.raises(ValueError):
+        lattice.get_batch(np.empty(4), "data")
+
+
+def test_header_and_catalog(opat):
+    assert opat.header.numIndex == 2
+    assert opat.header.magic == "OPAT"
+    assert len(opat) == 126
+    assert (0.35, 0.004) in opat
+    assert (0.351, 0.004) not in opat
+    assert opat.index_vectors().shape == (126, 2)
+    assert len(opat.bounds()) == 2
+    assert opat[(0.35, 0.004)].keys() == ["data"]
+    assert "data" in opat[(0.35, 0.004)]
+
+
+def test_views_keep_their_owners_alive(native):
+    # Nothing but the array refers to the table, card or OPAT object once the expression is done
+    data = native.read_opat(EXAMPLE_FILENAME)[(0.35, 0.004)]["data"].data
+    gc.collect()
+    assert not data.flags.owndata
+    assert data[5, 35] == pytest.approx(-0.402)
+
+
+def test_lazy_get_batch_matches_eager(native, lattice):
+    lazy = native.read_opat(EXAMPLE_FILENAME, lazy=True)
+    np.testing.assert_array_equal(native.TableLattice(lazy).get_batch(POINTS, "data"), lattice.get_batch(POINTS, "data"))
+    with pytest.raises(IndexError):
+        native.TableLattice(lazy).get_batch(POINTS, "missing")
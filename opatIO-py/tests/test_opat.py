@@ -0,0 +1,125 @@
+"""
+Tests for the table statistics, table checksums and checksum tree that opatio writes and verifies.
+
+Files are written with OPAT.save into a temporary directory, then read back with read_opat, both
+intact and with single bytes damaged where the readers are expected to notice.
+"""
+import struct
+
+import numpy as np
+import pytest
+from pathlib import Path
+
+from opatio import OPAT, read_opat
+from opatio.card.datacard import TableStatistics
+from opatio.misc.misc import merkle_combine
+
+REPO_ROOT = Path(__file__).resolve().parents[2]
+EXAMPLE_FILENAME = str(REPO_ROOT / "opatIO-cpp" / "tests" / "gs98hz.opat")
+INDEX = (0.1, 0.2)
+OTHER = (0.3, 0.2)
+
+# Byte offsets of fields that are read or damaged below (see Header, CardHeader and CardIndexEntry)
+HEADER_MERKLE_ROOT = struct.calcsize("<4s H I I Q 16s 64s 128s H B")
+CARD_STATS_OFFSET = struct.calcsize("<4s I I Q Q 128s")
+INDEX_ENTRY_CHECKSUM = struct.calcsize("<8s Q Q H H 8s 8s Q")
+
+
+@pytest.fixture
+def filename(tmp_path):
+    opat = OPAT()
+    opat.set_numIndex(2)
+    data = np.arange(6, dtype=np.float64).reshape(3, 2)
+    data[1, 1] = np.nan
+    opat.add_table(INDEX, "data", [10.0, 20.0], [1.0, 2.0, 3.0], data)
+    opat.add_table(OTHER, "data", [10.0, 20.0], [1.0, 2.0, 3.0], data + 1)
+    return opat.save(str(tmp_path / "written.opat"))
+
+
+def damage(filename, position, value=None):
+    """Flips one bit of the byte at `position`, or replaces the bytes there with `value`."""
+    with open(filename, "r+b") as f:
+        f.seek(position)
+        if value is None:
+            value = bytes([f.read(1)[0] ^ 0x10])
+            f.seek(position)
+        f.write(value)
+
+
+def table_position(opat, index, tag="data"):
+    """Absolute offsets of the card at `index` and of the index entry of its table tagged `tag`."""
+    entry = next(entry for entry in opat.catalog.values() if tuple(entry.index) == pytest.approx(index))
+    card = opat[index]
+    return entry.byteStart, entry.byteStart + card.header.indexOffset + 64 * list(card.index).index(tag)
+
+
+def test_statistics_are_written(filename):
+    opat = read_opat(filename)
+    cardStart, _ = table_position(opat, INDEX)
+    card = opat[INDEX]
+
+    # The section follows the card's one index entry
+    with open(filename, "rb") as f:
+        f.seek(cardStart + CARD_STATS_OFFSET)
+        statsOffset, = struct.unpack("<Q", f.read(8))
+        assert statsOffset == card.header.indexOffset + 64
+        f.seek(cardStart + statsOffset)
+        tag, minimum, maximum, mean, nanCount, _ = struct.unpack("<8s d d d Q 8s", f.read(48))
+    assert tag.rstrip(b"\x00") == b"data"
+    assert (minimum, maximum, nanCount) == (0.0, 5.0, 1)
+    assert mean == pytest.approx(np.mean([0.0, 1.0, 2.0, 4.0, 5.0]))
+    assert bytes(card.statistics["data"]) == bytes(TableStatistics.from_table("data", card["data"]))
+
+
+def test_checksums_are_verified(filename):
+    opat = read_opat(filename)
+    card = opat[INDEX]
+    assert card.index["data"].checksum != 0
+    assert card.index["data"].checksum == card["data"].checksum()
+
+    # One bit of one data value
+    cardStart, _ = table_position(opat, INDEX)
+    entry = card.index["data"]
+    damage(filename, cardStart + entry.byteStart + 8 * (entry.numRows + entry.numColumns) + 3)
+    with pytest.raises(ValueError, match="Checksum mismatch"):
+        read_opat(filename)
+
+
+def test_merkle_roots(filename):
+    opat = read_opat(filename)
+    roots = [card.header.merkleRoot for card in opat.cards.values()]
+    assert all(root != 0 for root in roots)
+    assert opat[INDEX].header.merkleRoot == merkle_combine([opat[INDEX].index["data"].checksum])
+    assert opat.header.merkleRoot == merkle_combine(roots)
+    # As computed by opat::merkle::combine, so both writers build the same tree
+    assert merkle_combine([1, 2, 3]) == 0x7C68B4906E7EA780
+
+
+def test_cleared_checksum_rejected(filename):
+    # A table whose checksum is cleared is no longer checked on its own, but its card root no longer matches
+    _, entryStart = table_position(read_opat(filename), INDEX)
+    damage(filename, entryStart + INDEX_ENTRY_CHECKSUM, bytes(8))
+    with pytest.raises(ValueError, match="checksum tree"):
+        read_opat(filename)
+
+
+def test_file_root_rejected(filename):
+    damage(filename, HEADER_MERKLE_ROOT)
+    with pytest.raises(ValueError, match="card roots"):
+        read_opat(filename)
+
+
+def test_file_without_checksums():
+    opat = read_opat(EXAMPLE_FILENAME)
+    card = opat[(0.35, 0.004)]
+    assert opat.header.merkleRoot == 0
+    assert card.header.merkleRoot == 0
+    assert card.index["data"].checksum == 0
+
+
+def test_native_reader_agrees(filename):
+    native = pytest.importorskip("opatio_native")
+    opat = read_opat(filename)
+    nativeOPAT = native.read_opat(filename)
+    assert nativeOPAT.header.merkleRoot == opat.header.merkleRoot
+    np.testing.assert_array_equal(nativeOPAT[INDEX]["data"].data, opat[INDEX]["data"].data)